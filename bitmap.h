@@ -0,0 +1,112 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#ifndef VTENC_BITMAP_H_
+#define VTENC_BITMAP_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bits.h"
+
+/*
+ * Helpers for bitmaps stored as arrays of 64-bit words, where bit `pos` is
+ * bit `pos % 64` of word `pos / 64`. Ranges are half-open, [from, to), and no
+ * word past the one holding bit `to - 1` is ever accessed.
+ */
+
+static inline uint64_t bitmap_count(const uint64_t *words, uint64_t from, uint64_t to)
+{
+  uint64_t i, end, word, count = 0;
+
+  if (from >= to)
+    return 0;
+
+  i = from >> 6;
+  end = (to - 1) >> 6;
+  word = words[i] & (~0ULL << (from & 63));
+
+  while (i < end) {
+    count += bits_count_u64(word);
+    word = words[++i];
+  }
+
+  word &= ~0ULL >> (63 - ((to - 1) & 63));
+
+  return count + bits_count_u64(word);
+}
+
+/* Returns the position of the first set bit in [from, to), or `to` if none */
+static inline uint64_t bitmap_next(const uint64_t *words, uint64_t from, uint64_t to)
+{
+  uint64_t i, end, word, pos;
+
+  if (from >= to)
+    return to;
+
+  i = from >> 6;
+  end = (to - 1) >> 6;
+  word = words[i] & (~0ULL << (from & 63));
+
+  while (word == 0) {
+    if (i == end)
+      return to;
+    word = words[++i];
+  }
+
+  pos = (i << 6) + bits_ctz_u64(word);
+
+  return pos < to ? pos : to;
+}
+
+/* Returns the position of the last set bit in [from, to), or `to` if none */
+static inline uint64_t bitmap_prev(const uint64_t *words, uint64_t from, uint64_t to)
+{
+  uint64_t i, start, word, pos;
+
+  if (from >= to)
+    return to;
+
+  i = (to - 1) >> 6;
+  start = from >> 6;
+  word = words[i] & (~0ULL >> (63 - ((to - 1) & 63)));
+
+  while (word == 0) {
+    if (i == start)
+      return to;
+    word = words[--i];
+  }
+
+  pos = (i << 6) + bits_len_u64(word) - 1;
+
+  return pos >= from ? pos : to;
+}
+
+static inline void bitmap_set(uint64_t *words, uint64_t pos)
+{
+  words[pos >> 6] |= 1ULL << (pos & 63);
+}
+
+static inline void bitmap_set_range(uint64_t *words, uint64_t from, uint64_t to)
+{
+  uint64_t i, end;
+
+  if (from >= to)
+    return;
+
+  i = from >> 6;
+  end = (to - 1) >> 6;
+
+  if (i == end) {
+    words[i] |= (~0ULL << (from & 63)) & (~0ULL >> (63 - ((to - 1) & 63)));
+    return;
+  }
+
+  words[i] |= ~0ULL << (from & 63);
+  memset(words + i + 1, 0xff, (end - i - 1) * sizeof(*words));
+  words[end] |= ~0ULL >> (63 - ((to - 1) & 63));
+}
+
+#endif /* VTENC_BITMAP_H_ */
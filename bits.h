@@ -198,4 +198,27 @@ static inline unsigned int bits_len_u64(uint64_t value)
 #endif
 }
 
+static inline unsigned int bits_count_u64(uint64_t value)
+{
+#ifdef __HAVE_BUILTIN_POPCOUNTLL__
+  return __builtin_popcountll(value);
+#else
+  value = value - ((value >> 1) & 0x5555555555555555ULL);
+  value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+  value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+
+  return (unsigned int)((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* `value` must be non-zero */
+static inline unsigned int bits_ctz_u64(uint64_t value)
+{
+#ifdef __HAVE_BUILTIN_CTZLL__
+  return __builtin_ctzll(value);
+#else
+  return bits_count_u64((value & -value) - 1);
+#endif
+}
+
 #endif /* VTENC_BITS_H_ */
@@ -14,12 +14,18 @@
 #include "internals.h"
 #include "mem.h"
 
+/* Longest prefix of an Elias gamma code for values of up to 64 */
+#define BIT_STREAM_GAMMA_MAX_PREFIX 6
+
 struct bswriter {
   uint64_t      bit_container;
   unsigned int  bit_pos;
   uint8_t       *start_ptr;
   uint8_t       *ptr;
   uint8_t       *end_ptr;
+  const struct vtenc_sink *sink;  /* Where full buffers go, or NULL */
+  size_t        drained;          /* Bytes already handed to `sink` */
+  int           rc;               /* First error found, or VTENC_OK */
 };
 
 static inline size_t bswriter_align_buffer_size(size_t orig_size)
@@ -39,10 +45,49 @@ static inline int bswriter_init(struct bswriter *writer,
   writer->start_ptr = out_buf;
   writer->ptr = writer->start_ptr;
   writer->end_ptr = writer->start_ptr + out_capacity - sizeof(writer->bit_container);
+  writer->sink = NULL;
+  writer->drained = 0;
+  writer->rc = VTENC_OK;
 
   return VTENC_OK;
 }
 
+/*
+ * Makes room in the buffer once it's full. With a sink, the bytes written so
+ * far are handed to it. Otherwise, they are lost and the buffer being too
+ * small is recorded. Either way, writing goes on from the buffer start, as
+ * the bits of the last byte are still in the bit container.
+ */
+static noinline void bswriter_drain(struct bswriter *writer)
+{
+  const size_t n_bytes = writer->ptr - writer->start_ptr;
+
+  if (writer->rc == VTENC_OK) {
+    if (writer->sink == NULL)
+      writer->rc = VTENC_ERR_BUFFER_TOO_SMALL;
+    else if (writer->sink->write(writer->sink->opaque, writer->start_ptr, n_bytes) != 0)
+      writer->rc = VTENC_ERR_SINK;
+  }
+
+  writer->drained += n_bytes;
+  writer->ptr = writer->start_ptr;
+}
+
+/*
+ * Hands the rest of the output to the sink, if any, and returns the first
+ * error found while writing, or VTENC_OK.
+ */
+static inline int bswriter_finish(struct bswriter *writer)
+{
+  const size_t n_bytes = (writer->ptr - writer->start_ptr) + (writer->bit_pos > 0);
+
+  if (writer->rc == VTENC_OK && writer->sink != NULL && n_bytes > 0 &&
+      writer->sink->write(writer->sink->opaque, writer->start_ptr, n_bytes) != 0)
+    writer->rc = VTENC_ERR_SINK;
+
+  return writer->rc;
+}
+
 static inline void bswriter_append(struct bswriter *writer,
   uint64_t value, unsigned int n_bits)
 {
@@ -71,7 +116,9 @@ static inline void bswriter_flush(struct bswriter *writer)
 {
   const unsigned int n_bytes = writer->bit_pos >> 3;
 
-  assert(writer->ptr < writer->end_ptr);
+  if (unlikely(writer->ptr > writer->end_ptr))
+    bswriter_drain(writer);
+
   mem_write_le_u64(writer->ptr, writer->bit_container);
 
   writer->ptr += n_bytes;
@@ -90,7 +137,9 @@ static inline void bswriter_write(struct bswriter *writer,
 
   writer->bit_container |= value << writer->bit_pos;
 
-  assert(writer->ptr < writer->end_ptr);
+  if (unlikely(writer->ptr > writer->end_ptr))
+    bswriter_drain(writer);
+
   mem_write_le_u64(writer->ptr, writer->bit_container);
 
   writer->ptr += n_bytes;
@@ -100,7 +149,25 @@ static inline void bswriter_write(struct bswriter *writer,
 
 static inline size_t bswriter_size(struct bswriter *writer)
 {
-  return (writer->ptr - writer->start_ptr) + (writer->bit_pos > 0);
+  return writer->drained + (writer->ptr - writer->start_ptr) + (writer->bit_pos > 0);
+}
+
+static inline uint64_t bswriter_bits(struct bswriter *writer)
+{
+  return (uint64_t)(writer->drained + (writer->ptr - writer->start_ptr)) * 8 + writer->bit_pos;
+}
+
+/*
+ * Writes the Elias gamma code of `value` (> 0): as many 1s as the number of
+ * bits after its leading 1, a 0, and then those bits.
+ */
+static inline void bswriter_write_gamma(struct bswriter *writer,
+  unsigned int value)
+{
+  const unsigned int n = bits_len_u32(value) - 1;
+  const uint64_t prefix = BITS_SIZE_MASK[n];
+
+  bswriter_write(writer, prefix | ((uint64_t)(value - (1U << n)) << (n + 1)), 2 * n + 1);
 }
 
 struct bsreader {
@@ -121,7 +188,7 @@ static inline void bsreader_init(struct bsreader *reader,
   reader->end_ptr = reader->start_ptr + buf_len;
 }
 
-static inline uint64_t bsreader_read(
+static __always_inline uint64_t bsreader_read(
   struct bsreader *reader,
   unsigned int n_bits)
 {
@@ -154,6 +221,118 @@ static inline uint64_t bsreader_read(
   return value;
 }
 
+/*
+ * Skips `n_bits` bits with no reading. Returns VTENC_ERR_WRONG_FORMAT if there
+ * aren't as many left.
+ */
+static inline int bsreader_skip(struct bsreader *reader, uint64_t n_bits)
+{
+  const size_t bytes_left = reader->ptr < reader->end_ptr ? reader->end_ptr - reader->ptr : 0;
+
+  if (n_bits + reader->bit_pos > (uint64_t)bytes_left * 8) return VTENC_ERR_WRONG_FORMAT;
+
+  reader->ptr += (reader->bit_pos + n_bits) >> 3;
+  reader->bit_pos = (reader->bit_pos + n_bits) & 7;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads `n_bits` bits, up to 64, or returns VTENC_ERR_WRONG_FORMAT if there
+ * aren't as many left.
+ */
+static inline int bsreader_read_bits(struct bsreader *reader,
+  unsigned int n_bits, uint64_t *value)
+{
+  struct bsreader end = *reader;
+  uint64_t lower = 0;
+  unsigned int shift = 0;
+
+  return_if_error(bsreader_skip(&end, n_bits));
+
+  if (n_bits > BIT_STREAM_MAX_READ) {
+    lower = bsreader_read(reader, BIT_STREAM_MAX_READ);
+    shift = BIT_STREAM_MAX_READ;
+    n_bits -= BIT_STREAM_MAX_READ;
+  }
+
+  *value = n_bits > 0 ? lower | (bsreader_read(reader, n_bits) << shift) : lower;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads an Elias gamma code, as bswriter_write_gamma() writes it. Returns
+ * VTENC_ERR_WRONG_FORMAT if it's cut short, or its prefix is longer than
+ * BIT_STREAM_GAMMA_MAX_PREFIX.
+ */
+static inline int bsreader_read_gamma(struct bsreader *reader,
+  unsigned int *value)
+{
+  uint64_t bit, rest;
+  unsigned int n = 0;
+
+  for (;;) {
+    return_if_error(bsreader_read_bits(reader, 1, &bit));
+
+    if (!bit)
+      break;
+
+    if (++n > BIT_STREAM_GAMMA_MAX_PREFIX)
+      return VTENC_ERR_WRONG_FORMAT;
+  }
+
+  return_if_error(bsreader_read_bits(reader, n, &rest));
+
+  *value = (1U << n) | (unsigned int)rest;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads the width of the values of a stream encoded with `detect_width`, in as
+ * many bits as `max_width` takes. Returns VTENC_ERR_WRONG_FORMAT if it's
+ * greater than `max_width`.
+ */
+static inline int bsreader_read_width(struct bsreader *reader,
+  unsigned int max_width, unsigned int *width)
+{
+  uint64_t value;
+
+  return_if_error(bsreader_read_bits(reader, bits_len_u32(max_width), &value));
+
+  if (value > max_width) return VTENC_ERR_WRONG_FORMAT;
+
+  *width = (unsigned int)value;
+
+  return VTENC_OK;
+}
+
+/*
+ * With path compression, the values of a cluster at level `*bit_pos` that all
+ * have the same bit there, 1 if `ones` or 0 otherwise, are followed by the
+ * number of bits they have in common from there on, as an Elias gamma code,
+ * and all those bits but the first one. Reads them, and returns them at their
+ * positions in `common_bits`, with `*bit_pos` lowered past them.
+ */
+static inline int bsreader_read_common_bits(struct bsreader *reader, int ones,
+  unsigned int *bit_pos, uint64_t *common_bits)
+{
+  unsigned int n_common;
+  uint64_t lower_bits;
+
+  return_if_error(bsreader_read_gamma(reader, &n_common));
+
+  if (n_common > *bit_pos) return VTENC_ERR_WRONG_FORMAT;
+
+  return_if_error(bsreader_read_bits(reader, n_common - 1, &lower_bits));
+
+  *bit_pos -= n_common;
+  *common_bits = (((uint64_t)(ones != 0) << (n_common - 1)) | lower_bits) << *bit_pos;
+
+  return VTENC_OK;
+}
+
 static inline size_t bsreader_size(struct bsreader *reader)
 {
   return (reader->ptr - reader->start_ptr) + (reader->bit_pos >> 3) + ((reader->bit_pos & 7) > 0);
@@ -8,6 +8,14 @@
 
 #include "internals.h"
 
+static void set_min_cluster_lengths(vtenc *handler,
+  const size_t *lengths, size_t lengths_len)
+{
+  for (size_t i = 0; i < VTENC_TREE_LEVELS; i++) {
+    handler->params.min_cluster_length[i] = lengths[MIN(i, lengths_len - 1)];
+  }
+}
+
 vtenc *vtenc_create(void)
 {
   vtenc *handler;
@@ -17,7 +25,16 @@ vtenc *vtenc_create(void)
   if (handler) {
     handler->params.allow_repeated_values = 1;
     handler->params.skip_full_subtrees = 1;
-    handler->params.min_cluster_length = 1;
+    set_min_cluster_lengths(handler, &(size_t){1}, 1);
+    handler->params.run_length_encoding = 0;
+    handler->params.optimal_leaves = 0;
+    handler->params.split_penalty = 0;
+    handler->params.width = 64;
+    handler->params.detect_width = 0;
+    handler->params.path_compression = 0;
+    handler->params.base = 0;
+    handler->params.frame_of_reference = 0;
+    handler->params.strict = 0;
     handler->out_size = 0;
   }
 
@@ -49,7 +66,55 @@ int vtenc_config(vtenc *handler, int op, ...)
       break;
     }
     case VTENC_CONFIG_MIN_CLUSTER_LENGTH: {
-      handler->params.min_cluster_length = va_arg(ap, size_t);
+      set_min_cluster_lengths(handler, &(size_t){va_arg(ap, size_t)}, 1);
+      break;
+    }
+    case VTENC_CONFIG_MIN_CLUSTER_LENGTHS: {
+      const size_t *lengths = va_arg(ap, const size_t *);
+      size_t lengths_len = va_arg(ap, size_t);
+
+      if (lengths == NULL || lengths_len == 0) {
+        rc = VTENC_ERR_CONFIG;
+        break;
+      }
+
+      set_min_cluster_lengths(handler, lengths, lengths_len);
+      break;
+    }
+    case VTENC_CONFIG_RUN_LENGTH_ENCODING: {
+      handler->params.run_length_encoding = va_arg(ap, int);
+      break;
+    }
+    case VTENC_CONFIG_OPTIMAL_LEAVES: {
+      handler->params.optimal_leaves = va_arg(ap, int);
+      break;
+    }
+    case VTENC_CONFIG_SPLIT_PENALTY: {
+      handler->params.split_penalty = va_arg(ap, size_t);
+      break;
+    }
+    case VTENC_CONFIG_WIDTH: {
+      handler->params.width = va_arg(ap, unsigned int);
+      break;
+    }
+    case VTENC_CONFIG_DETECT_WIDTH: {
+      handler->params.detect_width = va_arg(ap, int);
+      break;
+    }
+    case VTENC_CONFIG_PATH_COMPRESSION: {
+      handler->params.path_compression = va_arg(ap, int);
+      break;
+    }
+    case VTENC_CONFIG_BASE: {
+      handler->params.base = va_arg(ap, uint64_t);
+      break;
+    }
+    case VTENC_CONFIG_FRAME_OF_REFERENCE: {
+      handler->params.frame_of_reference = va_arg(ap, int);
+      break;
+    }
+    case VTENC_CONFIG_STRICT: {
+      handler->params.strict = va_arg(ap, int);
       break;
     }
     default: {
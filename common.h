@@ -13,7 +13,13 @@
 
 static inline unsigned int is_full_subtree(size_t values_len, unsigned int bit_pos)
 {
-  return ((uint64_t)values_len == BITS_POS_MASK64[bit_pos]);
+  return bit_pos < 64 && ((uint64_t)values_len == BITS_POS_MASK64[bit_pos]);
+}
+
+/* Returns the number of bits needed to represent `value`, 0 being 0 bits long */
+static inline unsigned int value_width(uint64_t value)
+{
+  return value ? bits_len_u64(value) : 0;
 }
 
 #endif /* VTENC_COMMON_H_ */
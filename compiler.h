@@ -22,9 +22,34 @@
 #if GCC_VERSION >= 40000
 #define __HAVE_BUILTIN_CLZ__
 #define __HAVE_BUILTIN_CLZLL__
+#define __HAVE_BUILTIN_CTZLL__
+#endif
+
+#if GCC_VERSION >= 30400
+#define __HAVE_BUILTIN_POPCOUNTLL__
 #endif
 
 #define likely(x)  __builtin_expect(!!(x), 1)
 #define unlikely(x)  __builtin_expect(!!(x), 0)
 
+#define noinline  __attribute__((__noinline__))
+#ifndef __always_inline
+#define __always_inline  inline __attribute__((__always_inline__))
+#endif
+
+/*
+ * Atomic accesses to an int shared between threads. Whatever a thread writes
+ * before a release store, or a successful compare and swap, is seen by the
+ * thread whose acquire load, or compare and swap, reads the value stored.
+ */
+#define atomic_load_acquire(ptr)  __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define atomic_store_release(ptr, value)  __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/* Sets `*ptr` to `desired` if it's `expected`, and returns 1 if it did */
+static inline int atomic_cas(int *ptr, int expected, int desired)
+{
+  return __atomic_compare_exchange_n(ptr, &expected, desired, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
 #endif /* VTENC_COMPILER_H_ */
@@ -8,51 +8,81 @@
 
 #include "bits.h"
 
-#define BINSEARCH                                             \
-do {                                                          \
-  size_t half;                                                \
-                                                              \
-  if (values_len == 0) return 0;                              \
-                                                              \
-  while (values_len > 1) {                                    \
-    half = values_len >> 1;                                   \
-    base = ((base[half] & mask) == 0) ? &base[half] : base;   \
-    values_len -= half;                                       \
-  }                                                           \
-                                                              \
-  return ((*base & mask) == 0) + base - values;               \
+/*
+ * Binary search for the number of values whose bit at `bit_pos` is 0, once
+ * `offset` is subtracted from them. Values are `stride` elements apart, and
+ * minus `offset`, they must be sorted and have the same bits above `bit_pos`.
+ *
+ * The strided functions are always inlined, so that the functions with no
+ * stride or offset are copies of their own with neither of them.
+ */
+#define BINSEARCH                                                   \
+do {                                                                \
+  size_t lo = 0;                                                    \
+  size_t half;                                                      \
+                                                                    \
+  if (values_len == 0) return 0;                                    \
+                                                                    \
+  while (values_len > 1) {                                          \
+    half = values_len >> 1;                                         \
+    if (((values[(lo + half) * stride] - offset) & mask) == 0)      \
+      lo += half;                                                   \
+    values_len -= half;                                             \
+  }                                                                 \
+                                                                    \
+  return (((values[lo * stride] - offset) & mask) == 0) + lo;       \
 } while (0)
 
-static inline size_t count_zeros_at_bit_pos8(const uint8_t *values,
-  size_t values_len, unsigned int bit_pos)
+static __always_inline size_t count_zeros_at_bit_pos_strided8(const uint8_t *values,
+  size_t values_len, size_t stride, unsigned int bit_pos, uint8_t offset)
 {
   const uint8_t mask = BITS_POS_MASK8[bit_pos];
-  const uint8_t *base = values;
   BINSEARCH;
 }
 
-static inline size_t count_zeros_at_bit_pos16(const uint16_t *values,
+static inline size_t count_zeros_at_bit_pos8(const uint8_t *values,
   size_t values_len, unsigned int bit_pos)
+{
+  return count_zeros_at_bit_pos_strided8(values, values_len, 1, bit_pos, 0);
+}
+
+static __always_inline size_t count_zeros_at_bit_pos_strided16(const uint16_t *values,
+  size_t values_len, size_t stride, unsigned int bit_pos, uint16_t offset)
 {
   const uint16_t mask = BITS_POS_MASK16[bit_pos];
-  const uint16_t *base = values;
   BINSEARCH;
 }
 
-static inline size_t count_zeros_at_bit_pos32(const uint32_t *values,
+static inline size_t count_zeros_at_bit_pos16(const uint16_t *values,
   size_t values_len, unsigned int bit_pos)
+{
+  return count_zeros_at_bit_pos_strided16(values, values_len, 1, bit_pos, 0);
+}
+
+static __always_inline size_t count_zeros_at_bit_pos_strided32(const uint32_t *values,
+  size_t values_len, size_t stride, unsigned int bit_pos, uint32_t offset)
 {
   const uint32_t mask = BITS_POS_MASK32[bit_pos];
-  const uint32_t *base = values;
   BINSEARCH;
 }
 
-static inline size_t count_zeros_at_bit_pos64(const uint64_t *values,
+static inline size_t count_zeros_at_bit_pos32(const uint32_t *values,
   size_t values_len, unsigned int bit_pos)
+{
+  return count_zeros_at_bit_pos_strided32(values, values_len, 1, bit_pos, 0);
+}
+
+static __always_inline size_t count_zeros_at_bit_pos_strided64(const uint64_t *values,
+  size_t values_len, size_t stride, unsigned int bit_pos, uint64_t offset)
 {
   const uint64_t mask = BITS_POS_MASK64[bit_pos];
-  const uint64_t *base = values;
   BINSEARCH;
 }
 
+static inline size_t count_zeros_at_bit_pos64(const uint64_t *values,
+  size_t values_len, unsigned int bit_pos)
+{
+  return count_zeros_at_bit_pos_strided64(values, values_len, 1, bit_pos, 0);
+}
+
 #endif /* VTENC_COUNTBITS_H_ */
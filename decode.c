@@ -3,11 +3,27 @@
   Licensed under the MIT License.
   See LICENSE file in the project root for full license information.
  */
+#include <string.h>
+
+#include "bitstream.h"
 #include "internals.h"
 #include "stack.h"
 
 #define DEC_STACK_MAX_SIZE 64
 
+/* Maximum depth of the histograms, whose number of buckets is 2^depth */
+#define DEC_HISTOGRAM_MAX_DEPTH 32
+
+/* What a traversal of the bit cluster tree does with the values it decodes */
+#define DEC_MODE_VALUES     0
+#define DEC_MODE_BITMAP     1
+#define DEC_MODE_CONVERTED  2
+#define DEC_MODE_WINDOW     3
+#define DEC_MODE_COUNTS     4
+#define DEC_MODE_PROBES     5
+#define DEC_MODE_SAMPLES    6
+#define DEC_MODE_PLAIN      7   /* As DEC_MODE_VALUES, for plain lists only */
+
 struct dec_bit_cluster {
   size_t        from;
   size_t        length;
@@ -17,6 +33,112 @@ struct dec_bit_cluster {
 
 CREATE_STACK(dec_stack, struct dec_bit_cluster, DEC_STACK_MAX_SIZE)
 
+/*
+ * Stores `length` values into an output of another width than the encoded
+ * one, from position `from` on. `value` is an expression of the index `i`
+ * within the stored values, and every case gets its own loop, so that the
+ * output type is known at compile time.
+ */
+#define DEC_CONVERTED_LOOP(type, ctx, from, length, value) \
+do {                                                      \
+  type *out_values = (type *)(ctx)->out + (from);         \
+  for (size_t i = 0; i < (length); ++i)                   \
+    out_values[i] = (type)(value);                        \
+} while(0)
+
+#define DEC_CONVERTED_STORE(ctx, from, length, value)                         \
+do {                                                                          \
+  switch ((ctx)->out_size) {                                                  \
+    case 1:                                                                   \
+      DEC_CONVERTED_LOOP(uint8_t, ctx, from, length, value);                  \
+      break;                                                                  \
+    case 2:                                                                   \
+      DEC_CONVERTED_LOOP(uint16_t, ctx, from, length, value);                 \
+      break;                                                                  \
+    case 4:                                                                   \
+      DEC_CONVERTED_LOOP(uint32_t, ctx, from, length, value);                 \
+      break;                                                                  \
+    default:                                                                  \
+      DEC_CONVERTED_LOOP(uint64_t, ctx, from, length, value);                 \
+      break;                                                                  \
+  }                                                                           \
+} while(0)
+
+/* Loads the value at position `pos` of an output of `out_size` bytes per value */
+static inline uint64_t dec_load_converted(const void *out, unsigned int out_size,
+  size_t pos)
+{
+  switch (out_size) {
+    case 1: return ((const uint8_t *)out)[pos];
+    case 2: return ((const uint16_t *)out)[pos];
+    case 4: return ((const uint32_t *)out)[pos];
+    default: return ((const uint64_t *)out)[pos];
+  }
+}
+
+/* Next number of a SplitMix64 generator, which drives vtenc_sample*() */
+static inline uint64_t dec_rand(uint64_t *state)
+{
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+}
+
+/*
+ * Uniform random number below `n`, which must be greater than 0. With 128-bit
+ * integers, it's the higher half of a random number times `n`, which only
+ * needs a division for the few products whose lower half falls in the biased
+ * range.
+ */
+static inline uint64_t dec_rand_below(uint64_t *state, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 m = (unsigned __int128)dec_rand(state) * n;
+
+  if ((uint64_t)m < n) {
+    const uint64_t threshold = -n % n;
+
+    while ((uint64_t)m < threshold)
+      m = (unsigned __int128)dec_rand(state) * n;
+  }
+
+  return (uint64_t)(m >> 64);
+#else
+  const uint64_t threshold = -n % n;
+  uint64_t r;
+
+  do {
+    r = dec_rand(state);
+  } while (r < threshold);
+
+  return r % n;
+#endif
+}
+
+/*
+ * Splits `n_samples` samples of `length` values between the first `n_zeros`
+ * values and the rest, by drawing them one by one as out of an urn. Returns
+ * how many of them are among the first `n_zeros` values.
+ */
+static inline size_t dec_split_samples(uint64_t *state, size_t n_samples,
+  size_t length, size_t n_zeros)
+{
+  size_t zeros_samples = 0;
+
+  if (n_samples == length || n_zeros == 0 || n_zeros == length)
+    return n_zeros == 0 ? 0 : (n_samples == length ? n_zeros : n_samples);
+
+  for (size_t i = 0; i < n_samples; i++) {
+    if (dec_rand_below(state, length - i) < n_zeros - zeros_samples)
+      zeros_samples++;
+  }
+
+  return zeros_samples;
+}
+
 #define LIST_MAX_VALUES VTENC_LIST_MAX_VALUES
 
 #define TYPE uint8_t
@@ -6,6 +6,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "bitmap.h"
 #include "bitstream.h"
 #include "common.h"
 #include "internals.h"
@@ -14,10 +15,16 @@
 #define decctx decctx_(BITWIDTH)
 #define decctx_init_(_width_) BITWIDTH_SUFFIX(decctx_init, _width_)
 #define decctx_init decctx_init_(BITWIDTH)
+#define decctx_set_output_(_width_) BITWIDTH_SUFFIX(decctx_set_output, _width_)
+#define decctx_set_output decctx_set_output_(BITWIDTH)
+#define decctx_set_window_(_width_) BITWIDTH_SUFFIX(decctx_set_window, _width_)
+#define decctx_set_window decctx_set_window_(BITWIDTH)
 #define decode_lower_bits_step_(_width_) BITWIDTH_SUFFIX(decode_lower_bits_step, _width_)
 #define decode_lower_bits_step decode_lower_bits_step_(BITWIDTH)
 #define decode_lower_bits_(_width_) BITWIDTH_SUFFIX(decode_lower_bits, _width_)
 #define decode_lower_bits decode_lower_bits_(BITWIDTH)
+#define decode_leaf_(_width_) BITWIDTH_SUFFIX(decode_leaf, _width_)
+#define decode_leaf decode_leaf_(BITWIDTH)
 #define decode_full_subtree_(_width_) BITWIDTH_SUFFIX(decode_full_subtree, _width_)
 #define decode_full_subtree decode_full_subtree_(BITWIDTH)
 #define bcltree_add_(_width_) BITWIDTH_SUFFIX(bcltree_add, _width_)
@@ -26,25 +33,159 @@
 #define bcltree_has_more bcltree_has_more_(BITWIDTH)
 #define bcltree_next_(_width_) BITWIDTH_SUFFIX(bcltree_next, _width_)
 #define bcltree_next bcltree_next_(BITWIDTH)
+#define decode_base_(_width_) BITWIDTH_SUFFIX(decode_base, _width_)
+#define decode_base decode_base_(BITWIDTH)
+#define decode_width_(_width_) BITWIDTH_SUFFIX(decode_width, _width_)
+#define decode_width decode_width_(BITWIDTH)
+#define decode_tree_(_width_) BITWIDTH_SUFFIX(decode_tree, _width_)
+#define decode_tree decode_tree_(BITWIDTH)
+#define decode_sample_tree_(_width_) BITWIDTH_SUFFIX(decode_sample_tree, _width_)
+#define decode_sample_tree decode_sample_tree_(BITWIDTH)
+#define decode_plain_tree_(_width_) BITWIDTH_SUFFIX(decode_plain_tree, _width_)
+#define decode_plain_tree decode_plain_tree_(BITWIDTH)
 #define decode_bit_cluster_tree_(_width_) BITWIDTH_SUFFIX(decode_bit_cluster_tree, _width_)
 #define decode_bit_cluster_tree decode_bit_cluster_tree_(BITWIDTH)
+#define decode_small_tree_(_width_) BITWIDTH_SUFFIX(decode_small_tree, _width_)
+#define decode_small_tree decode_small_tree_(BITWIDTH)
+#define decode_small_converted_(_width_) BITWIDTH_SUFFIX(decode_small_converted, _width_)
+#define decode_small_converted decode_small_converted_(BITWIDTH)
+#define fill_values_(_width_) BITWIDTH_SUFFIX(fill_values, _width_)
+#define fill_values fill_values_(BITWIDTH)
+#define decode_bitmap_leaf_(_width_) BITWIDTH_SUFFIX(decode_bitmap_leaf, _width_)
+#define decode_bitmap_leaf decode_bitmap_leaf_(BITWIDTH)
+#define decode_converted_leaf_(_width_) BITWIDTH_SUFFIX(decode_converted_leaf, _width_)
+#define decode_converted_leaf decode_converted_leaf_(BITWIDTH)
+#define output_window_leaf_(_width_) BITWIDTH_SUFFIX(output_window_leaf, _width_)
+#define output_window_leaf output_window_leaf_(BITWIDTH)
+#define count_leaf_(_width_) BITWIDTH_SUFFIX(count_leaf, _width_)
+#define count_leaf count_leaf_(BITWIDTH)
+#define count_range_(_width_) BITWIDTH_SUFFIX(count_range, _width_)
+#define count_range count_range_(BITWIDTH)
+#define probe_range_(_width_) BITWIDTH_SUFFIX(probe_range, _width_)
+#define probe_range probe_range_(BITWIDTH)
+#define probe_leaf_(_width_) BITWIDTH_SUFFIX(probe_leaf, _width_)
+#define probe_leaf probe_leaf_(BITWIDTH)
+#define sample_range_(_width_) BITWIDTH_SUFFIX(sample_range, _width_)
+#define sample_range sample_range_(BITWIDTH)
+#define sample_leaf_(_width_) BITWIDTH_SUFFIX(sample_leaf, _width_)
+#define sample_leaf sample_leaf_(BITWIDTH)
+#define split_samples_(_width_) BITWIDTH_SUFFIX(split_samples, _width_)
+#define split_samples split_samples_(BITWIDTH)
+#define output_leaf_(_width_) BITWIDTH_SUFFIX(output_leaf, _width_)
+#define output_leaf output_leaf_(BITWIDTH)
+#define output_full_subtree_(_width_) BITWIDTH_SUFFIX(output_full_subtree, _width_)
+#define output_full_subtree output_full_subtree_(BITWIDTH)
+#define output_repeated_(_width_) BITWIDTH_SUFFIX(output_repeated, _width_)
+#define output_repeated output_repeated_(BITWIDTH)
+#define decode_run_lengths_(_width_) BITWIDTH_SUFFIX(decode_run_lengths, _width_)
+#define decode_run_lengths decode_run_lengths_(BITWIDTH)
+#define decode_run_(_width_) BITWIDTH_SUFFIX(decode_run, _width_)
+#define decode_run decode_run_(BITWIDTH)
+#define decode_prefix_run_lengths_(_width_) BITWIDTH_SUFFIX(decode_prefix_run_lengths, _width_)
+#define decode_prefix_run_lengths decode_prefix_run_lengths_(BITWIDTH)
+#define decode_distinct_len_(_width_) BITWIDTH_SUFFIX(decode_distinct_len, _width_)
+#define decode_distinct_len decode_distinct_len_(BITWIDTH)
+#define count_run_lengths_(_width_) BITWIDTH_SUFFIX(count_run_lengths, _width_)
+#define count_run_lengths count_run_lengths_(BITWIDTH)
+#define find_run_(_width_) BITWIDTH_SUFFIX(find_run, _width_)
+#define find_run find_run_(BITWIDTH)
+#define decode_with_runs_(_width_) BITWIDTH_SUFFIX(decode_with_runs, _width_)
+#define decode_with_runs decode_with_runs_(BITWIDTH)
+#define decode_values_(_width_) BITWIDTH_SUFFIX(decode_values, _width_)
+#define decode_values decode_values_(BITWIDTH)
+#define decode_header_(_width_) BITWIDTH_SUFFIX(decode_header, _width_)
+#define decode_header decode_header_(BITWIDTH)
+#define decode_value_at_(_width_) BITWIDTH_SUFFIX(decode_value_at, _width_)
+#define decode_value_at decode_value_at_(BITWIDTH)
 #define vtenc_decode_(_width_) BITWIDTH_SUFFIX(vtenc_decode, _width_)
 #define vtenc_decode vtenc_decode_(BITWIDTH)
+#define vtenc_decode_strided_(_width_) BITWIDTH_SUFFIX(vtenc_decode_strided, _width_)
+#define vtenc_decode_strided vtenc_decode_strided_(BITWIDTH)
+#define vtenc_decode_to_bitmap_(_width_) BITWIDTH_SUFFIX(vtenc_decode_to_bitmap, _width_)
+#define vtenc_decode_to_bitmap vtenc_decode_to_bitmap_(BITWIDTH)
+#define vtenc_decode_converted_(_width_) BITWIDTH_SUFFIX(vtenc_decode_converted, _width_)
+#define vtenc_decode_converted vtenc_decode_converted_(BITWIDTH)
+#define vtenc_decode_prefix_(_width_) BITWIDTH_SUFFIX(vtenc_decode_prefix, _width_)
+#define vtenc_decode_prefix vtenc_decode_prefix_(BITWIDTH)
+#define vtenc_min_(_width_) BITWIDTH_SUFFIX(vtenc_min, _width_)
+#define vtenc_min vtenc_min_(BITWIDTH)
+#define vtenc_max_(_width_) BITWIDTH_SUFFIX(vtenc_max, _width_)
+#define vtenc_max vtenc_max_(BITWIDTH)
+#define vtenc_histogram_(_width_) BITWIDTH_SUFFIX(vtenc_histogram, _width_)
+#define vtenc_histogram vtenc_histogram_(BITWIDTH)
+#define vtenc_quantile_(_width_) BITWIDTH_SUFFIX(vtenc_quantile, _width_)
+#define vtenc_quantile vtenc_quantile_(BITWIDTH)
+#define vtenc_contains_batch_(_width_) BITWIDTH_SUFFIX(vtenc_contains_batch, _width_)
+#define vtenc_contains_batch vtenc_contains_batch_(BITWIDTH)
+#define vtenc_sample_(_width_) BITWIDTH_SUFFIX(vtenc_sample, _width_)
+#define vtenc_sample vtenc_sample_(BITWIDTH)
 
 struct decctx {
   TYPE              *values;
   size_t            values_len;
+  size_t            stride;
+  uint64_t          *bitmap;
+  uint64_t          bitmap_len;
+  void              *out;
+  unsigned int      out_size;
+  uint64_t          offset;
+  int               windowed;
+  size_t            window_from;
+  size_t            window_to;
+  int               window_stop;
+  size_t            *counts;
+  unsigned int      counts_shift;
+  const TYPE        *probes;
+  size_t            probes_len;
+  size_t            probe_pos;
+  uint64_t          *found;
+  int               sampling;
+  size_t            samples_len;
+  size_t            sample_pos;
+  size_t            cl_samples;
+  size_t            stack_samples[DEC_STACK_MAX_SIZE];
+  uint64_t          rng;
   int               reconstruct_full_subtrees;
-  size_t            min_cluster_length;
+  int               runs;
+  TYPE              base;
+  int               frame_of_reference;
+  unsigned int      width;
+  int               detect_width;
+  int               path_compression;
+  size_t            min_cluster_length[VTENC_TREE_LEVELS];
+  int               uniform_min_cluster_length;
+  int               optimal_leaves;
   struct dec_stack  stack;
   struct bsreader   bits_reader;
 };
 
 static int decctx_init(struct decctx *ctx, const vtenc *dec,
-  const uint8_t *in, size_t in_len, TYPE *out, size_t out_len)
+  const uint8_t *in, size_t in_len, TYPE *out, size_t out_len, size_t stride)
 {
   ctx->values = out;
   ctx->values_len = out_len;
+  ctx->stride = stride;
+  ctx->bitmap = NULL;
+  ctx->bitmap_len = 0;
+  ctx->out = NULL;
+  ctx->out_size = 0;
+  ctx->offset = 0;
+  ctx->windowed = 0;
+  ctx->window_from = 0;
+  ctx->window_to = 0;
+  ctx->window_stop = 0;
+  ctx->counts = NULL;
+  ctx->counts_shift = 0;
+  ctx->probes = NULL;
+  ctx->probes_len = 0;
+  ctx->probe_pos = 0;
+  ctx->found = NULL;
+  ctx->sampling = 0;
+  ctx->samples_len = 0;
+  ctx->sample_pos = 0;
+  ctx->cl_samples = 0;
+  ctx->rng = 0;
+  ctx->runs = 0;
 
   /**
    * `skip_full_subtrees` parameter is only applicable to sets, i.e. sequences
@@ -53,16 +194,76 @@ static int decctx_init(struct decctx *ctx, const vtenc *dec,
   ctx->reconstruct_full_subtrees = !dec->params.allow_repeated_values &&
                                     dec->params.skip_full_subtrees;
 
-  ctx->min_cluster_length = dec->params.min_cluster_length;
+  ctx->base = (TYPE)dec->params.base;
+  ctx->frame_of_reference = dec->params.frame_of_reference;
+  ctx->width = MIN(dec->params.width, BITWIDTH);
+  ctx->detect_width = dec->params.detect_width;
+  ctx->path_compression = dec->params.path_compression;
+
+  /**
+   * With `optimal_leaves`, clusters of length 2 or less are always leaves,
+   * since splitting them never takes fewer bits.
+   */
+  for (unsigned int i = 0; i < VTENC_TREE_LEVELS; i++) {
+    ctx->min_cluster_length[i] = dec->params.optimal_leaves ?
+      MAX(dec->params.min_cluster_length[i], 2) : dec->params.min_cluster_length[i];
+  }
+
+  /**
+   * Lengths are usually the same at all levels, which lets plain traversals
+   * compare them to a single one.
+   */
+  ctx->uniform_min_cluster_length = 1;
+  for (unsigned int i = 1; i <= BITWIDTH; i++) {
+    if (ctx->min_cluster_length[i] != ctx->min_cluster_length[0])
+      ctx->uniform_min_cluster_length = 0;
+  }
+
+  ctx->optimal_leaves = dec->params.optimal_leaves;
 
   dec_stack_init(&ctx->stack);
 
   bsreader_init(&ctx->bits_reader, in, in_len);
 
+  if (dec->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
   return VTENC_OK;
 }
 
-static inline TYPE decode_lower_bits_step(struct decctx *ctx,
+/*
+ * Sets the output of the decoding: `out_len` values of `out_size` bytes, with
+ * `offset` added to each of them. Values of other sizes than `TYPE` are
+ * written through `out` rather than `values`.
+ */
+static void decctx_set_output(struct decctx *ctx, void *out,
+  unsigned int out_size, uint64_t offset)
+{
+  ctx->offset = offset;
+
+  if (out_size != sizeof(TYPE)) {
+    ctx->values = NULL;
+    ctx->out = out;
+    ctx->out_size = out_size;
+  }
+}
+
+/*
+ * Makes the decoding store only the values at positions from `from` to `to`,
+ * to `values`. With `stop`, the decoding ends right after them, as nothing
+ * else is to be read from the stream.
+ */
+static void decctx_set_window(struct decctx *ctx, TYPE *values, size_t from,
+  size_t to, int stop)
+{
+  ctx->values = values;
+  ctx->windowed = 1;
+  ctx->window_from = from;
+  ctx->window_to = to;
+  ctx->window_stop = stop;
+}
+
+static inline TYPE decode_lower_bits_step(struct bsreader *reader,
   unsigned int n_bits)
 {
 #if BITWIDTH > BIT_STREAM_MAX_READ
@@ -70,29 +271,381 @@ static inline TYPE decode_lower_bits_step(struct decctx *ctx,
   unsigned int shift = 0;
 
   if (n_bits > BIT_STREAM_MAX_READ) {
-    value = bsreader_read(&ctx->bits_reader, BIT_STREAM_MAX_READ);
+    value = bsreader_read(reader, BIT_STREAM_MAX_READ);
     shift = BIT_STREAM_MAX_READ;
     n_bits -= BIT_STREAM_MAX_READ;
   }
 
-  return (TYPE)(value | (bsreader_read(&ctx->bits_reader, n_bits) << shift));
+  return (TYPE)(value | (bsreader_read(reader, n_bits) << shift));
 #else
-  return (TYPE)bsreader_read(&ctx->bits_reader, n_bits);
+  return (TYPE)bsreader_read(reader, n_bits);
 #endif
 }
 
-static inline void decode_lower_bits(struct decctx *ctx,
-  TYPE *values, size_t values_len, unsigned int n_bits, TYPE higher_bits)
+static inline void decode_lower_bits(struct decctx *ctx, TYPE *values,
+  size_t values_len, size_t stride, unsigned int n_bits, TYPE higher_bits)
+{
+  for (size_t i = 0; i < values_len; ++i) {
+    values[i * stride] = higher_bits + decode_lower_bits_step(&ctx->bits_reader, n_bits);
+  }
+}
+
+/*
+ * Decodes the lower bits of a leaf cluster. The most common strides get their
+ * own copy of the loop, so that the stride is a compile-time constant.
+ */
+static inline void decode_leaf(struct decctx *ctx, TYPE *values,
+  size_t values_len, unsigned int n_bits, TYPE higher_bits)
+{
+  switch (ctx->stride) {
+    case 1:
+      decode_lower_bits(ctx, values, values_len, 1, n_bits, higher_bits);
+      break;
+    case 2:
+      decode_lower_bits(ctx, values, values_len, 2, n_bits, higher_bits);
+      break;
+    case 3:
+      decode_lower_bits(ctx, values, values_len, 3, n_bits, higher_bits);
+      break;
+    case 4:
+      decode_lower_bits(ctx, values, values_len, 4, n_bits, higher_bits);
+      break;
+    default:
+      decode_lower_bits(ctx, values, values_len, ctx->stride, n_bits, higher_bits);
+      break;
+  }
+}
+
+static inline void decode_full_subtree(TYPE *values, size_t values_len,
+  size_t stride, TYPE higher_bits)
+{
+  for (size_t i = 0; i < values_len; ++i) {
+    values[i * stride] = higher_bits + (TYPE)i;
+  }
+}
+
+static inline void fill_values(TYPE *values, size_t values_len, size_t stride,
+  TYPE value)
 {
   for (size_t i = 0; i < values_len; ++i) {
-    values[i] = higher_bits | decode_lower_bits_step(ctx, n_bits);
+    values[i * stride] = value;
   }
 }
 
-static inline void decode_full_subtree(TYPE *values, size_t values_len, TYPE higher_bits)
+/*
+ * Decoded values are either written to an array, `stride` elements apart, or
+ * set as bits of a bitmap. With a bitmap, runs of consecutive values become
+ * word-level fills, and values that don't fit in it make the decoding fail
+ * with VTENC_ERR_BUFFER_TOO_SMALL.
+ *
+ * Values can also be written to an array of another width, through `out`. The
+ * offset is already in the higher bits of the clusters, so each value is just
+ * truncated to the output width as it's stored.
+ *
+ * With a window, only the values within it are stored, and the lower bits of
+ * leaves out of it are skipped rather than read.
+ *
+ * With `counts`, values aren't stored but counted in buckets of
+ * 2^`counts_shift` values each. Only leaves that span more than one bucket
+ * need their lower bits to be read.
+ *
+ * With `probes`, values are merged with a sorted array of probes instead,
+ * setting the bit of every probe that is found in `found`. Values come in
+ * ascending order, so the probes before `probe_pos` are never looked at again,
+ * and leaves with no probe in their range are skipped.
+ *
+ * With `sampling`, `cl_samples` of the values of every cluster are picked
+ * uniformly at random, and stored from `sample_pos` on, which keeps them in
+ * ascending order. Leaves with no samples are skipped.
+ */
+
+static inline int decode_bitmap_leaf(struct decctx *ctx, size_t values_len,
+  unsigned int n_bits, uint64_t higher_bits)
 {
   for (size_t i = 0; i < values_len; ++i) {
-    values[i] = higher_bits | (TYPE)i;
+    uint64_t value = (TYPE)(higher_bits + decode_lower_bits_step(&ctx->bits_reader, n_bits));
+
+    if (value >= ctx->bitmap_len) return VTENC_ERR_BUFFER_TOO_SMALL;
+
+    bitmap_set(ctx->bitmap, value);
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * The reader is copied to a local variable, as stores to the output may alias
+ * it and it'd need to be reloaded after each of them otherwise.
+ */
+static inline void decode_converted_leaf(struct decctx *ctx, size_t from,
+  size_t length, unsigned int n_bits, uint64_t higher_bits)
+{
+  struct bsreader reader = ctx->bits_reader;
+
+  DEC_CONVERTED_STORE(ctx, from, length,
+    higher_bits + decode_lower_bits_step(&reader, n_bits));
+
+  ctx->bits_reader = reader;
+}
+
+static inline int output_window_leaf(struct decctx *ctx, size_t from,
+  size_t length, unsigned int n_bits, uint64_t higher_bits)
+{
+  const size_t first = MAX(from, ctx->window_from);
+  const size_t last = MIN(from + length, ctx->window_to);
+
+  if (first >= last)
+    return bsreader_skip(&ctx->bits_reader, (uint64_t)length * n_bits);
+
+  return_if_error(bsreader_skip(&ctx->bits_reader, (uint64_t)(first - from) * n_bits));
+
+  decode_leaf(ctx, ctx->values + (first - ctx->window_from) * ctx->stride,
+    last - first, n_bits, higher_bits);
+
+  return bsreader_skip(&ctx->bits_reader, (uint64_t)(from + length - last) * n_bits);
+}
+
+static inline int count_leaf(struct decctx *ctx, size_t length,
+  unsigned int n_bits, uint64_t higher_bits)
+{
+  const unsigned int shift = ctx->counts_shift;
+  const uint64_t first = (TYPE)higher_bits;
+  const uint64_t max_lower = n_bits < 64 ? (1ULL << n_bits) - 1 : ~0ULL;
+  const TYPE max_value = (TYPE)~(TYPE)0;
+  const uint64_t last = first > max_value - max_lower ? max_value : first + max_lower;
+
+  if ((first >> shift) == (last >> shift)) {
+    ctx->counts[first >> shift] += length;
+    return bsreader_skip(&ctx->bits_reader, (uint64_t)length * n_bits);
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    const TYPE value = (TYPE)(higher_bits + decode_lower_bits_step(&ctx->bits_reader, n_bits));
+
+    ctx->counts[value >> shift]++;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Counts the `length` consecutive values from `first` on. As when they're
+ * stored, values wrap around past the largest one of the type.
+ */
+static inline void count_range(struct decctx *ctx, uint64_t first, size_t length)
+{
+  const uint64_t mask = (1ULL << ctx->counts_shift) - 1;
+
+  while (length > 0) {
+    const uint64_t value = (TYPE)first;
+    const size_t n = (size_t)MIN((uint64_t)length, mask - (value & mask) + 1);
+
+    ctx->counts[value >> ctx->counts_shift] += n;
+    first = value + n;
+    length -= n;
+  }
+}
+
+/* Looks for the probes from `first` to `last` in the consecutive values of a cluster */
+static inline void probe_range(struct decctx *ctx, uint64_t first, uint64_t last)
+{
+  const TYPE *probes = ctx->probes;
+  size_t pos = ctx->probe_pos;
+
+  while (pos < ctx->probes_len && probes[pos] < first)
+    pos++;
+
+  while (pos < ctx->probes_len && probes[pos] <= last)
+    bitmap_set(ctx->found, pos++);
+
+  ctx->probe_pos = pos;
+}
+
+static inline int probe_leaf(struct decctx *ctx, size_t length,
+  unsigned int n_bits, uint64_t higher_bits)
+{
+  const TYPE *probes = ctx->probes;
+  const uint64_t first = (TYPE)higher_bits;
+  const uint64_t max_lower = n_bits < 64 ? (1ULL << n_bits) - 1 : ~0ULL;
+  const TYPE max_value = (TYPE)~(TYPE)0;
+  const uint64_t last = first > max_value - max_lower ? max_value : first + max_lower;
+  size_t pos = ctx->probe_pos;
+
+  while (pos < ctx->probes_len && probes[pos] < first)
+    pos++;
+
+  ctx->probe_pos = pos;
+
+  if (pos == ctx->probes_len || probes[pos] > last)
+    return bsreader_skip(&ctx->bits_reader, (uint64_t)length * n_bits);
+
+  for (size_t i = 0; i < length; ++i) {
+    const TYPE value = (TYPE)(higher_bits + decode_lower_bits_step(&ctx->bits_reader, n_bits));
+
+    while (pos < ctx->probes_len && probes[pos] < value)
+      pos++;
+
+    while (pos < ctx->probes_len && probes[pos] == value)
+      bitmap_set(ctx->found, pos++);
+  }
+
+  ctx->probe_pos = pos;
+
+  return VTENC_OK;
+}
+
+/*
+ * Picks `n` of the `length` consecutive values from `first` on, by splitting
+ * them in halves, and the samples between the halves, until every value of a
+ * part is picked.
+ */
+static void sample_range(struct decctx *ctx, uint64_t first, uint64_t length,
+  size_t n)
+{
+  while (n > 0) {
+    const uint64_t half = length / 2;
+    size_t half_n;
+
+    if ((uint64_t)n == length) {
+      decode_full_subtree(ctx->values + ctx->sample_pos, n, 1, first);
+      ctx->sample_pos += n;
+      return;
+    }
+
+    half_n = dec_split_samples(&ctx->rng, n, length, half);
+
+    sample_range(ctx, first, half, half_n);
+
+    first += half;
+    length -= half;
+    n -= half_n;
+  }
+}
+
+/* Picks `cl_samples` values of a leaf, one by one, as in selection sampling */
+static inline int sample_leaf(struct decctx *ctx, size_t length,
+  unsigned int n_bits, uint64_t higher_bits)
+{
+  size_t n = ctx->cl_samples;
+  uint64_t skipped = 0;
+  size_t i = 0;
+
+  for (; n > 0; i++) {
+    if (n < length - i && dec_rand_below(&ctx->rng, length - i) >= n) {
+      skipped += n_bits;
+      continue;
+    }
+
+    return_if_error(bsreader_skip(&ctx->bits_reader, skipped));
+    ctx->values[ctx->sample_pos++] = higher_bits + decode_lower_bits_step(&ctx->bits_reader, n_bits);
+    skipped = 0;
+    n--;
+  }
+
+  return bsreader_skip(&ctx->bits_reader, skipped + (uint64_t)(length - i) * n_bits);
+}
+
+static __always_inline int output_leaf(struct decctx *ctx, const int mode,
+  size_t from, size_t length, unsigned int n_bits, uint64_t higher_bits)
+{
+  switch (mode) {
+    case DEC_MODE_BITMAP:
+      return decode_bitmap_leaf(ctx, length, n_bits, higher_bits);
+    case DEC_MODE_CONVERTED:
+      decode_converted_leaf(ctx, from, length, n_bits, higher_bits);
+      return VTENC_OK;
+    case DEC_MODE_WINDOW:
+      return output_window_leaf(ctx, from, length, n_bits, higher_bits);
+    case DEC_MODE_COUNTS:
+      return count_leaf(ctx, length, n_bits, higher_bits);
+    case DEC_MODE_PROBES:
+      return probe_leaf(ctx, length, n_bits, higher_bits);
+    case DEC_MODE_SAMPLES:
+      return sample_leaf(ctx, length, n_bits, higher_bits);
+    default:
+      decode_leaf(ctx, ctx->values + from * ctx->stride, length, n_bits, higher_bits);
+      return VTENC_OK;
+  }
+}
+
+static __always_inline int output_full_subtree(struct decctx *ctx,
+  const int mode, size_t from, size_t length, uint64_t higher_bits)
+{
+  switch (mode) {
+    case DEC_MODE_BITMAP: {
+      const uint64_t first = (TYPE)higher_bits;
+
+      if (first >= ctx->bitmap_len || length > ctx->bitmap_len - first)
+        return VTENC_ERR_BUFFER_TOO_SMALL;
+
+      bitmap_set_range(ctx->bitmap, first, first + length);
+      return VTENC_OK;
+    }
+    case DEC_MODE_CONVERTED:
+      DEC_CONVERTED_STORE(ctx, from, length, higher_bits + i);
+      return VTENC_OK;
+    case DEC_MODE_WINDOW: {
+      const size_t first = MAX(from, ctx->window_from);
+      const size_t last = MIN(from + length, ctx->window_to);
+
+      if (first < last) {
+        decode_full_subtree(ctx->values + (first - ctx->window_from) * ctx->stride,
+          last - first, ctx->stride, higher_bits + (first - from));
+      }
+      return VTENC_OK;
+    }
+    case DEC_MODE_COUNTS:
+      count_range(ctx, higher_bits, length);
+      return VTENC_OK;
+    case DEC_MODE_PROBES:
+      probe_range(ctx, (TYPE)higher_bits, (TYPE)higher_bits + (length - 1));
+      return VTENC_OK;
+    case DEC_MODE_SAMPLES:
+      sample_range(ctx, higher_bits, length, ctx->cl_samples);
+      return VTENC_OK;
+    default:
+      decode_full_subtree(ctx->values + from * ctx->stride, length, ctx->stride, higher_bits);
+      return VTENC_OK;
+  }
+}
+
+static __always_inline int output_repeated(struct decctx *ctx, const int mode,
+  size_t from, size_t length, uint64_t value)
+{
+  switch (mode) {
+    case DEC_MODE_BITMAP:
+      value = (TYPE)value;
+
+      if (value >= ctx->bitmap_len) return VTENC_ERR_BUFFER_TOO_SMALL;
+
+      bitmap_set(ctx->bitmap, value);
+      return VTENC_OK;
+    case DEC_MODE_CONVERTED:
+      DEC_CONVERTED_STORE(ctx, from, length, value);
+      return VTENC_OK;
+    case DEC_MODE_WINDOW: {
+      const size_t first = MAX(from, ctx->window_from);
+      const size_t last = MIN(from + length, ctx->window_to);
+
+      if (first < last) {
+        fill_values(ctx->values + (first - ctx->window_from) * ctx->stride,
+          last - first, ctx->stride, value);
+      }
+      return VTENC_OK;
+    }
+    case DEC_MODE_COUNTS:
+      ctx->counts[(TYPE)value >> ctx->counts_shift] += length;
+      return VTENC_OK;
+    case DEC_MODE_PROBES:
+      probe_range(ctx, (TYPE)value, (TYPE)value);
+      return VTENC_OK;
+    case DEC_MODE_SAMPLES:
+      fill_values(ctx->values + ctx->sample_pos, ctx->cl_samples, 1, value);
+      ctx->sample_pos += ctx->cl_samples;
+      return VTENC_OK;
+    default:
+      fill_values(ctx->values + from * ctx->stride, length, ctx->stride, value);
+      return VTENC_OK;
   }
 }
 
@@ -105,6 +658,24 @@ static inline void bcltree_add(struct decctx *ctx,
   dec_stack_push(&ctx->stack, cluster);
 }
 
+/*
+ * Splits the samples of a cluster between its two children, and sets them at
+ * the positions of the stack where the children are about to be pushed.
+ */
+static inline void split_samples(struct decctx *ctx, size_t length,
+  size_t n_zeros)
+{
+  const size_t zeros_samples = dec_split_samples(&ctx->rng, ctx->cl_samples,
+                                                 length, n_zeros);
+  size_t head = ctx->stack.head;
+
+  if (n_zeros < length)
+    ctx->stack_samples[head++] = ctx->cl_samples - zeros_samples;
+
+  if (n_zeros > 0)
+    ctx->stack_samples[head] = zeros_samples;
+}
+
 static inline int bcltree_has_more(struct decctx *ctx)
 {
   return !dec_stack_empty(&ctx->stack);
@@ -115,9 +686,152 @@ static inline struct dec_bit_cluster *bcltree_next(struct decctx *ctx)
   return dec_stack_pop(&ctx->stack);
 }
 
-static int decode_bit_cluster_tree(struct decctx *ctx)
+static int decode_base(struct decctx *ctx)
+{
+  if (!ctx->frame_of_reference || ctx->values_len == 0)
+    return VTENC_OK;
+
+  ctx->base += decode_lower_bits_step(&ctx->bits_reader, ctx->width);
+
+  return VTENC_OK;
+}
+
+static int decode_width(struct decctx *ctx)
 {
-  bcltree_add(ctx, &(struct dec_bit_cluster){0, ctx->values_len, BITWIDTH, 0});
+  if (!ctx->detect_width || ctx->values_len == 0)
+    return VTENC_OK;
+
+  return bsreader_read_width(&ctx->bits_reader, ctx->width, &ctx->width);
+}
+
+/*
+ * Decodes the bit cluster tree of a short array with no leaf flags, exactly
+ * as the general traversal below does, but faster when there are just a few
+ * values per cluster:
+ * - A cluster that doesn't split at a level carries on to the next one in
+ *   place, with no pushes or pops.
+ * - The reader and the stack of clusters are local variables, which the
+ *   compiler can keep in registers. Through `ctx`, they'd need to be reloaded
+ *   after every value stored to the output, since those stores may alias them.
+ */
+static int decode_small_tree(struct decctx *ctx)
+{
+  TYPE *values = ctx->values;
+  const int reconstruct_full_subtrees = ctx->reconstruct_full_subtrees;
+  const int path_compression = ctx->path_compression;
+  const size_t *min_cluster_length = ctx->min_cluster_length;
+  struct bsreader reader = ctx->bits_reader;
+  struct dec_bit_cluster stack[DEC_STACK_MAX_SIZE];
+  size_t depth = 0;
+
+  if (ctx->values_len > 0)
+    stack[depth++] = (struct dec_bit_cluster){0, ctx->values_len, ctx->width, ctx->base + ctx->offset};
+
+  while (depth > 0) {
+    const struct dec_bit_cluster cluster = stack[--depth];
+    TYPE *cl_values = values + cluster.from;
+    const size_t cl_len = cluster.length;
+    const unsigned int enc_len = bits_len_u64(cl_len);
+    unsigned int cl_bit_pos = cluster.bit_pos;
+    uint64_t cl_higher_bits = cluster.higher_bits;
+
+    for (;;) {
+      if (cl_bit_pos == 0) {
+        fill_values(cl_values, cl_len, 1, cl_higher_bits);
+        break;
+      }
+
+      if (reconstruct_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
+        decode_full_subtree(cl_values, cl_len, 1, cl_higher_bits);
+        break;
+      }
+
+      if (cl_len <= min_cluster_length[cl_bit_pos]) {
+        for (size_t i = 0; i < cl_len; ++i)
+          cl_values[i] = cl_higher_bits + decode_lower_bits_step(&reader, cl_bit_pos);
+        break;
+      }
+
+      uint64_t n_zeros = bsreader_read(&reader, enc_len);
+
+      if (n_zeros > (uint64_t)cl_len) return VTENC_ERR_WRONG_FORMAT;
+
+      if (path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH &&
+          (n_zeros == 0 || n_zeros == (uint64_t)cl_len)) {
+        uint64_t common_bits;
+
+        return_if_error(bsreader_read_common_bits(&reader, n_zeros == 0,
+          &cl_bit_pos, &common_bits));
+
+        cl_higher_bits += common_bits;
+
+        if (cl_bit_pos == 0) {
+          fill_values(cl_values, cl_len, 1, cl_higher_bits);
+          break;
+        }
+
+        n_zeros = bsreader_read(&reader, enc_len);
+
+        if (n_zeros > (uint64_t)cl_len) return VTENC_ERR_WRONG_FORMAT;
+      }
+
+      cl_bit_pos--;
+
+      if (n_zeros == 0 || n_zeros == (uint64_t)cl_len) {
+        cl_higher_bits += (uint64_t)(n_zeros == 0) << cl_bit_pos;
+        continue;
+      }
+
+      stack[depth++] = (struct dec_bit_cluster){
+        cluster.from + n_zeros, cl_len - n_zeros, cl_bit_pos, cl_higher_bits + (1ULL << cl_bit_pos)
+      };
+      stack[depth++] = (struct dec_bit_cluster){cluster.from, n_zeros, cl_bit_pos, cl_higher_bits};
+      break;
+    }
+  }
+
+  ctx->bits_reader = reader;
+
+  return VTENC_OK;
+}
+
+/*
+ * Short arrays of another width are decoded by decode_small_tree() into a
+ * buffer on the stack, which stays in cache, and converted from there. That's
+ * faster than the general traversal for them.
+ */
+static int decode_small_converted(struct decctx *ctx)
+{
+  TYPE buffer[VTENC_SMALL_DEC_MAX_LEN];
+  const uint64_t offset = ctx->offset;
+
+  ctx->values = buffer;
+  ctx->offset = 0;
+
+  return_if_error(decode_small_tree(ctx));
+
+  DEC_CONVERTED_STORE(ctx, 0, ctx->values_len, buffer[i] + offset);
+
+  ctx->values = NULL;
+  ctx->offset = offset;
+
+  return VTENC_OK;
+}
+
+/*
+ * Clusters carry the base and the output offset plus their higher bits, which
+ * are added rather than OR-ed to lower bits so that values come out with both
+ * added back.
+ *
+ * It's only ever inlined with a constant `mode`, into one copy per mode, so
+ * that each of them keeps just the checks and the outputs of its own.
+ */
+static __always_inline int decode_tree(struct decctx *ctx, const int mode)
+{
+  const size_t min_len = ctx->min_cluster_length[0];
+  const uint64_t offset = mode == DEC_MODE_PLAIN ? 0 : ctx->base + ctx->offset;
+
+  bcltree_add(ctx, &(struct dec_bit_cluster){0, ctx->values_len, ctx->width, offset});
 
   while (bcltree_has_more(ctx)) {
     struct dec_bit_cluster *cluster = bcltree_next(ctx);
@@ -126,21 +840,40 @@ static int decode_bit_cluster_tree(struct decctx *ctx)
     unsigned int cl_bit_pos = cluster->bit_pos;
     uint64_t cl_higher_bits = cluster->higher_bits;
 
-    if (cl_bit_pos == 0) {
-      for (size_t i = 0; i < cl_len; i++) {
-        ctx->values[cl_from + i] = (TYPE)cl_higher_bits;
-      }
+    /* Clusters come in order, so the rest are past the window too */
+    if (mode == DEC_MODE_WINDOW && ctx->window_stop && cl_from >= ctx->window_to)
+      break;
+
+    /* Likewise, the rest are past the last probe */
+    if (mode == DEC_MODE_PROBES && ctx->probe_pos == ctx->probes_len)
+      break;
+
+    if (mode == DEC_MODE_SAMPLES) {
+      /* Or past the last sample */
+      if (ctx->sample_pos == ctx->samples_len)
+        break;
+
+      ctx->cl_samples = ctx->stack_samples[ctx->stack.head];
+    }
 
+    if (cl_bit_pos == 0) {
+      return_if_error(output_repeated(ctx, mode, cl_from, cl_len, cl_higher_bits));
       continue;
     }
 
     if (ctx->reconstruct_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
-      decode_full_subtree(ctx->values + cl_from, cl_len, cl_higher_bits);
+      return_if_error(output_full_subtree(ctx, mode, cl_from, cl_len, cl_higher_bits));
       continue;
     }
 
-    if (cl_len <= ctx->min_cluster_length) {
-      decode_lower_bits(ctx, ctx->values + cl_from, cl_len, cl_bit_pos, cl_higher_bits);
+    if (cl_len <= (mode == DEC_MODE_PLAIN ? min_len : ctx->min_cluster_length[cl_bit_pos])) {
+      return_if_error(output_leaf(ctx, mode, cl_from, cl_len, cl_bit_pos, cl_higher_bits));
+      continue;
+    }
+
+    if (mode != DEC_MODE_PLAIN && ctx->optimal_leaves &&
+        bsreader_read(&ctx->bits_reader, 1)) {
+      return_if_error(output_leaf(ctx, mode, cl_from, cl_len, cl_bit_pos, cl_higher_bits));
       continue;
     }
 
@@ -149,9 +882,32 @@ static int decode_bit_cluster_tree(struct decctx *ctx)
 
     if (n_zeros > (uint64_t)cl_len) return VTENC_ERR_WRONG_FORMAT;
 
+    if (mode != DEC_MODE_PLAIN && ctx->path_compression &&
+        cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH &&
+        (n_zeros == 0 || n_zeros == (uint64_t)cl_len)) {
+      uint64_t common_bits;
+
+      return_if_error(bsreader_read_common_bits(&ctx->bits_reader, n_zeros == 0,
+        &cl_bit_pos, &common_bits));
+
+      cl_higher_bits += common_bits;
+
+      if (cl_bit_pos == 0) {
+        return_if_error(output_repeated(ctx, mode, cl_from, cl_len, cl_higher_bits));
+        continue;
+      }
+
+      n_zeros = bsreader_read(&ctx->bits_reader, enc_len);
+
+      if (n_zeros > (uint64_t)cl_len) return VTENC_ERR_WRONG_FORMAT;
+    }
+
     unsigned int next_bit_pos = cl_bit_pos - 1;
     struct dec_bit_cluster zeros_cluster = {cl_from, n_zeros, next_bit_pos, cl_higher_bits};
-    struct dec_bit_cluster ones_cluster = {cl_from + n_zeros, cl_len - n_zeros, next_bit_pos, cl_higher_bits | (1LL << (next_bit_pos))};
+    struct dec_bit_cluster ones_cluster = {cl_from + n_zeros, cl_len - n_zeros, next_bit_pos, cl_higher_bits + (1LL << (next_bit_pos))};
+
+    if (mode == DEC_MODE_SAMPLES)
+      split_samples(ctx, cl_len, n_zeros);
 
     bcltree_add(ctx, &ones_cluster);
     bcltree_add(ctx, &zeros_cluster);
@@ -160,7 +916,291 @@ static int decode_bit_cluster_tree(struct decctx *ctx)
   return VTENC_OK;
 }
 
-int vtenc_decode(vtenc *dec, const uint8_t *in, size_t in_len, TYPE *out, size_t out_len)
+/*
+ * Sampling descends the tree in a function of its own, which also splits the
+ * samples of every cluster between its children.
+ */
+static noinline int decode_sample_tree(struct decctx *ctx)
+{
+  return decode_tree(ctx, DEC_MODE_SAMPLES);
+}
+
+/*
+ * Plain lists, stored to an array with no stride or offset, with no leaf
+ * flags, no path compression, a base of 0 and the same minimum cluster length
+ * at all levels, have a copy of their own, which leaves those checks out.
+ */
+static noinline int decode_plain_tree(struct decctx *ctx)
+{
+  return decode_tree(ctx, DEC_MODE_PLAIN);
+}
+
+static int decode_bit_cluster_tree(struct decctx *ctx)
+{
+  const int small = ctx->values_len <= VTENC_SMALL_DEC_MAX_LEN &&
+                    ctx->stride == 1 && !ctx->optimal_leaves;
+
+  if (ctx->bitmap != NULL)
+    return decode_tree(ctx, DEC_MODE_BITMAP);
+
+  if (ctx->out != NULL)
+    return small ? decode_small_converted(ctx) : decode_tree(ctx, DEC_MODE_CONVERTED);
+
+  if (ctx->windowed)
+    return decode_tree(ctx, DEC_MODE_WINDOW);
+
+  if (ctx->counts != NULL)
+    return decode_tree(ctx, DEC_MODE_COUNTS);
+
+  if (ctx->probes != NULL)
+    return decode_tree(ctx, DEC_MODE_PROBES);
+
+  if (ctx->sampling)
+    return decode_sample_tree(ctx);
+
+  if (small)
+    return decode_small_tree(ctx);
+
+  if (ctx->stride == 1 && !ctx->optimal_leaves && !ctx->path_compression &&
+      ctx->base == 0 && ctx->offset == 0 && ctx->uniform_min_cluster_length)
+    return decode_plain_tree(ctx);
+
+  return decode_tree(ctx, DEC_MODE_VALUES);
+}
+
+/*
+ * Expands the distinct values, which are stored at the tail of `values`, or of
+ * `ctx->out` if set, into their runs. Runs are written from the front, which
+ * never overtakes the distinct values that are still to be read.
+ */
+static int decode_run_lengths(struct decctx *ctx, TYPE *values,
+  size_t values_len, size_t stride, size_t distinct_len)
+{
+  const size_t distinct_from = values_len - distinct_len;
+  size_t pos = 0;
+  size_t i = 0;
+
+  while (i < distinct_len) {
+    size_t n_runs = MIN(VTENC_RUNS_BLOCK_LEN, distinct_len - i);
+    unsigned int width = bsreader_read(&ctx->bits_reader, VTENC_RUNS_WIDTH_BITS);
+
+    if (width > BIT_STREAM_MAX_READ) return VTENC_ERR_WRONG_FORMAT;
+
+    for (size_t j = 0; j < n_runs; j++, i++) {
+      uint64_t run = 1;
+
+      if (width > 0)
+        run += bsreader_read(&ctx->bits_reader, width);
+
+      if (run > (uint64_t)(values_len - pos)) return VTENC_ERR_WRONG_FORMAT;
+
+      if (ctx->out != NULL) {
+        const uint64_t value = dec_load_converted(ctx->out, ctx->out_size, distinct_from + i);
+
+        DEC_CONVERTED_STORE(ctx, pos, run, value);
+      } else {
+        fill_values(values + pos * stride, run, stride, values[(distinct_from + i) * stride]);
+      }
+      pos += run;
+    }
+  }
+
+  if (pos != values_len) return VTENC_ERR_WRONG_FORMAT;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads the length of the `i`-th run, after the width of its block of runs if
+ * it's the first one of the block.
+ */
+static inline int decode_run(struct bsreader *reader, size_t i,
+  unsigned int *width, uint64_t *run)
+{
+  if (i % VTENC_RUNS_BLOCK_LEN == 0) {
+    *width = bsreader_read(reader, VTENC_RUNS_WIDTH_BITS);
+
+    if (*width > BIT_STREAM_MAX_READ) return VTENC_ERR_WRONG_FORMAT;
+  }
+
+  *run = 1 + (*width > 0 ? bsreader_read(reader, *width) : 0);
+
+  return VTENC_OK;
+}
+
+/*
+ * Expands the first `out_len` values of a list, whose first `distinct_len`
+ * distinct values are stored at the tail of `out`. Only the runs that start
+ * within `out` are needed, so they're counted first, and their distinct values
+ * moved to the very end of `out`. Then, as in decode_run_lengths(), runs are
+ * written from the front, which never overtakes the distinct values that are
+ * still to be read.
+ */
+static int decode_prefix_run_lengths(struct decctx *ctx, TYPE *out,
+  size_t out_len, size_t distinct_len)
+{
+  const struct bsreader runs_reader = ctx->bits_reader;
+  unsigned int width = 0;
+  size_t n_runs = 0;
+  size_t pos = 0;
+  uint64_t run;
+
+  while (pos < out_len) {
+    if (n_runs == distinct_len) return VTENC_ERR_WRONG_FORMAT;
+
+    return_if_error(decode_run(&ctx->bits_reader, n_runs++, &width, &run));
+    pos += MIN(run, (uint64_t)(out_len - pos));
+  }
+
+  memmove(out + out_len - n_runs, out + out_len - distinct_len, n_runs * sizeof(TYPE));
+
+  ctx->bits_reader = runs_reader;
+  pos = 0;
+
+  for (size_t i = 0; i < n_runs; i++) {
+    return_if_error(decode_run(&ctx->bits_reader, i, &width, &run));
+    run = MIN(run, (uint64_t)(out_len - pos));
+    fill_values(out + pos, run, 1, out[out_len - n_runs + i]);
+    pos += run;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads whether a list encoded with runs does have them and, if so, the number
+ * of its distinct values, and sets up `ctx` to decode them. Otherwise, the
+ * tree holds the whole list.
+ */
+static int decode_distinct_len(struct decctx *ctx, const vtenc *dec,
+  size_t out_len, size_t *distinct_len)
+{
+  uint64_t len;
+
+  ctx->runs = (int)bsreader_read(&ctx->bits_reader, 1);
+  if (!ctx->runs) {
+    *distinct_len = out_len;
+    return VTENC_OK;
+  }
+
+  len = bsreader_read(&ctx->bits_reader, bits_len_u64(out_len));
+
+  if (len == 0 || len > (uint64_t)out_len)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  /* Distinct values are a set, so full subtrees may have been skipped */
+  ctx->reconstruct_full_subtrees = dec->params.skip_full_subtrees;
+  ctx->values_len = (size_t)len;
+  *distinct_len = (size_t)len;
+
+  return VTENC_OK;
+}
+
+/*
+ * Turns the number of distinct values in every one of `n_buckets` buckets into
+ * their number of values, by adding up their run lengths, which come in the
+ * same order.
+ */
+static int count_run_lengths(struct decctx *ctx, size_t n_buckets,
+  size_t distinct_len, size_t values_len)
+{
+  unsigned int width = 0;
+  uint64_t run, total = 0;
+  size_t i = 0;
+
+  for (size_t b = 0; b < n_buckets; b++) {
+    size_t n_distinct = ctx->counts[b];
+    uint64_t count = 0;
+
+    if (n_distinct > distinct_len - i) return VTENC_ERR_WRONG_FORMAT;
+
+    for (; n_distinct > 0; n_distinct--, i++) {
+      return_if_error(decode_run(&ctx->bits_reader, i, &width, &run));
+      count += run;
+    }
+
+    ctx->counts[b] = (size_t)count;
+    total += count;
+  }
+
+  if (total != (uint64_t)values_len) return VTENC_ERR_WRONG_FORMAT;
+
+  return VTENC_OK;
+}
+
+/*
+ * Finds which distinct value of a list encoded with runs is at position `pos`
+ * of the list. The tree is traversed to the end with nothing stored, and then
+ * run lengths are read up to `pos`.
+ */
+static int find_run(struct decctx *ctx, size_t pos, size_t *distinct_pos)
+{
+  const size_t distinct_len = ctx->values_len;
+  unsigned int width = 0;
+  size_t run_from = 0;
+  uint64_t run;
+
+  decctx_set_window(ctx, NULL, 0, 0, 0);
+
+  return_if_error(decode_bit_cluster_tree(ctx));
+
+  for (size_t i = 0; i < distinct_len; i++) {
+    return_if_error(decode_run(&ctx->bits_reader, i, &width, &run));
+
+    if (run > (uint64_t)(pos - run_from)) {
+      *distinct_pos = i;
+      return VTENC_OK;
+    }
+
+    run_from += run;
+  }
+
+  return VTENC_ERR_WRONG_FORMAT;
+}
+
+static int decode_with_runs(vtenc *dec, const uint8_t *in, size_t in_len,
+  void *out, size_t out_len, size_t stride, unsigned int out_size, uint64_t offset)
+{
+  struct decctx ctx;
+  size_t distinct_len;
+
+  int rc = decctx_init(&ctx, dec, in, in_len, out, out_len, stride);
+  if (rc != VTENC_OK)
+    return rc;
+
+  decctx_set_output(&ctx, out, out_size, offset);
+
+  if (out_len == 0)
+    return VTENC_OK;
+
+  return_if_error(decode_base(&ctx));
+
+  return_if_error(decode_width(&ctx));
+
+  return_if_error(decode_distinct_len(&ctx, dec, out_len, &distinct_len));
+
+  if (!ctx.runs)
+    return decode_bit_cluster_tree(&ctx);
+
+  if (ctx.out != NULL) {
+    ctx.out = (uint8_t *)out + (out_len - distinct_len) * out_size;
+    return_if_error(decode_bit_cluster_tree(&ctx));
+    ctx.out = out;
+  } else {
+    ctx.values = (TYPE *)out + (out_len - distinct_len) * stride;
+    return_if_error(decode_bit_cluster_tree(&ctx));
+  }
+
+  return decode_run_lengths(&ctx, out, out_len, stride, distinct_len);
+}
+
+/*
+ * Decodes `out_len` values that are `stride` elements apart from each other,
+ * as integers of `out_size` bytes, and adds `offset` to them. Every value is
+ * written, so `out` doesn't need to be initialised.
+ */
+static int decode_values(vtenc *dec, const uint8_t *in, size_t in_len,
+  void *out, size_t out_len, size_t stride, unsigned int out_size, uint64_t offset)
 {
   struct decctx ctx;
   uint64_t max_values = dec->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
@@ -168,11 +1208,290 @@ int vtenc_decode(vtenc *dec, const uint8_t *in, size_t in_len, TYPE *out, size_t
   if ((uint64_t)out_len > max_values)
     return VTENC_ERR_OUTPUT_TOO_BIG;
 
-  int rc = decctx_init(&ctx, dec, in, in_len, out, out_len);
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding)
+    return decode_with_runs(dec, in, in_len, out, out_len, stride, out_size, offset);
+
+  int rc = decctx_init(&ctx, dec, in, in_len, out, out_len, stride);
   if (rc != VTENC_OK)
     return rc;
 
-  memset(out, 0, out_len * sizeof(*out));
+  decctx_set_output(&ctx, out, out_size, offset);
+
+  return_if_error(decode_base(&ctx));
+
+  return_if_error(decode_width(&ctx));
 
   return decode_bit_cluster_tree(&ctx);
 }
+
+int vtenc_decode(vtenc *dec, const uint8_t *in, size_t in_len, TYPE *out, size_t out_len)
+{
+  return decode_values(dec, in, in_len, out, out_len, 1, sizeof(TYPE), 0);
+}
+
+int vtenc_decode_strided(vtenc *dec, const uint8_t *in, size_t in_len,
+  void *out, size_t out_len, size_t stride, size_t offset)
+{
+  if (stride % sizeof(TYPE) != 0 || offset % sizeof(TYPE) != 0 ||
+      offset + sizeof(TYPE) > stride)
+    return VTENC_ERR_CONFIG;
+
+  return decode_values(dec, in, in_len, (TYPE *)((uint8_t *)out + offset),
+                       out_len, stride / sizeof(TYPE), sizeof(TYPE), 0);
+}
+
+int vtenc_decode_to_bitmap(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t out_len, uint64_t *bitmap, size_t bitmap_len)
+{
+  struct decctx ctx;
+  uint64_t max_values = dec->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+
+  if ((uint64_t)out_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  return_if_error(decctx_init(&ctx, dec, in, in_len, NULL, out_len, 1));
+
+  ctx.bitmap = bitmap;
+  ctx.bitmap_len = bitmap_len;
+
+  if (out_len == 0)
+    return VTENC_OK;
+
+  return_if_error(decode_base(&ctx));
+
+  return_if_error(decode_width(&ctx));
+
+  /* Only the distinct values matter, so run lengths aren't read */
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding) {
+    size_t distinct_len;
+
+    return_if_error(decode_distinct_len(&ctx, dec, out_len, &distinct_len));
+  }
+
+  return decode_bit_cluster_tree(&ctx);
+}
+
+int vtenc_decode_converted(vtenc *dec, const uint8_t *in, size_t in_len,
+  void *out, size_t out_len, unsigned int out_width, uint64_t offset)
+{
+  if (out_width != 8 && out_width != 16 && out_width != 32 && out_width != 64)
+    return VTENC_ERR_CONFIG;
+
+  return decode_values(dec, in, in_len, out, out_len, 1, out_width / 8, offset);
+}
+
+int vtenc_decode_prefix(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, TYPE *out, size_t out_len)
+{
+  struct decctx ctx;
+  uint64_t max_values = dec->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  size_t distinct_len;
+
+  if ((uint64_t)values_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  out_len = MIN(out_len, values_len);
+
+  return_if_error(decctx_init(&ctx, dec, in, in_len, out, values_len, 1));
+
+  if (out_len == 0)
+    return VTENC_OK;
+
+  return_if_error(decode_base(&ctx));
+
+  return_if_error(decode_width(&ctx));
+
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding)
+    return_if_error(decode_distinct_len(&ctx, dec, values_len, &distinct_len));
+
+  if (!ctx.runs) {
+    decctx_set_window(&ctx, out, 0, out_len, 1);
+    return decode_bit_cluster_tree(&ctx);
+  }
+
+  /**
+   * Run lengths come after the whole tree, so it's traversed to the end, but
+   * only the distinct values that may be in the prefix are stored.
+   */
+
+  distinct_len = MIN(distinct_len, out_len);
+
+  decctx_set_window(&ctx, out + out_len - distinct_len, 0, distinct_len, 0);
+
+  return_if_error(decode_bit_cluster_tree(&ctx));
+
+  return decode_prefix_run_lengths(&ctx, out, out_len, distinct_len);
+}
+
+/*
+ * Reads the header of a sequence of `values_len` values and sets up `ctx` to
+ * decode its bit cluster tree, whose values are the distinct ones with runs.
+ */
+static int decode_header(struct decctx *ctx, const vtenc *dec,
+  const uint8_t *in, size_t in_len, size_t values_len)
+{
+  uint64_t max_values = dec->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+
+  if ((uint64_t)values_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  return_if_error(decctx_init(ctx, dec, in, in_len, NULL, values_len, 1));
+
+  if (values_len == 0)
+    return VTENC_OK;
+
+  return_if_error(decode_base(ctx));
+
+  return_if_error(decode_width(ctx));
+
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding) {
+    size_t distinct_len;
+
+    return_if_error(decode_distinct_len(ctx, dec, values_len, &distinct_len));
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Decodes the value at position `pos` of the bit cluster tree only, or the
+ * last one with `last`. With runs, those are positions of distinct values, so
+ * run lengths aren't read.
+ */
+static int decode_value_at(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, int last, size_t pos, TYPE *value)
+{
+  struct decctx ctx;
+
+  if (values_len == 0)
+    return VTENC_ERR_CONFIG;
+
+  return_if_error(decode_header(&ctx, dec, in, in_len, values_len));
+
+  if (last)
+    pos = ctx.values_len - 1;
+
+  if (pos >= ctx.values_len)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  decctx_set_window(&ctx, value, pos, pos + 1, 1);
+
+  return decode_bit_cluster_tree(&ctx);
+}
+
+int vtenc_min(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len,
+  TYPE *min)
+{
+  return decode_value_at(dec, in, in_len, values_len, 0, 0, min);
+}
+
+int vtenc_max(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len,
+  TYPE *max)
+{
+  return decode_value_at(dec, in, in_len, values_len, 1, 0, max);
+}
+
+int vtenc_histogram(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, unsigned int depth, size_t *counts)
+{
+  struct decctx ctx;
+
+  if (depth == 0 || depth > MIN(BITWIDTH, DEC_HISTOGRAM_MAX_DEPTH))
+    return VTENC_ERR_CONFIG;
+
+  memset(counts, 0, ((size_t)1 << depth) * sizeof(size_t));
+
+  return_if_error(decode_header(&ctx, dec, in, in_len, values_len));
+
+  if (values_len == 0)
+    return VTENC_OK;
+
+  ctx.counts = counts;
+  ctx.counts_shift = BITWIDTH - depth;
+
+  return_if_error(decode_bit_cluster_tree(&ctx));
+
+  /* So far, only distinct values have been counted */
+  if (ctx.runs)
+    return count_run_lengths(&ctx, (size_t)1 << depth, ctx.values_len, values_len);
+
+  return VTENC_OK;
+}
+
+int vtenc_quantile(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, double q, TYPE *value)
+{
+  struct decctx ctx;
+  size_t pos;
+
+  if (!(q >= 0.0 && q <= 1.0) || values_len == 0)
+    return VTENC_ERR_CONFIG;
+
+  pos = MIN((size_t)(q * (double)(values_len - 1)), values_len - 1);
+
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding) {
+    return_if_error(decode_header(&ctx, dec, in, in_len, values_len));
+    if (ctx.runs)
+      return_if_error(find_run(&ctx, pos, &pos));
+  }
+
+  return decode_value_at(dec, in, in_len, values_len, 0, pos, value);
+}
+
+int vtenc_contains_batch(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, const TYPE *probes, size_t probes_len, uint64_t *found)
+{
+  struct decctx ctx;
+
+  memset(found, 0, ((probes_len + 63) >> 6) * sizeof(uint64_t));
+
+  for (size_t i = 1; i < probes_len; i++) {
+    if (probes[i] < probes[i - 1])
+      return VTENC_ERR_NOT_SORTED;
+  }
+
+  return_if_error(decode_header(&ctx, dec, in, in_len, values_len));
+
+  if (values_len == 0 || probes_len == 0)
+    return VTENC_OK;
+
+  /* With runs, the distinct values are enough, so run lengths aren't read */
+  ctx.probes = probes;
+  ctx.probes_len = probes_len;
+  ctx.found = found;
+
+  return decode_bit_cluster_tree(&ctx);
+}
+
+int vtenc_sample(vtenc *dec, const uint8_t *in, size_t in_len,
+  size_t values_len, size_t k, uint64_t seed, TYPE *out)
+{
+  struct decctx ctx;
+
+  if (k > values_len)
+    return VTENC_ERR_CONFIG;
+
+  /**
+   * Samples are split by the number of values of every cluster, but the
+   * clusters of a list with runs only count distinct values.
+   */
+  if (dec->params.allow_repeated_values && dec->params.run_length_encoding)
+    return VTENC_ERR_CONFIG;
+
+  return_if_error(decode_header(&ctx, dec, in, in_len, values_len));
+
+  if (k == 0)
+    return VTENC_OK;
+
+  ctx.values = out;
+  ctx.sampling = 1;
+  ctx.samples_len = k;
+  ctx.stack_samples[0] = k;
+  ctx.rng = seed;
+
+  return_if_error(decode_bit_cluster_tree(&ctx));
+
+  if (ctx.sample_pos != k) return VTENC_ERR_WRONG_FORMAT;
+
+  return VTENC_OK;
+}
@@ -3,12 +3,30 @@
   Licensed under the MIT License.
   See LICENSE file in the project root for full license information.
  */
+#include <stdlib.h>
+
 #include "encodebits.h"
 #include "internals.h"
 #include "stack.h"
 
 #define ENC_STACK_MAX_SIZE 64
 
+/* Longest run of values that are sorted by insertion rather than by bits */
+#define ENC_SORT_INSERTION_MAX_LEN 16
+
+/* Number of values of several inputs that are merged on the stack at once */
+#define ENC_MERGE_BUFFER_LEN 256
+
+/* Size of the buffer that output sinks are fed from */
+#define ENC_SINK_BUFFER_SIZE 4096
+
+/* Number of values checked at once for sortedness, with no early exit */
+#define ENC_SORTED_BLOCK_LEN 256
+
+/* Which values a traversal of the bit cluster tree can be given */
+#define ENC_MODE_GENERAL  0
+#define ENC_MODE_PLAIN    1
+
 struct enc_bit_cluster {
   size_t        from;
   size_t        length;
@@ -17,6 +35,82 @@ struct enc_bit_cluster {
 
 CREATE_STACK(enc_stack, struct enc_bit_cluster, ENC_STACK_MAX_SIZE)
 
+/*
+ * Leaf/split decisions taken by the cost model, stored as a sequence of bits
+ * in the same order in which their clusters are encoded. A bit set to 1 means
+ * that the cluster is a leaf.
+ */
+struct enc_decisions {
+  uint64_t  *bits;
+  size_t    len;
+  size_t    cap;
+  size_t    next;
+};
+
+static inline void enc_decisions_init(struct enc_decisions *d)
+{
+  d->bits = NULL;
+  d->len = 0;
+  d->cap = 0;
+  d->next = 0;
+}
+
+static inline void enc_decisions_free(struct enc_decisions *d)
+{
+  free(d->bits);
+  enc_decisions_init(d);
+}
+
+/* Appends a split decision and returns its position, or -1 on failure */
+static inline int64_t enc_decisions_push(struct enc_decisions *d)
+{
+  if (d->len == d->cap) {
+    size_t new_cap = d->cap ? d->cap * 2 : 4096;
+    uint64_t *new_bits = realloc(d->bits, new_cap / 8);
+
+    if (new_bits == NULL)
+      return -1;
+
+    d->bits = new_bits;
+    d->cap = new_cap;
+  }
+
+  d->bits[d->len >> 6] &= ~(1ULL << (d->len & 63));
+
+  return (int64_t)(d->len++);
+}
+
+/* Marks decision `pos` as a leaf, discarding all the decisions after it */
+static inline void enc_decisions_set_leaf(struct enc_decisions *d, size_t pos)
+{
+  d->bits[pos >> 6] |= 1ULL << (pos & 63);
+  d->len = pos + 1;
+}
+
+static inline int enc_decisions_next(struct enc_decisions *d)
+{
+  const size_t pos = d->next++;
+
+  return (d->bits[pos >> 6] >> (pos & 63)) & 1;
+}
+
+/* Returns the number of bits of the Elias gamma code of `value` (> 0) */
+static inline unsigned int enc_gamma_len(unsigned int value)
+{
+  return 2 * bits_len_u32(value) - 1;
+}
+
+#define ENC_LENGTH_BUCKETS 64
+
+/*
+ * Bits saved by turning clusters into leaves instead of splitting them,
+ * accumulated per tree level and per cluster length bucket. Bucket k holds
+ * clusters of length in (2^(k-1), 2^k].
+ */
+struct enc_level_gains {
+  int64_t gain[VTENC_TREE_LEVELS][ENC_LENGTH_BUCKETS];
+};
+
 #define LIST_MAX_VALUES VTENC_LIST_MAX_VALUES
 
 #define TYPE uint8_t
@@ -5,7 +5,10 @@
  */
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "bitmap.h"
 #include "bitstream.h"
 #include "common.h"
 #include "countbits.h"
@@ -19,35 +22,164 @@
 #define encctx_close encctx_close_(BITWIDTH)
 #define count_zeros_at_bit_pos_(_width_) BITWIDTH_SUFFIX(count_zeros_at_bit_pos, _width_)
 #define count_zeros_at_bit_pos count_zeros_at_bit_pos_(BITWIDTH)
+#define count_zeros_at_bit_pos_strided_(_width_) BITWIDTH_SUFFIX(count_zeros_at_bit_pos_strided, _width_)
+#define count_zeros_at_bit_pos_strided count_zeros_at_bit_pos_strided_(BITWIDTH)
 #define encode_lower_bits_(_width_) BITWIDTH_SUFFIX(encode_lower_bits, _width_)
 #define encode_lower_bits encode_lower_bits_(BITWIDTH)
+#define encode_lower_bits_strided_(_width_) BITWIDTH_SUFFIX(encode_lower_bits_strided, _width_)
+#define encode_lower_bits_strided encode_lower_bits_strided_(BITWIDTH)
 #define bcltree_add_(_width_) BITWIDTH_SUFFIX(bcltree_add, _width_)
 #define bcltree_add bcltree_add_(BITWIDTH)
 #define bcltree_has_more_(_width_) BITWIDTH_SUFFIX(bcltree_has_more, _width_)
 #define bcltree_has_more bcltree_has_more_(BITWIDTH)
 #define bcltree_next_(_width_) BITWIDTH_SUFFIX(bcltree_next, _width_)
 #define bcltree_next bcltree_next_(BITWIDTH)
+#define first_value_(_width_) BITWIDTH_SUFFIX(first_value, _width_)
+#define first_value first_value_(BITWIDTH)
+#define last_value_(_width_) BITWIDTH_SUFFIX(last_value, _width_)
+#define last_value last_value_(BITWIDTH)
+#define merged_first_(_width_) BITWIDTH_SUFFIX(merged_first, _width_)
+#define merged_first merged_first_(BITWIDTH)
+#define merged_last_(_width_) BITWIDTH_SUFFIX(merged_last, _width_)
+#define merged_last merged_last_(BITWIDTH)
+#define cluster_end_(_width_) BITWIDTH_SUFFIX(cluster_end, _width_)
+#define cluster_end cluster_end_(BITWIDTH)
+#define cluster_count_zeros_(_width_) BITWIDTH_SUFFIX(cluster_count_zeros, _width_)
+#define cluster_count_zeros cluster_count_zeros_(BITWIDTH)
+#define cluster_ones_from_(_width_) BITWIDTH_SUFFIX(cluster_ones_from, _width_)
+#define cluster_ones_from cluster_ones_from_(BITWIDTH)
+#define cluster_bounds_(_width_) BITWIDTH_SUFFIX(cluster_bounds, _width_)
+#define cluster_bounds cluster_bounds_(BITWIDTH)
+#define cluster_common_from_(_width_) BITWIDTH_SUFFIX(cluster_common_from, _width_)
+#define cluster_common_from cluster_common_from_(BITWIDTH)
+#define encode_common_bits_(_width_) BITWIDTH_SUFFIX(encode_common_bits, _width_)
+#define encode_common_bits encode_common_bits_(BITWIDTH)
+#define encode_leaf_(_width_) BITWIDTH_SUFFIX(encode_leaf, _width_)
+#define encode_leaf encode_leaf_(BITWIDTH)
+#define encode_bitmap_leaf_(_width_) BITWIDTH_SUFFIX(encode_bitmap_leaf, _width_)
+#define encode_bitmap_leaf encode_bitmap_leaf_(BITWIDTH)
+#define encode_cluster_leaf_(_width_) BITWIDTH_SUFFIX(encode_cluster_leaf, _width_)
+#define encode_cluster_leaf encode_cluster_leaf_(BITWIDTH)
+#define compute_optimal_leaves_(_width_) BITWIDTH_SUFFIX(compute_optimal_leaves, _width_)
+#define compute_optimal_leaves compute_optimal_leaves_(BITWIDTH)
+#define encode_base_(_width_) BITWIDTH_SUFFIX(encode_base, _width_)
+#define encode_base encode_base_(BITWIDTH)
+#define encode_width_(_width_) BITWIDTH_SUFFIX(encode_width, _width_)
+#define encode_width encode_width_(BITWIDTH)
 #define encode_bit_cluster_tree_(_width_) BITWIDTH_SUFFIX(encode_bit_cluster_tree, _width_)
 #define encode_bit_cluster_tree encode_bit_cluster_tree_(BITWIDTH)
+#define encode_tree_(_width_) BITWIDTH_SUFFIX(encode_tree, _width_)
+#define encode_tree encode_tree_(BITWIDTH)
+#define encode_plain_tree_(_width_) BITWIDTH_SUFFIX(encode_plain_tree, _width_)
+#define encode_plain_tree encode_plain_tree_(BITWIDTH)
+#define count_bit_cluster_tree_(_width_) BITWIDTH_SUFFIX(count_bit_cluster_tree, _width_)
+#define count_bit_cluster_tree count_bit_cluster_tree_(BITWIDTH)
+#define encode_small_tree_(_width_) BITWIDTH_SUFFIX(encode_small_tree, _width_)
+#define encode_small_tree encode_small_tree_(BITWIDTH)
+#define sort_cluster_(_width_) BITWIDTH_SUFFIX(sort_cluster, _width_)
+#define sort_cluster sort_cluster_(BITWIDTH)
+#define sort_partition_(_width_) BITWIDTH_SUFFIX(sort_partition, _width_)
+#define sort_partition sort_partition_(BITWIDTH)
+#define sort_values_(_width_) BITWIDTH_SUFFIX(sort_values, _width_)
+#define sort_values sort_values_(BITWIDTH)
+#define sort_full_subtree_(_width_) BITWIDTH_SUFFIX(sort_full_subtree, _width_)
+#define sort_full_subtree sort_full_subtree_(BITWIDTH)
+#define sort_encode_leaf_(_width_) BITWIDTH_SUFFIX(sort_encode_leaf, _width_)
+#define sort_encode_leaf sort_encode_leaf_(BITWIDTH)
+#define sort_encode_tree_(_width_) BITWIDTH_SUFFIX(sort_encode_tree, _width_)
+#define sort_encode_tree sort_encode_tree_(BITWIDTH)
+#define have_common_values_(_width_) BITWIDTH_SUFFIX(have_common_values, _width_)
+#define have_common_values have_common_values_(BITWIDTH)
+#define merged_inputs_(_width_) BITWIDTH_SUFFIX(merged_inputs, _width_)
+#define merged_inputs merged_inputs_(BITWIDTH)
+#define merge_values_(_width_) BITWIDTH_SUFFIX(merge_values, _width_)
+#define merge_values merge_values_(BITWIDTH)
+#define encode_merged_leaf_(_width_) BITWIDTH_SUFFIX(encode_merged_leaf, _width_)
+#define encode_merged_leaf encode_merged_leaf_(BITWIDTH)
+#define encode_merged_tree_(_width_) BITWIDTH_SUFFIX(encode_merged_tree, _width_)
+#define encode_merged_tree encode_merged_tree_(BITWIDTH)
+#define run_end_(_width_) BITWIDTH_SUFFIX(run_end, _width_)
+#define run_end run_end_(BITWIDTH)
+#define count_distinct_(_width_) BITWIDTH_SUFFIX(count_distinct, _width_)
+#define count_distinct count_distinct_(BITWIDTH)
+#define copy_distinct_(_width_) BITWIDTH_SUFFIX(copy_distinct, _width_)
+#define copy_distinct copy_distinct_(BITWIDTH)
+#define encode_run_lengths_(_width_) BITWIDTH_SUFFIX(encode_run_lengths, _width_)
+#define encode_run_lengths encode_run_lengths_(BITWIDTH)
+#define count_run_lengths_(_width_) BITWIDTH_SUFFIX(count_run_lengths, _width_)
+#define count_run_lengths count_run_lengths_(BITWIDTH)
+#define runs_pay_off_(_width_) BITWIDTH_SUFFIX(runs_pay_off, _width_)
+#define runs_pay_off runs_pay_off_(BITWIDTH)
+#define is_sorted_(_width_) BITWIDTH_SUFFIX(is_sorted, _width_)
+#define is_sorted is_sorted_(BITWIDTH)
+#define encode_with_runs_(_width_) BITWIDTH_SUFFIX(encode_with_runs, _width_)
+#define encode_with_runs encode_with_runs_(BITWIDTH)
+#define encode_values_(_width_) BITWIDTH_SUFFIX(encode_values, _width_)
+#define encode_values encode_values_(BITWIDTH)
 #define vtenc_encode_(_width_) BITWIDTH_SUFFIX(vtenc_encode, _width_)
 #define vtenc_encode vtenc_encode_(BITWIDTH)
+#define vtenc_encode_to_sink_(_width_) BITWIDTH_SUFFIX(vtenc_encode_to_sink, _width_)
+#define vtenc_encode_to_sink vtenc_encode_to_sink_(BITWIDTH)
+#define vtenc_encode_strided_(_width_) BITWIDTH_SUFFIX(vtenc_encode_strided, _width_)
+#define vtenc_encode_strided vtenc_encode_strided_(BITWIDTH)
+#define vtenc_encode_from_bitmap_(_width_) BITWIDTH_SUFFIX(vtenc_encode_from_bitmap, _width_)
+#define vtenc_encode_from_bitmap vtenc_encode_from_bitmap_(BITWIDTH)
+#define vtenc_encoded_size_exact_(_width_) BITWIDTH_SUFFIX(vtenc_encoded_size_exact, _width_)
+#define vtenc_encoded_size_exact vtenc_encoded_size_exact_(BITWIDTH)
+#define encode_sorted_values_(_width_) BITWIDTH_SUFFIX(encode_sorted_values, _width_)
+#define encode_sorted_values encode_sorted_values_(BITWIDTH)
+#define encode_merged_copy_(_width_) BITWIDTH_SUFFIX(encode_merged_copy, _width_)
+#define encode_merged_copy encode_merged_copy_(BITWIDTH)
+#define vtenc_encode_merged_(_width_) BITWIDTH_SUFFIX(vtenc_encode_merged, _width_)
+#define vtenc_encode_merged vtenc_encode_merged_(BITWIDTH)
+#define vtenc_sort_encode_(_width_) BITWIDTH_SUFFIX(vtenc_sort_encode, _width_)
+#define vtenc_sort_encode vtenc_sort_encode_(BITWIDTH)
+#define vtenc_suggest_min_cluster_lengths_(_width_) BITWIDTH_SUFFIX(vtenc_suggest_min_cluster_lengths, _width_)
+#define vtenc_suggest_min_cluster_lengths vtenc_suggest_min_cluster_lengths_(BITWIDTH)
 #define vtenc_max_encoded_size_(_width_) BITWIDTH_SUFFIX(vtenc_max_encoded_size, _width_)
 #define vtenc_max_encoded_size vtenc_max_encoded_size_(BITWIDTH)
+#define max_tree_bits_(_width_) BITWIDTH_SUFFIX(max_tree_bits, _width_)
+#define max_tree_bits max_tree_bits_(BITWIDTH)
+#define vtenc_max_encoded_size_range_(_width_) BITWIDTH_SUFFIX(vtenc_max_encoded_size_range, _width_)
+#define vtenc_max_encoded_size_range vtenc_max_encoded_size_range_(BITWIDTH)
 
 struct encctx {
   const TYPE        *values;
   size_t            values_len;
+  size_t            stride;
+  const uint64_t    *bitmap;
+  uint64_t          bitmap_len;
+  const TYPE *const *inputs;
+  const size_t      *inputs_len;
+  size_t            n_inputs;
+  size_t            *merge_pos;
   int               skip_full_subtrees;
-  size_t            min_cluster_length;
+  TYPE              base;
+  int               frame_of_reference;
+  unsigned int      width;
+  int               detect_width;
+  int               path_compression;
+  size_t            min_cluster_length[VTENC_TREE_LEVELS];
+  int               uniform_min_cluster_length;
+  int               optimal_leaves;
+  uint64_t          split_penalty;
+  struct enc_decisions decisions;
   struct enc_stack  stack;
   struct bswriter   bits_writer;
 };
 
 static int encctx_init(struct encctx *ctx, const vtenc *enc,
-  const TYPE *in, size_t in_len, uint8_t *out, size_t out_cap)
+  const TYPE *in, size_t in_len, size_t stride, uint8_t *out, size_t out_cap)
 {
   ctx->values = in;
   ctx->values_len = in_len;
+  ctx->stride = stride;
+  ctx->bitmap = NULL;
+  ctx->bitmap_len = 0;
+  ctx->inputs = NULL;
+  ctx->inputs_len = NULL;
+  ctx->n_inputs = 0;
+  ctx->merge_pos = NULL;
 
   /**
    * `skip_full_subtrees` parameter is only applicable to sets, i.e. sequences
@@ -56,16 +188,55 @@ static int encctx_init(struct encctx *ctx, const vtenc *enc,
   ctx->skip_full_subtrees = !enc->params.allow_repeated_values &&
                             enc->params.skip_full_subtrees;
 
-  ctx->min_cluster_length = enc->params.min_cluster_length;
+  ctx->base = (TYPE)enc->params.base;
+  ctx->frame_of_reference = enc->params.frame_of_reference;
+  ctx->width = MIN(enc->params.width, BITWIDTH);
+  ctx->detect_width = enc->params.detect_width;
+  ctx->path_compression = enc->params.path_compression;
+
+  /**
+   * With `optimal_leaves`, clusters of length 2 or less are always leaves,
+   * since splitting them never takes fewer bits.
+   */
+  for (unsigned int i = 0; i < VTENC_TREE_LEVELS; i++) {
+    ctx->min_cluster_length[i] = enc->params.optimal_leaves ?
+      MAX(enc->params.min_cluster_length[i], 2) : enc->params.min_cluster_length[i];
+  }
+
+  /**
+   * Lengths are usually the same at all levels, which lets plain traversals
+   * compare them to a single one.
+   */
+  ctx->uniform_min_cluster_length = 1;
+  for (unsigned int i = 1; i <= BITWIDTH; i++) {
+    if (ctx->min_cluster_length[i] != ctx->min_cluster_length[0])
+      ctx->uniform_min_cluster_length = 0;
+  }
+
+  ctx->optimal_leaves = enc->params.optimal_leaves;
+  ctx->split_penalty = enc->params.split_penalty;
+  enc_decisions_init(&ctx->decisions);
 
   enc_stack_init(&ctx->stack);
 
+  if (enc->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
   return bswriter_init(&ctx->bits_writer, out, out_cap);
 }
 
-static inline size_t encctx_close(struct encctx *ctx)
+/*
+ * Finishes writing the output and, if there was no error on the way, sets the
+ * output size of `enc`.
+ */
+static inline int encctx_close(struct encctx *ctx, vtenc *enc)
 {
-  return bswriter_size(&ctx->bits_writer);
+  int rc = bswriter_finish(&ctx->bits_writer);
+
+  if (rc == VTENC_OK)
+    enc->out_size = bswriter_size(&ctx->bits_writer);
+
+  return rc;
 }
 
 static inline void bcltree_add(struct encctx *ctx,
@@ -90,62 +261,1890 @@ static inline struct enc_bit_cluster *bcltree_next(struct encctx *ctx)
   return enc_stack_pop(&ctx->stack);
 }
 
-static void encode_bit_cluster_tree(struct encctx *ctx)
+/*
+ * Values are either read from an array, `stride` elements apart, or they are
+ * the positions of the set bits of a bitmap. Clusters always start at index
+ * `from` and have `length` values, but with a bitmap, `from` is the smallest
+ * value (minus the base) the cluster can hold rather than the index of its
+ * first value. The following functions hide that difference from the tree
+ * traversal.
+ *
+ * Values can also be merged from several sorted inputs, whose tree is
+ * traversed by encode_merged_tree() instead, so only the first and last
+ * values are needed for them.
+ *
+ * The functions that take a `mode` are only ever called with a constant one.
+ * With ENC_MODE_PLAIN, values are known to be read from an array with no
+ * stride and a base of 0, so they leave the other cases out.
+ */
+
+/*
+ * Returns the smallest of the values at `from` of the inputs that have
+ * values left before `to`, which must be at least one.
+ */
+static inline TYPE merged_first(const struct encctx *ctx, const size_t *from,
+  const size_t *to)
+{
+  TYPE first = (TYPE)~(TYPE)0;
+
+  for (size_t i = 0; i < ctx->n_inputs; i++) {
+    if (from[i] < to[i])
+      first = MIN(first, ctx->inputs[i][from[i]]);
+  }
+
+  return first;
+}
+
+/*
+ * Returns the largest of the values right before `to` of the inputs that
+ * have values left from `from`, which must be at least one.
+ */
+static inline TYPE merged_last(const struct encctx *ctx, const size_t *from,
+  const size_t *to)
+{
+  TYPE last = 0;
+
+  for (size_t i = 0; i < ctx->n_inputs; i++) {
+    if (from[i] < to[i])
+      last = MAX(last, ctx->inputs[i][to[i] - 1]);
+  }
+
+  return last;
+}
+
+static inline TYPE first_value(const struct encctx *ctx)
+{
+  if (ctx->bitmap != NULL)
+    return (TYPE)bitmap_next(ctx->bitmap, 0, ctx->bitmap_len);
+
+  if (ctx->inputs != NULL)
+    return merged_first(ctx, ctx->merge_pos, ctx->inputs_len);
+
+  return ctx->values[0];
+}
+
+static inline TYPE last_value(const struct encctx *ctx)
+{
+  if (ctx->bitmap != NULL)
+    return (TYPE)bitmap_prev(ctx->bitmap, 0, ctx->bitmap_len);
+
+  if (ctx->inputs != NULL)
+    return merged_last(ctx, ctx->merge_pos, ctx->inputs_len);
+
+  return ctx->values[(ctx->values_len - 1) * ctx->stride];
+}
+
+/*
+ * Returns the bitmap position right after the values that a cluster at level
+ * `bit_pos` can hold, without going past the end of the bitmap.
+ */
+static inline uint64_t cluster_end(const struct encctx *ctx, size_t from,
+  unsigned int bit_pos)
+{
+  const uint64_t start = (uint64_t)ctx->base + from;
+
+  if (bit_pos >= 64 || ((uint64_t)1 << bit_pos) >= ctx->bitmap_len - start)
+    return ctx->bitmap_len;
+
+  return start + ((uint64_t)1 << bit_pos);
+}
+
+/* Returns the number of values of a cluster whose bit at `bit_pos` is 0 */
+static __always_inline size_t cluster_count_zeros(const struct encctx *ctx,
+  const int mode, size_t from, size_t length, unsigned int bit_pos)
+{
+  if (mode == ENC_MODE_PLAIN)
+    return count_zeros_at_bit_pos(ctx->values + from, length, bit_pos);
+
+  if (ctx->bitmap != NULL) {
+    return (size_t)bitmap_count(ctx->bitmap, (uint64_t)ctx->base + from,
+                                cluster_end(ctx, from, bit_pos));
+  }
+
+  return count_zeros_at_bit_pos_strided(ctx->values + from * ctx->stride, length,
+                                        ctx->stride, bit_pos, ctx->base);
+}
+
+/* Returns where the ones child of a cluster split at `bit_pos` starts */
+static __always_inline size_t cluster_ones_from(const struct encctx *ctx,
+  const int mode, size_t from, size_t n_zeros, unsigned int bit_pos)
+{
+  if (mode != ENC_MODE_PLAIN && ctx->bitmap != NULL)
+    return from + ((size_t)1 << bit_pos);
+
+  return from + n_zeros;
+}
+
+/*
+ * Gets the first and the last values of a non-empty cluster at level
+ * `bit_pos`, minus the base.
+ */
+static __always_inline void cluster_bounds(const struct encctx *ctx,
+  const int mode, size_t from, size_t length, unsigned int bit_pos, TYPE *first,
+  TYPE *last)
+{
+  if (ctx->bitmap != NULL) {
+    const uint64_t start = (uint64_t)ctx->base + from;
+    const uint64_t end = cluster_end(ctx, from, bit_pos);
+
+    *first = (TYPE)(bitmap_next(ctx->bitmap, start, end) - ctx->base);
+    *last = (TYPE)(bitmap_prev(ctx->bitmap, start, end) - ctx->base);
+    return;
+  }
+
+  *first = (TYPE)(ctx->values[from * ctx->stride] - ctx->base);
+  *last = (TYPE)(ctx->values[(from + length - 1) * ctx->stride] - ctx->base);
+}
+
+/*
+ * Returns where a cluster starts once the higher bits shared by all its
+ * values, down to `split_pos`, are left behind. `first` is its first value,
+ * minus the base.
+ */
+static __always_inline size_t cluster_common_from(const struct encctx *ctx,
+  const int mode, size_t from, TYPE first, unsigned int split_pos)
+{
+  if (mode != ENC_MODE_PLAIN && ctx->bitmap != NULL)
+    return (size_t)(first & ~BITS_SIZE_MASK[split_pos]);
+
+  return from;
+}
+
+/*
+ * Encodes a cluster at level `bit_pos` whose values have all their higher
+ * bits in common down to `split_pos`. The cluster length is written in place
+ * of the number of zeros if the first common bit is 0, or 0 otherwise, as if
+ * the cluster didn't split. That's followed by the number of common bits, as
+ * an Elias gamma code, and the rest of them.
+ */
+static inline void encode_common_bits(struct bswriter *writer, TYPE first,
+  size_t values_len, unsigned int bit_pos, unsigned int split_pos)
+{
+  const unsigned int n_common = bit_pos - split_pos;
+  const TYPE common_bits = first >> split_pos;
+
+  bswriter_write(writer,
+    (common_bits >> (n_common - 1)) & 1 ? 0 : values_len, bits_len_u64(values_len));
+
+  bswriter_write_gamma(writer, n_common);
+
+  if (n_common > 1)
+    encode_lower_bits(writer, &common_bits, 1, n_common - 1);
+}
+
+/*
+ * Encodes the lower bits of a leaf cluster. The most common strides get their
+ * own copy of the kernel, so that the stride is a compile-time constant.
+ */
+static inline void encode_leaf(struct encctx *ctx, const TYPE *values,
+  size_t values_len, unsigned int n_bits)
+{
+  switch (ctx->stride) {
+    case 1:
+      encode_lower_bits_strided(&ctx->bits_writer, values, values_len, 1, n_bits, ctx->base);
+      break;
+    case 2:
+      encode_lower_bits_strided(&ctx->bits_writer, values, values_len, 2, n_bits, ctx->base);
+      break;
+    case 3:
+      encode_lower_bits_strided(&ctx->bits_writer, values, values_len, 3, n_bits, ctx->base);
+      break;
+    case 4:
+      encode_lower_bits_strided(&ctx->bits_writer, values, values_len, 4, n_bits, ctx->base);
+      break;
+    default:
+      encode_lower_bits_strided(&ctx->bits_writer, values, values_len, ctx->stride,
+                                n_bits, ctx->base);
+      break;
+  }
+}
+
+/*
+ * Encodes the lower bits of the set bits' positions in [from, to), gathering
+ * them in small batches first.
+ */
+static inline void encode_bitmap_leaf(struct encctx *ctx, uint64_t from,
+  uint64_t to, unsigned int n_bits)
+{
+  TYPE batch[64];
+  size_t batch_len = 0;
+  uint64_t i = from >> 6;
+  const uint64_t end = (to - 1) >> 6;
+  uint64_t word = ctx->bitmap[i] & (~0ULL << (from & 63));
+
+  for (;;) {
+    if (i == end)
+      word &= ~0ULL >> (63 - ((to - 1) & 63));
+
+    while (word != 0) {
+      batch[batch_len++] = (TYPE)(((i << 6) + bits_ctz_u64(word)) - ctx->base);
+      word &= word - 1;
+    }
+
+    encode_lower_bits(&ctx->bits_writer, batch, batch_len, n_bits);
+    batch_len = 0;
+
+    if (i == end)
+      break;
+
+    word = ctx->bitmap[++i];
+  }
+}
+
+static __always_inline void encode_cluster_leaf(struct encctx *ctx,
+  const int mode, size_t from, size_t length, unsigned int bit_pos)
+{
+  if (mode == ENC_MODE_PLAIN) {
+    encode_lower_bits(&ctx->bits_writer, ctx->values + from, length, bit_pos);
+    return;
+  }
+
+  if (ctx->bitmap != NULL) {
+    encode_bitmap_leaf(ctx, (uint64_t)ctx->base + from, cluster_end(ctx, from, bit_pos),
+                       bit_pos);
+    return;
+  }
+
+  encode_leaf(ctx, ctx->values + from * ctx->stride, length, bit_pos);
+}
+
+/*
+ * Walks the whole bit cluster tree in post-order to find out, for every
+ * cluster that needs a leaf/split flag, which option leads to the smallest
+ * cost for its subtree. A leaf costs the flag plus its lower bits, and a
+ * split costs the flag, the encoded common bits (with `path_compression`), the
+ * encoded cluster length, `split_penalty` and the optimal cost of both
+ * children.
+ *
+ * Decisions are pushed in pre-order as clusters are visited. Whenever a
+ * cluster ends up being a leaf, the decisions of its subtree are discarded,
+ * so the final sequence matches the order in which flags are encoded.
+ *
+ * If `gains` is not NULL, the difference between both costs of every
+ * cluster is also accumulated into it.
+ */
+static int compute_optimal_leaves(struct encctx *ctx,
+  struct enc_level_gains *gains)
+{
+  const unsigned int flag_bits = ctx->optimal_leaves ? 1 : 0;
+  struct dp_frame {
+    size_t        from;
+    size_t        length;
+    unsigned int  bit_pos;
+    unsigned int  split_pos;
+    size_t        n_zeros;
+    size_t        flag_pos;
+    uint64_t      split_cost;
+    int           state;
+  } frames[BITWIDTH + 1];
+  size_t depth = 0;
+
+  frames[depth++] = (struct dp_frame){0, ctx->values_len, ctx->width, 0, 0, 0, 0, 0};
+
+  while (depth > 0) {
+    struct dp_frame *f = &frames[depth - 1];
+    uint64_t cost;
+
+    if (f->state == 0) {
+      if (f->length == 0 || f->bit_pos == 0 ||
+          (ctx->skip_full_subtrees && is_full_subtree(f->length, f->bit_pos))) {
+        cost = 0;
+      } else if (f->length <= ctx->min_cluster_length[f->bit_pos]) {
+        cost = (uint64_t)f->length * f->bit_pos;
+      } else {
+        int64_t flag_pos = enc_decisions_push(&ctx->decisions);
+        if (flag_pos < 0)
+          return VTENC_ERR_NO_MEMORY;
+
+        f->flag_pos = (size_t)flag_pos;
+        f->split_pos = f->bit_pos;
+        f->split_cost = flag_bits + ctx->split_penalty;
+
+        if (ctx->path_compression && f->length >= VTENC_PATH_MIN_CLUSTER_LENGTH) {
+          TYPE first, last;
+
+          cluster_bounds(ctx, ENC_MODE_GENERAL, f->from, f->length, f->bit_pos,
+                         &first, &last);
+          f->split_pos = value_width(first ^ last);
+
+          if (f->split_pos < f->bit_pos) {
+            unsigned int n_common = f->bit_pos - f->split_pos;
+            f->split_cost += bits_len_u64(f->length) + enc_gamma_len(n_common) + n_common - 1;
+            f->from = cluster_common_from(ctx, ENC_MODE_GENERAL, f->from, first,
+                                          f->split_pos);
+          }
+        }
+
+        if (f->split_pos == 0) {
+          f->state = 2;
+          continue;
+        }
+
+        f->n_zeros = cluster_count_zeros(ctx, ENC_MODE_GENERAL, f->from, f->length,
+                                         f->split_pos - 1);
+        f->split_cost += bits_len_u64(f->length);
+        f->state = 1;
+        frames[depth++] = (struct dp_frame){f->from, f->n_zeros, f->split_pos - 1, 0, 0, 0, 0, 0};
+        continue;
+      }
+    } else if (f->state == 1) {
+      f->state = 2;
+      frames[depth++] = (struct dp_frame){
+        cluster_ones_from(ctx, ENC_MODE_GENERAL, f->from, f->n_zeros, f->split_pos - 1),
+        f->length - f->n_zeros, f->split_pos - 1, 0, 0, 0, 0, 0
+      };
+      continue;
+    } else {
+      uint64_t leaf_cost = flag_bits + (uint64_t)f->length * f->bit_pos;
+
+      if (gains != NULL) {
+        gains->gain[f->bit_pos][bits_len_u64(f->length - 1)] +=
+          (int64_t)f->split_cost - (int64_t)leaf_cost;
+      }
+
+      if (leaf_cost <= f->split_cost) {
+        enc_decisions_set_leaf(&ctx->decisions, f->flag_pos);
+        cost = leaf_cost;
+      } else {
+        cost = f->split_cost;
+      }
+    }
+
+    depth--;
+    if (depth > 0)
+      frames[depth - 1].split_cost += cost;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Checks that no value is below the configured base and, with
+ * `frame_of_reference`, takes the first value as the base instead and encodes
+ * its difference to the configured one, using as many bits as the width. That
+ * difference must fit in the width, as any other value would.
+ */
+static int encode_base(struct encctx *ctx)
+{
+  TYPE first, offset;
+
+  if (ctx->values_len == 0)
+    return VTENC_OK;
+
+  first = first_value(ctx);
+
+  if (first < ctx->base)
+    return VTENC_ERR_CONFIG;
+
+  if (ctx->frame_of_reference) {
+    offset = first - ctx->base;
+    if (value_width(offset) > ctx->width)
+      return VTENC_ERR_CONFIG;
+
+    encode_lower_bits(&ctx->bits_writer, &offset, 1, ctx->width);
+    ctx->base = first;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Checks that the largest value fits in the configured width and, if width
+ * detection is enabled, narrows the width down to the largest value's one and
+ * encodes it, so that the tree starts at that level.
+ */
+static int encode_width(struct encctx *ctx)
+{
+  unsigned int width;
+
+  if (ctx->values_len == 0)
+    return VTENC_OK;
+
+  width = value_width((TYPE)(last_value(ctx) - ctx->base));
+
+  if (width > ctx->width)
+    return VTENC_ERR_CONFIG;
+
+  if (ctx->detect_width) {
+    bswriter_write(&ctx->bits_writer, width, bits_len_u32(ctx->width));
+    ctx->width = width;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Encodes the subtree of the cluster at level `bit_pos` made of `values_len`
+ * values of an array, with no leaf flags, exactly as the general traversal
+ * below does, but faster when there are just a few values per cluster:
+ * - The levels at which a cluster doesn't split are known beforehand from its
+ *   first and last values. Its length, or 0, is written for each of them
+ *   right away, with no pushes, pops or searches.
+ * - The writer and the stack of clusters are local variables, which the
+ *   compiler can keep in registers. Through `ctx`, they'd need to be reloaded
+ *   after every store to the output, since those may alias them.
+ */
+static void encode_small_tree(struct encctx *ctx, const TYPE *values,
+  size_t values_len, unsigned int bit_pos)
+{
+  const TYPE base = ctx->base;
+  const int skip_full_subtrees = ctx->skip_full_subtrees;
+  const int path_compression = ctx->path_compression;
+  const size_t *min_cluster_length = ctx->min_cluster_length;
+  struct bswriter writer = ctx->bits_writer;
+  struct enc_bit_cluster stack[ENC_STACK_MAX_SIZE];
+  size_t depth = 0;
+
+  if (values_len > 0 && bit_pos > 0)
+    stack[depth++] = (struct enc_bit_cluster){0, values_len, bit_pos};
+
+  while (depth > 0) {
+    const struct enc_bit_cluster cluster = stack[--depth];
+    const TYPE *cl_values = values + cluster.from;
+    const size_t cl_len = cluster.length;
+    unsigned int cl_bit_pos = cluster.bit_pos;
+
+    if (skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos))
+      continue;
+
+    if (cl_len <= min_cluster_length[cl_bit_pos]) {
+      encode_lower_bits_strided(&writer, cl_values, cl_len, 1, cl_bit_pos, base);
+      continue;
+    }
+
+    const unsigned int enc_len = bits_len_u64(cl_len);
+    const TYPE first = cl_values[0] - base;
+    const unsigned int split_pos = value_width(first ^ (TYPE)(cl_values[cl_len - 1] - base));
+
+    if (path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH && split_pos < cl_bit_pos) {
+      encode_common_bits(&writer, first, cl_len, cl_bit_pos, split_pos);
+
+      if (split_pos == 0)
+        continue;
+
+      cl_bit_pos = split_pos;
+    }
+
+    for (;;) {
+      if (cl_bit_pos == split_pos) {
+        const unsigned int cur_bit_pos = cl_bit_pos - 1;
+        const size_t n_zeros = count_zeros_at_bit_pos_strided(cl_values, cl_len, 1, cur_bit_pos, base);
+
+        bswriter_write(&writer, n_zeros, enc_len);
+
+        if (cur_bit_pos > 0) {
+          stack[depth++] = (struct enc_bit_cluster){cluster.from + n_zeros, cl_len - n_zeros, cur_bit_pos};
+          stack[depth++] = (struct enc_bit_cluster){cluster.from, n_zeros, cur_bit_pos};
+        }
+        break;
+      }
+
+      /* The only child holds the same values, one level down */
+      cl_bit_pos--;
+      bswriter_write(&writer, (first >> cl_bit_pos) & 1 ? 0 : cl_len, enc_len);
+
+      if (cl_bit_pos == 0 || (skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)))
+        break;
+
+      if (cl_len <= min_cluster_length[cl_bit_pos]) {
+        encode_lower_bits_strided(&writer, cl_values, cl_len, 1, cl_bit_pos, base);
+        break;
+      }
+    }
+  }
+
+  ctx->bits_writer = writer;
+}
+
+/*
+ * It's only ever inlined with a constant `mode`, into the two copies below.
+ * encode_plain_tree() is the one for the plain lists of encode_values(), in an
+ * array with no stride, no runs, no leaf flags, no path compression, a base
+ * of 0 and the same minimum cluster length at all levels, so it's left with
+ * none of the checks for bitmaps, strides, optimal leaves and common bits, no
+ * base to subtract, and a single length to compare to.
+ * encode_bit_cluster_tree() is the one for everything else.
+ */
+static __always_inline int encode_tree(struct encctx *ctx, const int mode)
 {
-  bcltree_add(ctx, &(struct enc_bit_cluster){0, ctx->values_len, BITWIDTH});
+  const size_t min_len = ctx->min_cluster_length[0];
+
+  if (ctx->values_len <= VTENC_SMALL_ENC_MAX_LEN &&
+      (mode == ENC_MODE_PLAIN ||
+       (ctx->stride == 1 && ctx->bitmap == NULL && !ctx->optimal_leaves))) {
+    encode_small_tree(ctx, ctx->values, ctx->values_len, ctx->width);
+    return VTENC_OK;
+  }
+
+  if (mode != ENC_MODE_PLAIN && ctx->optimal_leaves) {
+    int rc = compute_optimal_leaves(ctx, NULL);
+    if (rc != VTENC_OK) {
+      enc_decisions_free(&ctx->decisions);
+      return rc;
+    }
+  }
+
+  bcltree_add(ctx, &(struct enc_bit_cluster){0, ctx->values_len, ctx->width});
+
+  while (bcltree_has_more(ctx)) {
+    struct enc_bit_cluster *cluster = bcltree_next(ctx);
+    size_t cl_from = cluster->from;
+    size_t cl_len = cluster->length;
+    unsigned int cl_bit_pos = cluster->bit_pos;
+
+    /**
+     * The zeros child of a cluster is encoded right after it, so it's taken
+     * on here rather than pushed and popped back at once. Besides the push
+     * and the pop, that saves a stall: compilers store both fields of a
+     * cluster at once with a vector instruction, which loading them one by
+     * one right away can't be forwarded from.
+     */
+    for (;;) {
+      if (ctx->skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos))
+        break;
+
+      if (cl_len <= (mode == ENC_MODE_PLAIN ? min_len : ctx->min_cluster_length[cl_bit_pos])) {
+        encode_cluster_leaf(ctx, mode, cl_from, cl_len, cl_bit_pos);
+        break;
+      }
+
+      if (mode != ENC_MODE_PLAIN && ctx->optimal_leaves) {
+        int is_leaf = enc_decisions_next(&ctx->decisions);
+
+        bswriter_write(&ctx->bits_writer, is_leaf, 1);
+
+        if (is_leaf) {
+          encode_cluster_leaf(ctx, mode, cl_from, cl_len, cl_bit_pos);
+          break;
+        }
+      }
+
+      if (mode != ENC_MODE_PLAIN && ctx->path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH) {
+        TYPE first, last;
+        unsigned int split_pos;
+
+        cluster_bounds(ctx, mode, cl_from, cl_len, cl_bit_pos, &first, &last);
+        split_pos = value_width(first ^ last);
+
+        if (split_pos < cl_bit_pos) {
+          encode_common_bits(&ctx->bits_writer, first, cl_len, cl_bit_pos, split_pos);
+
+          if (split_pos == 0)
+            break;
+
+          cl_from = cluster_common_from(ctx, mode, cl_from, first, split_pos);
+          cl_bit_pos = split_pos;
+        }
+      }
+
+      unsigned int cur_bit_pos = cl_bit_pos - 1;
+      size_t n_zeros = cluster_count_zeros(ctx, mode, cl_from, cl_len, cur_bit_pos);
+      unsigned int enc_len = bits_len_u64(cl_len);
+      bswriter_write(&ctx->bits_writer, n_zeros, enc_len);
+
+      {
+        struct enc_bit_cluster ones_cluster = {
+          cluster_ones_from(ctx, mode, cl_from, n_zeros, cur_bit_pos), cl_len - n_zeros, cur_bit_pos
+        };
+
+        bcltree_add(ctx, &ones_cluster);
+      }
+
+      if (cur_bit_pos == 0 || n_zeros == 0)
+        break;
+
+      cl_len = n_zeros;
+      cl_bit_pos = cur_bit_pos;
+    }
+  }
+
+  enc_decisions_free(&ctx->decisions);
+
+  return VTENC_OK;
+}
+
+static noinline int encode_bit_cluster_tree(struct encctx *ctx)
+{
+  return encode_tree(ctx, ENC_MODE_GENERAL);
+}
+
+static noinline int encode_plain_tree(struct encctx *ctx)
+{
+  return encode_tree(ctx, ENC_MODE_PLAIN);
+}
+
+/*
+ * Adds to `n_bits` the number of bits that encode_bit_cluster_tree() would
+ * write, going through the same clusters but only counting. Leaves take
+ * constant time, since their bits don't depend on their values.
+ */
+static int count_bit_cluster_tree(struct encctx *ctx, uint64_t *n_bits)
+{
+  uint64_t bits = 0;
+
+  if (ctx->optimal_leaves) {
+    int rc = compute_optimal_leaves(ctx, NULL);
+    if (rc != VTENC_OK) {
+      enc_decisions_free(&ctx->decisions);
+      return rc;
+    }
+  }
+
+  bcltree_add(ctx, &(struct enc_bit_cluster){0, ctx->values_len, ctx->width});
 
   while (bcltree_has_more(ctx)) {
     struct enc_bit_cluster *cluster = bcltree_next(ctx);
     size_t cl_from = cluster->from;
     size_t cl_len = cluster->length;
     unsigned int cl_bit_pos = cluster->bit_pos;
-    unsigned int cur_bit_pos = cl_bit_pos - 1;
 
     if (ctx->skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos))
       continue;
 
-    if (cl_len <= ctx->min_cluster_length) {
-      encode_lower_bits(&ctx->bits_writer, ctx->values + cl_from, cl_len, cl_bit_pos);
+    if (cl_len <= ctx->min_cluster_length[cl_bit_pos]) {
+      bits += (uint64_t)cl_len * cl_bit_pos;
       continue;
     }
 
-    size_t n_zeros = count_zeros_at_bit_pos(ctx->values + cl_from, cl_len, cur_bit_pos);
-    unsigned int enc_len = bits_len_u64(cl_len);
-    bswriter_write(&ctx->bits_writer, n_zeros, enc_len);
+    if (ctx->optimal_leaves) {
+      bits++;
+
+      if (enc_decisions_next(&ctx->decisions)) {
+        bits += (uint64_t)cl_len * cl_bit_pos;
+        continue;
+      }
+    }
+
+    if (ctx->path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH) {
+      TYPE first, last;
+      unsigned int split_pos;
+
+      cluster_bounds(ctx, ENC_MODE_GENERAL, cl_from, cl_len, cl_bit_pos, &first, &last);
+      split_pos = value_width(first ^ last);
+
+      if (split_pos < cl_bit_pos) {
+        const unsigned int n_common = cl_bit_pos - split_pos;
+
+        bits += bits_len_u64(cl_len) + enc_gamma_len(n_common) + n_common - 1;
+
+        if (split_pos == 0)
+          continue;
+
+        cl_from = cluster_common_from(ctx, ENC_MODE_GENERAL, cl_from, first, split_pos);
+        cl_bit_pos = split_pos;
+      }
+    }
+
+    unsigned int cur_bit_pos = cl_bit_pos - 1;
+    size_t n_zeros = cluster_count_zeros(ctx, ENC_MODE_GENERAL, cl_from, cl_len, cur_bit_pos);
+    bits += bits_len_u64(cl_len);
 
     {
       struct enc_bit_cluster zeros_cluster = {cl_from, n_zeros, cur_bit_pos};
-      struct enc_bit_cluster ones_cluster = {cl_from + n_zeros, cl_len - n_zeros, cur_bit_pos};
+      struct enc_bit_cluster ones_cluster = {
+        cluster_ones_from(ctx, ENC_MODE_GENERAL, cl_from, n_zeros, cur_bit_pos),
+        cl_len - n_zeros, cur_bit_pos
+      };
 
       bcltree_add(ctx, &ones_cluster);
       bcltree_add(ctx, &zeros_cluster);
     }
   }
+
+  enc_decisions_free(&ctx->decisions);
+
+  *n_bits += bits;
+
+  return VTENC_OK;
 }
 
-int vtenc_encode(vtenc *enc, const TYPE *in, size_t in_len, uint8_t *out, size_t out_cap)
+/*
+ * A cluster of values that aren't sorted yet. Minus the base, all of them
+ * have the same bits above `split_pos`, which are those of `common`.
+ */
+struct sort_cluster {
+  size_t        from;
+  size_t        length;
+  unsigned int  bit_pos;
+  unsigned int  split_pos;
+  TYPE          common;
+};
+
+/*
+ * Moves the values whose bit at `bit_pos`, once the base is subtracted, is 0
+ * in front of the rest, with no branches, and returns how many of them there
+ * are. The bits that each of the two groups have in common are gathered on
+ * the way, into `zeros` and `ones`.
+ */
+static size_t sort_partition(TYPE *values, size_t values_len, unsigned int bit_pos,
+  TYPE base, struct sort_cluster *zeros, struct sort_cluster *ones)
 {
-  int rc;
-  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
-  struct encctx ctx;
+  TYPE zeros_and = (TYPE)~(TYPE)0, zeros_or = 0;
+  TYPE ones_and = (TYPE)~(TYPE)0, ones_or = 0;
+  size_t n_zeros = 0;
 
-  enc->out_size = 0;
+  for (size_t i = 0; i < values_len; i++) {
+    const TYPE value = values[i];
+    const TYPE diff = value - base;
+    const TYPE is_one = (TYPE)0 - (TYPE)((diff >> bit_pos) & 1);
 
-  if ((uint64_t)in_len > max_values)
-    return VTENC_ERR_INPUT_TOO_BIG;
+    values[i] = values[n_zeros];
+    values[n_zeros] = value;
+    n_zeros += (size_t)(is_one == 0);
 
-  rc = encctx_init(&ctx, enc, in, in_len, out, out_cap);
-  if (rc != VTENC_OK)
-    return rc;
+    zeros_and &= diff | is_one;
+    zeros_or |= diff & (TYPE)~is_one;
+    ones_and &= diff | (TYPE)~is_one;
+    ones_or |= diff & is_one;
+  }
 
-  encode_bit_cluster_tree(&ctx);
+  zeros->split_pos = value_width(zeros_and ^ zeros_or);
+  zeros->common = zeros_and;
+  ones->split_pos = value_width(ones_and ^ ones_or);
+  ones->common = ones_and;
 
-  enc->out_size = encctx_close(&ctx);
+  return n_zeros;
+}
 
-  return rc;
+/*
+ * Sorts values that, minus the base, have the same bits above `bit_pos`, by
+ * partitioning them at every level down to short runs.
+ */
+static void sort_values(TYPE *values, size_t values_len, unsigned int bit_pos,
+  TYPE base)
+{
+  struct sort_cluster zeros, ones;
+
+  while (values_len > ENC_SORT_INSERTION_MAX_LEN && bit_pos > 0) {
+    const size_t n_zeros = sort_partition(values, values_len, --bit_pos, base, &zeros, &ones);
+
+    sort_values(values, n_zeros, bit_pos, base);
+    values += n_zeros;
+    values_len -= n_zeros;
+  }
+
+  for (size_t i = 1; i < values_len; i++) {
+    const TYPE value = values[i];
+    size_t j = i;
+
+    for (; j > 0 && values[j - 1] > value; j--)
+      values[j] = values[j - 1];
+
+    values[j] = value;
+  }
 }
 
-size_t vtenc_max_encoded_size(size_t in_len)
+/*
+ * Sorts the values of a full subtree at level `bit_pos`. If they are
+ * distinct, they are all those in its range, so each one is moved straight
+ * to its place. Otherwise, they are sorted as usual.
+ */
+static void sort_full_subtree(TYPE *values, size_t values_len,
+  unsigned int bit_pos, TYPE base)
 {
-  return bswriter_align_buffer_size((BITWIDTH / 8) * (in_len + 1));
+  const TYPE mask = (TYPE)BITS_SIZE_MASK[bit_pos];
+
+  for (size_t i = 0; i < values_len; i++) {
+    for (;;) {
+      const TYPE value = values[i];
+      const size_t j = (size_t)((TYPE)(value - base) & mask);
+
+      if (j == i)
+        break;
+
+      if (values[j] == value) {
+        sort_values(values, values_len, bit_pos, base);
+        return;
+      }
+
+      values[i] = values[j];
+      values[j] = value;
+    }
+  }
+}
+
+static void sort_encode_leaf(struct bswriter *writer, TYPE *values,
+  size_t values_len, unsigned int bit_pos, TYPE base)
+{
+  sort_values(values, values_len, bit_pos, base);
+  encode_lower_bits_strided(writer, values, values_len, 1, bit_pos, base);
+}
+
+/*
+ * Sorts the values while encoding their bit cluster tree, as the tree is the
+ * result of partitioning them by each bit, from the highest one down. A
+ * cluster is partitioned right when it's encoded, and the number of zeros
+ * is written from that. The output is the same as that of
+ * encode_small_tree() for the sorted values, which must be at the ends of
+ * the array already.
+ */
+static void sort_encode_tree(struct encctx *ctx, TYPE *values)
+{
+  const TYPE base = ctx->base;
+  const int skip_full_subtrees = ctx->skip_full_subtrees;
+  const int path_compression = ctx->path_compression;
+  const size_t *min_cluster_length = ctx->min_cluster_length;
+  struct bswriter writer = ctx->bits_writer;
+  struct sort_cluster stack[ENC_STACK_MAX_SIZE];
+  size_t depth = 0;
+
+  if (ctx->values_len > 0 && ctx->width > 0) {
+    const TYPE first = values[0] - base;
+    const TYPE last = values[ctx->values_len - 1] - base;
+
+    stack[depth++] = (struct sort_cluster){
+      0, ctx->values_len, ctx->width, value_width(first ^ last), first
+    };
+  }
+
+  while (depth > 0) {
+    const struct sort_cluster cluster = stack[--depth];
+    TYPE *cl_values = values + cluster.from;
+    const size_t cl_len = cluster.length;
+    const unsigned int split_pos = cluster.split_pos;
+    unsigned int cl_bit_pos = cluster.bit_pos;
+
+    if (skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
+      sort_full_subtree(cl_values, cl_len, cl_bit_pos, base);
+      continue;
+    }
+
+    if (cl_len <= min_cluster_length[cl_bit_pos]) {
+      sort_encode_leaf(&writer, cl_values, cl_len, cl_bit_pos, base);
+      continue;
+    }
+
+    const unsigned int enc_len = bits_len_u64(cl_len);
+
+    if (path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH && split_pos < cl_bit_pos) {
+      encode_common_bits(&writer, cluster.common, cl_len, cl_bit_pos, split_pos);
+
+      if (split_pos == 0)
+        continue;
+
+      cl_bit_pos = split_pos;
+    }
+
+    for (;;) {
+      if (cl_bit_pos == split_pos) {
+        const unsigned int cur_bit_pos = cl_bit_pos - 1;
+        struct sort_cluster zeros, ones;
+        const size_t n_zeros = sort_partition(cl_values, cl_len, cur_bit_pos, base, &zeros, &ones);
+
+        bswriter_write(&writer, n_zeros, enc_len);
+
+        if (cur_bit_pos > 0) {
+          ones.from = cluster.from + n_zeros;
+          ones.length = cl_len - n_zeros;
+          ones.bit_pos = cur_bit_pos;
+          zeros.from = cluster.from;
+          zeros.length = n_zeros;
+          zeros.bit_pos = cur_bit_pos;
+          stack[depth++] = ones;
+          stack[depth++] = zeros;
+        }
+        break;
+      }
+
+      /* The only child holds the same values, one level down */
+      cl_bit_pos--;
+      bswriter_write(&writer, (cluster.common >> cl_bit_pos) & 1 ? 0 : cl_len, enc_len);
+
+      if (cl_bit_pos == 0)
+        break;
+
+      if (skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
+        sort_full_subtree(cl_values, cl_len, cl_bit_pos, base);
+        break;
+      }
+
+      if (cl_len <= min_cluster_length[cl_bit_pos]) {
+        sort_encode_leaf(&writer, cl_values, cl_len, cl_bit_pos, base);
+        break;
+      }
+    }
+  }
+
+  ctx->bits_writer = writer;
+}
+
+/*
+ * Returns 1 if the values, `stride` elements apart, are sorted in
+ * non-decreasing order, or in strictly increasing order if `strictly` is
+ * non-zero. Contiguous values are compared in blocks with no branches in
+ * between, which the compiler turns into vector compares.
+ */
+static int is_sorted(const TYPE *values, size_t values_len, size_t stride,
+  int strictly)
+{
+  if (stride != 1) {
+    for (size_t i = 1; i < values_len; i++) {
+      const TYPE prev = values[(i - 1) * stride];
+      const TYPE cur = values[i * stride];
+
+      if (prev > cur || (strictly && prev == cur))
+        return 0;
+    }
+    return 1;
+  }
+
+  for (size_t from = 1; from < values_len; from += ENC_SORTED_BLOCK_LEN) {
+    const size_t to = MIN(from + ENC_SORTED_BLOCK_LEN, values_len);
+    int unsorted = 0;
+
+    for (size_t i = from; i < to; i++)
+      unsorted |= (values[i - 1] > values[i]) | (strictly & (values[i - 1] == values[i]));
+
+    if (unsorted)
+      return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Returns 1 if any two inputs have a value in common from `from` up to `to`,
+ * or 0 otherwise.
+ */
+static int have_common_values(const struct encctx *ctx, const size_t *from,
+  const size_t *to)
+{
+  for (size_t i = 0; i < ctx->n_inputs; i++) {
+    for (size_t j = i + 1; j < ctx->n_inputs; j++) {
+      const TYPE *a = ctx->inputs[i], *b = ctx->inputs[j];
+      size_t a_pos = from[i], b_pos = from[j];
+
+      while (a_pos < to[i] && b_pos < to[j]) {
+        if (a[a_pos] < b[b_pos])
+          a_pos++;
+        else if (b[b_pos] < a[a_pos])
+          b_pos++;
+        else
+          return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Returns the number of inputs that have values from `from` up to `to`, and
+ * sets `input` to the first of them.
+ */
+static inline size_t merged_inputs(const struct encctx *ctx, const size_t *from,
+  const size_t *to, size_t *input)
+{
+  size_t n = 0;
+
+  for (size_t i = ctx->n_inputs; i-- > 0;) {
+    if (from[i] < to[i]) {
+      *input = i;
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/*
+ * Merges up to `len` of the values of the inputs from `from` up to `to` into
+ * `buffer`, moving `from` past them, and returns how many were merged.
+ */
+static size_t merge_values(const struct encctx *ctx, size_t *from,
+  const size_t *to, TYPE *buffer, size_t len)
+{
+  size_t n = 0, min_input = 0, n_left;
+
+  while (n < len && (n_left = merged_inputs(ctx, from, to, &min_input)) > 0) {
+    if (n_left == 1) {
+      const size_t n_copy = MIN(len - n, to[min_input] - from[min_input]);
+
+      memcpy(buffer + n, ctx->inputs[min_input] + from[min_input], n_copy * sizeof(TYPE));
+      from[min_input] += n_copy;
+      return n + n_copy;
+    }
+
+    for (size_t i = min_input + 1; i < ctx->n_inputs; i++) {
+      if (from[i] < to[i] && ctx->inputs[i][from[i]] < ctx->inputs[min_input][from[min_input]])
+        min_input = i;
+    }
+
+    buffer[n++] = ctx->inputs[min_input][from[min_input]++];
+  }
+
+  return n;
+}
+
+/*
+ * Encodes the values of the inputs from `from` up to `to`, which are the
+ * whole of a leaf at level `bit_pos`, in merged order, and moves `from` up to
+ * `to`. Returns 1 if the inputs of a set turn out to have a value in common,
+ * or 0 otherwise.
+ */
+static int encode_merged_leaf(struct encctx *ctx, size_t *from,
+  const size_t *to, unsigned int bit_pos, int is_set)
+{
+  TYPE buffer[ENC_MERGE_BUFFER_LEN];
+  size_t n;
+  int is_first = 1;
+  TYPE prev = 0;
+
+  while ((n = merge_values(ctx, from, to, buffer, ENC_MERGE_BUFFER_LEN)) > 0) {
+    if (is_set && (!is_sorted(buffer, n, 1, 1) || (!is_first && buffer[0] == prev)))
+      return 1;
+
+    encode_lower_bits_strided(&ctx->bits_writer, buffer, n, 1, bit_pos, ctx->base);
+    prev = buffer[n - 1];
+    is_first = 0;
+  }
+
+  return 0;
+}
+
+/*
+ * Encodes the bit cluster tree of the values of several sorted inputs, as if
+ * they were merged. A cluster is made of a range of values of each input, so
+ * its number of zeros is the sum of those of its ranges. Once all its values
+ * come from a single input, or they are few enough to be merged on the stack,
+ * its subtree is that of a plain array.
+ * Clusters are visited in order, hence each one starts where the previous one
+ * ended, which is kept at the beginning of `merge_pos`. Only where they end is
+ * stored, right after that, once for each entry of the stack.
+ *
+ * Returns 1 if the inputs of a set turn out to have values in common, in
+ * which case the output is meaningless, or 0 otherwise.
+ */
+static int encode_merged_tree(struct encctx *ctx, int is_set)
+{
+  const size_t n_inputs = ctx->n_inputs;
+  const size_t *min_cluster_length = ctx->min_cluster_length;
+  size_t *from = ctx->merge_pos;
+  TYPE buffer[ENC_MERGE_BUFFER_LEN];
+  struct enc_bit_cluster stack[ENC_STACK_MAX_SIZE];
+  size_t depth = 0;
+
+  if (ctx->values_len > 0 && ctx->width > 0) {
+    memcpy(from + n_inputs, ctx->inputs_len, n_inputs * sizeof(size_t));
+    stack[depth++] = (struct enc_bit_cluster){0, ctx->values_len, ctx->width};
+  } else if (is_set && ctx->values_len > 1) {
+    /* With no tree, all values are the same one */
+    return 1;
+  }
+
+  while (depth > 0) {
+    const size_t cl_depth = --depth;
+    const size_t *to = from + (cl_depth + 1) * n_inputs;
+    const size_t cl_len = stack[cl_depth].length;
+    unsigned int cl_bit_pos = stack[cl_depth].bit_pos;
+    size_t input = 0;
+    const size_t cl_inputs = merged_inputs(ctx, from, to, &input);
+
+    if (cl_inputs <= 1) {
+      if (cl_inputs == 1) {
+        encode_small_tree(ctx, ctx->inputs[input] + from[input], cl_len, cl_bit_pos);
+        from[input] = to[input];
+      }
+      continue;
+    }
+
+    if (cl_len <= ENC_MERGE_BUFFER_LEN) {
+      merge_values(ctx, from, to, buffer, cl_len);
+
+      if (is_set && !is_sorted(buffer, cl_len, 1, 1))
+        return 1;
+
+      encode_small_tree(ctx, buffer, cl_len, cl_bit_pos);
+      continue;
+    }
+
+    if (ctx->skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
+      if (have_common_values(ctx, from, to))
+        return 1;
+
+      memcpy(from, to, n_inputs * sizeof(size_t));
+      continue;
+    }
+
+    if (cl_len <= min_cluster_length[cl_bit_pos]) {
+      if (encode_merged_leaf(ctx, from, to, cl_bit_pos, is_set))
+        return 1;
+      continue;
+    }
+
+    if (ctx->path_compression && cl_len >= VTENC_PATH_MIN_CLUSTER_LENGTH) {
+      const TYPE first = merged_first(ctx, from, to) - ctx->base;
+      const TYPE last = merged_last(ctx, from, to) - ctx->base;
+      const unsigned int split_pos = value_width(first ^ last);
+
+      if (split_pos < cl_bit_pos) {
+        encode_common_bits(&ctx->bits_writer, first, cl_len, cl_bit_pos, split_pos);
+
+        if (split_pos == 0) {
+          if (is_set)
+            return 1;
+
+          memcpy(from, to, n_inputs * sizeof(size_t));
+          continue;
+        }
+
+        cl_bit_pos = split_pos;
+      }
+    }
+
+    const unsigned int cur_bit_pos = cl_bit_pos - 1;
+    size_t *zeros_to = from + (cl_depth + 2) * n_inputs;
+    size_t n_zeros = 0;
+
+    for (size_t i = 0; i < n_inputs; i++) {
+      size_t input_zeros = 0;
+
+      if (from[i] < to[i]) {
+        input_zeros = count_zeros_at_bit_pos_strided(ctx->inputs[i] + from[i], to[i] - from[i],
+                                                     1, cur_bit_pos, ctx->base);
+      }
+
+      zeros_to[i] = from[i] + input_zeros;
+      n_zeros += input_zeros;
+    }
+
+    bswriter_write(&ctx->bits_writer, n_zeros, bits_len_u64(cl_len));
+
+    if (cur_bit_pos == 0) {
+      /* Clusters at level 0 hold a single value, repeated or not */
+      if (is_set && (n_zeros > 1 || cl_len - n_zeros > 1))
+        return 1;
+
+      memcpy(from, to, n_inputs * sizeof(size_t));
+      continue;
+    }
+
+    /* The ones cluster ends where its parent does, so it keeps its ends */
+    stack[depth++] = (struct enc_bit_cluster){0, cl_len - n_zeros, cur_bit_pos};
+    stack[depth++] = (struct enc_bit_cluster){0, n_zeros, cur_bit_pos};
+  }
+
+  return 0;
+}
+
+/*
+ * Returns the index right after the run of values equal to `values[from]`,
+ * values being `stride` elements apart. It gallops forward first, so long runs
+ * are found in logarithmic time.
+ */
+static inline size_t run_end(const TYPE *values, size_t values_len,
+  size_t stride, size_t from)
+{
+  const TYPE value = values[from * stride];
+  size_t lo = from + 1;
+  size_t step = 1;
+
+  while (lo + step < values_len && values[(lo + step) * stride] == value) {
+    lo += step + 1;
+    step <<= 1;
+  }
+
+  size_t hi = MIN(lo + step, values_len);
+
+  while (lo < hi) {
+    size_t mid = lo + ((hi - lo) >> 1);
+    if (values[mid * stride] == value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static size_t count_distinct(const TYPE *values, size_t values_len, size_t stride)
+{
+  size_t count = 0;
+
+  for (size_t i = 0; i < values_len; i = run_end(values, values_len, stride, i))
+    count++;
+
+  return count;
+}
+
+static void copy_distinct(TYPE *distinct, const TYPE *values, size_t values_len,
+  size_t stride)
+{
+  for (size_t i = 0; i < values_len; i = run_end(values, values_len, stride, i))
+    *distinct++ = values[i * stride];
+}
+
+/*
+ * Encodes the length of every run of repeated values in blocks of
+ * VTENC_RUNS_BLOCK_LEN runs. Each block starts with the bit width needed to
+ * represent its longest run, followed by the (length - 1) of each run.
+ */
+static void encode_run_lengths(struct bswriter *writer,
+  const TYPE *values, size_t values_len, size_t stride)
+{
+  uint64_t runs[VTENC_RUNS_BLOCK_LEN];
+  size_t i = 0;
+
+  while (i < values_len) {
+    size_t n_runs = 0;
+    uint64_t runs_or = 0;
+    unsigned int width;
+
+    while (n_runs < VTENC_RUNS_BLOCK_LEN && i < values_len) {
+      size_t next = run_end(values, values_len, stride, i);
+      runs[n_runs] = next - i - 1;
+      runs_or |= runs[n_runs];
+      n_runs++;
+      i = next;
+    }
+
+    width = runs_or ? bits_len_u64(runs_or) : 0;
+    bswriter_write(writer, width, VTENC_RUNS_WIDTH_BITS);
+
+    if (width == 0)
+      continue;
+
+    for (size_t j = 0; j < n_runs; j++)
+      bswriter_write(writer, runs[j], width);
+  }
+}
+
+/* Returns the number of bits that encode_run_lengths() would write */
+static uint64_t count_run_lengths(const TYPE *values, size_t values_len,
+  size_t stride)
+{
+  uint64_t n_bits = 0;
+  size_t i = 0;
+
+  while (i < values_len) {
+    size_t n_runs = 0;
+    uint64_t runs_or = 0;
+    unsigned int width;
+
+    while (n_runs < VTENC_RUNS_BLOCK_LEN && i < values_len) {
+      size_t next = run_end(values, values_len, stride, i);
+      runs_or |= next - i - 1;
+      n_runs++;
+      i = next;
+    }
+
+    width = runs_or ? bits_len_u64(runs_or) : 0;
+    n_bits += VTENC_RUNS_WIDTH_BITS + (uint64_t)n_runs * width;
+  }
+
+  return n_bits;
+}
+
+/*
+ * Tells whether a list of `values_len` values, `distinct_len` of them
+ * distinct, is better encoded as its distinct values and run lengths than as
+ * it is. A tree of m values at level `width` never takes more than
+ * m * `width` bits, plus the leaf flag of its root with optimal leaves, which
+ * the tree of the distinct values and that of the whole list both pay. So with
+ * runs, the list certainly stays within the bound of the list as it is if the
+ * distinct count and the run lengths take no more bits than the repeated
+ * values they leave out.
+ */
+static int runs_pay_off(const TYPE *values, size_t values_len, size_t stride,
+  size_t distinct_len, unsigned int width)
+{
+  uint64_t n_bits;
+
+  if (distinct_len == values_len)
+    return 0;
+
+  n_bits = bits_len_u64(values_len) + count_run_lengths(values, values_len, stride);
+
+  return n_bits <= (uint64_t)(values_len - distinct_len) * width;
+}
+
+static int encode_with_runs(vtenc *enc, const TYPE *in, size_t in_len,
+  size_t stride, uint8_t *out, size_t out_cap, const struct vtenc_sink *sink)
+{
+  struct encctx ctx;
+  TYPE *distinct = NULL;
+  size_t distinct_len;
+  int with_runs, rc;
+
+  rc = encctx_init(&ctx, enc, in, in_len, stride, out, out_cap);
+  if (rc != VTENC_OK)
+    return rc;
+
+  ctx.bits_writer.sink = sink;
+
+  if (in_len == 0)
+    return encctx_close(&ctx, enc);
+
+  rc = encode_base(&ctx);
+  if (rc != VTENC_OK)
+    return rc;
+
+  rc = encode_width(&ctx);
+  if (rc != VTENC_OK)
+    return rc;
+
+  distinct_len = count_distinct(in, in_len, stride);
+
+  /* Otherwise, the list is encoded as it is, after a flag bit */
+  with_runs = runs_pay_off(in, in_len, stride, distinct_len, ctx.width);
+  bswriter_write(&ctx.bits_writer, with_runs, 1);
+
+  if (!with_runs) {
+    return_if_error(encode_bit_cluster_tree(&ctx));
+    return encctx_close(&ctx, enc);
+  }
+
+  distinct = malloc(distinct_len * sizeof(*distinct));
+  if (distinct == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  copy_distinct(distinct, in, in_len, stride);
+  ctx.values = distinct;
+  ctx.values_len = distinct_len;
+  ctx.stride = 1;
+
+  /* Distinct values are a set, so full subtrees can be skipped */
+  ctx.skip_full_subtrees = enc->params.skip_full_subtrees;
+
+  bswriter_write(&ctx.bits_writer, distinct_len, bits_len_u64(in_len));
+
+  rc = encode_bit_cluster_tree(&ctx);
+
+  if (rc == VTENC_OK) {
+    encode_run_lengths(&ctx.bits_writer, in, in_len, stride);
+    rc = encctx_close(&ctx, enc);
+  }
+
+  free(distinct);
+
+  return rc;
+}
+
+/*
+ * Encodes `in_len` values that are `stride` elements apart from each other,
+ * into `out` or, if `sink` is not NULL, through it, using `out` as a buffer.
+ */
+static int encode_values(vtenc *enc, const TYPE *in, size_t in_len,
+  size_t stride, uint8_t *out, size_t out_cap, const struct vtenc_sink *sink)
+{
+  int rc;
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  struct encctx ctx;
+
+  if ((uint64_t)in_len > max_values)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  if (enc->params.strict &&
+      !is_sorted(in, in_len, stride, !enc->params.allow_repeated_values))
+    return VTENC_ERR_NOT_SORTED;
+
+  if (enc->params.allow_repeated_values && enc->params.run_length_encoding)
+    return encode_with_runs(enc, in, in_len, stride, out, out_cap, sink);
+
+  rc = encctx_init(&ctx, enc, in, in_len, stride, out, out_cap);
+  if (rc != VTENC_OK)
+    return rc;
+
+  ctx.bits_writer.sink = sink;
+
+  return_if_error(encode_base(&ctx));
+
+  return_if_error(encode_width(&ctx));
+
+  if (stride == 1 && !ctx.optimal_leaves && !ctx.path_compression &&
+      ctx.base == 0 && ctx.uniform_min_cluster_length)
+    return_if_error(encode_plain_tree(&ctx));
+  else
+    return_if_error(encode_bit_cluster_tree(&ctx));
+
+  return encctx_close(&ctx, enc);
+}
+
+int vtenc_encode(vtenc *enc, const TYPE *in, size_t in_len, uint8_t *out, size_t out_cap)
+{
+  enc->out_size = 0;
+
+  return encode_values(enc, in, in_len, 1, out, out_cap, NULL);
+}
+
+int vtenc_encode_to_sink(vtenc *enc, const TYPE *in, size_t in_len,
+  const struct vtenc_sink *sink)
+{
+  uint8_t buffer[ENC_SINK_BUFFER_SIZE];
+
+  enc->out_size = 0;
+
+  return encode_values(enc, in, in_len, 1, buffer, sizeof(buffer), sink);
+}
+
+int vtenc_encode_strided(vtenc *enc, const void *in, size_t in_len,
+  size_t stride, size_t offset, uint8_t *out, size_t out_cap)
+{
+  enc->out_size = 0;
+
+  if (stride % sizeof(TYPE) != 0 || offset % sizeof(TYPE) != 0 ||
+      offset + sizeof(TYPE) > stride)
+    return VTENC_ERR_CONFIG;
+
+  return encode_values(enc, (const TYPE *)((const uint8_t *)in + offset),
+                       in_len, stride / sizeof(TYPE), out, out_cap, NULL);
+}
+
+int vtenc_encode_from_bitmap(vtenc *enc, const uint64_t *bitmap, size_t bitmap_len,
+  uint8_t *out, size_t out_cap)
+{
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  int with_runs = enc->params.allow_repeated_values && enc->params.run_length_encoding;
+  struct encctx ctx;
+  uint64_t values_len;
+  int rc;
+
+  enc->out_size = 0;
+
+#if BITWIDTH < 64
+  if ((uint64_t)bitmap_len > ((uint64_t)1 << BITWIDTH))
+    return VTENC_ERR_INPUT_TOO_BIG;
+#endif
+
+  values_len = bitmap_count(bitmap, 0, bitmap_len);
+
+  if (values_len > max_values)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  rc = encctx_init(&ctx, enc, NULL, (size_t)values_len, 1, out, out_cap);
+  if (rc != VTENC_OK)
+    return rc;
+
+  ctx.bitmap = bitmap;
+  ctx.bitmap_len = bitmap_len;
+
+  return_if_error(encode_base(&ctx));
+
+  return_if_error(encode_width(&ctx));
+
+  /* All values are distinct, so runs never pay off */
+  if (with_runs && values_len > 0)
+    bswriter_write(&ctx.bits_writer, 0, 1);
+
+  return_if_error(encode_bit_cluster_tree(&ctx));
+
+  return encctx_close(&ctx, enc);
+}
+
+int vtenc_encoded_size_exact(vtenc *enc, const TYPE *in, size_t in_len)
+{
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  /* Room for the base and the width, which are written as usual */
+  uint8_t header[32];
+  struct encctx ctx;
+  TYPE *distinct = NULL;
+  uint64_t n_bits;
+  int rc;
+
+  enc->out_size = 0;
+
+  if ((uint64_t)in_len > max_values)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  if (enc->params.strict &&
+      !is_sorted(in, in_len, 1, !enc->params.allow_repeated_values))
+    return VTENC_ERR_NOT_SORTED;
+
+  rc = encctx_init(&ctx, enc, in, in_len, 1, header, sizeof(header));
+  if (rc != VTENC_OK)
+    return rc;
+
+  return_if_error(encode_base(&ctx));
+
+  return_if_error(encode_width(&ctx));
+
+  n_bits = bswriter_bits(&ctx.bits_writer);
+
+  if (enc->params.allow_repeated_values && enc->params.run_length_encoding && in_len > 0) {
+    const size_t distinct_len = count_distinct(in, in_len, 1);
+
+    n_bits += 1;
+
+    if (runs_pay_off(in, in_len, 1, distinct_len, ctx.width)) {
+      distinct = malloc(distinct_len * sizeof(*distinct));
+      if (distinct == NULL)
+        return VTENC_ERR_NO_MEMORY;
+
+      copy_distinct(distinct, in, in_len, 1);
+      ctx.values = distinct;
+      ctx.values_len = distinct_len;
+      ctx.skip_full_subtrees = enc->params.skip_full_subtrees;
+      n_bits += bits_len_u64(in_len) + count_run_lengths(in, in_len, 1);
+    }
+  }
+
+  rc = count_bit_cluster_tree(&ctx, &n_bits);
+
+  if (rc == VTENC_OK)
+    enc->out_size = (size_t)((n_bits + 7) / 8);
+
+  free(distinct);
+
+  return rc;
+}
+
+/*
+ * Encodes values that were just sorted in place, leaving only one of each
+ * if they are a set.
+ */
+static int encode_sorted_values(vtenc *enc, TYPE *values, size_t values_len,
+  uint8_t *out, size_t out_cap, size_t *sorted_len)
+{
+  if (!enc->params.allow_repeated_values) {
+    const size_t distinct_len = count_distinct(values, values_len, 1);
+
+    copy_distinct(values, values, values_len, 1);
+    values_len = distinct_len;
+  }
+
+  if (sorted_len != NULL)
+    *sorted_len = values_len;
+
+  return encode_values(enc, values, values_len, 1, out, out_cap, NULL);
+}
+
+int vtenc_sort_encode(vtenc *enc, TYPE *in, size_t in_len, uint8_t *out,
+  size_t out_cap, size_t *sorted_len)
+{
+  const int is_set = !enc->params.allow_repeated_values;
+  struct encctx ctx;
+  size_t min_pos = 0, max_pos = 0;
+  int rc;
+
+  enc->out_size = 0;
+
+  if ((uint64_t)in_len > LIST_MAX_VALUES)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  /*
+   * Leaf flags and runs can't be written until the whole tree is known, and a
+   * set that is too long may still shrink once sorted, so these cases are
+   * sorted first and encoded afterwards.
+   */
+  if (enc->params.optimal_leaves || (!is_set && enc->params.run_length_encoding) ||
+      (is_set && (uint64_t)in_len > SET_MAX_VALUES)) {
+    sort_values(in, in_len, BITWIDTH, 0);
+    return encode_sorted_values(enc, in, in_len, out, out_cap, sorted_len);
+  }
+
+  /* The smallest and largest values go where they'd be once sorted */
+  for (size_t i = 1; i < in_len; i++) {
+    if (in[i] < in[min_pos])
+      min_pos = i;
+    if (in[i] > in[max_pos])
+      max_pos = i;
+  }
+
+  if (in_len > 0) {
+    const TYPE min = in[min_pos], max = in[max_pos];
+
+    in[min_pos] = in[0];
+    in[0] = min;
+    if (max_pos == 0)
+      max_pos = min_pos;
+    in[max_pos] = in[in_len - 1];
+    in[in_len - 1] = max;
+  }
+
+  rc = encctx_init(&ctx, enc, in, in_len, 1, out, out_cap);
+  if (rc != VTENC_OK)
+    return rc;
+
+  return_if_error(encode_base(&ctx));
+
+  return_if_error(encode_width(&ctx));
+
+  sort_encode_tree(&ctx, in);
+
+  /* A set with repeated values is encoded again without them */
+  if (is_set && !is_sorted(in, in_len, 1, 1))
+    return encode_sorted_values(enc, in, in_len, out, out_cap, sorted_len);
+
+  if (sorted_len != NULL)
+    *sorted_len = in_len;
+
+  return encctx_close(&ctx, enc);
+}
+
+/*
+ * Encodes the values of several sorted inputs by copying them into a single
+ * array and sorting it first.
+ */
+static int encode_merged_copy(vtenc *enc, const TYPE *const *ins,
+  const size_t *ins_len, size_t n_ins, size_t values_len, uint8_t *out,
+  size_t out_cap, size_t *merged_len)
+{
+  TYPE *values = malloc(MAX(values_len, 1) * sizeof(*values));
+  size_t len = 0;
+  int rc;
+
+  if (values == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  for (size_t i = 0; i < n_ins; i++) {
+    memcpy(values + len, ins[i], ins_len[i] * sizeof(*values));
+    len += ins_len[i];
+  }
+
+  sort_values(values, values_len, BITWIDTH, 0);
+
+  rc = encode_sorted_values(enc, values, values_len, out, out_cap, merged_len);
+
+  free(values);
+
+  return rc;
+}
+
+int vtenc_encode_merged(vtenc *enc, const TYPE *const *ins, const size_t *ins_len,
+  size_t n_ins, uint8_t *out, size_t out_cap, size_t *merged_len)
+{
+  const int is_set = !enc->params.allow_repeated_values;
+  uint64_t max_values = is_set ? SET_MAX_VALUES : LIST_MAX_VALUES;
+  uint64_t values_len = 0;
+  struct encctx ctx;
+  int rc;
+
+  enc->out_size = 0;
+
+  for (size_t i = 0; i < n_ins; i++) {
+    if (enc->params.strict && !is_sorted(ins[i], ins_len[i], 1, is_set))
+      return VTENC_ERR_NOT_SORTED;
+
+    values_len += ins_len[i];
+    if (values_len > LIST_MAX_VALUES)
+      return VTENC_ERR_INPUT_TOO_BIG;
+  }
+
+  /*
+   * Leaf flags and runs can only be written once the whole tree is known, and
+   * a set that is too long may still shrink once merged, so these cases are
+   * merged first.
+   */
+  if (enc->params.optimal_leaves || (!is_set && enc->params.run_length_encoding) ||
+      values_len > max_values) {
+    return encode_merged_copy(enc, ins, ins_len, n_ins, (size_t)values_len, out, out_cap,
+                              merged_len);
+  }
+
+  rc = encctx_init(&ctx, enc, NULL, (size_t)values_len, 1, out, out_cap);
+  if (rc != VTENC_OK)
+    return rc;
+
+  ctx.inputs = ins;
+  ctx.inputs_len = ins_len;
+  ctx.n_inputs = n_ins;
+  /* Where clusters start, and where each of the stack and its zeros child end */
+  ctx.merge_pos = calloc((ENC_STACK_MAX_SIZE + 2) * MAX(n_ins, 1), sizeof(size_t));
+  if (ctx.merge_pos == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = encode_base(&ctx);
+
+  if (rc == VTENC_OK)
+    rc = encode_width(&ctx);
+
+  if (rc == VTENC_OK && encode_merged_tree(&ctx, is_set)) {
+    /* The inputs of a set have values in common, which are left out once merged */
+    free(ctx.merge_pos);
+    return encode_merged_copy(enc, ins, ins_len, n_ins, (size_t)values_len, out, out_cap,
+                              merged_len);
+  }
+
+  if (rc == VTENC_OK) {
+    if (merged_len != NULL)
+      *merged_len = (size_t)values_len;
+
+    rc = encctx_close(&ctx, enc);
+  }
+
+  free(ctx.merge_pos);
+
+  return rc;
+}
+
+int vtenc_suggest_min_cluster_lengths(vtenc *enc, const TYPE *sample,
+  size_t sample_len, size_t *lengths)
+{
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  uint8_t unused_out[sizeof(uint64_t)];
+  struct enc_level_gains *gains;
+  struct encctx ctx;
+  int rc;
+
+  if ((uint64_t)sample_len > max_values)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  gains = calloc(1, sizeof(*gains));
+  if (gains == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  /* Nothing is written, but the context needs a valid output buffer */
+  rc = encctx_init(&ctx, enc, sample, sample_len, 1, unused_out, sizeof(unused_out));
+  if (rc != VTENC_OK) {
+    free(gains);
+    return rc;
+  }
+
+  /* Build the same tree as the encoder would */
+  if (ctx.frame_of_reference && sample_len > 0)
+    ctx.base = sample[0];
+  if (ctx.detect_width && sample_len > 0)
+    ctx.width = MIN(ctx.width, value_width((TYPE)(sample[sample_len - 1] - ctx.base)));
+
+  /* Evaluate every cluster of length 2 or more, with no leaf flags */
+  ctx.optimal_leaves = 0;
+  for (unsigned int i = 0; i <= BITWIDTH; i++) {
+    ctx.min_cluster_length[i] = 1;
+  }
+  ctx.uniform_min_cluster_length = 1;
+
+  rc = compute_optimal_leaves(&ctx, gains);
+  enc_decisions_free(&ctx.decisions);
+
+  if (rc == VTENC_OK) {
+    for (unsigned int i = 0; i <= BITWIDTH; i++) {
+      int64_t acc_gain = 0, best_gain = 0;
+      unsigned int best_bucket = 0;
+
+      for (unsigned int k = 1; k < ENC_LENGTH_BUCKETS; k++) {
+        acc_gain += gains->gain[i][k];
+        if (acc_gain > best_gain) {
+          best_gain = acc_gain;
+          best_bucket = k;
+        }
+      }
+
+      lengths[i] = (size_t)1 << best_bucket;
+    }
+  }
+
+  free(gains);
+
+  return rc;
+}
+
+size_t vtenc_max_encoded_size(size_t in_len)
+{
+  return bswriter_align_buffer_size((BITWIDTH / 8) * (in_len + 1));
+}
+
+/*
+ * Returns an upper bound of the bits of the tree of `len` values that starts
+ * at level `width`, when all the values have the same bits above `split_pos`.
+ * Down to `split_pos`, there's a single cluster per level. Below it, a cluster
+ * of m values at level b never takes more than m * b bits, since splitting it
+ * takes fewer bits than the m it loses from every value. With leaf flags,
+ * the cost of a cluster, split penalties included, is never above that of
+ * making it a leaf, 1 + m * b, so the bound is the best of making each of the
+ * top clusters a leaf.
+ */
+static uint64_t max_tree_bits(const vtenc *enc, uint64_t len, unsigned int width,
+  unsigned int split_pos)
+{
+  const int optimal_leaves = enc->params.optimal_leaves;
+  uint64_t n_bits = 0, best = UINT64_MAX;
+
+  if (len == 0)
+    return 0;
+
+  for (unsigned int bit_pos = width; bit_pos > split_pos; bit_pos--) {
+    const size_t min_len = enc->params.min_cluster_length[bit_pos];
+
+    if (len <= (optimal_leaves ? MAX(min_len, 2) : min_len))
+      return MIN(best, n_bits + len * bit_pos);
+
+    if (optimal_leaves) {
+      best = MIN(best, n_bits + 1 + len * bit_pos);
+      n_bits += 1 + enc->params.split_penalty;
+    }
+
+    if (enc->params.path_compression && len >= VTENC_PATH_MIN_CLUSTER_LENGTH) {
+      const unsigned int n_common = bit_pos - split_pos;
+
+      n_bits += bits_len_u64(len) + enc_gamma_len(n_common) + n_common - 1;
+      if (split_pos > 0)
+        n_bits += bits_len_u64(len) + len * split_pos;
+
+      return MIN(best, n_bits);
+    }
+
+    n_bits += bits_len_u64(len);
+  }
+
+  if (split_pos > 0)
+    n_bits += (optimal_leaves ? 1 : 0) + len * split_pos;
+
+  return MIN(best, n_bits);
+}
+
+size_t vtenc_max_encoded_size_range(const vtenc *enc, size_t in_len, TYPE min, TYPE max)
+{
+  const unsigned int conf_width = MIN(enc->params.width, BITWIDTH);
+  TYPE base = (TYPE)enc->params.base;
+  unsigned int width = conf_width, split_pos;
+  uint64_t n_bits = 0;
+
+  if (in_len == 0)
+    return bswriter_align_buffer_size(0);
+
+  if (enc->params.base > (TYPE)~(TYPE)0 || min > max || max < base)
+    return vtenc_max_encoded_size(in_len);
+
+  /* Values below the base or too wide for the width can't be encoded */
+  min = MAX(min, base);
+
+  if (enc->params.frame_of_reference) {
+    n_bits += conf_width;
+    base = min;
+  }
+
+  if (enc->params.detect_width) {
+    n_bits += bits_len_u32(conf_width);
+    width = MIN(value_width((TYPE)(max - base)), conf_width);
+  }
+
+  split_pos = MIN(value_width((TYPE)((min - base) ^ (max - base))), width);
+
+  if (enc->params.allow_repeated_values && enc->params.run_length_encoding) {
+    /*
+     * With runs, the tree holds d distinct values, which take up to
+     * 1 + d * width bits, and every run length takes up to bits_len(n - d)
+     * bits. For each of those bit lengths, the bound is the largest for the
+     * highest d. Runs are only used when they take no more than the whole
+     * list would, 1 + n * width bits, and otherwise the list's own tree
+     * follows the flag bit.
+     */
+    const uint64_t range = (uint64_t)(TYPE)(max - min);
+    const uint64_t max_distinct = range < in_len ? range + 1 : in_len;
+    uint64_t max_bits = 0;
+
+    for (unsigned int runs_width = 0; runs_width <= 64; runs_width++) {
+      uint64_t d = max_distinct;
+
+      if (runs_width > 0) {
+        const uint64_t min_rest = (uint64_t)1 << (runs_width - 1);
+
+        if (min_rest >= in_len)
+          break;
+
+        d = MIN(d, in_len - min_rest);
+      }
+
+      max_bits = MAX(max_bits, 1 + d * width +
+        ((d + VTENC_RUNS_BLOCK_LEN - 1) / VTENC_RUNS_BLOCK_LEN) * VTENC_RUNS_WIDTH_BITS +
+        d * value_width(in_len - d));
+    }
+
+    n_bits += 1 + MAX(max_tree_bits(enc, in_len, width, split_pos),
+      MIN(bits_len_u64(in_len) + max_bits, 1 + (uint64_t)in_len * width));
+  } else {
+    n_bits += max_tree_bits(enc, in_len, width, split_pos);
+  }
+
+  return bswriter_align_buffer_size((size_t)((n_bits + 7) / 8));
 }
@@ -12,13 +12,14 @@
 #define batch3               batch_(BITWIDTH, 3)
 #define batch4               batch_(BITWIDTH, 4)
 
-static inline void batch1(
+static __always_inline void batch1(
   struct bswriter *writer,
   const TYPE *values,
-  unsigned int n_bits)
+  unsigned int n_bits,
+  TYPE offset)
 {
 #if BITWIDTH == 64
-  uint64_t value = values[0];
+  uint64_t value = (TYPE)(values[0] - offset);
   if (n_bits > BIT_STREAM_MAX_WRITE) {
     bswriter_append(writer, value, BIT_STREAM_MAX_WRITE);
     bswriter_flush(writer);
@@ -28,41 +29,47 @@ static inline void batch1(
   bswriter_append(writer, value, n_bits);
   bswriter_flush(writer);
 #else
-  bswriter_append(writer, values[0], n_bits);
+  bswriter_append(writer, (TYPE)(values[0] - offset), n_bits);
   bswriter_flush(writer);
 #endif
 }
 
-static inline void batch2(
+static __always_inline void batch2(
   struct bswriter *writer,
   const TYPE *values,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
-  bswriter_append(writer, values[0], n_bits);
-  bswriter_append(writer, values[1], n_bits);
+  bswriter_append(writer, (TYPE)(values[0] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[stride] - offset), n_bits);
   bswriter_flush(writer);
 }
 
-static inline void batch3(
+static __always_inline void batch3(
   struct bswriter *writer,
   const TYPE *values,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
-  bswriter_append(writer, values[0], n_bits);
-  bswriter_append(writer, values[1], n_bits);
-  bswriter_append(writer, values[2], n_bits);
+  bswriter_append(writer, (TYPE)(values[0] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[stride] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[2 * stride] - offset), n_bits);
   bswriter_flush(writer);
 }
 
-static inline void batch4(
+static __always_inline void batch4(
   struct bswriter *writer,
   const TYPE *values,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
-  bswriter_append(writer, values[0], n_bits);
-  bswriter_append(writer, values[1], n_bits);
-  bswriter_append(writer, values[2], n_bits);
-  bswriter_append(writer, values[3], n_bits);
+  bswriter_append(writer, (TYPE)(values[0] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[stride] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[2 * stride] - offset), n_bits);
+  bswriter_append(writer, (TYPE)(values[3 * stride] - offset), n_bits);
   bswriter_flush(writer);
 }
 
@@ -72,67 +79,102 @@ static inline void batch4(
 #define in_batches3               in_batches_(BITWIDTH, 3)
 #define in_batches4               in_batches_(BITWIDTH, 4)
 
-static inline void in_batches1(
+static __always_inline void in_batches1(
   struct bswriter *writer,
   const TYPE *values,
   size_t values_len,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
   size_t i;
 
   for (i = 0; i < values_len; i++) {
-    batch1(writer, values + i, n_bits);
+    batch1(writer, values + i * stride, n_bits, offset);
   }
 }
 
-static inline void in_batches2(
+static __always_inline void in_batches2(
   struct bswriter *writer,
   const TYPE *values,
   size_t values_len,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
   while (values_len >= 2) {
-    batch2(writer, values, n_bits);
-    values += 2;
+    batch2(writer, values, stride, n_bits, offset);
+    values += 2 * stride;
     values_len -= 2;
   }
 
-  in_batches1(writer, values, values_len, n_bits);
+  in_batches1(writer, values, values_len, stride, n_bits, offset);
 }
 
-static inline void in_batches3(
+static __always_inline void in_batches3(
   struct bswriter *writer,
   const TYPE *values,
   size_t values_len,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
   while (values_len >= 3) {
-    batch3(writer, values, n_bits);
-    values += 3;
+    batch3(writer, values, stride, n_bits, offset);
+    values += 3 * stride;
     values_len -= 3;
   }
 
-  in_batches1(writer, values, values_len, n_bits);
+  in_batches1(writer, values, values_len, stride, n_bits, offset);
 }
 
-static inline void in_batches4(
+static __always_inline void in_batches4(
   struct bswriter *writer,
   const TYPE *values,
   size_t values_len,
-  unsigned int n_bits)
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
 {
   while (values_len >= 4) {
-    batch4(writer, values, n_bits);
-    values += 4;
+    batch4(writer, values, stride, n_bits, offset);
+    values += 4 * stride;
     values_len -= 4;
   }
 
-  in_batches1(writer, values, values_len, n_bits);
+  in_batches1(writer, values, values_len, stride, n_bits, offset);
 }
 
-#define encode_lower_bits_(_width_) BITWIDTH_SUFFIX(encode_lower_bits, _width_)
-#define encode_lower_bits           encode_lower_bits_(BITWIDTH)
+#define encode_lower_bits_strided_(_width_) BITWIDTH_SUFFIX(encode_lower_bits_strided, _width_)
+#define encode_lower_bits_strided           encode_lower_bits_strided_(BITWIDTH)
+#define encode_lower_bits_(_width_)         BITWIDTH_SUFFIX(encode_lower_bits, _width_)
+#define encode_lower_bits                   encode_lower_bits_(BITWIDTH)
+
+/*
+ * Encodes the lower `n_bits` of each value minus `offset`, values being
+ * `stride` elements apart. Since subtraction wraps around, those are also the
+ * lower bits of the difference.
+ */
+static inline void encode_lower_bits_strided(
+  struct bswriter *writer,
+  const TYPE *values,
+  size_t values_len,
+  size_t stride,
+  unsigned int n_bits,
+  TYPE offset)
+{
+  switch (batch_sz_table[n_bits]) {
+    case 1: in_batches1(writer, values, values_len, stride, n_bits, offset); break;
+    case 2: in_batches2(writer, values, values_len, stride, n_bits, offset); break;
+    case 3: in_batches3(writer, values, values_len, stride, n_bits, offset); break;
+    case 4: in_batches4(writer, values, values_len, stride, n_bits, offset); break;
+  }
+}
 
+/*
+ * Same as encode_lower_bits_strided() with no stride or offset, as a copy of
+ * its own, which reads the values one after the other and subtracts nothing.
+ */
 static inline void encode_lower_bits(
   struct bswriter *writer,
   const TYPE *values,
@@ -140,9 +182,9 @@ static inline void encode_lower_bits(
   unsigned int n_bits)
 {
   switch (batch_sz_table[n_bits]) {
-    case 1: in_batches1(writer, values, values_len, n_bits); break;
-    case 2: in_batches2(writer, values, values_len, n_bits); break;
-    case 3: in_batches3(writer, values, values_len, n_bits); break;
-    case 4: in_batches4(writer, values, values_len, n_bits); break;
+    case 1: in_batches1(writer, values, values_len, 1, n_bits, 0); break;
+    case 2: in_batches2(writer, values, values_len, 1, n_bits, 0); break;
+    case 3: in_batches3(writer, values, values_len, 1, n_bits, 0); break;
+    case 4: in_batches4(writer, values, values_len, 1, n_bits, 0); break;
   }
 }
@@ -31,12 +31,44 @@
 #define VTENC_SET_MAX_VALUES32    MIN(BITS_POS_MASK64[32], VTENC_MAX_VALUES_LIMIT)
 #define VTENC_SET_MAX_VALUES64    MIN(BITS_SIZE_MASK[64], VTENC_MAX_VALUES_LIMIT)
 
+/* Number of levels of the deepest bit cluster tree (for 64-bit values) */
+#define VTENC_TREE_LEVELS         (64 + 1)
+
+/*
+ * Shortest cluster to which path compression applies. Shorter clusters encode
+ * a chain of levels that don't split at a cost of 2 bits per level, which
+ * path compression can't improve.
+ */
+#define VTENC_PATH_MIN_CLUSTER_LENGTH 4
+
+/*
+ * Longest sequences that are encoded and decoded through the paths tuned for
+ * short inputs, which produce the same format. Past them, the general paths
+ * are as fast or faster.
+ */
+#define VTENC_SMALL_ENC_MAX_LEN   32
+#define VTENC_SMALL_DEC_MAX_LEN   256
+
+/* Run-length encoding constants */
+#define VTENC_RUNS_BLOCK_LEN      128   /* Number of run lengths per block */
+#define VTENC_RUNS_WIDTH_BITS     6     /* Bits used to encode a block's width */
+
 /* Encoding/decoding handler structure */
 struct vtenc {
   struct vtenc_enc_params {     /* Encoding parameters */
     int allow_repeated_values;  /* 1 if repeated values are allowed */
     int skip_full_subtrees;     /* 1 to skip full subtrees */
-    size_t min_cluster_length;  /* Minimum cluster length to serialise */
+    size_t min_cluster_length[VTENC_TREE_LEVELS]; /* Minimum cluster length
+                                                     to serialise, per level */
+    int run_length_encoding;    /* 1 to encode repeated values as runs */
+    int optimal_leaves;         /* 1 to flag leaves chosen by cost */
+    size_t split_penalty;       /* Cost in bits added to split clusters */
+    unsigned int width;         /* Number of bits all values fit in */
+    int detect_width;           /* 1 to detect and store the actual width */
+    int path_compression;       /* 1 to skip levels that don't split */
+    uint64_t base;              /* Value subtracted from all values */
+    int frame_of_reference;     /* 1 to take the first value as the base */
+    int strict;                 /* 1 to check that the input is sorted */
   } params;
   size_t out_size;              /* Output size in bytes */
 };
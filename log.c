@@ -0,0 +1,316 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "compiler.h"
+#include "internals.h"
+
+/*
+ * A log is a sequence of encoded segments, followed by a tail of values that
+ * aren't encoded yet. Once the tail has as many values as a segment, it's
+ * encoded to a new segment of level 0.
+ *
+ * As in a log-structured merge tree, LOG_MERGE_FANOUT consecutive segments of
+ * the same level are merged into one of the next level with vtenc_concat*,
+ * which mostly copies their bit cluster trees. There are at most
+ * LOG_MERGE_FANOUT - 1 segments per level once merged, so their number only
+ * grows with the logarithm of the length of the log. Appends at most begin a
+ * merge, so their cost doesn't depend on it.
+ *
+ * The segments to merge are copied from the directory when the merge begins,
+ * and their streams are only freed when it ends, which is what lets a merge
+ * run alongside the rest of operations.
+ *
+ * As with the compaction of a set, the step of the merge in progress is only
+ * accessed atomically. A run takes the merge from LOG_BEGUN to LOG_RUNNING, and
+ * hands the new segment over with LOG_READY. vtenc_log_merge_end() only
+ * replaces the merged segments once it's ready, or merges them itself if no
+ * run has taken the merge yet.
+ */
+
+/* Number of segments of the same level merged into one */
+#define LOG_MERGE_FANOUT 4
+
+/* Default number of values of a segment of level 0 */
+#define LOG_DEFAULT_SEGMENT_LEN 1024
+
+/* Steps of a merge */
+enum log_step {
+  LOG_IDLE,     /* No merge in progress */
+  LOG_BEGUN,    /* The segments to merge are picked, and still to merge */
+  LOG_RUNNING,  /* The segments are being merged */
+  LOG_READY     /* The new segment is built */
+};
+
+struct log_segment {
+  uint8_t       *data;    /* Encoded stream */
+  size_t        size;     /* Size of the encoded stream */
+  size_t        len;      /* Number of values */
+  unsigned int  level;
+};
+
+struct log_merge {
+  vtenc               handler;    /* Copy of the log's, for the merge alone */
+  struct log_segment  from[LOG_MERGE_FANOUT]; /* Segments being merged */
+  size_t              pos;    /* Position of the first one in the directory */
+  size_t              len;    /* Number of segments being merged, 0 if none */
+  struct log_segment  to;     /* Result of the merge */
+};
+
+struct vtenc_log {
+  vtenc               handler;      /* Encoding parameters of the segments */
+  unsigned int        width;        /* Width of the values, in bits */
+  size_t              segment_len;  /* Number of values of a new segment */
+  int                 auto_merge;   /* 1 to merge segments on appends */
+  size_t              len;          /* Number of values */
+  uint64_t            last;         /* Last value */
+  struct log_segment  *segments;
+  size_t              segments_len;
+  size_t              segments_cap;
+  void                *tail;        /* Values not encoded yet */
+  size_t              tail_len;
+  int                 step;         /* Step of the merge, a log_step */
+  struct log_merge    merge;
+};
+
+/* Appends a segment to the directory */
+static int log_add_segment(struct vtenc_log *log,
+  const struct log_segment *segment)
+{
+  if (log->segments_len == log->segments_cap) {
+    const size_t new_cap = log->segments_cap ? 2 * log->segments_cap : 16;
+    struct log_segment *new_segments;
+
+    new_segments = realloc(log->segments, new_cap * sizeof(*new_segments));
+    if (new_segments == NULL)
+      return VTENC_ERR_NO_MEMORY;
+
+    log->segments = new_segments;
+    log->segments_cap = new_cap;
+  }
+
+  log->segments[log->segments_len++] = *segment;
+
+  return VTENC_OK;
+}
+
+/*
+ * Returns the position of the first LOG_MERGE_FANOUT consecutive segments of
+ * the same level, or @log->segments_len if there are none.
+ */
+static size_t log_find_merge(const struct vtenc_log *log)
+{
+  size_t from = 0, i;
+
+  for (i = 1; i <= log->segments_len; i++) {
+    if (i - from == LOG_MERGE_FANOUT)
+      return from;
+
+    if (i == log->segments_len ||
+        log->segments[i].level != log->segments[from].level)
+      from = i;
+  }
+
+  return log->segments_len;
+}
+
+static struct vtenc_log *log_create(const vtenc *handler, unsigned int width,
+  size_t segment_len, int auto_merge)
+{
+  struct vtenc_log *log = calloc(1, sizeof(*log));
+
+  if (log == NULL)
+    return NULL;
+
+  if (segment_len == 0)
+    segment_len = LOG_DEFAULT_SEGMENT_LEN;
+
+  log->tail = malloc(segment_len * (width / 8));
+  if (log->tail == NULL) {
+    free(log);
+    return NULL;
+  }
+
+  log->handler = *handler;
+  log->width = width;
+  log->segment_len = segment_len;
+  log->auto_merge = auto_merge;
+
+  return log;
+}
+
+/* Returns 1 between vtenc_log_merge_begin() and vtenc_log_merge_end() */
+static inline int log_merging(const struct vtenc_log *log)
+{
+  return atomic_load_acquire(&log->step) != LOG_IDLE;
+}
+
+/*
+ * Begins a merge if enabled and there are segments to merge. Running and
+ * ending it is left to the caller, so that an append never waits for it.
+ */
+static int log_maybe_merge(struct vtenc_log *log)
+{
+  if (!log->auto_merge || log_merging(log))
+    return VTENC_OK;
+
+  if (log_find_merge(log) == log->segments_len)
+    return VTENC_OK;
+
+  return vtenc_log_merge_begin(log);
+}
+
+void vtenc_log_destroy(vtenc_log *log)
+{
+  size_t i;
+
+  if (!log)
+    return;
+
+  for (i = 0; i < log->segments_len; i++)
+    free(log->segments[i].data);
+
+  free(log->merge.to.data);
+  free(log->segments);
+  free(log->tail);
+  free(log);
+}
+
+size_t vtenc_log_len(const vtenc_log *log)
+{
+  return log->len;
+}
+
+size_t vtenc_log_segments(const vtenc_log *log)
+{
+  return log->segments_len;
+}
+
+int vtenc_log_merging(const vtenc_log *log)
+{
+  return log_merging(log);
+}
+
+static int log_merge_run8(struct log_merge *merge);
+static int log_merge_run16(struct log_merge *merge);
+static int log_merge_run32(struct log_merge *merge);
+static int log_merge_run64(struct log_merge *merge);
+
+int vtenc_log_merge_begin(vtenc_log *log)
+{
+  const size_t pos = log_find_merge(log);
+
+  if (log_merging(log))
+    return VTENC_ERR_CONFIG;
+
+  memset(&log->merge, 0, sizeof(log->merge));
+  log->merge.handler = log->handler;
+
+  if (pos < log->segments_len) {
+    memcpy(log->merge.from, log->segments + pos, sizeof(log->merge.from));
+    log->merge.pos = pos;
+    log->merge.len = LOG_MERGE_FANOUT;
+  }
+
+  atomic_store_release(&log->step, LOG_BEGUN);
+
+  return VTENC_OK;
+}
+
+int vtenc_log_merge_run(vtenc_log *log)
+{
+  struct log_merge *merge = &log->merge;
+  int rc;
+
+  if (!atomic_cas(&log->step, LOG_BEGUN, LOG_RUNNING))
+    return VTENC_ERR_CONFIG;
+
+  if (merge->len > 0) {
+    switch (log->width) {
+    case 8: rc = log_merge_run8(merge); break;
+    case 16: rc = log_merge_run16(merge); break;
+    case 32: rc = log_merge_run32(merge); break;
+    default: rc = log_merge_run64(merge); break;
+    }
+
+    if (rc != VTENC_OK) {
+      atomic_store_release(&log->step, LOG_BEGUN);
+      return rc;
+    }
+  }
+
+  atomic_store_release(&log->step, LOG_READY);
+
+  return VTENC_OK;
+}
+
+int vtenc_log_merge_end(vtenc_log *log)
+{
+  struct log_merge *merge = &log->merge;
+  const int step = atomic_load_acquire(&log->step);
+  size_t i;
+
+  if (step == LOG_IDLE || step == LOG_RUNNING)
+    return VTENC_ERR_CONFIG;
+
+  if (step == LOG_BEGUN)
+    return_if_error(vtenc_log_merge_run(log));
+
+  if (merge->len > 0) {
+    for (i = 0; i < merge->len; i++)
+      free(merge->from[i].data);
+
+    log->segments[merge->pos] = merge->to;
+    memmove(log->segments + merge->pos + 1,
+      log->segments + merge->pos + merge->len,
+      (log->segments_len - merge->pos - merge->len) * sizeof(*log->segments));
+    log->segments_len -= merge->len - 1;
+  }
+
+  memset(merge, 0, sizeof(*merge));
+  atomic_store_release(&log->step, LOG_IDLE);
+
+  return VTENC_OK;
+}
+
+int vtenc_log_merge(vtenc_log *log)
+{
+  if (log_merging(log))
+    return_if_error(vtenc_log_merge_end(log));
+
+  while (log_find_merge(log) < log->segments_len) {
+    return_if_error(vtenc_log_merge_begin(log));
+    return_if_error(vtenc_log_merge_end(log));
+  }
+
+  return VTENC_OK;
+}
+
+#define TYPE uint8_t
+#define BITWIDTH 8
+#include "log_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint16_t
+#define BITWIDTH 16
+#include "log_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint32_t
+#define BITWIDTH 32
+#include "log_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint64_t
+#define BITWIDTH 64
+#include "log_generic.h"
+#undef TYPE
+#undef BITWIDTH
@@ -0,0 +1,284 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internals.h"
+
+#define vtenc_encode_(_width_) BITWIDTH_SUFFIX(vtenc_encode, _width_)
+#define vtenc_encode vtenc_encode_(BITWIDTH)
+#define vtenc_decode_(_width_) BITWIDTH_SUFFIX(vtenc_decode, _width_)
+#define vtenc_decode vtenc_decode_(BITWIDTH)
+#define vtenc_decode_prefix_(_width_) BITWIDTH_SUFFIX(vtenc_decode_prefix, _width_)
+#define vtenc_decode_prefix vtenc_decode_prefix_(BITWIDTH)
+#define vtenc_concat_(_width_) BITWIDTH_SUFFIX(vtenc_concat, _width_)
+#define vtenc_concat vtenc_concat_(BITWIDTH)
+#define vtenc_max_encoded_size_(_width_) BITWIDTH_SUFFIX(vtenc_max_encoded_size, _width_)
+#define vtenc_max_encoded_size vtenc_max_encoded_size_(BITWIDTH)
+#define log_seal_(_width_) BITWIDTH_SUFFIX(log_seal, _width_)
+#define log_seal log_seal_(BITWIDTH)
+#define log_merge_run_(_width_) BITWIDTH_SUFFIX(log_merge_run, _width_)
+#define log_merge_run log_merge_run_(BITWIDTH)
+#define vtenc_log_create_(_width_) BITWIDTH_SUFFIX(vtenc_log_create, _width_)
+#define vtenc_log_create vtenc_log_create_(BITWIDTH)
+#define vtenc_log_append_(_width_) BITWIDTH_SUFFIX(vtenc_log_append, _width_)
+#define vtenc_log_append vtenc_log_append_(BITWIDTH)
+#define vtenc_log_foreach_(_width_) BITWIDTH_SUFFIX(vtenc_log_foreach, _width_)
+#define vtenc_log_foreach vtenc_log_foreach_(BITWIDTH)
+#define vtenc_log_decode_(_width_) BITWIDTH_SUFFIX(vtenc_log_decode, _width_)
+#define vtenc_log_decode vtenc_log_decode_(BITWIDTH)
+
+/* Encodes the tail of @log to a new segment of level 0 */
+static int log_seal(struct vtenc_log *log)
+{
+  struct log_segment segment = {0};
+  const size_t cap = vtenc_max_encoded_size(log->tail_len);
+  uint8_t *data;
+  int rc;
+
+  segment.data = malloc(cap);
+  if (segment.data == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = vtenc_encode(&log->handler, log->tail, log->tail_len, segment.data, cap);
+  if (rc == VTENC_OK) {
+    segment.size = vtenc_encoded_size(&log->handler);
+    segment.len = log->tail_len;
+    rc = log_add_segment(log, &segment);
+  }
+
+  if (rc != VTENC_OK) {
+    free(segment.data);
+    return rc;
+  }
+
+  /* Gives back the unused capacity, which is kept if that fails */
+  if (segment.size > 0) {
+    data = realloc(segment.data, segment.size);
+    if (data != NULL)
+      log->segments[log->segments_len - 1].data = data;
+  }
+
+  log->tail_len = 0;
+
+  return VTENC_OK;
+}
+
+/* Concatenates the segments of @merge, one after another */
+static int log_merge_run(struct log_merge *merge)
+{
+  struct log_segment merged = merge->from[0];
+  size_t i;
+
+  for (i = 1; i < merge->len; i++) {
+    const struct log_segment *next = &merge->from[i];
+    const size_t cap = vtenc_max_encoded_size(merged.len + next->len);
+    uint8_t *data = malloc(cap);
+    int rc;
+
+    if (data == NULL)
+      rc = VTENC_ERR_NO_MEMORY;
+    else
+      rc = vtenc_concat(&merge->handler, merged.data, merged.size, merged.len,
+        next->data, next->size, next->len, data, cap);
+
+    if (i > 1)
+      free(merged.data);
+
+    if (rc != VTENC_OK) {
+      free(data);
+      return rc;
+    }
+
+    merged.data = data;
+    merged.size = vtenc_encoded_size(&merge->handler);
+    merged.len += next->len;
+  }
+
+  merged.level = merge->from[0].level + 1;
+  merge->to = merged;
+
+  return VTENC_OK;
+}
+
+vtenc_log *vtenc_log_create(vtenc *handler, size_t segment_len, int auto_merge)
+{
+  return log_create(handler, BITWIDTH, segment_len, auto_merge);
+}
+
+int vtenc_log_append(vtenc_log *log, const TYPE *values, size_t values_len)
+{
+  const uint64_t base = log->handler.params.base;
+  const unsigned int width = MIN(log->handler.params.width, BITWIDTH);
+  TYPE *tail = log->tail;
+  size_t i;
+
+  if (log->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  for (i = 0; i < values_len; i++) {
+    if (values[i] < base || value_width(values[i] - base) > width)
+      return VTENC_ERR_CONFIG;
+
+    if (log->len + i > 0) {
+      const TYPE prev = (i > 0) ? values[i - 1] : (TYPE)log->last;
+
+      if (values[i] < prev ||
+          (values[i] == prev && !log->handler.params.allow_repeated_values))
+        return VTENC_ERR_NOT_SORTED;
+    }
+  }
+
+  i = 0;
+  for (;;) {
+    size_t n;
+
+    if (log->tail_len == log->segment_len) {
+      return_if_error(log_seal(log));
+      return_if_error(log_maybe_merge(log));
+    }
+
+    if (i == values_len)
+      break;
+
+    n = MIN(log->segment_len - log->tail_len, values_len - i);
+    memcpy(tail + log->tail_len, values + i, n * sizeof(TYPE));
+    log->tail_len += n;
+    log->len += n;
+    log->last = values[i + n - 1];
+    i += n;
+  }
+
+  return VTENC_OK;
+}
+
+int vtenc_log_foreach(vtenc_log *log, int (*fn)(void *opaque, TYPE value),
+  void *opaque)
+{
+  const TYPE *tail = log->tail;
+  TYPE *values = NULL;
+  size_t cap = 0, i, j;
+  int rc = VTENC_OK;
+
+  if (log->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  for (i = 0; i < log->segments_len && rc == VTENC_OK; i++) {
+    const struct log_segment *segment = &log->segments[i];
+
+    if (segment->len > cap) {
+      TYPE *new_values = realloc(values, segment->len * sizeof(TYPE));
+
+      if (new_values == NULL) {
+        rc = VTENC_ERR_NO_MEMORY;
+        break;
+      }
+
+      values = new_values;
+      cap = segment->len;
+    }
+
+    rc = vtenc_decode(&log->handler, segment->data, segment->size, values,
+      segment->len);
+
+    for (j = 0; j < segment->len && rc == VTENC_OK; j++) {
+      if (fn(opaque, values[j]) != 0)
+        rc = VTENC_ERR_SINK;
+    }
+  }
+
+  for (j = 0; j < log->tail_len && rc == VTENC_OK; j++) {
+    if (fn(opaque, tail[j]) != 0)
+      rc = VTENC_ERR_SINK;
+  }
+
+  free(values);
+
+  return rc;
+}
+
+int vtenc_log_decode(vtenc_log *log, size_t from, TYPE *out, size_t out_len)
+{
+  const TYPE *tail = log->tail;
+  const size_t to = from + out_len;
+  size_t pos = 0, i;
+
+  if (log->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  if (from > log->len || out_len > log->len - from)
+    return VTENC_ERR_CONFIG;
+
+  for (i = 0; i < log->segments_len && pos < to; i++) {
+    const struct log_segment *segment = &log->segments[i];
+    const size_t end = pos + segment->len;
+
+    if (end <= from) {
+      pos = end;
+      continue;
+    }
+
+    if (pos >= from && end <= to) {
+      return_if_error(vtenc_decode(&log->handler, segment->data,
+        segment->size, out + (pos - from), segment->len));
+    } else if (pos >= from) {
+      return_if_error(vtenc_decode_prefix(&log->handler, segment->data,
+        segment->size, segment->len, out + (pos - from), to - pos));
+    } else {
+      /* The range starts within the segment, which is decoded on its own */
+      const size_t n = MIN(end, to) - pos;
+      TYPE *values = malloc(n * sizeof(TYPE));
+      int rc;
+
+      if (values == NULL)
+        return VTENC_ERR_NO_MEMORY;
+
+      rc = vtenc_decode_prefix(&log->handler, segment->data, segment->size,
+        segment->len, values, n);
+      if (rc == VTENC_OK)
+        memcpy(out, values + (from - pos), (n - (from - pos)) * sizeof(TYPE));
+
+      free(values);
+      return_if_error(rc);
+    }
+
+    pos = end;
+  }
+
+  if (pos < to) {
+    const size_t skip = (from > pos) ? from - pos : 0;
+
+    memcpy(out + (pos + skip - from), tail + skip,
+      (to - pos - skip) * sizeof(TYPE));
+  }
+
+  return VTENC_OK;
+}
+
+#undef vtenc_encode_
+#undef vtenc_encode
+#undef vtenc_decode_
+#undef vtenc_decode
+#undef vtenc_decode_prefix_
+#undef vtenc_decode_prefix
+#undef vtenc_concat_
+#undef vtenc_concat
+#undef vtenc_max_encoded_size_
+#undef vtenc_max_encoded_size
+#undef log_seal_
+#undef log_seal
+#undef log_merge_run_
+#undef log_merge_run
+#undef vtenc_log_create_
+#undef vtenc_log_create
+#undef vtenc_log_append_
+#undef vtenc_log_append
+#undef vtenc_log_foreach_
+#undef vtenc_log_foreach
+#undef vtenc_log_decode_
+#undef vtenc_log_decode
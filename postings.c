@@ -0,0 +1,213 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "internals.h"
+
+/*
+ * A postings stream is a sequence of blocks of up to POSTINGS_BLOCK_LEN
+ * postings, each made of:
+ * - A header, with the size of the ids stream, the width of the payloads and
+ *   the last id, as little-endian integers. It's all it takes to skip the
+ *   block, or to know whether an id might be in it.
+ * - The ids, encoded as vtenc_encode* would.
+ * - The payloads, in the same order as the ids, bit-packed with the width of
+ *   the largest one, so that any of them can be read on its own.
+ */
+
+/* Number of postings per block */
+#define POSTINGS_BLOCK_LEN 128
+
+/* Size of the parts of a block header */
+#define POSTINGS_IDS_SIZE_BYTES 2
+#define POSTINGS_WIDTH_BYTES    1
+
+struct postings_block {
+  size_t        offset;         /* Offset of the block in the stream */
+  size_t        index;          /* Position of its first posting */
+  size_t        len;            /* Number of postings */
+  uint64_t      last;           /* Last id */
+  size_t        ids_offset;     /* Offset of the ids stream */
+  size_t        ids_size;       /* Size of the ids stream */
+  size_t        payloads_offset;/* Offset of the payloads */
+  unsigned int  payload_width;  /* Width of the payloads, in bits */
+  size_t        end;            /* Offset of the next block */
+};
+
+struct vtenc_postings_cursor {
+  vtenc                 handler;  /* Decoding parameters of the ids */
+  unsigned int          width;    /* Width of the ids, in bits */
+  const uint8_t         *in;
+  size_t                in_len;
+  size_t                values_len;
+  struct postings_block block;    /* Current block */
+  int                   decoded;  /* 1 once the ids of the block are in ids */
+  size_t                pos;      /* Position of the current posting in it */
+  uint64_t              ids[POSTINGS_BLOCK_LEN];
+};
+
+static inline size_t postings_header_size(unsigned int width)
+{
+  return POSTINGS_IDS_SIZE_BYTES + POSTINGS_WIDTH_BYTES + width / 8;
+}
+
+static inline size_t postings_payloads_size(size_t len, unsigned int width)
+{
+  return (len * width + 7) / 8;
+}
+
+static void postings_write_le(uint8_t *out, uint64_t value, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint64_t postings_read_le(const uint8_t *in, size_t size)
+{
+  uint64_t value = 0;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    value |= (uint64_t)in[i] << (8 * i);
+
+  return value;
+}
+
+/* Writes the header of a block of ids of @width bits at @out */
+static void postings_write_header(uint8_t *out, unsigned int width,
+  size_t ids_size, unsigned int payload_width, uint64_t last)
+{
+  postings_write_le(out, ids_size, POSTINGS_IDS_SIZE_BYTES);
+  out += POSTINGS_IDS_SIZE_BYTES;
+  postings_write_le(out, payload_width, POSTINGS_WIDTH_BYTES);
+  out += POSTINGS_WIDTH_BYTES;
+  postings_write_le(out, last, width / 8);
+}
+
+/*
+ * Reads the header of the block that starts at @offset, with the postings from
+ * @index on, into @block.
+ */
+static int postings_read_header(const uint8_t *in, size_t in_len,
+  size_t values_len, unsigned int width, size_t offset, size_t index,
+  struct postings_block *block)
+{
+  const size_t header_size = postings_header_size(width);
+  const uint8_t *header = in + offset;
+
+  if (index >= values_len || in_len - offset < header_size)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  block->offset = offset;
+  block->index = index;
+  block->len = MIN(values_len - index, POSTINGS_BLOCK_LEN);
+  block->ids_size = (size_t)postings_read_le(header, POSTINGS_IDS_SIZE_BYTES);
+  header += POSTINGS_IDS_SIZE_BYTES;
+  block->payload_width = (unsigned int)postings_read_le(header,
+    POSTINGS_WIDTH_BYTES);
+  header += POSTINGS_WIDTH_BYTES;
+  block->last = postings_read_le(header, width / 8);
+  block->ids_offset = offset + header_size;
+  block->payloads_offset = block->ids_offset + block->ids_size;
+
+  if (block->payload_width > 32 ||
+      block->ids_size > in_len - block->ids_offset ||
+      postings_payloads_size(block->len, block->payload_width) >
+        in_len - block->payloads_offset)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  block->end = block->payloads_offset +
+    postings_payloads_size(block->len, block->payload_width);
+
+  return VTENC_OK;
+}
+
+/* Bit-packs the @len values of @in with @width bits each into @out */
+static void postings_pack(const uint32_t *in, size_t len, unsigned int width,
+  uint8_t *out)
+{
+  size_t i;
+
+  memset(out, 0, postings_payloads_size(len, width));
+
+  for (i = 0; i < len && width > 0; i++) {
+    const size_t bit = i * width;
+    const uint64_t value = (uint64_t)in[i] << (bit % 8);
+    uint8_t *p = out + bit / 8;
+    size_t k;
+
+    for (k = 0; 8 * k < bit % 8 + width; k++)
+      p[k] |= (uint8_t)(value >> (8 * k));
+  }
+}
+
+/* Reads the value @i of the bit-packed values of @width bits at @in */
+static uint32_t postings_unpack(const uint8_t *in, size_t i,
+  unsigned int width)
+{
+  const size_t bit = i * width;
+  const uint8_t *p = in + bit / 8;
+  uint64_t value = 0;
+  size_t k;
+
+  for (k = 0; 8 * k < bit % 8 + width; k++)
+    value |= (uint64_t)p[k] << (8 * k);
+
+  return (uint32_t)((value >> (bit % 8)) & BITS_SIZE_MASK[width]);
+}
+
+static struct vtenc_postings_cursor *postings_cursor_create(const vtenc *dec,
+  unsigned int width, const uint8_t *in, size_t in_len, size_t values_len)
+{
+  struct vtenc_postings_cursor *cursor = calloc(1, sizeof(*cursor));
+
+  if (cursor == NULL)
+    return NULL;
+
+  cursor->handler = *dec;
+  cursor->width = width;
+  cursor->in = in;
+  cursor->in_len = in_len;
+  cursor->values_len = values_len;
+
+  return cursor;
+}
+
+void vtenc_postings_cursor_destroy(vtenc_postings_cursor *cursor)
+{
+  if (!cursor)
+    return;
+
+  free(cursor);
+}
+
+#define TYPE uint8_t
+#define BITWIDTH 8
+#include "postings_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint16_t
+#define BITWIDTH 16
+#include "postings_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint32_t
+#define BITWIDTH 32
+#include "postings_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint64_t
+#define BITWIDTH 64
+#include "postings_generic.h"
+#undef TYPE
+#undef BITWIDTH
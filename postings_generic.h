@@ -0,0 +1,218 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internals.h"
+
+#define vtenc_encode_(_width_) BITWIDTH_SUFFIX(vtenc_encode, _width_)
+#define vtenc_encode vtenc_encode_(BITWIDTH)
+#define vtenc_decode_(_width_) BITWIDTH_SUFFIX(vtenc_decode, _width_)
+#define vtenc_decode vtenc_decode_(BITWIDTH)
+#define vtenc_max_encoded_size_(_width_) BITWIDTH_SUFFIX(vtenc_max_encoded_size, _width_)
+#define vtenc_max_encoded_size vtenc_max_encoded_size_(BITWIDTH)
+#define postings_decode_ids_(_width_) BITWIDTH_SUFFIX(postings_decode_ids, _width_)
+#define postings_decode_ids postings_decode_ids_(BITWIDTH)
+#define vtenc_postings_max_encoded_size_(_width_) BITWIDTH_SUFFIX(vtenc_postings_max_encoded_size, _width_)
+#define vtenc_postings_max_encoded_size vtenc_postings_max_encoded_size_(BITWIDTH)
+#define vtenc_postings_encode_(_width_) BITWIDTH_SUFFIX(vtenc_postings_encode, _width_)
+#define vtenc_postings_encode vtenc_postings_encode_(BITWIDTH)
+#define vtenc_postings_decode_(_width_) BITWIDTH_SUFFIX(vtenc_postings_decode, _width_)
+#define vtenc_postings_decode vtenc_postings_decode_(BITWIDTH)
+#define vtenc_postings_cursor_create_(_width_) BITWIDTH_SUFFIX(vtenc_postings_cursor_create, _width_)
+#define vtenc_postings_cursor_create vtenc_postings_cursor_create_(BITWIDTH)
+#define vtenc_postings_next_geq_(_width_) BITWIDTH_SUFFIX(vtenc_postings_next_geq, _width_)
+#define vtenc_postings_next_geq vtenc_postings_next_geq_(BITWIDTH)
+
+size_t vtenc_postings_max_encoded_size(size_t in_len)
+{
+  const size_t header_size = postings_header_size(BITWIDTH);
+  const size_t full_blocks = in_len / POSTINGS_BLOCK_LEN;
+  const size_t rest = in_len % POSTINGS_BLOCK_LEN;
+  size_t size;
+
+  size = full_blocks * (header_size +
+    vtenc_max_encoded_size(POSTINGS_BLOCK_LEN) +
+    POSTINGS_BLOCK_LEN * sizeof(uint32_t));
+
+  if (rest > 0)
+    size += header_size + vtenc_max_encoded_size(rest) +
+      rest * sizeof(uint32_t);
+
+  return size;
+}
+
+int vtenc_postings_encode(vtenc *enc, const TYPE *ids,
+  const uint32_t *payloads, size_t in_len, uint8_t *out, size_t out_cap)
+{
+  const size_t header_size = postings_header_size(BITWIDTH);
+  size_t pos = 0, i, j;
+
+  for (i = 0; i < in_len; i += POSTINGS_BLOCK_LEN) {
+    const size_t len = MIN(in_len - i, POSTINGS_BLOCK_LEN);
+    uint32_t payloads_or = 0;
+    unsigned int payload_width;
+    size_t ids_size, payloads_size;
+
+    if (enc->params.strict && i > 0 &&
+        (ids[i] < ids[i - 1] ||
+         (ids[i] == ids[i - 1] && !enc->params.allow_repeated_values)))
+      return VTENC_ERR_NOT_SORTED;
+
+    if (out_cap - pos < header_size)
+      return VTENC_ERR_BUFFER_TOO_SMALL;
+
+    return_if_error(vtenc_encode(enc, ids + i, len, out + pos + header_size,
+      out_cap - pos - header_size));
+    ids_size = vtenc_encoded_size(enc);
+
+    for (j = 0; j < len; j++)
+      payloads_or |= payloads[i + j];
+
+    payload_width = value_width(payloads_or);
+    payloads_size = postings_payloads_size(len, payload_width);
+
+    if (out_cap - pos - header_size - ids_size < payloads_size)
+      return VTENC_ERR_BUFFER_TOO_SMALL;
+
+    postings_write_header(out + pos, BITWIDTH, ids_size, payload_width,
+      ids[i + len - 1]);
+    postings_pack(payloads + i, len, payload_width,
+      out + pos + header_size + ids_size);
+
+    pos += header_size + ids_size + payloads_size;
+  }
+
+  enc->out_size = pos;
+
+  return VTENC_OK;
+}
+
+int vtenc_postings_decode(vtenc *dec, const uint8_t *in, size_t in_len,
+  TYPE *ids, uint32_t *payloads, size_t out_len)
+{
+  struct postings_block block;
+  size_t offset = 0, i, j;
+
+  for (i = 0; i < out_len; i += block.len) {
+    return_if_error(postings_read_header(in, in_len, out_len, BITWIDTH,
+      offset, i, &block));
+
+    return_if_error(vtenc_decode(dec, in + block.ids_offset, block.ids_size,
+      ids + i, block.len));
+
+    for (j = 0; j < block.len; j++)
+      payloads[i + j] = postings_unpack(in + block.payloads_offset, j,
+        block.payload_width);
+
+    offset = block.end;
+  }
+
+  return VTENC_OK;
+}
+
+/* Decodes the ids of the current block of @cursor */
+static int postings_decode_ids(struct vtenc_postings_cursor *cursor)
+{
+  const struct postings_block *block = &cursor->block;
+  TYPE ids[POSTINGS_BLOCK_LEN];
+  size_t i;
+
+  return_if_error(vtenc_decode(&cursor->handler, cursor->in + block->ids_offset,
+    block->ids_size, ids, block->len));
+
+  for (i = 0; i < block->len; i++)
+    cursor->ids[i] = ids[i];
+
+  cursor->decoded = 1;
+
+  return VTENC_OK;
+}
+
+vtenc_postings_cursor *vtenc_postings_cursor_create(vtenc *dec,
+  const uint8_t *in, size_t in_len, size_t values_len)
+{
+  return postings_cursor_create(dec, BITWIDTH, in, in_len, values_len);
+}
+
+int vtenc_postings_next_geq(vtenc_postings_cursor *cursor, TYPE target,
+  size_t *pos, TYPE *id, uint32_t *payload)
+{
+  struct postings_block *block = &cursor->block;
+  size_t lo, hi;
+
+  if (cursor->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  *pos = cursor->values_len;
+
+  if (cursor->values_len == 0)
+    return VTENC_OK;
+
+  if (block->len == 0) {
+    return_if_error(postings_read_header(cursor->in, cursor->in_len,
+      cursor->values_len, BITWIDTH, 0, 0, block));
+  }
+
+  /* Skips the blocks whose ids are all lower than @target */
+  while (block->last < target) {
+    if (block->index + block->len == cursor->values_len) {
+      cursor->pos = block->len;
+      return VTENC_OK;
+    }
+
+    return_if_error(postings_read_header(cursor->in, cursor->in_len,
+      cursor->values_len, BITWIDTH, block->end, block->index + block->len,
+      block));
+    cursor->decoded = 0;
+    cursor->pos = 0;
+  }
+
+  if (!cursor->decoded)
+    return_if_error(postings_decode_ids(cursor));
+
+  /* First id not lower than @target, from the current posting on */
+  lo = cursor->pos;
+  hi = block->len;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (cursor->ids[mid] < target)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  cursor->pos = lo;
+
+  if (lo < block->len) {
+    *pos = block->index + lo;
+    *id = (TYPE)cursor->ids[lo];
+    *payload = postings_unpack(cursor->in + block->payloads_offset, lo,
+      block->payload_width);
+  }
+
+  return VTENC_OK;
+}
+
+#undef vtenc_encode_
+#undef vtenc_encode
+#undef vtenc_decode_
+#undef vtenc_decode
+#undef vtenc_max_encoded_size_
+#undef vtenc_max_encoded_size
+#undef postings_decode_ids_
+#undef postings_decode_ids
+#undef vtenc_postings_max_encoded_size_
+#undef vtenc_postings_max_encoded_size
+#undef vtenc_postings_encode_
+#undef vtenc_postings_encode
+#undef vtenc_postings_decode_
+#undef vtenc_postings_decode
+#undef vtenc_postings_cursor_create_
+#undef vtenc_postings_cursor_create
+#undef vtenc_postings_next_geq_
+#undef vtenc_postings_next_geq
@@ -0,0 +1,571 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "compiler.h"
+#include "internals.h"
+
+/*
+ * A set is made of three layers, from the bottom up:
+ * - The base: the values of the last compaction, encoded in blocks of about
+ *   SET_BLOCK_LEN values each. A block holds the values from its first one up
+ *   to the first one of the next block, and the first block holds all the
+ *   values before it too.
+ * - The frozen edits, which are being folded into the base by a compaction.
+ * - The buffer, with the edits made since the last compaction began.
+ * Each layer of edits has the sorted values inserted into and erased from the
+ * layers below it: the inserted values aren't in those layers, the erased ones
+ * are, and no value is both inserted and erased.
+ *
+ * The base and the frozen edits are never modified, only replaced by
+ * vtenc_set_compact_end(), which is what lets a compaction run alongside the
+ * rest of operations.
+ *
+ * The step of the compaction in progress is written both by the thread that
+ * may run it and by the rest of functions, so it's only accessed atomically.
+ * A run takes the compaction from SET_BEGUN to SET_RUNNING, and hands the next
+ * base over with SET_READY. vtenc_set_compact_end() only replaces the base
+ * once it's ready, or builds it itself if no run has taken the compaction yet.
+ */
+
+/* Number of values per block of the base */
+#define SET_BLOCK_LEN 256
+
+/* Steps of a compaction */
+enum set_step {
+  SET_IDLE,     /* No compaction in progress */
+  SET_BEGUN,    /* The edits are frozen, and the next base is still to build */
+  SET_RUNNING,  /* The next base is being built */
+  SET_READY     /* The next base is built */
+};
+
+struct set_block {
+  uint64_t  first;    /* First value */
+  size_t    len;      /* Number of values */
+  size_t    offset;   /* Offset of its stream in the bytes of the base */
+  size_t    size;     /* Size of its stream */
+};
+
+struct set_base {
+  struct vtenc_buffer bytes;    /* Streams of all blocks, one after another */
+  struct set_block    *blocks;
+  size_t              blocks_len;
+  size_t              blocks_cap;
+};
+
+struct set_edits {
+  uint64_t  *ins;
+  size_t    ins_len;
+  size_t    ins_cap;
+  uint64_t  *dels;
+  size_t    dels_len;
+  size_t    dels_cap;
+};
+
+struct vtenc_set {
+  vtenc             handler;      /* Encoding parameters of the blocks */
+  unsigned int      width;        /* Width of the values, in bits */
+  size_t            threshold;    /* Number of edits that trigger a compaction */
+  size_t            len;          /* Number of values */
+  struct set_base   base;
+  struct set_edits  frozen;
+  struct set_edits  buffer;
+  int               step;         /* Step of the compaction, a set_step */
+  struct set_base   next;         /* Base being built by a compaction */
+};
+
+/* Returns 1 between vtenc_set_compact_begin() and vtenc_set_compact_end() */
+static inline int set_compacting(const struct vtenc_set *set)
+{
+  return atomic_load_acquire(&set->step) != SET_IDLE;
+}
+
+static void set_base_free(struct set_base *base)
+{
+  free(base->bytes.data);
+  free(base->blocks);
+  memset(base, 0, sizeof(*base));
+}
+
+static void set_edits_free(struct set_edits *edits)
+{
+  free(edits->ins);
+  free(edits->dels);
+  memset(edits, 0, sizeof(*edits));
+}
+
+/* Appends a block, whose stream is already at the end of the base's bytes */
+static int set_base_add(struct set_base *base, uint64_t first, size_t len,
+  size_t offset)
+{
+  struct set_block *block;
+
+  if (base->blocks_len == base->blocks_cap) {
+    const size_t new_cap = base->blocks_cap ? 2 * base->blocks_cap : 16;
+    struct set_block *new_blocks;
+
+    new_blocks = realloc(base->blocks, new_cap * sizeof(*new_blocks));
+    if (new_blocks == NULL)
+      return VTENC_ERR_NO_MEMORY;
+
+    base->blocks = new_blocks;
+    base->blocks_cap = new_cap;
+  }
+
+  block = &base->blocks[base->blocks_len++];
+  block->first = first;
+  block->len = len;
+  block->offset = offset;
+  block->size = base->bytes.len - offset;
+
+  return VTENC_OK;
+}
+
+/*
+ * Returns the index of the block whose values range holds @value, or
+ * @base->blocks_len if there are no blocks.
+ */
+static size_t set_base_find(const struct set_base *base, uint64_t value)
+{
+  size_t lo = 1, hi = base->blocks_len;
+
+  if (base->blocks_len == 0)
+    return 0;
+
+  /* Index of the first block whose first value is greater than @value */
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (base->blocks[mid].first <= value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo - 1;
+}
+
+/* Returns the position of the first value of @a not lower than @value */
+static size_t set_lower_bound(const uint64_t *a, size_t len, uint64_t value)
+{
+  size_t lo = 0, hi = len;
+
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (a[mid] < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static int set_has(const uint64_t *a, size_t len, uint64_t value)
+{
+  const size_t pos = set_lower_bound(a, len, value);
+
+  return pos < len && a[pos] == value;
+}
+
+/* Adds @value to the sorted array @a, where it isn't */
+static int set_array_add(uint64_t **a, size_t *len, size_t *cap,
+  uint64_t value)
+{
+  const size_t pos = set_lower_bound(*a, *len, value);
+
+  if (*len == *cap) {
+    const size_t new_cap = *cap ? 2 * *cap : 16;
+    uint64_t *new_a;
+
+    new_a = realloc(*a, new_cap * sizeof(*new_a));
+    if (new_a == NULL)
+      return VTENC_ERR_NO_MEMORY;
+
+    *a = new_a;
+    *cap = new_cap;
+  }
+
+  memmove(*a + pos + 1, *a + pos, (*len - pos) * sizeof(**a));
+  (*a)[pos] = value;
+  (*len)++;
+
+  return VTENC_OK;
+}
+
+/* Removes @value from the sorted array @a, if it's there */
+static int set_array_remove(uint64_t *a, size_t *len, uint64_t value)
+{
+  const size_t pos = set_lower_bound(a, *len, value);
+
+  if (pos == *len || a[pos] != value)
+    return 0;
+
+  memmove(a + pos, a + pos + 1, (*len - pos - 1) * sizeof(*a));
+  (*len)--;
+
+  return 1;
+}
+
+/*
+ * Applies the edits of @edits on values in [@lo, @hi] to the sorted values
+ * @in, which are all in that range, and writes the result to @out, which has
+ * room for @in_len values plus the insertions. Returns the number of values
+ * written.
+ */
+static size_t set_apply_edits(const struct set_edits *edits, uint64_t lo,
+  uint64_t hi, const uint64_t *in, size_t in_len, uint64_t *out)
+{
+  const size_t ins_from = set_lower_bound(edits->ins, edits->ins_len, lo);
+  const size_t dels_from = set_lower_bound(edits->dels, edits->dels_len, lo);
+  const uint64_t *ins = edits->ins + ins_from;
+  const uint64_t *dels = edits->dels + dels_from;
+  const size_t ins_len = edits->ins_len - ins_from;
+  const size_t dels_len = edits->dels_len - dels_from;
+  size_t i = 0, j = 0, k = 0, out_len = 0;
+
+  while (i < in_len) {
+    while (j < ins_len && ins[j] < in[i])
+      out[out_len++] = ins[j++];
+
+    while (k < dels_len && dels[k] < in[i])
+      k++;
+
+    if (k < dels_len && dels[k] == in[i])
+      k++;
+    else
+      out[out_len++] = in[i];
+
+    i++;
+  }
+
+  while (j < ins_len && ins[j] <= hi)
+    out[out_len++] = ins[j++];
+
+  return out_len;
+}
+
+/* Returns the number of insertions of @edits on values in [@lo, @hi] */
+static size_t set_count_ins(const struct set_edits *edits, uint64_t lo,
+  uint64_t hi)
+{
+  const size_t from = set_lower_bound(edits->ins, edits->ins_len, lo);
+  size_t to = edits->ins_len;
+
+  if (hi < UINT64_MAX)
+    to = set_lower_bound(edits->ins, edits->ins_len, hi + 1);
+
+  return to - from;
+}
+
+/* Returns 1 if @edits has no edits on values in [@lo, @hi] */
+static int set_edits_none(const struct set_edits *edits, uint64_t lo,
+  uint64_t hi)
+{
+  const size_t dels_from = set_lower_bound(edits->dels, edits->dels_len, lo);
+
+  if (dels_from < edits->dels_len && edits->dels[dels_from] <= hi)
+    return 0;
+
+  return set_count_ins(edits, lo, hi) == 0;
+}
+
+/*
+ * Returns the range of values [@lo, @hi] of the block @i, or of all values if
+ * there are no blocks.
+ */
+static void set_block_range(const struct set_base *base, size_t i,
+  uint64_t *lo, uint64_t *hi)
+{
+  *lo = (i == 0) ? 0 : base->blocks[i].first;
+  *hi = (i + 1 < base->blocks_len) ? base->blocks[i + 1].first - 1 : UINT64_MAX;
+}
+
+/*
+ * Returns 1 if @value is in the layers of edits, 0 if it's erased by them, or
+ * -1 if they don't have it and it's up to the base.
+ */
+static int set_edits_lookup(const struct vtenc_set *set, uint64_t value)
+{
+  if (set_has(set->buffer.ins, set->buffer.ins_len, value))
+    return 1;
+  if (set_has(set->buffer.dels, set->buffer.dels_len, value))
+    return 0;
+
+  if (set_compacting(set)) {
+    if (set_has(set->frozen.ins, set->frozen.ins_len, value))
+      return 1;
+    if (set_has(set->frozen.dels, set->frozen.dels_len, value))
+      return 0;
+  }
+
+  return -1;
+}
+
+/* Records the insertion of @value, which isn't in the set */
+static int set_record_insert(struct vtenc_set *set, uint64_t value)
+{
+  struct set_edits *buffer = &set->buffer;
+
+  if (!set_array_remove(buffer->dels, &buffer->dels_len, value))
+    return_if_error(set_array_add(&buffer->ins, &buffer->ins_len,
+      &buffer->ins_cap, value));
+
+  set->len++;
+
+  return VTENC_OK;
+}
+
+/* Records the erasure of @value, which is in the set */
+static int set_record_erase(struct vtenc_set *set, uint64_t value)
+{
+  struct set_edits *buffer = &set->buffer;
+
+  if (!set_array_remove(buffer->ins, &buffer->ins_len, value))
+    return_if_error(set_array_add(&buffer->dels, &buffer->dels_len,
+      &buffer->dels_cap, value));
+
+  set->len--;
+
+  return VTENC_OK;
+}
+
+/* Scratch arrays to decode and edit blocks */
+struct set_scratch {
+  void      *decoded;
+  uint64_t  *values;
+  uint64_t  *edited;
+  size_t    cap;
+};
+
+/*
+ * Makes room for @len values in each array of @scratch, keeping the contents
+ * of @scratch->edited.
+ */
+static int set_scratch_reserve(struct set_scratch *scratch, size_t len,
+  size_t type_size)
+{
+  void *decoded;
+  uint64_t *values, *edited;
+
+  if (len <= scratch->cap)
+    return VTENC_OK;
+
+  len = MAX(len, 2 * scratch->cap);
+
+  decoded = realloc(scratch->decoded, len * type_size);
+  if (decoded == NULL)
+    return VTENC_ERR_NO_MEMORY;
+  scratch->decoded = decoded;
+
+  values = realloc(scratch->values, len * sizeof(*values));
+  if (values == NULL)
+    return VTENC_ERR_NO_MEMORY;
+  scratch->values = values;
+
+  edited = realloc(scratch->edited, len * sizeof(*edited));
+  if (edited == NULL)
+    return VTENC_ERR_NO_MEMORY;
+  scratch->edited = edited;
+
+  scratch->cap = len;
+
+  return VTENC_OK;
+}
+
+static void set_scratch_free(struct set_scratch *scratch)
+{
+  free(scratch->decoded);
+  free(scratch->values);
+  free(scratch->edited);
+}
+
+/* Makes room for @size more bytes at the end of @bytes */
+static int set_bytes_reserve(struct vtenc_buffer *bytes, size_t size)
+{
+  size_t new_cap = bytes->cap ? bytes->cap : 4096;
+  uint8_t *new_data;
+
+  if (size <= bytes->cap - bytes->len)
+    return VTENC_OK;
+
+  while (new_cap - bytes->len < size) {
+    if (new_cap > SIZE_MAX / 2)
+      return VTENC_ERR_NO_MEMORY;
+    new_cap *= 2;
+  }
+
+  new_data = realloc(bytes->data, new_cap);
+  if (new_data == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  bytes->data = new_data;
+  bytes->cap = new_cap;
+
+  return VTENC_OK;
+}
+
+/* Appends a copy of the block @block of @from to @to */
+static int set_base_copy(struct set_base *to, const struct set_base *from,
+  const struct set_block *block)
+{
+  const size_t offset = to->bytes.len;
+
+  return_if_error(vtenc_buffer_write(&to->bytes,
+    from->bytes.data + block->offset, block->size));
+
+  return set_base_add(to, block->first, block->len, offset);
+}
+
+/*
+ * Begins a compaction if the buffer has reached the threshold. Running and
+ * ending it is left to the caller, so that an edit never waits for a new base.
+ */
+static int set_maybe_compact(struct vtenc_set *set)
+{
+  if (set->threshold == 0 || set_compacting(set))
+    return VTENC_OK;
+
+  if (set->buffer.ins_len + set->buffer.dels_len < set->threshold)
+    return VTENC_OK;
+
+  return vtenc_set_compact_begin(set);
+}
+
+static struct vtenc_set *set_create(const vtenc *handler, unsigned int width,
+  size_t threshold)
+{
+  struct vtenc_set *set = calloc(1, sizeof(*set));
+
+  if (set == NULL)
+    return NULL;
+
+  set->handler = *handler;
+  set->handler.params.allow_repeated_values = 0;
+  set->handler.params.run_length_encoding = 0;
+  set->width = width;
+  set->threshold = threshold;
+
+  return set;
+}
+
+void vtenc_set_destroy(vtenc_set *set)
+{
+  if (!set)
+    return;
+
+  set_base_free(&set->base);
+  set_base_free(&set->next);
+  set_edits_free(&set->frozen);
+  set_edits_free(&set->buffer);
+  free(set);
+}
+
+size_t vtenc_set_len(const vtenc_set *set)
+{
+  return set->len;
+}
+
+int vtenc_set_compacting(const vtenc_set *set)
+{
+  return set_compacting(set);
+}
+
+static int set_compact_run8(struct vtenc_set *set);
+static int set_compact_run16(struct vtenc_set *set);
+static int set_compact_run32(struct vtenc_set *set);
+static int set_compact_run64(struct vtenc_set *set);
+
+int vtenc_set_compact_begin(vtenc_set *set)
+{
+  if (set_compacting(set))
+    return VTENC_ERR_CONFIG;
+
+  set->frozen = set->buffer;
+  memset(&set->buffer, 0, sizeof(set->buffer));
+  atomic_store_release(&set->step, SET_BEGUN);
+
+  return VTENC_OK;
+}
+
+int vtenc_set_compact_run(vtenc_set *set)
+{
+  int rc;
+
+  if (!atomic_cas(&set->step, SET_BEGUN, SET_RUNNING))
+    return VTENC_ERR_CONFIG;
+
+  switch (set->width) {
+  case 8: rc = set_compact_run8(set); break;
+  case 16: rc = set_compact_run16(set); break;
+  case 32: rc = set_compact_run32(set); break;
+  default: rc = set_compact_run64(set); break;
+  }
+
+  if (rc != VTENC_OK) {
+    set_base_free(&set->next);
+    atomic_store_release(&set->step, SET_BEGUN);
+    return rc;
+  }
+
+  atomic_store_release(&set->step, SET_READY);
+
+  return VTENC_OK;
+}
+
+int vtenc_set_compact_end(vtenc_set *set)
+{
+  const int step = atomic_load_acquire(&set->step);
+
+  if (step == SET_IDLE || step == SET_RUNNING)
+    return VTENC_ERR_CONFIG;
+
+  if (step == SET_BEGUN)
+    return_if_error(vtenc_set_compact_run(set));
+
+  set_base_free(&set->base);
+  set->base = set->next;
+  memset(&set->next, 0, sizeof(set->next));
+  set_edits_free(&set->frozen);
+  atomic_store_release(&set->step, SET_IDLE);
+
+  return VTENC_OK;
+}
+
+int vtenc_set_compact(vtenc_set *set)
+{
+  if (!set_compacting(set))
+    return_if_error(vtenc_set_compact_begin(set));
+
+  return vtenc_set_compact_end(set);
+}
+
+#define TYPE uint8_t
+#define BITWIDTH 8
+#include "set_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint16_t
+#define BITWIDTH 16
+#include "set_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint32_t
+#define BITWIDTH 32
+#include "set_generic.h"
+#undef TYPE
+#undef BITWIDTH
+
+#define TYPE uint64_t
+#define BITWIDTH 64
+#include "set_generic.h"
+#undef TYPE
+#undef BITWIDTH
@@ -0,0 +1,340 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internals.h"
+
+#define vtenc_encode_(_width_) BITWIDTH_SUFFIX(vtenc_encode, _width_)
+#define vtenc_encode vtenc_encode_(BITWIDTH)
+#define vtenc_decode_(_width_) BITWIDTH_SUFFIX(vtenc_decode, _width_)
+#define vtenc_decode vtenc_decode_(BITWIDTH)
+#define vtenc_max_encoded_size_(_width_) BITWIDTH_SUFFIX(vtenc_max_encoded_size, _width_)
+#define vtenc_max_encoded_size vtenc_max_encoded_size_(BITWIDTH)
+#define vtenc_contains_batch_(_width_) BITWIDTH_SUFFIX(vtenc_contains_batch, _width_)
+#define vtenc_contains_batch vtenc_contains_batch_(BITWIDTH)
+#define set_add_blocks_(_width_) BITWIDTH_SUFFIX(set_add_blocks, _width_)
+#define set_add_blocks set_add_blocks_(BITWIDTH)
+#define set_decode_block_(_width_) BITWIDTH_SUFFIX(set_decode_block, _width_)
+#define set_decode_block set_decode_block_(BITWIDTH)
+#define set_compact_run_(_width_) BITWIDTH_SUFFIX(set_compact_run, _width_)
+#define set_compact_run set_compact_run_(BITWIDTH)
+#define vtenc_set_create_(_width_) BITWIDTH_SUFFIX(vtenc_set_create, _width_)
+#define vtenc_set_create vtenc_set_create_(BITWIDTH)
+#define vtenc_set_assign_(_width_) BITWIDTH_SUFFIX(vtenc_set_assign, _width_)
+#define vtenc_set_assign vtenc_set_assign_(BITWIDTH)
+#define vtenc_set_contains_(_width_) BITWIDTH_SUFFIX(vtenc_set_contains, _width_)
+#define vtenc_set_contains vtenc_set_contains_(BITWIDTH)
+#define vtenc_set_insert_(_width_) BITWIDTH_SUFFIX(vtenc_set_insert, _width_)
+#define vtenc_set_insert vtenc_set_insert_(BITWIDTH)
+#define vtenc_set_erase_(_width_) BITWIDTH_SUFFIX(vtenc_set_erase, _width_)
+#define vtenc_set_erase vtenc_set_erase_(BITWIDTH)
+#define vtenc_set_foreach_(_width_) BITWIDTH_SUFFIX(vtenc_set_foreach, _width_)
+#define vtenc_set_foreach vtenc_set_foreach_(BITWIDTH)
+
+/*
+ * Encodes the sorted values @values to blocks appended to @base. Up to twice
+ * SET_BLOCK_LEN values make a single block, and longer sequences are split
+ * into blocks of about SET_BLOCK_LEN values.
+ */
+static int set_add_blocks(vtenc *handler, struct set_base *base,
+  const TYPE *values, size_t values_len)
+{
+  size_t blocks_len = 1, from = 0, i;
+
+  if (values_len > 2 * SET_BLOCK_LEN)
+    blocks_len = (values_len + SET_BLOCK_LEN - 1) / SET_BLOCK_LEN;
+
+  for (i = 0; i < blocks_len && values_len > 0; i++) {
+    const size_t to = (size_t)((uint64_t)values_len * (i + 1) / blocks_len);
+    const size_t offset = base->bytes.len;
+
+    return_if_error(set_bytes_reserve(&base->bytes,
+      vtenc_max_encoded_size(to - from)));
+
+    return_if_error(vtenc_encode(handler, values + from, to - from,
+      base->bytes.data + offset, base->bytes.cap - offset));
+
+    base->bytes.len += vtenc_encoded_size(handler);
+
+    return_if_error(set_base_add(base, values[from], to - from, offset));
+
+    from = to;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Decodes the block @i of @base, if there is one, into @scratch->values.
+ * Returns the number of decoded values through @len.
+ */
+static int set_decode_block(vtenc *handler, const struct set_base *base,
+  size_t i, struct set_scratch *scratch, size_t *len)
+{
+  const struct set_block *block;
+  TYPE *decoded = scratch->decoded;
+  size_t j;
+
+  *len = 0;
+
+  if (i == base->blocks_len)
+    return VTENC_OK;
+
+  block = &base->blocks[i];
+
+  return_if_error(vtenc_decode(handler, base->bytes.data + block->offset,
+    block->size, decoded, block->len));
+
+  for (j = 0; j < block->len; j++)
+    scratch->values[j] = decoded[j];
+
+  *len = block->len;
+
+  return VTENC_OK;
+}
+
+/*
+ * Builds the next base from the current one and the frozen edits. The blocks
+ * with no edits are copied, and the rest are decoded, edited and encoded
+ * again. An edited block left with few values is joined to the next one if
+ * that one is edited too.
+ */
+static int set_compact_run(struct vtenc_set *set)
+{
+  vtenc handler = set->handler;
+  const struct set_base *base = &set->base;
+  const struct set_edits *edits = &set->frozen;
+  const size_t blocks_len = MAX(base->blocks_len, 1);
+  struct set_scratch scratch = {0};
+  size_t pending_len = 0, i;
+  int rc = VTENC_OK;
+
+  set_base_free(&set->next);
+
+  for (i = 0; i < blocks_len && rc == VTENC_OK; i++) {
+    uint64_t lo, hi, next_lo, next_hi;
+    size_t len, j;
+
+    set_block_range(base, i, &lo, &hi);
+
+    if (set_edits_none(edits, lo, hi)) {
+      if (i < base->blocks_len)
+        rc = set_base_copy(&set->next, base, &base->blocks[i]);
+      continue;
+    }
+
+    len = (i < base->blocks_len) ? base->blocks[i].len : 0;
+    rc = set_scratch_reserve(&scratch,
+      pending_len + len + set_count_ins(edits, lo, hi), sizeof(TYPE));
+    if (rc != VTENC_OK)
+      break;
+
+    rc = set_decode_block(&handler, base, i, &scratch, &len);
+    if (rc != VTENC_OK)
+      break;
+
+    pending_len += set_apply_edits(edits, lo, hi, scratch.values, len,
+      scratch.edited + pending_len);
+
+    if (pending_len < SET_BLOCK_LEN / 4 && i + 1 < blocks_len) {
+      set_block_range(base, i + 1, &next_lo, &next_hi);
+      if (!set_edits_none(edits, next_lo, next_hi))
+        continue;
+    }
+
+    for (j = 0; j < pending_len; j++)
+      ((TYPE *)scratch.decoded)[j] = (TYPE)scratch.edited[j];
+
+    rc = set_add_blocks(&handler, &set->next, scratch.decoded, pending_len);
+    pending_len = 0;
+  }
+
+  set_scratch_free(&scratch);
+
+  return rc;
+}
+
+vtenc_set *vtenc_set_create(vtenc *handler, size_t threshold)
+{
+  return set_create(handler, BITWIDTH, threshold);
+}
+
+int vtenc_set_assign(vtenc_set *set, const TYPE *values, size_t values_len)
+{
+  struct set_base base = {0};
+  size_t i;
+  int rc;
+
+  if (set->width != BITWIDTH || set_compacting(set))
+    return VTENC_ERR_CONFIG;
+
+  for (i = 1; i < values_len; i++) {
+    if (values[i] <= values[i - 1])
+      return VTENC_ERR_NOT_SORTED;
+  }
+
+  rc = set_add_blocks(&set->handler, &base, values, values_len);
+  if (rc != VTENC_OK) {
+    set_base_free(&base);
+    return rc;
+  }
+
+  set_base_free(&set->base);
+  set_edits_free(&set->buffer);
+  set->base = base;
+  set->len = values_len;
+
+  return VTENC_OK;
+}
+
+int vtenc_set_contains(vtenc_set *set, TYPE value, int *found)
+{
+  const struct set_block *block;
+  uint64_t bitmap;
+  size_t i;
+  int rc;
+
+  if (set->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  rc = set_edits_lookup(set, value);
+  if (rc >= 0) {
+    *found = rc;
+    return VTENC_OK;
+  }
+
+  i = set_base_find(&set->base, value);
+  if (i == set->base.blocks_len || value < set->base.blocks[i].first) {
+    *found = 0;
+    return VTENC_OK;
+  }
+
+  block = &set->base.blocks[i];
+  return_if_error(vtenc_contains_batch(&set->handler,
+    set->base.bytes.data + block->offset, block->size, block->len,
+    &value, 1, &bitmap));
+
+  *found = (int)(bitmap & 1);
+
+  return VTENC_OK;
+}
+
+int vtenc_set_insert(vtenc_set *set, TYPE value)
+{
+  const uint64_t base = set->handler.params.base;
+  int found;
+
+  if (set->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  if (value < base ||
+      value_width(value - base) > MIN(set->handler.params.width, BITWIDTH))
+    return VTENC_ERR_CONFIG;
+
+  return_if_error(vtenc_set_contains(set, value, &found));
+
+  if (found)
+    return VTENC_OK;
+
+  return_if_error(set_record_insert(set, value));
+
+  return set_maybe_compact(set);
+}
+
+int vtenc_set_erase(vtenc_set *set, TYPE value)
+{
+  int found;
+
+  return_if_error(vtenc_set_contains(set, value, &found));
+
+  if (!found)
+    return VTENC_OK;
+
+  return_if_error(set_record_erase(set, value));
+
+  return set_maybe_compact(set);
+}
+
+int vtenc_set_foreach(vtenc_set *set, int (*fn)(void *opaque, TYPE value),
+  void *opaque)
+{
+  const size_t blocks_len = MAX(set->base.blocks_len, 1);
+  struct set_scratch scratch = {0};
+  size_t i;
+  int rc = VTENC_OK;
+
+  if (set->width != BITWIDTH)
+    return VTENC_ERR_CONFIG;
+
+  for (i = 0; i < blocks_len && rc == VTENC_OK; i++) {
+    uint64_t lo, hi, *values, *edited;
+    size_t len, j;
+
+    set_block_range(&set->base, i, &lo, &hi);
+
+    len = (i < set->base.blocks_len) ? set->base.blocks[i].len : 0;
+    len += set_count_ins(&set->buffer, lo, hi);
+    if (set_compacting(set))
+      len += set_count_ins(&set->frozen, lo, hi);
+
+    rc = set_scratch_reserve(&scratch, len, sizeof(TYPE));
+    if (rc != VTENC_OK)
+      break;
+
+    rc = set_decode_block(&set->handler, &set->base, i, &scratch, &len);
+    if (rc != VTENC_OK)
+      break;
+
+    values = scratch.values;
+    edited = scratch.edited;
+    if (set_compacting(set)) {
+      len = set_apply_edits(&set->frozen, lo, hi, values, len, edited);
+      values = scratch.edited;
+      edited = scratch.values;
+    }
+    len = set_apply_edits(&set->buffer, lo, hi, values, len, edited);
+    values = edited;
+
+    for (j = 0; j < len; j++) {
+      if (fn(opaque, (TYPE)values[j]) != 0) {
+        rc = VTENC_ERR_SINK;
+        break;
+      }
+    }
+  }
+
+  set_scratch_free(&scratch);
+
+  return rc;
+}
+
+#undef vtenc_encode_
+#undef vtenc_encode
+#undef vtenc_decode_
+#undef vtenc_decode
+#undef vtenc_max_encoded_size_
+#undef vtenc_max_encoded_size
+#undef vtenc_contains_batch_
+#undef vtenc_contains_batch
+#undef set_add_blocks_
+#undef set_add_blocks
+#undef set_decode_block_
+#undef set_decode_block
+#undef set_compact_run_
+#undef set_compact_run
+#undef vtenc_set_create_
+#undef vtenc_set_create
+#undef vtenc_set_assign_
+#undef vtenc_set_assign
+#undef vtenc_set_contains_
+#undef vtenc_set_contains
+#undef vtenc_set_insert_
+#undef vtenc_set_insert
+#undef vtenc_set_erase_
+#undef vtenc_set_erase
+#undef vtenc_set_foreach_
+#undef vtenc_set_foreach
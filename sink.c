@@ -0,0 +1,59 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internals.h"
+
+int vtenc_buffer_write(void *opaque, const uint8_t *data, size_t data_len)
+{
+  struct vtenc_buffer *buffer = opaque;
+
+  if (data_len > buffer->cap - buffer->len) {
+    size_t new_cap = buffer->cap ? buffer->cap : 4096;
+    uint8_t *new_data;
+
+    while (new_cap - buffer->len < data_len) {
+      if (new_cap > SIZE_MAX / 2)
+        return VTENC_ERR_NO_MEMORY;
+      new_cap *= 2;
+    }
+
+    new_data = realloc(buffer->data, new_cap);
+    if (new_data == NULL)
+      return VTENC_ERR_NO_MEMORY;
+
+    buffer->data = new_data;
+    buffer->cap = new_cap;
+  }
+
+  memcpy(buffer->data + buffer->len, data, data_len);
+  buffer->len += data_len;
+
+  return VTENC_OK;
+}
+
+int vtenc_fd_write(void *opaque, const uint8_t *data, size_t data_len)
+{
+  const int fd = *(const int *)opaque;
+
+  while (data_len > 0) {
+    ssize_t written = write(fd, data, data_len);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return VTENC_ERR_SINK;
+    }
+
+    data += written;
+    data_len -= (size_t)written;
+  }
+
+  return VTENC_OK;
+}
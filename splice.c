@@ -0,0 +1,1660 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitstream.h"
+#include "common.h"
+#include "internals.h"
+
+/*
+ * Splitting, concatenation and transcoding of encoded streams work on their bit
+ * cluster trees, which are read as they're needed. Every cluster of the output
+ * is made of a range of values of a cluster of each input, at the same level:
+ * - A cluster that is a whole input cluster, encoded on its own at the same
+ *   level with the same parameters, has the same encoding, so its bits are
+ *   copied.
+ * - Otherwise, it's written from its parts, as the encoder would, which only
+ *   happens along the boundary between the inputs, at the split value, or
+ *   wherever the parameters of the input and the output differ.
+ * The bits of an input cluster follow those of its zeros child, so the
+ * clusters that aren't needed before one that is still have to be skipped,
+ * which takes reading their number of values but not the values of leaves.
+ */
+
+/* Size of the buffers that output sinks are fed from */
+#define SPLICE_SINK_BUFFER_SIZE 4096
+
+/* A skipped subtree has a cluster pending per level, plus the current one */
+#define SPLICE_STACK_MAX_SIZE (VTENC_TREE_LEVELS + 1)
+
+/* Longest clusters that are read into an array before being encoded again */
+#define SPLICE_GATHER_MAX_LEN 256
+
+/*
+ * Longest clusters with edits that are read into an array before being encoded
+ * again. It's lower than SPLICE_GATHER_MAX_LEN since most of the children of
+ * longer ones have no edits, and are copied.
+ */
+#define SPLICE_APPLY_GATHER_MAX_LEN 16
+
+/* Bits used to encode the width of each number in the header of a diff */
+#define SPLICE_DIFF_WIDTH_BITS 6
+
+/* Longest header of a diff: three numbers of up to 64 bits and their widths */
+#define SPLICE_DIFF_HEADER_MAX_SIZE 32
+
+struct splice_cluster {
+  size_t        length;
+  unsigned int  bit_pos;
+};
+
+/*
+ * States of an input cluster at level `bit_pos`, whose values are the lower
+ * `bit_pos` bits of the values under it, since all their higher bits are in
+ * common.
+ */
+enum splice_kind {
+  SPLICE_UNREAD,  /* Its encoding is next in the stream */
+  SPLICE_SPLIT,   /* Its number of zeros is read, and its children are next */
+  SPLICE_CHAIN,   /* Its values share `bits` down to `split_pos`, where
+                     they split into `n_zeros` zeros and the rest */
+  SPLICE_LEAF,    /* Its values are stored from bit `bits` of the stream on,
+                     `leaf_bits` bits each */
+  SPLICE_RANGE    /* Its values are consecutive from `bits` on, or all 0 at
+                     level 0 */
+};
+
+struct splice_node {
+  struct bsreader   *reader;
+  enum splice_kind  kind;
+  unsigned int      bit_pos;
+  unsigned int      split_pos;
+  unsigned int      leaf_bits;
+  size_t            length;
+  size_t            n_zeros;
+  uint64_t          bits;
+};
+
+/* Values in [from, to) of an input cluster */
+struct splice_view {
+  struct splice_node  node;
+  size_t              from;
+  size_t              to;
+};
+
+/* A cluster that has already been skipped, and where its encoding starts and ends */
+struct splice_skipped {
+  size_t          length;
+  unsigned int    bit_pos;
+  uint64_t        from;
+  struct bsreader to;
+};
+
+/* Parameters that decide how a cluster is encoded */
+struct splice_format {
+  int           skip_full_subtrees;
+  int           path_compression;
+  const size_t  *min_cluster_length;
+};
+
+struct splice_ctx {
+  int                         is_set;
+  struct splice_format        in;           /* Format of the inputs */
+  struct splice_format        out;          /* Format of the output */
+  unsigned int                max_copy_pos; /* Highest level whose clusters are
+                                               encoded the same in both */
+  struct bswriter             *writer;
+  const struct splice_skipped *skipped;
+  size_t                      skipped_len;
+};
+
+static void splice_format_init(struct splice_format *format, const vtenc *handler)
+{
+  format->skip_full_subtrees = !handler->params.allow_repeated_values &&
+                               handler->params.skip_full_subtrees;
+  format->path_compression = handler->params.path_compression;
+  format->min_cluster_length = handler->params.min_cluster_length;
+}
+
+/*
+ * Sets up the context to read inputs encoded by `dec` and write them as `enc`
+ * encodes, which must both hold sets or lists.
+ */
+static void splice_ctx_init(struct splice_ctx *ctx, const vtenc *dec,
+  const vtenc *enc, struct bswriter *writer)
+{
+  unsigned int bit_pos = 0;
+
+  ctx->is_set = !enc->params.allow_repeated_values;
+  splice_format_init(&ctx->in, dec);
+  splice_format_init(&ctx->out, enc);
+
+  /* The encoding of a cluster only depends on the parameters of its level and the lower ones */
+  if (ctx->in.skip_full_subtrees == ctx->out.skip_full_subtrees &&
+      ctx->in.path_compression == ctx->out.path_compression) {
+    while (bit_pos + 1 < VTENC_TREE_LEVELS &&
+           ctx->in.min_cluster_length[bit_pos + 1] == ctx->out.min_cluster_length[bit_pos + 1])
+      bit_pos++;
+  }
+
+  ctx->max_copy_pos = bit_pos;
+  ctx->writer = writer;
+  ctx->skipped = NULL;
+  ctx->skipped_len = 0;
+}
+
+/*
+ * Only streams with no run lengths, no base of their own and no leaf flags
+ * have clusters that are encoded the same regardless of the rest of the tree.
+ */
+static inline int splice_is_supported(const vtenc *handler)
+{
+  return !(handler->params.allow_repeated_values && handler->params.run_length_encoding) &&
+         !handler->params.frame_of_reference && !handler->params.optimal_leaves;
+}
+
+static inline uint64_t splice_reader_pos(const struct bsreader *reader)
+{
+  return (uint64_t)(reader->ptr - reader->start_ptr) * 8 + reader->bit_pos;
+}
+
+/* Reads `n_bits` bits at bit `pos` of a stream, which are known to be there */
+static inline uint64_t splice_read_at(const struct bsreader *reader,
+  uint64_t pos, unsigned int n_bits)
+{
+  struct bsreader at = *reader;
+  uint64_t value = 0;
+
+  at.ptr = at.start_ptr + (pos >> 3);
+  at.bit_pos = pos & 7;
+  bsreader_read_bits(&at, n_bits, &value);
+
+  return value;
+}
+
+/* Writes the lower `n_bits` bits of `value`, up to 64 */
+static inline void splice_write(struct bswriter *writer, uint64_t value,
+  unsigned int n_bits)
+{
+  if (n_bits > BIT_STREAM_MAX_WRITE) {
+    bswriter_write(writer, value & BITS_SIZE_MASK[BIT_STREAM_MAX_WRITE], BIT_STREAM_MAX_WRITE);
+    value >>= BIT_STREAM_MAX_WRITE;
+    n_bits -= BIT_STREAM_MAX_WRITE;
+  }
+
+  bswriter_write(writer, value & BITS_SIZE_MASK[n_bits], n_bits);
+}
+
+/*
+ * Reads what follows the number of zeros, `*n_zeros`, of a cluster of
+ * `length` values at level `*bit_pos` if it's 0 or `length`. With path
+ * compression, that number stands for the common bits of its values instead,
+ * which come next. They are returned in `common_bits`, at their positions,
+ * and `*bit_pos` is lowered to the level at which the cluster splits, whose
+ * number of zeros is read then.
+ */
+static noinline int splice_read_common(const struct splice_ctx *ctx,
+  struct bsreader *reader, size_t length, unsigned int *bit_pos,
+  uint64_t *n_zeros, uint64_t *common_bits)
+{
+  *common_bits = 0;
+
+  if (!ctx->in.path_compression || length < VTENC_PATH_MIN_CLUSTER_LENGTH)
+    return VTENC_OK;
+
+  return_if_error(bsreader_read_common_bits(reader, *n_zeros == 0, bit_pos,
+    common_bits));
+
+  if (*bit_pos == 0)
+    return VTENC_OK;
+
+  return_if_error(bsreader_read_bits(reader, bits_len_u64(length), n_zeros));
+
+  if (*n_zeros > (uint64_t)length) return VTENC_ERR_WRONG_FORMAT;
+
+  return VTENC_OK;
+}
+
+/*
+ * Skips the encoding of a cluster of `length` values at level `bit_pos`. As
+ * in encode_small_tree(), the reader and the stack are local variables, so
+ * that they can be kept in registers.
+ */
+static int splice_skip(const struct splice_ctx *ctx, struct bsreader *reader,
+  size_t length, unsigned int bit_pos)
+{
+  const int skip_full_subtrees = ctx->in.skip_full_subtrees;
+  const size_t *min_cluster_length = ctx->in.min_cluster_length;
+  struct splice_cluster stack[SPLICE_STACK_MAX_SIZE];
+  struct bsreader bits_reader = *reader;
+  size_t depth = 0, i;
+  int rc = VTENC_OK;
+
+  for (i = 0; i < ctx->skipped_len; i++) {
+    if (ctx->skipped[i].from == splice_reader_pos(reader) &&
+        ctx->skipped[i].length == length && ctx->skipped[i].bit_pos == bit_pos) {
+      *reader = ctx->skipped[i].to;
+      return VTENC_OK;
+    }
+  }
+
+  if (length > 0 && bit_pos > 0)
+    stack[depth++] = (struct splice_cluster){length, bit_pos};
+
+  while (depth > 0 && rc == VTENC_OK) {
+    const struct splice_cluster cluster = stack[--depth];
+    const size_t cl_len = cluster.length;
+    unsigned int cl_bit_pos = cluster.bit_pos;
+    uint64_t n_zeros, common_bits;
+
+    if (skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos))
+      continue;
+
+    if (cl_len <= min_cluster_length[cl_bit_pos]) {
+      rc = bsreader_skip(&bits_reader, (uint64_t)cl_len * cl_bit_pos);
+      continue;
+    }
+
+    if (bits_reader.ptr >= bits_reader.end_ptr) {
+      rc = VTENC_ERR_WRONG_FORMAT;
+      break;
+    }
+
+    n_zeros = bsreader_read(&bits_reader, bits_len_u64(cl_len));
+
+    if (n_zeros == 0 || n_zeros >= (uint64_t)cl_len) {
+      if (n_zeros > (uint64_t)cl_len) {
+        rc = VTENC_ERR_WRONG_FORMAT;
+        break;
+      }
+
+      rc = splice_read_common(ctx, &bits_reader, cl_len, &cl_bit_pos, &n_zeros, &common_bits);
+
+      if (cl_bit_pos == 0)
+        continue;
+    }
+
+    if (--cl_bit_pos == 0)
+      continue;
+
+    if (n_zeros < (uint64_t)cl_len)
+      stack[depth++] = (struct splice_cluster){cl_len - n_zeros, cl_bit_pos};
+
+    if (n_zeros > 0)
+      stack[depth++] = (struct splice_cluster){n_zeros, cl_bit_pos};
+  }
+
+  *reader = bits_reader;
+
+  return rc;
+}
+
+/* Reads what an unread cluster is, along with its number of zeros if it splits */
+static int splice_open(const struct splice_ctx *ctx, struct splice_node *node)
+{
+  const size_t length = node->length;
+  unsigned int bit_pos = node->bit_pos;
+  uint64_t n_zeros, common_bits;
+
+  if (length == 0 || bit_pos == 0 ||
+      (ctx->in.skip_full_subtrees && is_full_subtree(length, bit_pos))) {
+    node->kind = SPLICE_RANGE;
+    node->bits = 0;
+    return VTENC_OK;
+  }
+
+  if (length <= ctx->in.min_cluster_length[bit_pos]) {
+    node->kind = SPLICE_LEAF;
+    node->bits = splice_reader_pos(node->reader);
+    node->leaf_bits = bit_pos;
+    return bsreader_skip(node->reader, (uint64_t)length * bit_pos);
+  }
+
+  return_if_error(bsreader_read_bits(node->reader, bits_len_u64(length), &n_zeros));
+
+  if (n_zeros > (uint64_t)length) return VTENC_ERR_WRONG_FORMAT;
+
+  common_bits = 0;
+  if (n_zeros == 0 || n_zeros == (uint64_t)length)
+    return_if_error(splice_read_common(ctx, node->reader, length, &bit_pos,
+                                       &n_zeros, &common_bits));
+
+  node->kind = bit_pos < node->bit_pos ? SPLICE_CHAIN : SPLICE_SPLIT;
+  node->split_pos = bit_pos;
+  node->n_zeros = (size_t)n_zeros;
+  node->bits = common_bits;
+
+  return VTENC_OK;
+}
+
+/* Returns the value at position `i` of a leaf or a range */
+static inline uint64_t splice_value(const struct splice_node *node, size_t i)
+{
+  if (node->kind == SPLICE_LEAF)
+    return splice_read_at(node->reader, node->bits + (uint64_t)i * node->leaf_bits, node->bit_pos);
+
+  return node->bit_pos > 0 ? node->bits + i : 0;
+}
+
+/* Returns the number of values of a leaf or a range below `value` */
+static size_t splice_lower_bound(const struct splice_node *node, uint64_t value)
+{
+  size_t lo = 0, hi = node->length;
+
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (splice_value(node, mid) < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/*
+ * Sets the children of a cluster at a level greater than 0, reading it first
+ * if needed. The zeros child of a split cluster is next in the stream, but
+ * the ones child only comes after it.
+ */
+static int splice_children(const struct splice_ctx *ctx, struct splice_node *node,
+  struct splice_node *zeros, struct splice_node *ones)
+{
+  const unsigned int bit_pos = node->bit_pos - 1;
+  size_t n_zeros;
+
+  if (node->kind == SPLICE_UNREAD)
+    return_if_error(splice_open(ctx, node));
+
+  *zeros = *node;
+  *ones = *node;
+  zeros->bit_pos = bit_pos;
+  ones->bit_pos = bit_pos;
+
+  switch (node->kind) {
+    case SPLICE_SPLIT:
+      n_zeros = node->n_zeros;
+      zeros->kind = SPLICE_UNREAD;
+      ones->kind = SPLICE_UNREAD;
+      break;
+    case SPLICE_CHAIN:
+      n_zeros = (node->bits >> bit_pos) & 1 ? 0 : node->length;
+      if (bit_pos == node->split_pos) {
+        zeros->kind = bit_pos > 0 ? SPLICE_SPLIT : SPLICE_RANGE;
+        ones->kind = zeros->kind;
+        zeros->bits = 0;
+        ones->bits = 0;
+      }
+      break;
+    case SPLICE_LEAF:
+      n_zeros = splice_lower_bound(node, 1ULL << bit_pos);
+      ones->bits = node->bits + (uint64_t)n_zeros * node->leaf_bits;
+      break;
+    default:
+      if (node->length == 0) {
+        n_zeros = 0;
+      } else if (node->bits >> bit_pos) {
+        n_zeros = 0;
+        ones->bits = node->bits - (1ULL << bit_pos);
+      } else {
+        n_zeros = MIN(node->length, (1ULL << bit_pos) - node->bits);
+        ones->bits = 0;
+      }
+      break;
+  }
+
+  zeros->length = n_zeros;
+  ones->length = node->length - n_zeros;
+
+  return VTENC_OK;
+}
+
+/*
+ * Sets the children at level `bit_pos` - 1 of a view at level `bit_pos`.
+ * Views of clusters at a lower level than `bit_pos` have 0 as their higher
+ * bits, so they are their own zeros child.
+ */
+static int splice_view_children(const struct splice_ctx *ctx,
+  struct splice_view *view, unsigned int bit_pos,
+  struct splice_view *zeros, struct splice_view *ones)
+{
+  size_t n_zeros;
+
+  if (view->from == view->to || view->node.bit_pos < bit_pos) {
+    *zeros = *view;
+    *ones = *view;
+    ones->node.kind = SPLICE_RANGE;
+    ones->node.length = 0;
+    ones->from = 0;
+    ones->to = 0;
+    return VTENC_OK;
+  }
+
+  return_if_error(splice_children(ctx, &view->node, &zeros->node, &ones->node));
+
+  n_zeros = zeros->node.length;
+  zeros->from = MIN(view->from, n_zeros);
+  zeros->to = MIN(view->to, n_zeros);
+  ones->from = MAX(view->from, n_zeros) - n_zeros;
+  ones->to = MAX(view->to, n_zeros) - n_zeros;
+
+  return VTENC_OK;
+}
+
+/* Skips a cluster if it hasn't been read yet, so that the next one can be */
+static inline int splice_skip_node(const struct splice_ctx *ctx,
+  const struct splice_node *node)
+{
+  if (node->length == 0 || node->kind != SPLICE_UNREAD)
+    return VTENC_OK;
+
+  return splice_skip(ctx, node->reader, node->length, node->bit_pos);
+}
+
+/*
+ * Skips the zeros child of a view if none of its values are taken, so that the
+ * ones child can be read next.
+ */
+static inline int splice_drop(const struct splice_ctx *ctx,
+  const struct splice_view *zeros)
+{
+  return zeros->from < zeros->to ? VTENC_OK : splice_skip_node(ctx, &zeros->node);
+}
+
+/*
+ * Goes through the values of a view in order, writing their lower `n_bits`
+ * bits, along with `higher_bits`, if `write` is set.
+ */
+static int splice_stream(const struct splice_ctx *ctx, struct splice_view *view,
+  unsigned int n_bits, uint64_t higher_bits, int write)
+{
+  struct splice_node *node = &view->node;
+  struct splice_view zeros, ones;
+  size_t i;
+
+  if (view->from == view->to)
+    return VTENC_OK;
+
+  if (!write && node->kind == SPLICE_UNREAD && view->from == 0 && view->to == node->length)
+    return splice_skip(ctx, node->reader, node->length, node->bit_pos);
+
+  if (node->kind == SPLICE_UNREAD)
+    return_if_error(splice_open(ctx, node));
+
+  if (node->kind == SPLICE_LEAF || node->kind == SPLICE_RANGE) {
+    for (i = view->from; write && i < view->to; i++)
+      splice_write(ctx->writer, higher_bits | splice_value(node, i), n_bits);
+    return VTENC_OK;
+  }
+
+  return_if_error(splice_view_children(ctx, view, node->bit_pos, &zeros, &ones));
+  return_if_error(splice_stream(ctx, &zeros, n_bits, higher_bits, write));
+  return_if_error(splice_drop(ctx, &zeros));
+
+  return splice_stream(ctx, &ones, n_bits, higher_bits | (1ULL << ones.node.bit_pos), write);
+}
+
+struct splice_gathered {
+  size_t        length;
+  unsigned int  bit_pos;
+  uint64_t      higher_bits;
+};
+
+/*
+ * Reads the values of an unread cluster of `length` values at level `bit_pos`
+ * into `values`, from `*n_values` on, with `higher_bits` added to them. Like
+ * splice_skip(), it goes through the subtree with a stack of its own.
+ */
+static int splice_decode(const struct splice_ctx *ctx, struct bsreader *reader,
+  size_t length, unsigned int bit_pos, uint64_t higher_bits, uint64_t *values,
+  size_t *n_values)
+{
+  struct splice_gathered stack[SPLICE_STACK_MAX_SIZE];
+  size_t depth = 0, n = *n_values, i;
+
+  stack[depth++] = (struct splice_gathered){length, bit_pos, higher_bits};
+
+  while (depth > 0) {
+    const struct splice_gathered cluster = stack[--depth];
+    const size_t cl_len = cluster.length;
+    unsigned int cl_bit_pos = cluster.bit_pos;
+    uint64_t n_zeros, common_bits, higher = cluster.higher_bits;
+
+    if (cl_bit_pos == 0) {
+      for (i = 0; i < cl_len; i++)
+        values[n++] = higher;
+      continue;
+    }
+
+    if (ctx->in.skip_full_subtrees && is_full_subtree(cl_len, cl_bit_pos)) {
+      for (i = 0; i < cl_len; i++)
+        values[n++] = higher | i;
+      continue;
+    }
+
+    if (cl_len <= ctx->in.min_cluster_length[cl_bit_pos]) {
+      for (i = 0; i < cl_len; i++) {
+        return_if_error(bsreader_read_bits(reader, cl_bit_pos, &values[n]));
+        values[n++] |= higher;
+      }
+      continue;
+    }
+
+    return_if_error(bsreader_read_bits(reader, bits_len_u64(cl_len), &n_zeros));
+
+    if (n_zeros > (uint64_t)cl_len) return VTENC_ERR_WRONG_FORMAT;
+
+    if (n_zeros == 0 || n_zeros == (uint64_t)cl_len) {
+      return_if_error(splice_read_common(ctx, reader, cl_len, &cl_bit_pos, &n_zeros, &common_bits));
+      higher |= common_bits;
+
+      if (cl_bit_pos == 0) {
+        stack[depth++] = (struct splice_gathered){cl_len, 0, higher};
+        continue;
+      }
+    }
+
+    cl_bit_pos--;
+
+    if (n_zeros < (uint64_t)cl_len)
+      stack[depth++] = (struct splice_gathered){cl_len - n_zeros, cl_bit_pos, higher | (1ULL << cl_bit_pos)};
+
+    if (n_zeros > 0)
+      stack[depth++] = (struct splice_gathered){n_zeros, cl_bit_pos, higher};
+  }
+
+  *n_values = n;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads the values of a view into `values`, from `*n_values` on, with
+ * `higher_bits` added to them.
+ */
+static int splice_gather(const struct splice_ctx *ctx, struct splice_view *view,
+  uint64_t higher_bits, uint64_t *values, size_t *n_values)
+{
+  struct splice_node *node = &view->node;
+  struct splice_view zeros, ones;
+  size_t i;
+
+  if (view->from == view->to)
+    return VTENC_OK;
+
+  if (node->kind == SPLICE_UNREAD && view->from == 0 && view->to == node->length)
+    return splice_decode(ctx, node->reader, node->length, node->bit_pos, higher_bits,
+                         values, n_values);
+
+  if (node->kind == SPLICE_UNREAD)
+    return_if_error(splice_open(ctx, node));
+
+  if (node->kind == SPLICE_LEAF || node->kind == SPLICE_RANGE) {
+    for (i = view->from; i < view->to; i++)
+      values[(*n_values)++] = higher_bits | splice_value(node, i);
+    return VTENC_OK;
+  }
+
+  return_if_error(splice_view_children(ctx, view, node->bit_pos, &zeros, &ones));
+  return_if_error(splice_gather(ctx, &zeros, higher_bits, values, n_values));
+  return_if_error(splice_drop(ctx, &zeros));
+
+  return splice_gather(ctx, &ones, higher_bits | (1ULL << ones.node.bit_pos), values, n_values);
+}
+
+/* Finds the first or the last value of a view, which mustn't be empty */
+static int splice_bound(const struct splice_ctx *ctx, const struct splice_view *view,
+  int last, uint64_t *value)
+{
+  struct splice_view cur = *view, zeros, ones;
+  uint64_t higher_bits = 0;
+
+  for (;;) {
+    struct splice_node *node = &cur.node;
+
+    if (node->kind == SPLICE_UNREAD)
+      return_if_error(splice_open(ctx, node));
+
+    if (node->kind == SPLICE_LEAF || node->kind == SPLICE_RANGE) {
+      *value = higher_bits | splice_value(node, last ? cur.to - 1 : cur.from);
+      return VTENC_OK;
+    }
+
+    return_if_error(splice_view_children(ctx, &cur, node->bit_pos, &zeros, &ones));
+
+    if (last ? ones.from < ones.to : zeros.from == zeros.to) {
+      return_if_error(splice_skip_node(ctx, &zeros.node));
+      higher_bits |= 1ULL << ones.node.bit_pos;
+      cur = ones;
+    } else {
+      cur = zeros;
+    }
+  }
+}
+
+/*
+ * Checks that all the values of the first of two views of the same cluster
+ * are lower than those of the second one, or not greater for lists. Their
+ * clusters are read ahead, from a copy of their readers.
+ */
+static int splice_check_order(const struct splice_ctx *ctx,
+  const struct splice_view *views, size_t n_views)
+{
+  struct bsreader readers[2];
+  uint64_t last, first;
+  int rc;
+
+  if (n_views < 2 || views[0].from == views[0].to || views[1].from == views[1].to)
+    return VTENC_OK;
+
+  readers[0] = *views[0].node.reader;
+  readers[1] = *views[1].node.reader;
+
+  rc = splice_bound(ctx, &views[0], 1, &last);
+  if (rc == VTENC_OK)
+    rc = splice_bound(ctx, &views[1], 0, &first);
+
+  *views[0].node.reader = readers[0];
+  *views[1].node.reader = readers[1];
+
+  if (rc == VTENC_OK && (last > first || (ctx->is_set && last == first)))
+    rc = VTENC_ERR_NOT_SORTED;
+
+  return rc;
+}
+
+/* Copies the bits of a cluster encoded on its own at its level */
+static int splice_copy(const struct splice_ctx *ctx, struct splice_node *node)
+{
+  struct bsreader from = *node->reader;
+  uint64_t n_bits;
+
+  return_if_error(splice_skip(ctx, node->reader, node->length, node->bit_pos));
+
+  if (splice_reader_pos(node->reader) > (uint64_t)(from.end_ptr - from.start_ptr) * 8)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  n_bits = splice_reader_pos(node->reader) - splice_reader_pos(&from);
+
+  while (n_bits > 0) {
+    const unsigned int n = (unsigned int)MIN(n_bits, BIT_STREAM_MAX_WRITE);
+
+    bswriter_write(ctx->writer, bsreader_read(&from, n), n);
+    n_bits -= n;
+  }
+
+  return VTENC_OK;
+}
+
+/* Returns the number of sorted values whose bit at `bit_pos` - 1 is 0 */
+static inline size_t splice_count_zeros(const uint64_t *values, size_t length,
+  unsigned int bit_pos)
+{
+  const uint64_t bit = 1ULL << (bit_pos - 1);
+  size_t lo = 0, hi = length;
+
+  /* The values of a cluster share their higher bits, so the bit only goes from 0 to 1 once */
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (values[mid] & bit)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
+/* Encodes a cluster of sorted values as splice_emit() does, from memory */
+static void splice_emit_values(const struct splice_ctx *ctx, const uint64_t *values,
+  size_t length, unsigned int bit_pos)
+{
+  unsigned int split_pos = bit_pos;
+  uint64_t common_bits = 0;
+  size_t n_zeros, i;
+
+  if (length == 0 || bit_pos == 0 ||
+      (ctx->out.skip_full_subtrees && is_full_subtree(length, bit_pos)))
+    return;
+
+  if (length <= ctx->out.min_cluster_length[bit_pos]) {
+    for (i = 0; i < length; i++)
+      splice_write(ctx->writer, values[i], bit_pos);
+    return;
+  }
+
+  for (;;) {
+    n_zeros = splice_count_zeros(values, length, split_pos);
+
+    if (!ctx->out.path_compression || length < VTENC_PATH_MIN_CLUSTER_LENGTH ||
+        (n_zeros != 0 && n_zeros != length))
+      break;
+
+    common_bits = (common_bits << 1) | (n_zeros == 0);
+
+    if (--split_pos == 0)
+      break;
+  }
+
+  if (split_pos < bit_pos) {
+    const unsigned int n_common = bit_pos - split_pos;
+
+    bswriter_write(ctx->writer, (common_bits >> (n_common - 1)) & 1 ? 0 : length,
+                   bits_len_u64(length));
+    bswriter_write_gamma(ctx->writer, n_common);
+    splice_write(ctx->writer, common_bits, n_common - 1);
+
+    if (split_pos == 0)
+      return;
+  }
+
+  bswriter_write(ctx->writer, n_zeros, bits_len_u64(length));
+
+  splice_emit_values(ctx, values, n_zeros, split_pos - 1);
+  splice_emit_values(ctx, values + n_zeros, length - n_zeros, split_pos - 1);
+}
+
+/*
+ * Encodes a short cluster made of the values of `n_views` views by reading
+ * them first, which is faster than going through the views level by level.
+ */
+static noinline int splice_emit_gathered(const struct splice_ctx *ctx,
+  struct splice_view *views, size_t n_views, unsigned int bit_pos)
+{
+  uint64_t values[SPLICE_GATHER_MAX_LEN];
+  size_t n_values = 0, first_len = 0, i;
+
+  for (i = 0; i < n_views; i++) {
+    return_if_error(splice_gather(ctx, &views[i], 0, values, &n_values));
+
+    if (i == 0)
+      first_len = n_values;
+  }
+
+  if (first_len > 0 && first_len < n_values &&
+      (values[first_len - 1] > values[first_len] ||
+       (ctx->is_set && values[first_len - 1] == values[first_len])))
+    return VTENC_ERR_NOT_SORTED;
+
+  splice_emit_values(ctx, values, n_values, bit_pos);
+
+  return VTENC_OK;
+}
+
+/*
+ * Encodes the cluster at level `bit_pos` made of the values of `n_views`
+ * views, of one or two inputs, exactly as encode_bit_cluster_tree() does.
+ * With two inputs, it also checks that the values of the first one are lower
+ * than those of the second one, wherever they share a cluster.
+ */
+static int splice_emit(const struct splice_ctx *ctx, const struct splice_view *in_views,
+  size_t n_views, unsigned int bit_pos)
+{
+  struct splice_view views[2], zeros[2], ones[2];
+  struct splice_view *single = NULL;
+  size_t length = 0, n_zeros = 0, n_single = 0, i;
+  unsigned int split_pos = bit_pos;
+  uint64_t common_bits = 0;
+
+  for (i = 0; i < n_views; i++) {
+    views[i] = in_views[i];
+    length += views[i].to - views[i].from;
+    if (views[i].from < views[i].to) {
+      single = &views[i];
+      n_single++;
+    }
+  }
+
+  if (length == 0)
+    return VTENC_OK;
+
+  if (bit_pos == 0)
+    return n_single > 1 && ctx->is_set ? VTENC_ERR_NOT_SORTED : VTENC_OK;
+
+  /* A whole cluster encoded on its own at the same level is encoded the same */
+  if (n_single == 1 && single->node.kind == SPLICE_UNREAD && single->node.bit_pos == bit_pos &&
+      single->from == 0 && single->to == single->node.length && bit_pos <= ctx->max_copy_pos)
+    return splice_copy(ctx, &single->node);
+
+  if ((ctx->out.skip_full_subtrees && is_full_subtree(length, bit_pos)) ||
+      length <= ctx->out.min_cluster_length[bit_pos]) {
+    const int is_leaf = !(ctx->out.skip_full_subtrees && is_full_subtree(length, bit_pos));
+
+    return_if_error(splice_check_order(ctx, views, n_views));
+
+    for (i = 0; i < n_views; i++)
+      return_if_error(splice_stream(ctx, &views[i], bit_pos, 0, is_leaf));
+
+    return VTENC_OK;
+  }
+
+  if (length <= SPLICE_GATHER_MAX_LEN)
+    return splice_emit_gathered(ctx, views, n_views, bit_pos);
+
+  /* With path compression, the levels at which values don't split are skipped */
+  for (;;) {
+    n_zeros = 0;
+    for (i = 0; i < n_views; i++) {
+      return_if_error(splice_view_children(ctx, &views[i], split_pos, &zeros[i], &ones[i]));
+      n_zeros += zeros[i].to - zeros[i].from;
+    }
+
+    if (!ctx->out.path_compression || length < VTENC_PATH_MIN_CLUSTER_LENGTH ||
+        (n_zeros != 0 && n_zeros != length))
+      break;
+
+    common_bits = (common_bits << 1) | (n_zeros == 0);
+
+    for (i = 0; i < n_views; i++) {
+      if (n_zeros == 0) {
+        return_if_error(splice_drop(ctx, &zeros[i]));
+        views[i] = ones[i];
+      } else {
+        views[i] = zeros[i];
+      }
+    }
+
+    if (--split_pos == 0)
+      break;
+  }
+
+  if (split_pos < bit_pos) {
+    const unsigned int n_common = bit_pos - split_pos;
+
+    bswriter_write(ctx->writer, (common_bits >> (n_common - 1)) & 1 ? 0 : length,
+                   bits_len_u64(length));
+    bswriter_write_gamma(ctx->writer, n_common);
+    splice_write(ctx->writer, common_bits, n_common - 1);
+
+    if (split_pos == 0)
+      return n_single > 1 && ctx->is_set ? VTENC_ERR_NOT_SORTED : VTENC_OK;
+  }
+
+  /* Values of the first input can't be in the ones child with some of the second one's in the zeros one */
+  if (n_views == 2 && ones[0].from < ones[0].to && zeros[1].from < zeros[1].to)
+    return VTENC_ERR_NOT_SORTED;
+
+  bswriter_write(ctx->writer, n_zeros, bits_len_u64(length));
+
+  return_if_error(splice_emit(ctx, zeros, n_views, split_pos - 1));
+
+  for (i = 0; i < n_views; i++)
+    return_if_error(splice_drop(ctx, &zeros[i]));
+
+  return splice_emit(ctx, ones, n_views, split_pos - 1);
+}
+
+/*
+ * Reads the header of a stream of `values_len` values, which only holds the
+ * width if it's detected, and sets up a view of its whole tree.
+ */
+static int splice_read_header(const vtenc *handler, struct bsreader *reader,
+  size_t values_len, unsigned int max_width, struct splice_view *view)
+{
+  unsigned int width = max_width;
+
+  if (handler->params.detect_width && values_len > 0)
+    return_if_error(bsreader_read_width(reader, max_width, &width));
+
+  view->node = (struct splice_node){reader, SPLICE_UNREAD, width, 0, 0, values_len, 0, 0};
+  view->from = 0;
+  view->to = values_len;
+
+  return VTENC_OK;
+}
+
+static inline void splice_write_header(const vtenc *handler, struct bswriter *writer,
+  size_t values_len, unsigned int max_width, unsigned int width)
+{
+  if (handler->params.detect_width && values_len > 0)
+    bswriter_write(writer, width, bits_len_u32(max_width));
+}
+
+/*
+ * Returns in `rank` the number of values of a whole tree below `value`. The
+ * clusters skipped on the way, one per level at most, are added to `skipped`.
+ */
+static int splice_rank(const struct splice_ctx *ctx, struct splice_view view,
+  uint64_t value, size_t *rank, struct splice_skipped *skipped, size_t *skipped_len)
+{
+  struct splice_view zeros, ones;
+  unsigned int bit_pos = view.node.bit_pos;
+
+  *rank = 0;
+
+  if (bit_pos < 64 && (value >> bit_pos) != 0) {
+    *rank = view.to;
+    return VTENC_OK;
+  }
+
+  while (view.from < view.to && bit_pos > 0) {
+    struct splice_node *node = &view.node;
+
+    if (node->kind == SPLICE_UNREAD)
+      return_if_error(splice_open(ctx, node));
+
+    if (node->kind == SPLICE_LEAF || node->kind == SPLICE_RANGE) {
+      *rank += splice_lower_bound(node, value & BITS_SIZE_MASK[bit_pos]);
+      break;
+    }
+
+    return_if_error(splice_view_children(ctx, &view, bit_pos, &zeros, &ones));
+
+    if ((value >> (bit_pos - 1)) & 1) {
+      *rank += zeros.to - zeros.from;
+      skipped[*skipped_len].length = zeros.node.length;
+      skipped[*skipped_len].bit_pos = zeros.node.bit_pos;
+      skipped[*skipped_len].from = splice_reader_pos(view.node.reader);
+      return_if_error(splice_skip_node(ctx, &zeros.node));
+      skipped[(*skipped_len)++].to = *view.node.reader;
+      view = ones;
+    } else {
+      view = zeros;
+    }
+
+    bit_pos--;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Lowers the level of a view of a whole tree to the width of its last value,
+ * which is returned in `width`. Values are below 2^width, so only zeros
+ * children lead to it.
+ */
+static int splice_narrow(const struct splice_ctx *ctx, struct splice_view *view,
+  unsigned int *width)
+{
+  struct splice_view zeros, ones;
+
+  for (*width = view->node.bit_pos; *width > 0; (*width)--) {
+    return_if_error(splice_view_children(ctx, view, *width, &zeros, &ones));
+
+    if (ones.from < ones.to)
+      break;
+
+    *view = zeros;
+  }
+
+  return VTENC_OK;
+}
+
+/*
+ * Encodes the values of the first `lo_len` values of a tree, whose width is
+ * lowered to that of the last one if it's detected.
+ */
+static int splice_emit_lower(const vtenc *handler, const struct splice_ctx *ctx,
+  struct splice_view view, size_t lo_len, unsigned int max_width)
+{
+  unsigned int width = view.node.bit_pos;
+
+  view.to = lo_len;
+
+  if (handler->params.detect_width && lo_len < view.node.length)
+    return_if_error(splice_narrow(ctx, &view, &width));
+
+  splice_write_header(handler, ctx->writer, lo_len, max_width, width);
+
+  return splice_emit(ctx, &view, 1, width);
+}
+
+static int splice_split(vtenc *handler, const uint8_t *in, size_t in_len,
+  size_t values_len, uint64_t value, unsigned int max_width,
+  const struct vtenc_sink *lo, const struct vtenc_sink *hi, size_t *lo_len)
+{
+  uint8_t lo_buffer[SPLICE_SINK_BUFFER_SIZE], hi_buffer[SPLICE_SINK_BUFFER_SIZE];
+  struct bswriter lo_writer, hi_writer;
+  struct bsreader reader, tree_reader;
+  struct splice_view root, view;
+  struct splice_skipped skipped[VTENC_TREE_LEVELS];
+  size_t skipped_len = 0;
+  struct splice_ctx ctx;
+  const uint64_t base = handler->params.base;
+  size_t rank = 0;
+  int rc;
+
+  bsreader_init(&reader, in, in_len);
+  bswriter_init(&lo_writer, lo_buffer, sizeof(lo_buffer));
+  bswriter_init(&hi_writer, hi_buffer, sizeof(hi_buffer));
+  lo_writer.sink = lo;
+  hi_writer.sink = hi;
+
+  return_if_error(splice_read_header(handler, &reader, values_len, max_width, &root));
+
+  /* The tree is read up to three times: to count the lower values, and for each half */
+  tree_reader = reader;
+  splice_ctx_init(&ctx, handler, handler, &lo_writer);
+
+  if (value > base)
+    return_if_error(splice_rank(&ctx, root, value - base, &rank, skipped, &skipped_len));
+
+  /* Those clusters are copied to the lower half or skipped again for the upper one */
+  ctx.skipped = skipped;
+  ctx.skipped_len = skipped_len;
+
+  if (rank > 0) {
+    reader = tree_reader;
+    return_if_error(splice_emit_lower(handler, &ctx, root, rank, max_width));
+  }
+
+  if (rank < values_len) {
+    reader = tree_reader;
+    view = root;
+    view.from = rank;
+    ctx.writer = &hi_writer;
+    splice_write_header(handler, &hi_writer, values_len - rank, max_width, root.node.bit_pos);
+    return_if_error(splice_emit(&ctx, &view, 1, root.node.bit_pos));
+  }
+
+  rc = bswriter_finish(&lo_writer);
+  if (rc == VTENC_OK)
+    rc = bswriter_finish(&hi_writer);
+
+  if (rc == VTENC_OK)
+    *lo_len = rank;
+
+  return rc;
+}
+
+static int splice_concat(vtenc *handler, const uint8_t *a, size_t a_in_len,
+  size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len,
+  unsigned int max_width, uint8_t *out, size_t out_cap)
+{
+  struct bsreader a_reader, b_reader;
+  struct splice_view views[2];
+  struct bswriter writer;
+  struct splice_ctx ctx;
+  unsigned int width;
+  int rc;
+
+  bsreader_init(&a_reader, a, a_in_len);
+  bsreader_init(&b_reader, b, b_in_len);
+
+  return_if_error(splice_read_header(handler, &a_reader, a_len, max_width, &views[0]));
+  return_if_error(splice_read_header(handler, &b_reader, b_len, max_width, &views[1]));
+
+  return_if_error(bswriter_init(&writer, out, out_cap));
+
+  splice_ctx_init(&ctx, handler, handler, &writer);
+
+  if (a_len > 0 && b_len > 0 && views[0].node.bit_pos > views[1].node.bit_pos)
+    return VTENC_ERR_NOT_SORTED;
+
+  width = b_len > 0 ? views[1].node.bit_pos : views[0].node.bit_pos;
+
+  splice_write_header(handler, &writer, a_len + b_len, max_width, width);
+
+  return_if_error(splice_emit(&ctx, views, 2, width));
+
+  rc = bswriter_finish(&writer);
+  if (rc == VTENC_OK)
+    handler->out_size = bswriter_size(&writer);
+
+  return rc;
+}
+
+/*
+ * Encodes the tree of a stream encoded by `dec` as `enc` does, at the width
+ * that `enc` would use. Levels above the width of the values are either
+ * added or dropped.
+ */
+static int splice_transcode(const vtenc *dec, vtenc *enc, const uint8_t *in,
+  size_t in_len, size_t values_len, unsigned int dec_max_width,
+  unsigned int enc_max_width, uint8_t *out, size_t out_cap)
+{
+  struct bsreader reader;
+  struct splice_view view;
+  struct bswriter writer;
+  struct splice_ctx ctx;
+  unsigned int width;
+  int rc;
+
+  bsreader_init(&reader, in, in_len);
+
+  return_if_error(splice_read_header(dec, &reader, values_len, dec_max_width, &view));
+
+  return_if_error(bswriter_init(&writer, out, out_cap));
+
+  splice_ctx_init(&ctx, dec, enc, &writer);
+
+  width = view.node.bit_pos;
+
+  if (enc->params.detect_width || width > enc_max_width)
+    return_if_error(splice_narrow(&ctx, &view, &width));
+
+  if (width > enc_max_width)
+    return VTENC_ERR_CONFIG;
+
+  if (!enc->params.detect_width)
+    width = enc_max_width;
+
+  splice_write_header(enc, &writer, values_len, enc_max_width, width);
+
+  return_if_error(splice_emit(&ctx, &view, 1, width));
+
+  rc = bswriter_finish(&writer);
+  if (rc == VTENC_OK)
+    enc->out_size = bswriter_size(&writer);
+
+  return rc;
+}
+
+/*
+ * Diffs are made of a header with the number of insertions, the number of
+ * deletions and the size of the encoded insertions, followed by the
+ * insertions, encoded as the values, and the deletions, encoded as the set of
+ * the ranks in the base stream of the values that are deleted. Ranks are
+ * much lower than values, and consecutive deletions make full subtrees.
+ */
+struct splice_edits {
+  const uint64_t  *ins;     /* Values inserted, without the base */
+  size_t          n_ins;
+  const uint64_t  *dels;    /* Ranks deleted */
+  size_t          n_dels;
+  uint64_t        rank;     /* Rank of the first value of the view */
+};
+
+/*
+ * Clusters whose values are all deleted, which are skipped once the clusters
+ * that come before them are encoded. There's one per level at most.
+ */
+struct splice_pending {
+  struct splice_view  views[VTENC_TREE_LEVELS];
+  size_t              len;
+};
+
+/* Where the merged values go: into `values`, written `n_bits` each, or nowhere */
+struct splice_merged {
+  uint64_t      *values;
+  size_t        n_values;
+  unsigned int  n_bits;
+  int           write;
+};
+
+/* Sets up the handler that the ranks of the deletions of a diff are encoded with */
+static void splice_diff_ranks_handler(const vtenc *enc, vtenc *ranks)
+{
+  *ranks = *enc;
+  ranks->params.allow_repeated_values = 0;
+  ranks->params.run_length_encoding = 0;
+  ranks->params.width = 64;
+  ranks->params.detect_width = 1;
+  ranks->params.base = 0;
+  ranks->params.frame_of_reference = 0;
+  ranks->params.strict = 0;
+}
+
+static inline void splice_diff_write_number(struct bswriter *writer, uint64_t value)
+{
+  const unsigned int width = bits_len_u64(value);
+
+  bswriter_write(writer, width, SPLICE_DIFF_WIDTH_BITS);
+  splice_write(writer, value, width);
+}
+
+static inline int splice_diff_read_number(struct bsreader *reader, uint64_t *value)
+{
+  uint64_t width;
+
+  return_if_error(bsreader_read_bits(reader, SPLICE_DIFF_WIDTH_BITS, &width));
+
+  if (width > 64) return VTENC_ERR_WRONG_FORMAT;
+
+  return bsreader_read_bits(reader, (unsigned int)width, value);
+}
+
+/* Writes a diff from its encoded insertions and deletions */
+static int splice_diff_write(size_t n_ins, const struct vtenc_buffer *ins,
+  size_t n_dels, const struct vtenc_buffer *dels, uint8_t *out, size_t out_cap,
+  size_t *out_size)
+{
+  uint8_t header[SPLICE_DIFF_HEADER_MAX_SIZE];
+  struct bswriter writer;
+  size_t header_size;
+
+  return_if_error(bswriter_init(&writer, header, sizeof(header)));
+
+  splice_diff_write_number(&writer, n_ins);
+  splice_diff_write_number(&writer, n_dels);
+  splice_diff_write_number(&writer, ins->len);
+
+  return_if_error(bswriter_finish(&writer));
+  header_size = bswriter_size(&writer);
+
+  if (out_cap < header_size || out_cap - header_size < ins->len ||
+      out_cap - header_size - ins->len < dels->len)
+    return VTENC_ERR_BUFFER_TOO_SMALL;
+
+  memcpy(out, header, header_size);
+  if (ins->len > 0)
+    memcpy(out + header_size, ins->data, ins->len);
+  if (dels->len > 0)
+    memcpy(out + header_size + ins->len, dels->data, dels->len);
+
+  *out_size = header_size + ins->len + dels->len;
+
+  return VTENC_OK;
+}
+
+/*
+ * Reads the header of a diff, and returns where its encoded insertions and
+ * deletions start in `ins_pos` and `dels_pos`.
+ */
+static int splice_diff_read(const uint8_t *diff, size_t diff_len, size_t *n_ins,
+  size_t *n_dels, size_t *ins_pos, size_t *dels_pos)
+{
+  struct bsreader reader;
+  uint64_t ins, dels, ins_size;
+
+  bsreader_init(&reader, diff, diff_len);
+
+  return_if_error(splice_diff_read_number(&reader, &ins));
+  return_if_error(splice_diff_read_number(&reader, &dels));
+  return_if_error(splice_diff_read_number(&reader, &ins_size));
+
+  *ins_pos = bsreader_size(&reader);
+
+  if (ins > VTENC_LIST_MAX_VALUES || dels > VTENC_LIST_MAX_VALUES ||
+      ins_size > (uint64_t)(diff_len - *ins_pos))
+    return VTENC_ERR_WRONG_FORMAT;
+
+  *n_ins = (size_t)ins;
+  *n_dels = (size_t)dels;
+  *dels_pos = *ins_pos + (size_t)ins_size;
+
+  return VTENC_OK;
+}
+
+/*
+ * Decodes the ranks deleted by a diff, which must be lower than `base_len`,
+ * into a new array.
+ */
+static int splice_diff_read_dels(const vtenc *enc, const uint8_t *in,
+  size_t in_len, size_t n_dels, size_t base_len, uint64_t **dels)
+{
+  vtenc ranks;
+  int rc;
+  size_t i;
+
+  if (n_dels > base_len)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  *dels = malloc(MAX(n_dels, 1) * sizeof(uint64_t));
+  if (*dels == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  splice_diff_ranks_handler(enc, &ranks);
+
+  rc = vtenc_decode64(&ranks, in, in_len, *dels, n_dels);
+
+  for (i = 0; rc == VTENC_OK && i < n_dels; i++) {
+    if ((*dels)[i] >= base_len || (i > 0 && (*dels)[i - 1] >= (*dels)[i]))
+      rc = VTENC_ERR_WRONG_FORMAT;
+  }
+
+  if (rc != VTENC_OK) {
+    free(*dels);
+    *dels = NULL;
+  }
+
+  return rc;
+}
+
+static int splice_diff_encode_dels(const vtenc *enc, const uint64_t *dels,
+  size_t n_dels, struct vtenc_buffer *out)
+{
+  const struct vtenc_sink sink = {vtenc_buffer_write, out};
+  vtenc ranks;
+
+  splice_diff_ranks_handler(enc, &ranks);
+
+  return vtenc_encode_to_sink64(&ranks, dels, n_dels, &sink);
+}
+
+/* Returns the number of sorted values lower than `value` */
+static inline size_t splice_count_below(const uint64_t *values, size_t length,
+  uint64_t value)
+{
+  size_t lo = 0, hi = length;
+
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+
+    if (values[mid] < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static inline void splice_merge_out(const struct splice_ctx *ctx,
+  struct splice_merged *merged, uint64_t value)
+{
+  if (merged->values != NULL)
+    merged->values[merged->n_values++] = value;
+  else if (merged->write)
+    splice_write(ctx->writer, value, merged->n_bits);
+}
+
+/*
+ * Goes through the values of a view, with `higher_bits` added to them, and
+ * passes them on along with the insertions lower than each one, unless their
+ * rank is deleted. The insertions that are left are passed on by the caller.
+ */
+static int splice_merge(const struct splice_ctx *ctx, struct splice_view *view,
+  uint64_t higher_bits, struct splice_edits *edits, struct splice_merged *merged)
+{
+  struct splice_node *node = &view->node;
+  struct splice_view zeros, ones;
+  size_t i;
+
+  if (view->from == view->to)
+    return VTENC_OK;
+
+  /* Whole subtrees whose values go nowhere are skipped, unless they have to be checked against insertions */
+  if (!merged->write && merged->values == NULL && node->kind == SPLICE_UNREAD &&
+      view->from == 0 && view->to == node->length && edits->n_ins == 0) {
+    const size_t n_dels = splice_count_below(edits->dels, edits->n_dels, edits->rank + node->length);
+
+    edits->dels += n_dels;
+    edits->n_dels -= n_dels;
+    edits->rank += node->length;
+    return splice_skip(ctx, node->reader, node->length, node->bit_pos);
+  }
+
+  if (node->kind == SPLICE_UNREAD)
+    return_if_error(splice_open(ctx, node));
+
+  if (node->kind == SPLICE_LEAF || node->kind == SPLICE_RANGE) {
+    for (i = view->from; i < view->to; i++) {
+      const uint64_t value = higher_bits | splice_value(node, i);
+
+      while (edits->n_ins > 0 && edits->ins[0] < value) {
+        splice_merge_out(ctx, merged, edits->ins[0]);
+        edits->ins++;
+        edits->n_ins--;
+      }
+
+      if (edits->n_dels > 0 && edits->dels[0] == edits->rank) {
+        edits->dels++;
+        edits->n_dels--;
+      } else {
+        if (ctx->is_set && edits->n_ins > 0 && edits->ins[0] == value)
+          return VTENC_ERR_NOT_SORTED;
+
+        splice_merge_out(ctx, merged, value);
+      }
+
+      edits->rank++;
+    }
+
+    return VTENC_OK;
+  }
+
+  return_if_error(splice_view_children(ctx, view, node->bit_pos, &zeros, &ones));
+  return_if_error(splice_merge(ctx, &zeros, higher_bits, edits, merged));
+  return_if_error(splice_drop(ctx, &zeros));
+
+  return splice_merge(ctx, &ones, higher_bits | (1ULL << ones.node.bit_pos), edits, merged);
+}
+
+/* Merges the values of a view with its edits, which must all belong to it */
+static int splice_merge_all(const struct splice_ctx *ctx, struct splice_view *view,
+  uint64_t higher_bits, struct splice_edits edits, struct splice_merged *merged)
+{
+  size_t i;
+
+  return_if_error(splice_merge(ctx, view, higher_bits, &edits, merged));
+
+  for (i = 0; i < edits.n_ins; i++)
+    splice_merge_out(ctx, merged, edits.ins[i]);
+
+  return VTENC_OK;
+}
+
+/* Encodes a short cluster made of the values of a view and its edits by reading them first */
+static noinline int splice_apply_gathered(const struct splice_ctx *ctx,
+  struct splice_view *view, unsigned int bit_pos, uint64_t prefix,
+  struct splice_edits edits)
+{
+  uint64_t values[SPLICE_GATHER_MAX_LEN];
+  struct splice_merged merged = {values, 0, 0, 0};
+
+  return_if_error(splice_merge_all(ctx, view, prefix, edits, &merged));
+
+  splice_emit_values(ctx, values, merged.n_values, bit_pos);
+
+  return VTENC_OK;
+}
+
+/* Splits the edits of a view at level `bit_pos` between the children of its values */
+static inline void splice_split_edits(const struct splice_edits *edits,
+  unsigned int bit_pos, size_t base_zeros, struct splice_edits *zeros,
+  struct splice_edits *ones)
+{
+  const size_t ins_zeros = splice_count_zeros(edits->ins, edits->n_ins, bit_pos);
+  const size_t dels_zeros = splice_count_below(edits->dels, edits->n_dels,
+                                               edits->rank + base_zeros);
+
+  *zeros = (struct splice_edits){edits->ins, ins_zeros, edits->dels, dels_zeros, edits->rank};
+  *ones = (struct splice_edits){edits->ins + ins_zeros, edits->n_ins - ins_zeros,
+                                edits->dels + dels_zeros, edits->n_dels - dels_zeros,
+                                edits->rank + base_zeros};
+}
+
+/* Number of values of a cluster made of a view and its edits */
+static inline size_t splice_edited_len(const struct splice_view *view,
+  const struct splice_edits *edits)
+{
+  return view->to - view->from - edits->n_dels + edits->n_ins;
+}
+
+/*
+ * Encodes the cluster at level `bit_pos` made of the values of a view and its
+ * edits, whose higher bits are `prefix`, as splice_emit() does. Clusters with
+ * no edits are left to splice_emit(), which copies most of them.
+ */
+static int splice_emit_edited(const struct splice_ctx *ctx, struct splice_view view,
+  unsigned int bit_pos, uint64_t prefix, struct splice_edits edits,
+  struct splice_pending *pending)
+{
+  struct splice_view zeros, ones;
+  struct splice_edits zeros_edits, ones_edits;
+  struct splice_merged merged = {NULL, 0, bit_pos, 0};
+  const size_t pending_len = pending->len;
+  size_t length, n_zeros = 0;
+  unsigned int split_pos = bit_pos;
+  uint64_t common_bits = 0;
+  int rc;
+
+  if (edits.n_dels > view.to - view.from)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  if (edits.n_ins == 0 && edits.n_dels == 0)
+    return splice_emit(ctx, &view, 1, bit_pos);
+
+  length = splice_edited_len(&view, &edits);
+
+  if (length == 0 || bit_pos == 0) {
+    return_if_error(splice_merge_all(ctx, &view, prefix, edits, &merged));
+    return length > 1 && ctx->is_set ? VTENC_ERR_NOT_SORTED : VTENC_OK;
+  }
+
+  if ((ctx->out.skip_full_subtrees && is_full_subtree(length, bit_pos)) ||
+      length <= ctx->out.min_cluster_length[bit_pos]) {
+    merged.write = !(ctx->out.skip_full_subtrees && is_full_subtree(length, bit_pos));
+    return splice_merge_all(ctx, &view, prefix, edits, &merged);
+  }
+
+  if (view.to - view.from + edits.n_ins <= SPLICE_APPLY_GATHER_MAX_LEN)
+    return splice_apply_gathered(ctx, &view, bit_pos, prefix, edits);
+
+  /* The values of a child may all be deleted, and then it's skipped, after its sibling if it's the ones one */
+  for (;;) {
+    return_if_error(splice_view_children(ctx, &view, split_pos, &zeros, &ones));
+    splice_split_edits(&edits, split_pos, zeros.to - zeros.from, &zeros_edits, &ones_edits);
+    n_zeros = splice_edited_len(&zeros, &zeros_edits);
+
+    if (!ctx->out.path_compression || length < VTENC_PATH_MIN_CLUSTER_LENGTH ||
+        (n_zeros != 0 && n_zeros != length))
+      break;
+
+    common_bits = (common_bits << 1) | (n_zeros == 0);
+
+    if (n_zeros == 0) {
+      return_if_error(splice_stream(ctx, &zeros, 0, 0, 0));
+      prefix |= 1ULL << (split_pos - 1);
+      view = ones;
+      edits = ones_edits;
+    } else {
+      pending->views[pending->len++] = ones;
+      view = zeros;
+      edits = zeros_edits;
+    }
+
+    if (--split_pos == 0)
+      break;
+  }
+
+  if (split_pos < bit_pos) {
+    const unsigned int n_common = bit_pos - split_pos;
+
+    bswriter_write(ctx->writer, (common_bits >> (n_common - 1)) & 1 ? 0 : length,
+                   bits_len_u64(length));
+    bswriter_write_gamma(ctx->writer, n_common);
+    splice_write(ctx->writer, common_bits, n_common - 1);
+  }
+
+  if (split_pos == 0) {
+    merged.write = 0;
+    rc = splice_merge_all(ctx, &view, prefix, edits, &merged);
+    if (rc == VTENC_OK && ctx->is_set)
+      rc = VTENC_ERR_NOT_SORTED;
+  } else {
+    bswriter_write(ctx->writer, n_zeros, bits_len_u64(length));
+
+    rc = splice_emit_edited(ctx, zeros, split_pos - 1, prefix, zeros_edits, pending);
+    if (rc == VTENC_OK)
+      rc = splice_drop(ctx, &zeros);
+    if (rc == VTENC_OK)
+      rc = splice_emit_edited(ctx, ones, split_pos - 1, prefix | (1ULL << (split_pos - 1)),
+                              ones_edits, pending);
+  }
+
+  while (rc == VTENC_OK && pending->len > pending_len)
+    rc = splice_stream(ctx, &pending->views[--pending->len], 0, 0, 0);
+
+  return rc;
+}
+
+/*
+ * Encodes the values of a stream with the insertions and deletions of a diff
+ * applied to them. Insertions mustn't have the base.
+ */
+static int splice_apply(vtenc *enc, const uint8_t *base, size_t base_in_len,
+  size_t base_len, const uint64_t *ins, size_t n_ins, const uint64_t *dels,
+  size_t n_dels, unsigned int max_width, uint8_t *out, size_t out_cap)
+{
+  struct splice_pending pending;
+  struct splice_edits edits = {ins, n_ins, dels, n_dels, 0};
+  struct splice_edits zeros_edits, ones_edits;
+  struct splice_view view, zeros, ones;
+  const unsigned int ins_width = n_ins > 0 ? bits_len_u64(ins[n_ins - 1]) : 0;
+  const int detect_width = enc->params.detect_width;
+  const size_t new_len = base_len - n_dels + n_ins;
+  struct bsreader reader;
+  struct bswriter writer;
+  struct splice_ctx ctx;
+  unsigned int width;
+  int rc;
+
+  bsreader_init(&reader, base, base_in_len);
+
+  return_if_error(splice_read_header(enc, &reader, base_len, max_width, &view));
+
+  return_if_error(bswriter_init(&writer, out, out_cap));
+
+  splice_ctx_init(&ctx, enc, enc, &writer);
+  pending.len = 0;
+
+  /* Levels above the highest value that is left are dropped, along with the deleted values under them */
+  for (width = view.node.bit_pos; width > ins_width && (detect_width || width > max_width); width--) {
+    return_if_error(splice_view_children(&ctx, &view, width, &zeros, &ones));
+    splice_split_edits(&edits, width, zeros.to - zeros.from, &zeros_edits, &ones_edits);
+
+    if (splice_edited_len(&ones, &ones_edits) > 0) {
+      if (!detect_width)
+        return VTENC_ERR_CONFIG;
+      break;
+    }
+
+    pending.views[pending.len++] = ones;
+    view = zeros;
+    edits = zeros_edits;
+  }
+
+  width = detect_width ? MAX(width, ins_width) : max_width;
+
+  if (width > max_width)
+    return VTENC_ERR_CONFIG;
+
+  splice_write_header(enc, &writer, new_len, max_width, width);
+
+  rc = splice_emit_edited(&ctx, view, width, 0, edits, &pending);
+
+  while (rc == VTENC_OK && pending.len > 0)
+    rc = splice_stream(&ctx, &pending.views[--pending.len], 0, 0, 0);
+
+  if (rc == VTENC_OK)
+    rc = bswriter_finish(&writer);
+
+  if (rc == VTENC_OK)
+    enc->out_size = bswriter_size(&writer);
+
+  return rc;
+}
+
+#define LIST_MAX_VALUES VTENC_LIST_MAX_VALUES
+
+#define TYPE uint8_t
+#define BITWIDTH 8
+#define SET_MAX_VALUES VTENC_SET_MAX_VALUES8
+#include "splice_generic.h"
+#undef TYPE
+#undef BITWIDTH
+#undef SET_MAX_VALUES
+
+#define TYPE uint16_t
+#define BITWIDTH 16
+#define SET_MAX_VALUES VTENC_SET_MAX_VALUES16
+#include "splice_generic.h"
+#undef TYPE
+#undef BITWIDTH
+#undef SET_MAX_VALUES
+
+#define TYPE uint32_t
+#define BITWIDTH 32
+#define SET_MAX_VALUES VTENC_SET_MAX_VALUES32
+#include "splice_generic.h"
+#undef TYPE
+#undef BITWIDTH
+#undef SET_MAX_VALUES
+
+#define TYPE uint64_t
+#define BITWIDTH 64
+#define SET_MAX_VALUES VTENC_SET_MAX_VALUES64
+#include "splice_generic.h"
+#undef TYPE
+#undef BITWIDTH
+#undef SET_MAX_VALUES
+
+#undef LIST_MAX_VALUES
@@ -0,0 +1,413 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "internals.h"
+
+#define vtenc_encode_(_width_) BITWIDTH_SUFFIX(vtenc_encode, _width_)
+#define vtenc_encode vtenc_encode_(BITWIDTH)
+#define vtenc_encode_to_sink_(_width_) BITWIDTH_SUFFIX(vtenc_encode_to_sink, _width_)
+#define vtenc_encode_to_sink vtenc_encode_to_sink_(BITWIDTH)
+#define vtenc_decode_(_width_) BITWIDTH_SUFFIX(vtenc_decode, _width_)
+#define vtenc_decode vtenc_decode_(BITWIDTH)
+#define split_values_(_width_) BITWIDTH_SUFFIX(split_values, _width_)
+#define split_values split_values_(BITWIDTH)
+#define concat_values_(_width_) BITWIDTH_SUFFIX(concat_values, _width_)
+#define concat_values concat_values_(BITWIDTH)
+#define vtenc_split_(_width_) BITWIDTH_SUFFIX(vtenc_split, _width_)
+#define vtenc_split vtenc_split_(BITWIDTH)
+#define vtenc_concat_(_width_) BITWIDTH_SUFFIX(vtenc_concat, _width_)
+#define vtenc_concat vtenc_concat_(BITWIDTH)
+#define transcode_values_(_width_) BITWIDTH_SUFFIX(transcode_values, _width_)
+#define transcode_values transcode_values_(BITWIDTH)
+#define vtenc_transcode_(_width_) BITWIDTH_SUFFIX(vtenc_transcode, _width_)
+#define vtenc_transcode vtenc_transcode_(BITWIDTH)
+#define diff_read_ins_(_width_) BITWIDTH_SUFFIX(diff_read_ins, _width_)
+#define diff_read_ins diff_read_ins_(BITWIDTH)
+#define diff_apply_values_(_width_) BITWIDTH_SUFFIX(diff_apply_values, _width_)
+#define diff_apply_values diff_apply_values_(BITWIDTH)
+#define diff_apply_tree_(_width_) BITWIDTH_SUFFIX(diff_apply_tree, _width_)
+#define diff_apply_tree diff_apply_tree_(BITWIDTH)
+#define vtenc_diff_encode_(_width_) BITWIDTH_SUFFIX(vtenc_diff_encode, _width_)
+#define vtenc_diff_encode vtenc_diff_encode_(BITWIDTH)
+#define vtenc_diff_apply_(_width_) BITWIDTH_SUFFIX(vtenc_diff_apply, _width_)
+#define vtenc_diff_apply vtenc_diff_apply_(BITWIDTH)
+
+/*
+ * Splits a stream whose clusters can't be spliced by decoding it and encoding
+ * both halves again.
+ */
+static int split_values(vtenc *handler, const uint8_t *in, size_t in_len,
+  size_t values_len, TYPE value, const struct vtenc_sink *lo,
+  const struct vtenc_sink *hi, size_t *lo_len)
+{
+  TYPE *values = malloc(MAX(values_len, 1) * sizeof(TYPE));
+  size_t lo_pos = 0, hi_pos = values_len;
+  int rc;
+
+  if (values == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = vtenc_decode(handler, in, in_len, values, values_len);
+
+  while (lo_pos < hi_pos) {
+    const size_t mid = lo_pos + (hi_pos - lo_pos) / 2;
+
+    if (values[mid] < value)
+      lo_pos = mid + 1;
+    else
+      hi_pos = mid;
+  }
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode_to_sink(handler, values, lo_pos, lo);
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode_to_sink(handler, values + lo_pos, values_len - lo_pos, hi);
+
+  if (rc == VTENC_OK)
+    *lo_len = lo_pos;
+
+  free(values);
+
+  return rc;
+}
+
+/*
+ * Concatenates two streams whose clusters can't be spliced by decoding them
+ * next to each other and encoding the result again.
+ */
+static int concat_values(vtenc *handler, const uint8_t *a, size_t a_in_len,
+  size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len,
+  uint8_t *out, size_t out_cap)
+{
+  TYPE *values = malloc(MAX(a_len + b_len, 1) * sizeof(TYPE));
+  int rc;
+
+  if (values == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = vtenc_decode(handler, a, a_in_len, values, a_len);
+
+  if (rc == VTENC_OK)
+    rc = vtenc_decode(handler, b, b_in_len, values + a_len, b_len);
+
+  if (rc == VTENC_OK && a_len > 0 && b_len > 0 &&
+      (values[a_len - 1] > values[a_len] ||
+       (!handler->params.allow_repeated_values && values[a_len - 1] == values[a_len])))
+    rc = VTENC_ERR_NOT_SORTED;
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode(handler, values, a_len + b_len, out, out_cap);
+
+  free(values);
+
+  return rc;
+}
+
+/*
+ * Transcodes a stream whose clusters can't be spliced by decoding it and
+ * encoding it again.
+ */
+static int transcode_values(vtenc *dec, vtenc *enc, const uint8_t *in,
+  size_t in_len, size_t values_len, uint8_t *out, size_t out_cap)
+{
+  TYPE *values = malloc(MAX(values_len, 1) * sizeof(TYPE));
+  int rc;
+
+  if (values == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = vtenc_decode(dec, in, in_len, values, values_len);
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode(enc, values, values_len, out, out_cap);
+
+  free(values);
+
+  return rc;
+}
+
+int vtenc_split(vtenc *handler, const uint8_t *in, size_t in_len,
+  size_t values_len, TYPE value, const struct vtenc_sink *lo,
+  const struct vtenc_sink *hi, size_t *lo_len)
+{
+  uint64_t max_values = handler->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+
+  if ((uint64_t)values_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  if (handler->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
+  if (!splice_is_supported(handler))
+    return split_values(handler, in, in_len, values_len, value, lo, hi, lo_len);
+
+  return splice_split(handler, in, in_len, values_len, value,
+                      MIN(handler->params.width, BITWIDTH), lo, hi, lo_len);
+}
+
+int vtenc_concat(vtenc *handler, const uint8_t *a, size_t a_in_len,
+  size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len,
+  uint8_t *out, size_t out_cap)
+{
+  uint64_t max_values = handler->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+
+  handler->out_size = 0;
+
+  if ((uint64_t)a_len > max_values || (uint64_t)b_len > max_values - a_len)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  if (handler->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
+  if (!splice_is_supported(handler))
+    return concat_values(handler, a, a_in_len, a_len, b, b_in_len, b_len, out, out_cap);
+
+  return splice_concat(handler, a, a_in_len, a_len, b, b_in_len, b_len,
+                       MIN(handler->params.width, BITWIDTH), out, out_cap);
+}
+
+int vtenc_transcode(vtenc *dec, vtenc *enc, const uint8_t *in, size_t in_len,
+  size_t values_len, uint8_t *out, size_t out_cap)
+{
+  uint64_t max_values = dec->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+
+  enc->out_size = 0;
+
+  if ((uint64_t)values_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  if (dec->params.base > (TYPE)~(TYPE)0 || enc->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
+  /* Sets are transcoded to lists and back by decoding them, as are values with another base */
+  if (!splice_is_supported(dec) || !splice_is_supported(enc) ||
+      dec->params.allow_repeated_values != enc->params.allow_repeated_values ||
+      dec->params.base != enc->params.base)
+    return transcode_values(dec, enc, in, in_len, values_len, out, out_cap);
+
+  return splice_transcode(dec, enc, in, in_len, values_len, MIN(dec->params.width, BITWIDTH),
+                          MIN(enc->params.width, BITWIDTH), out, out_cap);
+}
+
+int vtenc_diff_encode(vtenc *enc, const uint8_t *base, size_t base_in_len,
+  size_t base_len, const TYPE *values, size_t values_len, uint8_t *out,
+  size_t out_cap)
+{
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  const int is_set = !enc->params.allow_repeated_values;
+  struct vtenc_buffer ins_buf = {NULL, 0, 0}, dels_buf = {NULL, 0, 0};
+  const struct vtenc_sink ins_sink = {vtenc_buffer_write, &ins_buf};
+  TYPE *base_values, *ins;
+  uint64_t *dels;
+  size_t n_ins = 0, n_dels = 0, i = 0, j = 0, out_size = 0;
+  int rc = VTENC_OK;
+
+  enc->out_size = 0;
+
+  if ((uint64_t)base_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  if ((uint64_t)values_len > max_values)
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  for (j = 1; j < values_len; j++) {
+    if (values[j - 1] > values[j] || (is_set && values[j - 1] == values[j]))
+      return VTENC_ERR_NOT_SORTED;
+  }
+
+  base_values = malloc(MAX(base_len, 1) * sizeof(TYPE));
+  ins = malloc(MAX(values_len, 1) * sizeof(TYPE));
+  dels = malloc(MAX(base_len, 1) * sizeof(uint64_t));
+
+  if (base_values == NULL || ins == NULL || dels == NULL)
+    rc = VTENC_ERR_NO_MEMORY;
+
+  if (rc == VTENC_OK)
+    rc = vtenc_decode(enc, base, base_in_len, base_values, base_len);
+
+  /* Values are matched in order, so repeated values of lists are matched once each */
+  for (i = 0, j = 0; rc == VTENC_OK && (i < base_len || j < values_len);) {
+    if (j == values_len || (i < base_len && base_values[i] < values[j])) {
+      dels[n_dels++] = i++;
+    } else if (i == base_len || values[j] < base_values[i]) {
+      ins[n_ins++] = values[j++];
+    } else {
+      i++;
+      j++;
+    }
+  }
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode_to_sink(enc, ins, n_ins, &ins_sink);
+
+  if (rc == VTENC_OK)
+    rc = splice_diff_encode_dels(enc, dels, n_dels, &dels_buf);
+
+  if (rc == VTENC_OK)
+    rc = splice_diff_write(n_ins, &ins_buf, n_dels, &dels_buf, out, out_cap, &out_size);
+
+  enc->out_size = rc == VTENC_OK ? out_size : 0;
+
+  free(ins_buf.data);
+  free(dels_buf.data);
+  free(base_values);
+  free(ins);
+  free(dels);
+
+  return rc;
+}
+
+/* Decodes the insertions of a diff into a new array, and checks their order */
+static int diff_read_ins(vtenc *enc, const uint8_t *in, size_t in_len,
+  size_t n_ins, TYPE **ins)
+{
+  int rc;
+
+  *ins = malloc(MAX(n_ins, 1) * sizeof(TYPE));
+  if (*ins == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  rc = vtenc_decode(enc, in, in_len, *ins, n_ins);
+
+  for (size_t i = 1; rc == VTENC_OK && i < n_ins; i++) {
+    if ((*ins)[i - 1] > (*ins)[i] ||
+        (!enc->params.allow_repeated_values && (*ins)[i - 1] == (*ins)[i]))
+      rc = VTENC_ERR_WRONG_FORMAT;
+  }
+
+  if (rc != VTENC_OK) {
+    free(*ins);
+    *ins = NULL;
+  }
+
+  return rc;
+}
+
+/*
+ * Applies a diff to a stream whose clusters can't be spliced by decoding it,
+ * merging it with the insertions and encoding the result again.
+ */
+static int diff_apply_values(vtenc *enc, const uint8_t *base, size_t base_in_len,
+  size_t base_len, const TYPE *ins, size_t n_ins, const uint64_t *dels,
+  size_t n_dels, uint8_t *out, size_t out_cap)
+{
+  const int is_set = !enc->params.allow_repeated_values;
+  const size_t new_len = base_len - n_dels + n_ins;
+  TYPE *base_values = malloc(MAX(base_len, 1) * sizeof(TYPE));
+  TYPE *values = malloc(MAX(new_len, 1) * sizeof(TYPE));
+  size_t len = 0, i, j = 0, d = 0;
+  int rc = VTENC_OK;
+
+  if (base_values == NULL || values == NULL)
+    rc = VTENC_ERR_NO_MEMORY;
+
+  if (rc == VTENC_OK)
+    rc = vtenc_decode(enc, base, base_in_len, base_values, base_len);
+
+  for (i = 0; rc == VTENC_OK && i < base_len; i++) {
+    if (d < n_dels && dels[d] == i) {
+      d++;
+      continue;
+    }
+
+    while (j < n_ins && ins[j] < base_values[i])
+      values[len++] = ins[j++];
+
+    if (is_set && j < n_ins && ins[j] == base_values[i])
+      rc = VTENC_ERR_NOT_SORTED;
+
+    values[len++] = base_values[i];
+  }
+
+  while (rc == VTENC_OK && j < n_ins)
+    values[len++] = ins[j++];
+
+  if (rc == VTENC_OK)
+    rc = vtenc_encode(enc, values, new_len, out, out_cap);
+
+  free(base_values);
+  free(values);
+
+  return rc;
+}
+
+/* Applies a diff to a stream on its bit cluster tree */
+static int diff_apply_tree(vtenc *enc, const uint8_t *base, size_t base_in_len,
+  size_t base_len, const TYPE *ins, size_t n_ins, const uint64_t *dels,
+  size_t n_dels, uint8_t *out, size_t out_cap)
+{
+  uint64_t *offsets = malloc(MAX(n_ins, 1) * sizeof(uint64_t));
+  int rc;
+
+  if (offsets == NULL)
+    return VTENC_ERR_NO_MEMORY;
+
+  for (size_t i = 0; i < n_ins; i++) {
+    if (ins[i] < enc->params.base) {
+      free(offsets);
+      return VTENC_ERR_WRONG_FORMAT;
+    }
+    offsets[i] = ins[i] - enc->params.base;
+  }
+
+  rc = splice_apply(enc, base, base_in_len, base_len, offsets, n_ins, dels, n_dels,
+                    MIN(enc->params.width, BITWIDTH), out, out_cap);
+
+  free(offsets);
+
+  return rc;
+}
+
+int vtenc_diff_apply(vtenc *enc, const uint8_t *base, size_t base_in_len,
+  size_t base_len, const uint8_t *diff, size_t diff_len, uint8_t *out,
+  size_t out_cap, size_t *out_len)
+{
+  uint64_t max_values = enc->params.allow_repeated_values ? LIST_MAX_VALUES : SET_MAX_VALUES;
+  size_t n_ins, n_dels, ins_pos, dels_pos;
+  uint64_t *dels = NULL;
+  TYPE *ins = NULL;
+  int rc;
+
+  enc->out_size = 0;
+
+  if ((uint64_t)base_len > max_values)
+    return VTENC_ERR_OUTPUT_TOO_BIG;
+
+  if (enc->params.base > (TYPE)~(TYPE)0)
+    return VTENC_ERR_CONFIG;
+
+  return_if_error(splice_diff_read(diff, diff_len, &n_ins, &n_dels, &ins_pos, &dels_pos));
+
+  if (n_dels > base_len)
+    return VTENC_ERR_WRONG_FORMAT;
+
+  if ((uint64_t)n_ins > max_values - (base_len - n_dels))
+    return VTENC_ERR_INPUT_TOO_BIG;
+
+  rc = diff_read_ins(enc, diff + ins_pos, dels_pos - ins_pos, n_ins, &ins);
+
+  if (rc == VTENC_OK)
+    rc = splice_diff_read_dels(enc, diff + dels_pos, diff_len - dels_pos, n_dels, base_len, &dels);
+
+  if (rc == VTENC_OK) {
+    if (splice_is_supported(enc))
+      rc = diff_apply_tree(enc, base, base_in_len, base_len, ins, n_ins, dels, n_dels, out, out_cap);
+    else
+      rc = diff_apply_values(enc, base, base_in_len, base_len, ins, n_ins, dels, n_dels, out, out_cap);
+  }
+
+  if (rc == VTENC_OK)
+    *out_len = base_len - n_dels + n_ins;
+
+  free(ins);
+  free(dels);
+
+  return rc;
+}
@@ -20,6 +20,7 @@ static size_t type_size64() { return sizeof(uint64_t); }
 static const struct EncDecFuncs enc_dec_8_funcs = {
   .type_size        = type_size8,
   .max_encoded_size = vtenc_max_encoded_size8,
+  .encoded_size_exact = (encoded_size_exact_func_t)vtenc_encoded_size_exact8,
   .encode           = (encode_func_t)vtenc_encode8,
   .decode           = (decode_func_t)vtenc_decode8
 };
@@ -27,6 +28,7 @@ static const struct EncDecFuncs enc_dec_8_funcs = {
 static const struct EncDecFuncs enc_dec_16_funcs = {
   .type_size        = type_size16,
   .max_encoded_size = vtenc_max_encoded_size16,
+  .encoded_size_exact = (encoded_size_exact_func_t)vtenc_encoded_size_exact16,
   .encode           = (encode_func_t)vtenc_encode16,
   .decode           = (decode_func_t)vtenc_decode16
 };
@@ -34,6 +36,7 @@ static const struct EncDecFuncs enc_dec_16_funcs = {
 static const struct EncDecFuncs enc_dec_32_funcs = {
   .type_size        = type_size32,
   .max_encoded_size = vtenc_max_encoded_size32,
+  .encoded_size_exact = (encoded_size_exact_func_t)vtenc_encoded_size_exact32,
   .encode           = (encode_func_t)vtenc_encode32,
   .decode           = (decode_func_t)vtenc_decode32
 };
@@ -41,6 +44,7 @@ static const struct EncDecFuncs enc_dec_32_funcs = {
 static const struct EncDecFuncs enc_dec_64_funcs = {
   .type_size        = type_size64,
   .max_encoded_size = vtenc_max_encoded_size64,
+  .encoded_size_exact = (encoded_size_exact_func_t)vtenc_encoded_size_exact64,
   .encode           = (encode_func_t)vtenc_encode64,
   .decode           = (decode_func_t)vtenc_decode64
 };
@@ -60,6 +64,12 @@ void encdec_init(struct EncDec *encdec, const struct EncDecFuncs *funcs)
   encdec->allow_repeated_values = 1;
   encdec->skip_full_subtrees    = 1;
   encdec->min_cluster_length    = 1;
+  encdec->run_length_encoding   = 0;
+  encdec->optimal_leaves        = 0;
+  encdec->split_penalty         = 0;
+  encdec->detect_width          = 0;
+  encdec->path_compression      = 0;
+  encdec->frame_of_reference    = 0;
   encdec->funcs                 = funcs;
   encdecctx_init(&(encdec->ctx));
 }
@@ -98,12 +108,29 @@ int encdec_encode(struct EncDec *encdec, const void *in, size_t in_len)
   vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, encdec->allow_repeated_values);
   vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, encdec->skip_full_subtrees);
   vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, encdec->min_cluster_length);
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, encdec->run_length_encoding);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, encdec->optimal_leaves);
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, encdec->split_penalty);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, encdec->detect_width);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, encdec->path_compression);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, encdec->frame_of_reference);
 
   encdec->ctx.in = in;
   encdec->ctx.in_len = in_len;
 
   enc_out_cap = encdec->funcs->max_encoded_size(in_len);
 
+  /* Lists with runs get an exact buffer, which checks that size as well */
+  if (encdec->run_length_encoding) {
+    rc = encdec->funcs->encoded_size_exact(encoder, in, in_len);
+    if (rc != VTENC_OK) {
+      fprintf(stderr, "encoded size calculation failed with code: %d\n", rc);
+      res = 0;
+      goto destroy_and_return;
+    }
+    enc_out_cap = vtenc_encoded_size(encoder) + 8;
+  }
+
   encdec->ctx.enc_out = (uint8_t *) malloc(enc_out_cap * sizeof(uint8_t));
   if (encdec->ctx.enc_out == NULL) {
     fprintf(stderr, "allocation error\n");
@@ -145,6 +172,12 @@ int encdec_decode(struct EncDec *encdec)
   vtenc_config(decoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, encdec->allow_repeated_values);
   vtenc_config(decoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, encdec->skip_full_subtrees);
   vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, encdec->min_cluster_length);
+  vtenc_config(decoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, encdec->run_length_encoding);
+  vtenc_config(decoder, VTENC_CONFIG_OPTIMAL_LEAVES, encdec->optimal_leaves);
+  vtenc_config(decoder, VTENC_CONFIG_SPLIT_PENALTY, encdec->split_penalty);
+  vtenc_config(decoder, VTENC_CONFIG_DETECT_WIDTH, encdec->detect_width);
+  vtenc_config(decoder, VTENC_CONFIG_PATH_COMPRESSION, encdec->path_compression);
+  vtenc_config(decoder, VTENC_CONFIG_FRAME_OF_REFERENCE, encdec->frame_of_reference);
 
   encdec->ctx.dec_out_len = encdec->ctx.in_len;
 
@@ -13,12 +13,14 @@
 
 typedef size_t (*type_size_func_t)();
 typedef size_t (*max_encoded_size_func_t)(size_t);
+typedef int (*encoded_size_exact_func_t)(vtenc *, const void *, size_t);
 typedef int (*encode_func_t)(vtenc *, const void *, size_t,  uint8_t *, size_t);
 typedef int (*decode_func_t)(vtenc *, const uint8_t *, size_t,  void *, size_t);
 
 struct EncDecFuncs {
   type_size_func_t type_size;
   max_encoded_size_func_t max_encoded_size;
+  encoded_size_exact_func_t encoded_size_exact;
   encode_func_t encode;
   decode_func_t decode;
 };
@@ -36,6 +38,12 @@ struct EncDec {
   int allow_repeated_values;
   int skip_full_subtrees;
   size_t min_cluster_length;
+  int run_length_encoding;
+  int optimal_leaves;
+  size_t split_penalty;
+  int detect_width;
+  int path_compression;
+  int frame_of_reference;
   struct EncDecCtx ctx;
   const struct EncDecFuncs *funcs;
 };
@@ -0,0 +1,194 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../vtenc.h"
+
+/* Number of different lists encoded and decoded for every length */
+#define N_LISTS 1024
+
+/* Minimum time spent on every length and operation */
+#define MIN_SECONDS 0.2
+
+static const size_t list_lengths[] = {
+  1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256
+};
+
+struct SmallLists {
+  size_t length;
+  uint32_t *values;
+  uint32_t *decoded;
+  uint8_t *encoded;
+  size_t *encoded_sizes;
+  size_t encoded_cap;
+};
+
+/*
+ * Fills every list with random sorted values, gov2-like: gaps grow with the
+ * universe, and short lists have the largest gaps.
+ */
+static void generate_lists(struct SmallLists *lists)
+{
+  const uint32_t max_gap = (uint32_t)(25000000 / lists->length);
+
+  for (size_t i = 0; i < N_LISTS; ++i) {
+    uint32_t *values = lists->values + i * lists->length;
+    uint32_t value = (uint32_t)rand() % max_gap;
+
+    for (size_t j = 0; j < lists->length; ++j) {
+      values[j] = value;
+      value += 1 + (uint32_t)rand() % max_gap;
+    }
+  }
+}
+
+static int small_lists_init(struct SmallLists *lists, size_t length)
+{
+  lists->length = length;
+  lists->encoded_cap = vtenc_max_encoded_size32(length);
+  lists->values = malloc(N_LISTS * length * sizeof(uint32_t));
+  lists->decoded = malloc(N_LISTS * length * sizeof(uint32_t));
+  lists->encoded = malloc(N_LISTS * lists->encoded_cap);
+  lists->encoded_sizes = malloc(N_LISTS * sizeof(size_t));
+
+  if (lists->values == NULL || lists->decoded == NULL ||
+      lists->encoded == NULL || lists->encoded_sizes == NULL) {
+    fprintf(stderr, "allocation error\n");
+    return 0;
+  }
+
+  generate_lists(lists);
+
+  return 1;
+}
+
+static void small_lists_free(struct SmallLists *lists)
+{
+  free(lists->values);
+  free(lists->decoded);
+  free(lists->encoded);
+  free(lists->encoded_sizes);
+}
+
+static int encode_lists(vtenc *handler, struct SmallLists *lists)
+{
+  for (size_t i = 0; i < N_LISTS; ++i) {
+    int rc = vtenc_encode32(handler, lists->values + i * lists->length, lists->length,
+                            lists->encoded + i * lists->encoded_cap, lists->encoded_cap);
+    if (rc != VTENC_OK) {
+      fprintf(stderr, "encode failed with code: %d\n", rc);
+      return 0;
+    }
+
+    lists->encoded_sizes[i] = vtenc_encoded_size(handler);
+  }
+
+  return 1;
+}
+
+static int decode_lists(vtenc *handler, struct SmallLists *lists)
+{
+  for (size_t i = 0; i < N_LISTS; ++i) {
+    int rc = vtenc_decode32(handler, lists->encoded + i * lists->encoded_cap,
+                            lists->encoded_sizes[i], lists->decoded + i * lists->length,
+                            lists->length);
+    if (rc != VTENC_OK) {
+      fprintf(stderr, "decode failed with code: %d\n", rc);
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+ * Returns the time per list in nanoseconds, or a negative number on failure.
+ * Lists are processed in rounds of N_LISTS, and the fastest round is taken,
+ * which filters out most of the noise.
+ */
+static double time_lists(vtenc *handler, struct SmallLists *lists,
+  int (*func)(vtenc *, struct SmallLists *))
+{
+  clock_t start = clock(), best = 0;
+
+  do {
+    clock_t round_start = clock(), elapsed;
+
+    if (!func(handler, lists))
+      return -1.0;
+
+    elapsed = clock() - round_start;
+    if (best == 0 || elapsed < best)
+      best = elapsed;
+  } while (clock() - start < MIN_SECONDS * CLOCKS_PER_SEC);
+
+  return (double)best * 1e9 / CLOCKS_PER_SEC / N_LISTS;
+}
+
+static int run_length(vtenc *handler, size_t length)
+{
+  struct SmallLists lists;
+  double enc_ns, dec_ns;
+  size_t encoded_size = 0;
+  int res = 1;
+
+  if (!small_lists_init(&lists, length)) {
+    small_lists_free(&lists);
+    return 0;
+  }
+
+  enc_ns = time_lists(handler, &lists, encode_lists);
+  dec_ns = time_lists(handler, &lists, decode_lists);
+
+  if (enc_ns < 0.0 || dec_ns < 0.0 ||
+      memcmp(lists.values, lists.decoded, N_LISTS * length * sizeof(uint32_t)) != 0) {
+    fprintf(stderr, "encoding and decoding failed for length %lu\n", length);
+    res = 0;
+  } else {
+    for (size_t i = 0; i < N_LISTS; ++i)
+      encoded_size += lists.encoded_sizes[i];
+
+    printf("%8lu %12.1f %12.1f %12.2f\n", length, enc_ns, dec_ns,
+      (double)encoded_size * 8.0 / (double)(N_LISTS * length));
+  }
+
+  small_lists_free(&lists);
+
+  return res;
+}
+
+int main(void)
+{
+  int exit_code = EXIT_SUCCESS;
+  vtenc *handler = vtenc_create();
+
+  if (handler == NULL) {
+    fprintf(stderr, "failed to create the handler\n");
+    return EXIT_FAILURE;
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+
+  srand(1);
+
+  printf("%8s %12s %12s %12s\n", "length", "enc ns/list", "dec ns/list", "bits/value");
+
+  for (size_t i = 0; i < sizeof(list_lengths) / sizeof(list_lengths[0]); ++i) {
+    if (!run_length(handler, list_lengths[i])) {
+      exit_code = EXIT_FAILURE;
+      break;
+    }
+  }
+
+  vtenc_destroy(handler);
+
+  return exit_code;
+}
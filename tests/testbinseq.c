@@ -19,6 +19,12 @@ struct seq_attr
 struct cli_opt {
   int show_help;
   size_t min_cluster_length;
+  int run_length_encoding;
+  int optimal_leaves;
+  size_t split_penalty;
+  int detect_width;
+  int path_compression;
+  int frame_of_reference;
   const char *filename;
 };
 
@@ -26,6 +32,12 @@ static void init_cli_opt(struct cli_opt *opt)
 {
   opt->show_help = 0;
   opt->min_cluster_length = 0;
+  opt->run_length_encoding = 0;
+  opt->optimal_leaves = 0;
+  opt->split_penalty = 0;
+  opt->detect_width = 0;
+  opt->path_compression = 0;
+  opt->frame_of_reference = 0;
   opt->filename = NULL;
 }
 
@@ -35,6 +47,17 @@ static void parse_cli_opt(int argc, char **argv, struct cli_opt *opt) {
       opt->show_help = 1;
     } else if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc)) {
       opt->min_cluster_length = (size_t)(atoll(argv[++i]));
+    } else if (strcmp(argv[i], "-r") == 0) {
+      opt->run_length_encoding = 1;
+    } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+      opt->optimal_leaves = 1;
+      opt->split_penalty = (size_t)(atoll(argv[++i]));
+    } else if (strcmp(argv[i], "-w") == 0) {
+      opt->detect_width = 1;
+    } else if (strcmp(argv[i], "-p") == 0) {
+      opt->path_compression = 1;
+    } else if (strcmp(argv[i], "-f") == 0) {
+      opt->frame_of_reference = 1;
     } else if(argv[i][0] == '-') {
       fprintf(stderr, "Unrecognized option: '%s'\n", argv[i]);
     } else {
@@ -62,6 +85,11 @@ static void usage(const char *program)
 "\n"
 "  -h              Output this help and exit\n"
 "  -m <length>     Specify min_cluster_length encoding option\n"
+"  -r              Enable run_length_encoding encoding option\n"
+"  -o <penalty>    Enable optimal_leaves with the given split_penalty\n"
+"  -w              Enable detect_width encoding option\n"
+"  -p              Enable path_compression encoding option\n"
+"  -f              Enable frame_of_reference encoding option\n"
 "\n",
   program);
 }
@@ -320,6 +348,12 @@ static int test_sequence(
       encdec_init8(&encdec);
       encdec.allow_repeated_values = attr->islist;
       encdec.min_cluster_length = opt->min_cluster_length;
+      encdec.run_length_encoding = opt->run_length_encoding;
+      encdec.optimal_leaves = opt->optimal_leaves;
+      encdec.split_penalty = opt->split_penalty;
+      encdec.detect_width = opt->detect_width;
+      encdec.path_compression = opt->path_compression;
+      encdec.frame_of_reference = opt->frame_of_reference;
 
       return test_seq8(f, attr->size, &encdec);
     }
@@ -327,6 +361,12 @@ static int test_sequence(
       encdec_init16(&encdec);
       encdec.allow_repeated_values = attr->islist;
       encdec.min_cluster_length = opt->min_cluster_length;
+      encdec.run_length_encoding = opt->run_length_encoding;
+      encdec.optimal_leaves = opt->optimal_leaves;
+      encdec.split_penalty = opt->split_penalty;
+      encdec.detect_width = opt->detect_width;
+      encdec.path_compression = opt->path_compression;
+      encdec.frame_of_reference = opt->frame_of_reference;
 
       return test_seq16(f, attr->size, &encdec);
     }
@@ -334,6 +374,12 @@ static int test_sequence(
       encdec_init32(&encdec);
       encdec.allow_repeated_values = attr->islist;
       encdec.min_cluster_length = opt->min_cluster_length;
+      encdec.run_length_encoding = opt->run_length_encoding;
+      encdec.optimal_leaves = opt->optimal_leaves;
+      encdec.split_penalty = opt->split_penalty;
+      encdec.detect_width = opt->detect_width;
+      encdec.path_compression = opt->path_compression;
+      encdec.frame_of_reference = opt->frame_of_reference;
 
       return test_seq32(f, attr->size, &encdec);
     }
@@ -341,6 +387,12 @@ static int test_sequence(
       encdec_init64(&encdec);
       encdec.allow_repeated_values = attr->islist;
       encdec.min_cluster_length = opt->min_cluster_length;
+      encdec.run_length_encoding = opt->run_length_encoding;
+      encdec.optimal_leaves = opt->optimal_leaves;
+      encdec.split_penalty = opt->split_penalty;
+      encdec.detect_width = opt->detect_width;
+      encdec.path_compression = opt->path_compression;
+      encdec.frame_of_reference = opt->frame_of_reference;
 
       return test_seq64(f, attr->size, &encdec);
     }
@@ -3,20 +3,23 @@
 ROOTDIR="$(dirname $0)"
 FILES=`ls $ROOTDIR/data/rand.*.bin`
 MIN_CLUSTER_LENGTHS="1 2 4 8 16 32 64 128 256"
+OPTION_SETS=("" "-r" "-o 0" "-o 8" "-r -o 4" "-w" "-w -r -o 4" "-p" "-p -o 0" "-p -r -o 4 -w" "-f -w" "-f -w -p -r")
 
 for file in $FILES; do
-  echo -n "$file -m"
+  for opts in "${OPTION_SETS[@]}"; do
+    echo -n "$file${opts:+ $opts} -m"
 
-  for m in $MIN_CLUSTER_LENGTHS; do
-    echo -n " $m"
+    for m in $MIN_CLUSTER_LENGTHS; do
+      echo -n " $m"
 
-    $ROOTDIR/testbinseq -m $m $file
+      $ROOTDIR/testbinseq $opts -m $m $file
 
-    if [ "$?" -ne "0" ]; then
-      echo " - KO"
-      exit 1
-    fi
-  done
+      if [ "$?" -ne "0" ]; then
+        echo " - KO"
+        exit 1
+      fi
+    done
 
-  echo " - OK"
+    echo " - OK"
+  done
 done
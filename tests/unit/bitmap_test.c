@@ -0,0 +1,63 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <stdint.h>
+
+#include "unit_tests.h"
+#include "../../bitmap.h"
+
+int test_bitmap_count(void)
+{
+  const uint64_t words[] = {0xff000000000000f0ULL, 0x0ULL, 0x8000000000000001ULL};
+
+  EXPECT_TRUE(bitmap_count(words, 0, 0) == 0);
+  EXPECT_TRUE(bitmap_count(words, 0, 192) == 14);
+  EXPECT_TRUE(bitmap_count(words, 4, 8) == 4);
+  EXPECT_TRUE(bitmap_count(words, 5, 60) == 7);
+  EXPECT_TRUE(bitmap_count(words, 60, 129) == 5);
+  EXPECT_TRUE(bitmap_count(words, 64, 128) == 0);
+  EXPECT_TRUE(bitmap_count(words, 129, 191) == 0);
+  EXPECT_TRUE(bitmap_count(words, 191, 192) == 1);
+
+  return 1;
+}
+
+int test_bitmap_next_and_prev(void)
+{
+  const uint64_t words[] = {0xff000000000000f0ULL, 0x0ULL, 0x8000000000000001ULL};
+
+  EXPECT_TRUE(bitmap_next(words, 0, 192) == 4);
+  EXPECT_TRUE(bitmap_next(words, 8, 192) == 56);
+  EXPECT_TRUE(bitmap_next(words, 64, 192) == 128);
+  EXPECT_TRUE(bitmap_next(words, 64, 128) == 128);
+  EXPECT_TRUE(bitmap_next(words, 129, 191) == 191);
+  EXPECT_TRUE(bitmap_next(words, 8, 8) == 8);
+
+  EXPECT_TRUE(bitmap_prev(words, 0, 192) == 191);
+  EXPECT_TRUE(bitmap_prev(words, 0, 191) == 128);
+  EXPECT_TRUE(bitmap_prev(words, 0, 128) == 63);
+  EXPECT_TRUE(bitmap_prev(words, 0, 56) == 7);
+  EXPECT_TRUE(bitmap_prev(words, 8, 56) == 56);
+  EXPECT_TRUE(bitmap_prev(words, 64, 128) == 128);
+
+  return 1;
+}
+
+int test_bitmap_set_range(void)
+{
+  uint64_t words[4] = {0};
+
+  bitmap_set_range(words, 4, 8);
+  EXPECT_TRUE(words[0] == 0xf0ULL && words[1] == 0 && words[2] == 0 && words[3] == 0);
+
+  bitmap_set_range(words, 62, 194);
+  EXPECT_TRUE(words[0] == 0xc0000000000000f0ULL);
+  EXPECT_TRUE(words[1] == ~0ULL && words[2] == ~0ULL && words[3] == 0x3ULL);
+
+  bitmap_set(words, 255);
+  EXPECT_TRUE(words[3] == 0x8000000000000003ULL);
+
+  return 1;
+}
@@ -112,3 +112,24 @@ int test_bits_len_u64(void)
 
   return 1;
 }
+
+int test_bits_count_u64(void)
+{
+  EXPECT_TRUE(bits_count_u64(0) == 0);
+  EXPECT_TRUE(bits_count_u64(1) == 1);
+  EXPECT_TRUE(bits_count_u64(0xf0f0ULL) == 8);
+  EXPECT_TRUE(bits_count_u64(0x8000000000000001ULL) == 2);
+  EXPECT_TRUE(bits_count_u64(0xffffffffffffffffULL) == 64);
+
+  return 1;
+}
+
+int test_bits_ctz_u64(void)
+{
+  EXPECT_TRUE(bits_ctz_u64(1) == 0);
+  EXPECT_TRUE(bits_ctz_u64(0xf0f0ULL) == 4);
+  EXPECT_TRUE(bits_ctz_u64(0x8000000000000000ULL) == 63);
+  EXPECT_TRUE(bits_ctz_u64(0xffffffffffffffffULL) == 0);
+
+  return 1;
+}
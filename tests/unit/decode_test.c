@@ -15,6 +15,16 @@ struct EncodingParams {
   int allow_repeated_values;
   int skip_full_subtrees;
   size_t min_cluster_length;
+  const size_t *min_cluster_lengths;
+  size_t min_cluster_lengths_len;
+  int run_length_encoding;
+  int optimal_leaves;
+  size_t split_penalty;
+  unsigned int width;
+  int detect_width;
+  int path_compression;
+  uint64_t base;
+  int frame_of_reference;
 };
 
 struct DecodeTestCaseInput {
@@ -342,6 +352,180 @@ static struct DecodeTestCase test_cases8[] = {
       .values = (uint8_t []){0, 1, 2, 3, 4, 5, 6, 7, 10},
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .bytes = (uint8_t []){0xc7, 0xf2, 0x17, 0x2a, 0x78},
+      .bytes_len = 5,
+      .values_len = 9,
+    },
+    .expected_output = {
+      .values = (uint8_t []){57, 57, 57, 111, 111, 111, 111, 208, 208},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .bytes = (uint8_t []){0xc7, 0xf2, 0x17, 0x2a, 0x78},
+      .bytes_len = 5,
+      .values_len = 8,
+    },
+    .expected_output = {
+      .values = (uint8_t []){},
+      .result_code = VTENC_ERR_WRONG_FORMAT
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .bytes = (uint8_t []){0x11, 0x11, 0x11, 0x05, 0x42, 0x20},
+      .bytes_len = 6,
+      .values_len = 12,
+    },
+    .expected_output = {
+      .values = (uint8_t []){0, 1, 1, 2, 3, 3, 3, 4, 5, 6, 7, 7},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 0
+      },
+      .bytes = (uint8_t []){0x50, 0x99, 0xca, 0x8e, 0x79, 0x95, 0x16, 0x25, 0x0b, 0x0e},
+      .bytes_len = 10,
+      .values_len = 11,
+    },
+    .expected_output = {
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 8
+      },
+      .bytes = (uint8_t []){0x0b, 0x2c, 0x2e, 0x58, 0x7c, 0x8a, 0xda, 0xe2, 0x64, 0x85, 0x9d, 0x01},
+      .bytes_len = 12,
+      .values_len = 11,
+    },
+    .expected_output = {
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 4
+      },
+      .bytes = (uint8_t []){0x52, 0x4a, 0x09, 0x05},
+      .bytes_len = 4,
+      .values_len = 9,
+    },
+    .expected_output = {
+      .values = (uint8_t []){0, 1, 2, 3, 4, 5, 6, 7, 10},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .min_cluster_lengths = (size_t []){1, 1, 1, 1, 1, 4, 4, 1, 1},
+        .min_cluster_lengths_len = 9
+      },
+      .bytes = (uint8_t []){0x58, 0x2b, 0xf6, 0x32, 0x5f, 0xb4, 0x71, 0xb2, 0xe0, 0x00},
+      .bytes_len = 10,
+      .values_len = 11,
+    },
+    .expected_output = {
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .bytes = (uint8_t []){0xc4, 0x81, 0x15, 0x0c, 0xcf, 0x03},
+      .bytes_len = 6,
+      .values_len = 8,
+    },
+    .expected_output = {
+      .values = (uint8_t []){1, 2, 3, 4, 240, 241, 243, 247},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .bytes = (uint8_t []){0xfc, 0xff},
+      .bytes_len = 2,
+      .values_len = 4,
+    },
+    .expected_output = {
+      .values = (uint8_t []){},
+      .result_code = VTENC_ERR_WRONG_FORMAT
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .bytes = (uint8_t []){0x48, 0x92, 0xcc, 0x00},
+      .bytes_len = 4,
+      .values_len = 4,
+    },
+    .expected_output = {
+      .values = (uint8_t []){1, 2, 3, 3},
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -620,6 +804,97 @@ static struct DecodeTestCase test_cases16[] = {
       .values = (uint16_t []){0, 1, 2, 3, 4, 5, 6, 7, 10},
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .min_cluster_lengths = (size_t []){0, 1, 2, 3, 4, 8},
+        .min_cluster_lengths_len = 6
+      },
+      .bytes = (uint8_t []){
+        0xff, 0xff, 0xff, 0xcd, 0x9a, 0x17, 0xc4, 0x28, 0xa8, 0x55, 0x71, 0x33,
+        0x48, 0x3a, 0x4f, 0xcc, 0x76
+      },
+      .bytes_len = 17,
+      .values_len = 15,
+    },
+    .expected_output = {
+      .values = (uint16_t []){1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 377, 610, 987},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 10
+      },
+      .bytes = (uint8_t []){0xaa, 0x7a, 0x9d, 0x45, 0x42, 0xa2, 0x30, 0x08, 0x02},
+      .bytes_len = 9,
+      .values_len = 10,
+    },
+    .expected_output = {
+      .values = (uint16_t []){1, 4, 9, 16, 25, 36, 49, 64, 81, 100},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 10,
+        .detect_width = 1
+      },
+      .bytes = (uint8_t []){0x77, 0x9d, 0x45, 0x42, 0xa2, 0x30, 0x08, 0x02},
+      .bytes_len = 8,
+      .values_len = 10,
+    },
+    .expected_output = {
+      .values = (uint16_t []){1, 4, 9, 16, 25, 36, 49, 64, 81, 100},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .detect_width = 1
+      },
+      .bytes = (uint8_t []){0x1f, 0x00},
+      .bytes_len = 2,
+      .values_len = 2,
+    },
+    .expected_output = {
+      .values = (uint16_t []){},
+      .result_code = VTENC_ERR_WRONG_FORMAT
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 8,
+        .base = 1000
+      },
+      .bytes = (uint8_t []){0xdc, 0xbf, 0xc8, 0x3f},
+      .bytes_len = 4,
+      .values_len = 5,
+    },
+    .expected_output = {
+      .values = (uint16_t []){1000, 1001, 1002, 1100, 1255},
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -920,6 +1195,80 @@ static struct DecodeTestCase test_cases32[] = {
       .values = (uint32_t []){0, 1, 2, 3, 4, 5, 6, 7, 10},
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .bytes = (uint8_t []){0xa5, 0x02, 0x00, 0x00, 0xc0, 0xff, 0xff, 0xff, 0x9f, 0xc8, 0x00},
+      .bytes_len = 11,
+      .values_len = 12,
+    },
+    .expected_output = {
+      .values = (uint32_t []){5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 0xffffffff, 0xffffffff},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 16
+      },
+      .bytes = (uint8_t []){
+        0x03, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00,
+        0x0e, 0x00, 0x00, 0x00, 0x12, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00,
+        0x1a, 0x00, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+        0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00
+      },
+      .bytes_len = 45,
+      .values_len = 11,
+    },
+    .expected_output = {
+      .values = (uint32_t []){1, 3, 5, 7, 9, 11, 13, 15, 0x10000, 0x10001, 0x20000},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .detect_width = 1
+      },
+      .bytes = (uint8_t []){0x51, 0xdb, 0x92, 0xdc, 0xab, 0xf6, 0x24, 0x7a, 0xc4, 0x81, 0x8b, 0x00},
+      .bytes_len = 12,
+      .values_len = 6,
+    },
+    .expected_output = {
+      .values = (uint32_t []){3, 7, 100, 1000, 5000, 70000},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .bytes = (uint8_t []){0xbd, 0x03, 0x00, 0xe4, 0x03, 0xf4, 0x01, 0x5c, 0x04},
+      .bytes_len = 9,
+      .values_len = 5,
+    },
+    .expected_output = {
+      .values = (uint32_t []){1000, 1000, 1000, 1000, 70000},
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -1246,6 +1595,67 @@ static struct DecodeTestCase test_cases64[] = {
       },
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .detect_width = 1
+      },
+      .bytes = (uint8_t []){
+        0x23, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+        0x89, 0x21, 0xff, 0xff, 0xff, 0xff, 0x03
+      },
+      .bytes_len = 19,
+      .values_len = 5,
+    },
+    .expected_output = {
+      .values = (uint64_t []){10, 10, 11, 12, 34359738367},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .bytes = (uint8_t []){
+        0xfd, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x7f, 0xa1, 0x19, 0x68,
+        0x01
+      },
+      .bytes_len = 13,
+      .values_len = 5,
+    },
+    .expected_output = {
+      .values = (uint64_t []){0x7fff000000000010ULL, 0x7fff000000000013ULL, 0x7fff000000000020ULL, 0x7fff000000000031ULL, 0x7fff000000000032ULL},
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .detect_width = 1,
+        .frame_of_reference = 1
+      },
+      .bytes = (uint8_t []){
+        0x00, 0x68, 0xe5, 0xcf, 0x8b, 0x01, 0x00, 0x00, 0x0a, 0x92, 0xfb, 0xd5,
+        0x76, 0xf4
+      },
+      .bytes_len = 14,
+      .values_len = 5,
+    },
+    .expected_output = {
+      .values = (uint64_t []){1700000000000, 1700000000000, 1700000000005, 1700000000123, 1700000001000},
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -1261,6 +1671,19 @@ int vtenc_decode8_test_case(struct DecodeTestCase *test_case)
   vtenc_config(decoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(decoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(decoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(decoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(decoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(decoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(decoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(decoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(decoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(decoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_decode8(
     decoder,
@@ -1292,6 +1715,19 @@ int vtenc_decode16_test_case(struct DecodeTestCase *test_case)
   vtenc_config(decoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(decoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(decoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(decoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(decoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(decoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(decoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(decoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(decoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(decoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_decode16(
     decoder,
@@ -1323,6 +1759,19 @@ int vtenc_decode32_test_case(struct DecodeTestCase *test_case)
   vtenc_config(decoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(decoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(decoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(decoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(decoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(decoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(decoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(decoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(decoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(decoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_decode32(
     decoder,
@@ -1354,6 +1803,19 @@ int vtenc_decode64_test_case(struct DecodeTestCase *test_case)
   vtenc_config(decoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(decoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(decoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(decoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(decoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(decoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(decoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(decoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(decoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(decoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(decoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_decode64(
     decoder,
@@ -1428,3 +1890,394 @@ int test_vtenc_decode64(void)
 
   return 1;
 }
+
+int test_vtenc_decode_strided(void)
+{
+  struct record { uint16_t key; uint16_t pad[4]; } records[200];
+  uint16_t keys[200];
+  uint8_t in[512];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 200; ++i) {
+    keys[i] = (uint16_t)(i * 7 + (i >> 4) * 100);
+    memset(&records[i], 0xAB, sizeof(records[i]));
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
+  EXPECT_TRUE(vtenc_encode16(handler, keys, 200, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_decode_strided16(handler, in, in_len, records, 200,
+    sizeof(struct record), offsetof(struct record, key)) == VTENC_OK);
+
+  for (i = 0; i < 200; ++i) {
+    EXPECT_TRUE(records[i].key == keys[i]);
+    EXPECT_TRUE(records[i].pad[0] == 0xABAB && records[i].pad[3] == 0xABAB);
+  }
+
+  EXPECT_TRUE(vtenc_decode_strided16(handler, in, in_len, records, 200,
+    sizeof(struct record), sizeof(struct record) - 1) == VTENC_ERR_CONFIG);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_decode_to_bitmap(void)
+{
+  uint64_t expected[8] = {0}, bitmap[8] = {0};
+  uint16_t values[512];
+  uint8_t in[512];
+  size_t n = 0, in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 512; ++i) {
+    if ((i >= 64 && i < 320) || i % 5 == 0) {
+      expected[i >> 6] |= 1ULL << (i & 63);
+      values[n++] = (uint16_t)i;
+    }
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode16(handler, values, n, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_decode_to_bitmap16(handler, in, in_len, n, bitmap, 512) == VTENC_OK);
+  EXPECT_TRUE(memcmp(bitmap, expected, sizeof(bitmap)) == 0);
+
+  EXPECT_TRUE(vtenc_decode_to_bitmap16(handler, in, in_len, n, bitmap, 500) == VTENC_ERR_BUFFER_TOO_SMALL);
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  values[n] = values[n - 1];
+  EXPECT_TRUE(vtenc_encode16(handler, values, n + 1, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  memset(bitmap, 0, sizeof(bitmap));
+  EXPECT_TRUE(vtenc_decode_to_bitmap16(handler, in, in_len, n + 1, bitmap, 512) == VTENC_OK);
+  EXPECT_TRUE(memcmp(bitmap, expected, sizeof(bitmap)) == 0);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_decode_converted(void)
+{
+  uint32_t values[1000];
+  uint64_t wide[1000];
+  uint16_t narrow[1001];
+  uint8_t in[4096];
+  const uint64_t offset = 1ULL << 40;
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 1000; ++i) {
+    values[i] = (uint32_t)(4000000000U + i * 3 + (i >> 5) * 50);
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  vtenc_config(handler, VTENC_CONFIG_FRAME_OF_REFERENCE, 1);
+
+  /* Short and long lists take different paths */
+  for (size_t len = 10; len <= 1000; len += 990) {
+    EXPECT_TRUE(vtenc_encode32(handler, values, len, in, sizeof(in)) == VTENC_OK);
+    in_len = vtenc_encoded_size(handler);
+
+    EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, wide, len, 64, offset) == VTENC_OK);
+    for (i = 0; i < len; ++i) {
+      EXPECT_TRUE(wide[i] == values[i] + offset);
+    }
+
+    narrow[len] = 0xABCD;
+    EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, narrow, len, 16, 7) == VTENC_OK);
+    for (i = 0; i < len; ++i) {
+      EXPECT_TRUE(narrow[i] == (uint16_t)(values[i] + 7));
+    }
+    EXPECT_TRUE(narrow[len] == 0xABCD);
+
+    EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, values + 1, 0, 64, 0) == VTENC_OK);
+    EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, wide, len, 24, 0) == VTENC_ERR_CONFIG);
+  }
+
+  /* Same width, with the offset wrapping around */
+  EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, values, 1000, 32, 1000000000) == VTENC_OK);
+  for (i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(values[i] == (uint32_t)(705032704U + i * 3 + (i >> 5) * 50));
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  for (i = 0; i < 1000; ++i) {
+    values[i] = (uint32_t)(i / 3);
+  }
+  EXPECT_TRUE(vtenc_encode32(handler, values, 1000, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_decode_converted32(handler, in, in_len, wide, 1000, 64, offset) == VTENC_OK);
+  for (i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(wide[i] == values[i] + offset);
+  }
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_decode_prefix(void)
+{
+  uint16_t values[600], out[601];
+  uint8_t in[2048];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 600; ++i) {
+    values[i] = (uint16_t)(i * 13 + (i & 7));
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode16(handler, values, 600, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  out[5] = 0xFFFF;
+  EXPECT_TRUE(vtenc_decode_prefix16(handler, in, in_len, 600, out, 5) == VTENC_OK);
+  EXPECT_TRUE(memcmp(out, values, 5 * sizeof(uint16_t)) == 0);
+  EXPECT_TRUE(out[5] == 0xFFFF);
+
+  out[600] = 0xFFFF;
+  EXPECT_TRUE(vtenc_decode_prefix16(handler, in, in_len, 600, out, 601) == VTENC_OK);
+  EXPECT_TRUE(memcmp(out, values, sizeof(values)) == 0);
+  EXPECT_TRUE(out[600] == 0xFFFF);
+
+  /* Lists with runs: prefixes ending within a run and at its end */
+  for (i = 0; i < 600; ++i) {
+    values[i] = (uint16_t)(i / 4 * 10);
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode16(handler, values, 600, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  for (size_t len = 1; len <= 600; len += 141) {
+    out[len] = 0xFFFF;
+    EXPECT_TRUE(vtenc_decode_prefix16(handler, in, in_len, 600, out, len) == VTENC_OK);
+    EXPECT_TRUE(memcmp(out, values, len * sizeof(uint16_t)) == 0);
+    EXPECT_TRUE(out[len] == 0xFFFF);
+  }
+
+  EXPECT_TRUE(vtenc_decode_prefix16(handler, in, in_len, 600, out, 0) == VTENC_OK);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_min_max(void)
+{
+  const uint32_t values[] = {17, 17, 300, 4000, 4000, 4000, 50000, 600000, 600000};
+  const size_t values_len = sizeof(values) / sizeof(values[0]);
+  uint32_t min, max;
+  uint8_t in[64];
+  size_t in_len;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_min32(handler, in, in_len, values_len, &min) == VTENC_OK);
+  EXPECT_TRUE(min == 17);
+  EXPECT_TRUE(vtenc_max32(handler, in, in_len, values_len, &max) == VTENC_OK);
+  EXPECT_TRUE(max == 600000);
+
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  vtenc_config(handler, VTENC_CONFIG_FRAME_OF_REFERENCE, 1);
+  EXPECT_TRUE(vtenc_encode32(handler, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_min32(handler, in, in_len, values_len, &min) == VTENC_OK);
+  EXPECT_TRUE(min == 17);
+  EXPECT_TRUE(vtenc_max32(handler, in, in_len, values_len, &max) == VTENC_OK);
+  EXPECT_TRUE(max == 600000);
+
+  EXPECT_TRUE(vtenc_min32(handler, in, in_len, 0, &min) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_max32(handler, in, in_len, 0, &max) == VTENC_ERR_CONFIG);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_histogram(void)
+{
+  uint16_t values[1000];
+  size_t counts[16], expected[16] = {0};
+  uint8_t in[4096];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  /* Consecutive values across two buckets, and sparser values */
+  for (i = 0; i < 1000; ++i) {
+    values[i] = (uint16_t)(i < 800 ? 0x0F00 + i : 0x5000 + i * 37);
+    expected[values[i] >> 12]++;
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  vtenc_config(handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
+  vtenc_config(handler, VTENC_CONFIG_MIN_CLUSTER_LENGTH, 8);
+  EXPECT_TRUE(vtenc_encode16(handler, values, 1000, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_histogram16(handler, in, in_len, 1000, 4, counts) == VTENC_OK);
+  EXPECT_TRUE(memcmp(counts, expected, sizeof(counts)) == 0);
+
+  EXPECT_TRUE(vtenc_histogram16(handler, in, in_len, 1000, 0, counts) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_histogram16(handler, in, in_len, 1000, 17, counts) == VTENC_ERR_CONFIG);
+
+  /* With runs, every repetition counts */
+  for (i = 0; i < 1000; ++i) {
+    values[i] = (uint16_t)(i / 10 * 600);
+  }
+  memset(expected, 0, sizeof(expected));
+  for (i = 0; i < 1000; ++i) {
+    expected[values[i] >> 12]++;
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode16(handler, values, 1000, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_histogram16(handler, in, in_len, 1000, 4, counts) == VTENC_OK);
+  EXPECT_TRUE(memcmp(counts, expected, sizeof(counts)) == 0);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_quantile(void)
+{
+  uint32_t values[101], value;
+  uint8_t in[1024];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 101; ++i) {
+    values[i] = (uint32_t)(i * i);
+  }
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, 101, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 0.5, &value) == VTENC_OK);
+  EXPECT_TRUE(value == 2500);
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 0.99, &value) == VTENC_OK);
+  EXPECT_TRUE(value == 9801);
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 1.0, &value) == VTENC_OK);
+  EXPECT_TRUE(value == 10000);
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 1.5, &value) == VTENC_ERR_CONFIG);
+
+  for (i = 0; i < 101; ++i) {
+    values[i] = (uint32_t)(i < 90 ? 7 : i);
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode32(handler, values, 101, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 0.5, &value) == VTENC_OK);
+  EXPECT_TRUE(value == 7);
+  EXPECT_TRUE(vtenc_quantile32(handler, in, in_len, 101, 0.95, &value) == VTENC_OK);
+  EXPECT_TRUE(value == 95);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_contains_batch(void)
+{
+  uint32_t values[100];
+  const uint32_t probes[] = {0, 3, 3, 4, 297, 298, 5000};
+  const uint32_t unsorted[] = {6, 3};
+  uint8_t in[1024];
+  uint64_t found[1];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 100; ++i) {
+    values[i] = (uint32_t)(i * 3);
+  }
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, 100, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_contains_batch32(handler, in, in_len, 100, probes, 7, found) == VTENC_OK);
+  EXPECT_TRUE(found[0] == 0x17);
+  EXPECT_TRUE(vtenc_contains_batch32(handler, in, in_len, 100, probes + 6, 1, found) == VTENC_OK);
+  EXPECT_TRUE(found[0] == 0);
+  EXPECT_TRUE(vtenc_contains_batch32(handler, in, in_len, 100, unsorted, 2, found) == VTENC_ERR_NOT_SORTED);
+
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode32(handler, values, 100, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_contains_batch32(handler, in, in_len, 100, probes, 7, found) == VTENC_OK);
+  EXPECT_TRUE(found[0] == 0x17);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+int test_vtenc_sample(void)
+{
+  uint32_t values[200], sample[200], other[200];
+  uint8_t in[1024];
+  size_t in_len, i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 200; ++i) {
+    values[i] = (uint32_t)(i * 5);
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode32(handler, values, 200, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_sample32(handler, in, in_len, 200, 20, 1, sample) == VTENC_OK);
+  for (i = 0; i < 20; ++i) {
+    EXPECT_TRUE(sample[i] / 5 * 5 == sample[i] && sample[i] < 1000);
+    EXPECT_TRUE(i == 0 || sample[i - 1] < sample[i]);
+  }
+
+  EXPECT_TRUE(vtenc_sample32(handler, in, in_len, 200, 20, 1, other) == VTENC_OK);
+  EXPECT_TRUE(memcmp(sample, other, 20 * sizeof(uint32_t)) == 0);
+
+  EXPECT_TRUE(vtenc_sample32(handler, in, in_len, 200, 200, 2, sample) == VTENC_OK);
+  EXPECT_TRUE(memcmp(sample, values, sizeof(values)) == 0);
+
+  EXPECT_TRUE(vtenc_sample32(handler, in, in_len, 200, 201, 1, sample) == VTENC_ERR_CONFIG);
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode32(handler, values, 200, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_sample32(handler, in, in_len, 200, 20, 1, sample) == VTENC_ERR_CONFIG);
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
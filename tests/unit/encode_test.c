@@ -4,8 +4,10 @@
   See LICENSE file in the project root for full license information.
  */
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "unit_tests.h"
 #include "../../vtenc.h"
@@ -14,6 +16,16 @@ struct EncodingParams {
   int allow_repeated_values;
   int skip_full_subtrees;
   size_t min_cluster_length;
+  const size_t *min_cluster_lengths;
+  size_t min_cluster_lengths_len;
+  int run_length_encoding;
+  int optimal_leaves;
+  size_t split_penalty;
+  unsigned int width;
+  int detect_width;
+  int path_compression;
+  uint64_t base;
+  int frame_of_reference;
 };
 
 struct EncodeTestCaseInput {
@@ -309,6 +321,146 @@ static struct EncodeTestCase test_cases8[] = {
       .bytes_len = 3,
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .values = (uint8_t []){57, 57, 57, 111, 111, 111, 111, 208, 208},
+      .values_len = 9
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xc7, 0xf2, 0x17, 0x2a, 0x78},
+      .bytes_len = 5,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .values = (uint8_t []){0, 1, 1, 2, 3, 3, 3, 4, 5, 6, 7, 7},
+      .values_len = 12
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x11, 0x11, 0x11, 0x05, 0x42, 0x20},
+      .bytes_len = 6,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 0
+      },
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .values_len = 11
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x50, 0x99, 0xca, 0x8e, 0x79, 0x95, 0x16, 0x25, 0x0b, 0x0e},
+      .bytes_len = 10,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 8
+      },
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .values_len = 11
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x0b, 0x2c, 0x2e, 0x58, 0x7c, 0x8a, 0xda, 0xe2, 0x64, 0x85, 0x9d, 0x01},
+      .bytes_len = 12,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 4
+      },
+      .values = (uint8_t []){0, 1, 2, 3, 4, 5, 6, 7, 10},
+      .values_len = 9
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x52, 0x4a, 0x09, 0x05},
+      .bytes_len = 4,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .min_cluster_lengths = (size_t []){1, 1, 1, 1, 1, 4, 4, 1, 1},
+        .min_cluster_lengths_len = 9
+      },
+      .values = (uint8_t []){5, 22, 23, 44, 62, 69, 109, 113, 178, 194, 206},
+      .values_len = 11
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x58, 0x2b, 0xf6, 0x32, 0x5f, 0xb4, 0x71, 0xb2, 0xe0, 0x00},
+      .bytes_len = 10,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .values = (uint8_t []){1, 2, 3, 4, 240, 241, 243, 247},
+      .values_len = 8
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xc4, 0x81, 0x15, 0x0c, 0xcf, 0x03},
+      .bytes_len = 6,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .values = (uint8_t []){1, 2, 3, 3},
+      .values_len = 4
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x48, 0x92, 0xcc, 0x00},
+      .bytes_len = 4,
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -555,6 +707,115 @@ static struct EncodeTestCase test_cases16[] = {
       .bytes_len = 7,
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .min_cluster_lengths = (size_t []){0, 1, 2, 3, 4, 8},
+        .min_cluster_lengths_len = 6
+      },
+      .values = (uint16_t []){1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 377, 610, 987},
+      .values_len = 15
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){
+        0xff, 0xff, 0xff, 0xcd, 0x9a, 0x17, 0xc4, 0x28, 0xa8, 0x55, 0x71, 0x33,
+        0x48, 0x3a, 0x4f, 0xcc, 0x76
+      },
+      .bytes_len = 17,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 10
+      },
+      .values = (uint16_t []){1, 4, 9, 16, 25, 36, 49, 64, 81, 100},
+      .values_len = 10
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xaa, 0x7a, 0x9d, 0x45, 0x42, 0xa2, 0x30, 0x08, 0x02},
+      .bytes_len = 9,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 10,
+        .detect_width = 1
+      },
+      .values = (uint16_t []){1, 4, 9, 16, 25, 36, 49, 64, 81, 100},
+      .values_len = 10
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x77, 0x9d, 0x45, 0x42, 0xa2, 0x30, 0x08, 0x02},
+      .bytes_len = 8,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 10
+      },
+      .values = (uint16_t []){1, 4, 9, 1024},
+      .values_len = 4
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){},
+      .bytes_len = 0,
+      .result_code = VTENC_ERR_CONFIG
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 8,
+        .base = 1000
+      },
+      .values = (uint16_t []){1000, 1001, 1002, 1100, 1255},
+      .values_len = 5
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xdc, 0xbf, 0xc8, 0x3f},
+      .bytes_len = 4,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 8,
+        .base = 1000
+      },
+      .values = (uint16_t []){999, 1001},
+      .values_len = 2
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){},
+      .bytes_len = 0,
+      .result_code = VTENC_ERR_CONFIG
+    }
   }
 };
 
@@ -823,6 +1084,80 @@ static struct EncodeTestCase test_cases32[] = {
       .bytes_len = 15,
       .result_code = VTENC_OK
     }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .run_length_encoding = 1
+      },
+      .values = (uint32_t []){5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 0xffffffff, 0xffffffff},
+      .values_len = 12
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xa5, 0x02, 0x00, 0x00, 0xc0, 0xff, 0xff, 0xff, 0x9f, 0xc8, 0x00},
+      .bytes_len = 11,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .optimal_leaves = 1,
+        .split_penalty = 16
+      },
+      .values = (uint32_t []){1, 3, 5, 7, 9, 11, 13, 15, 0x10000, 0x10001, 0x20000},
+      .values_len = 11
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){
+        0x03, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00,
+        0x0e, 0x00, 0x00, 0x00, 0x12, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00,
+        0x1a, 0x00, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+        0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00
+      },
+      .bytes_len = 45,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .detect_width = 1
+      },
+      .values = (uint32_t []){3, 7, 100, 1000, 5000, 70000},
+      .values_len = 6
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0x51, 0xdb, 0x92, 0xdc, 0xab, 0xf6, 0x24, 0x7a, 0xc4, 0x81, 0x8b, 0x00},
+      .bytes_len = 12,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .values = (uint32_t []){1000, 1000, 1000, 1000, 70000},
+      .values_len = 5
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){0xbd, 0x03, 0x00, 0xe4, 0x03, 0xf4, 0x01, 0x5c, 0x04},
+      .bytes_len = 9,
+      .result_code = VTENC_OK
+    }
   }
 };
 
@@ -1101,27 +1436,119 @@ static struct EncodeTestCase test_cases64[] = {
       .bytes_len = 31,
       .result_code = VTENC_OK
     }
-  }
-};
-
-int vtenc_encode8_test_case(struct EncodeTestCase *test_case)
-{
-  struct EncodeTestCaseInput *input = &(test_case->input);
-  struct EncodeTestCaseOutput *expected_output = &(test_case->expected_output);
-  const size_t out_cap = vtenc_max_encoded_size8(input->values_len);
-  uint8_t out[out_cap & 0xffff]; // mask capacity to avoid large allocations on the stack
-  size_t out_len;
-  int rc;
-  vtenc *encoder = vtenc_create();
-  assert(encoder != NULL);
-
-  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
-  vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
-  vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
-
-  rc = vtenc_encode8(
-    encoder,
-    input->values,
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .detect_width = 1
+      },
+      .values = (uint64_t []){10, 10, 11, 12, 34359738367},
+      .values_len = 5
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){
+        0x23, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+        0x89, 0x21, 0xff, 0xff, 0xff, 0xff, 0x03
+      },
+      .bytes_len = 19,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .path_compression = 1
+      },
+      .values = (uint64_t []){0x7fff000000000010ULL, 0x7fff000000000013ULL, 0x7fff000000000020ULL, 0x7fff000000000031ULL, 0x7fff000000000032ULL},
+      .values_len = 5
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){
+        0xfd, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x7f, 0xa1, 0x19, 0x68,
+        0x01
+      },
+      .bytes_len = 13,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 1,
+        .skip_full_subtrees = 0,
+        .min_cluster_length = 1,
+        .detect_width = 1,
+        .frame_of_reference = 1
+      },
+      .values = (uint64_t []){1700000000000, 1700000000000, 1700000000005, 1700000000123, 1700000001000},
+      .values_len = 5
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){
+        0x00, 0x68, 0xe5, 0xcf, 0x8b, 0x01, 0x00, 0x00, 0x0a, 0x92, 0xfb, 0xd5,
+        0x76, 0xf4
+      },
+      .bytes_len = 14,
+      .result_code = VTENC_OK
+    }
+  },
+  {
+    .input = {
+      .params = {
+        .allow_repeated_values = 0,
+        .skip_full_subtrees = 1,
+        .min_cluster_length = 1,
+        .width = 16,
+        .frame_of_reference = 1
+      },
+      .values = (uint64_t []){1000000000000, 1000000000003, 1000000000005},
+      .values_len = 3
+    },
+    .expected_output = {
+      .bytes = (uint8_t []){},
+      .bytes_len = 0,
+      .result_code = VTENC_ERR_CONFIG
+    }
+  }
+};
+
+int vtenc_encode8_test_case(struct EncodeTestCase *test_case)
+{
+  struct EncodeTestCaseInput *input = &(test_case->input);
+  struct EncodeTestCaseOutput *expected_output = &(test_case->expected_output);
+  const size_t out_cap = vtenc_max_encoded_size8(input->values_len);
+  uint8_t out[out_cap & 0xffff]; // mask capacity to avoid large allocations on the stack
+  size_t out_len;
+  int rc;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
+  vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
+  vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(encoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(encoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
+
+  rc = vtenc_encode8(
+    encoder,
+    input->values,
     input->values_len,
     out,
     out_cap
@@ -1152,6 +1579,19 @@ int vtenc_encode16_test_case(struct EncodeTestCase *test_case)
   vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(encoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(encoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_encode16(
     encoder,
@@ -1186,6 +1626,19 @@ int vtenc_encode32_test_case(struct EncodeTestCase *test_case)
   vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(encoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(encoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_encode32(
     encoder,
@@ -1220,6 +1673,19 @@ int vtenc_encode64_test_case(struct EncodeTestCase *test_case)
   vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, input->params.allow_repeated_values);
   vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, input->params.skip_full_subtrees);
   vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, input->params.min_cluster_length);
+  if (input->params.min_cluster_lengths != NULL) {
+    vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS,
+      input->params.min_cluster_lengths, input->params.min_cluster_lengths_len);
+  }
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, input->params.run_length_encoding);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, input->params.optimal_leaves);
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, input->params.split_penalty);
+  if (input->params.width != 0)
+    vtenc_config(encoder, VTENC_CONFIG_WIDTH, input->params.width);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, input->params.detect_width);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, input->params.path_compression);
+  vtenc_config(encoder, VTENC_CONFIG_BASE, input->params.base);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, input->params.frame_of_reference);
 
   rc = vtenc_encode64(
     encoder,
@@ -1351,3 +1817,1112 @@ int test_vtenc_max_encoded_size64(void)
 
   return 1;
 }
+
+int test_vtenc_max_encoded_size_range(void)
+{
+  uint32_t values[1000];
+  uint8_t out[2048];
+  size_t bound, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 1000; ++i)
+    values[i] = (uint32_t)(1000 + i);
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, 0);
+  EXPECT_TRUE(vtenc_max_encoded_size_range32(encoder, 0, 1000, 1999) == 8);
+
+  /* 21 levels above the bits that differ, and 11 bits per value below them */
+  bound = vtenc_max_encoded_size_range32(encoder, 1000, 1000, 1999);
+  EXPECT_TRUE(bound == 1410);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 1000, out, bound) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) + 8 <= bound);
+
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  bound = vtenc_max_encoded_size_range32(encoder, 1000, 1000, 1999);
+  EXPECT_TRUE(bound == 1390);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 1000, out, bound) == VTENC_OK);
+
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, 1);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, 1);
+  bound = vtenc_max_encoded_size_range32(encoder, 1000, 1000, 1999);
+  EXPECT_TRUE(bound == 1263);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 1000, out, bound) == VTENC_OK);
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  for (i = 0; i < 1000; ++i)
+    values[i] = (uint32_t)(1000 + i - i % 3);
+  bound = vtenc_max_encoded_size_range32(encoder, 1000, 1000, 1999);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 1000, out, bound) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) + 8 <= bound);
+
+  EXPECT_TRUE(vtenc_max_encoded_size_range32(encoder, 1000, 1999, 1000) == vtenc_max_encoded_size32(1000));
+
+  /* A single run among distinct values doesn't pay for the run lengths */
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, 0);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, 0);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 0);
+  vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, (size_t)256);
+  for (i = 0; i < 136; ++i)
+    values[i] = (uint32_t)((i < 9 ? 0 : i - 8) << 20);
+  bound = vtenc_max_encoded_size32(136);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 136, out, bound) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) + 8 <= bound);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_encoded_size_exact(void)
+{
+  uint16_t values[600];
+  uint8_t out[2048];
+  size_t i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 600; ++i)
+    values[i] = (uint16_t)(i * i / 7);
+
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values, 0) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == 0);
+
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 600, out, sizeof(out)) == VTENC_OK);
+  i = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values, 600) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == i);
+
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, 1);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 600, out, sizeof(out)) == VTENC_OK);
+  i = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values, 600) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == i);
+
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 0);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, 1);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, 1);
+  EXPECT_TRUE(vtenc_encode16(encoder, values + 100, 500, out, sizeof(out)) == VTENC_OK);
+  i = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values + 100, 500) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == i);
+
+  vtenc_config(encoder, VTENC_CONFIG_WIDTH, 15);
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values, 600) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_WIDTH, 16);
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  vtenc_config(encoder, VTENC_CONFIG_STRICT, 1);
+  EXPECT_TRUE(vtenc_encoded_size_exact16(encoder, values, 600) == VTENC_ERR_NOT_SORTED);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_suggest_min_cluster_lengths(void)
+{
+  uint8_t sample[256];
+  size_t lengths[9];
+  size_t i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 256; ++i) sample[i] = (uint8_t)i;
+
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, (size_t)0);
+  EXPECT_TRUE(vtenc_suggest_min_cluster_lengths8(encoder, sample, 256, lengths) == VTENC_OK);
+  for (i = 0; i < 9; ++i) EXPECT_TRUE(lengths[i] == 1);
+
+  vtenc_config(encoder, VTENC_CONFIG_SPLIT_PENALTY, (size_t)64);
+  EXPECT_TRUE(vtenc_suggest_min_cluster_lengths8(encoder, sample, 256, lengths) == VTENC_OK);
+  EXPECT_TRUE(memcmp(lengths, (size_t []){1, 2, 4, 8, 16, 32, 64, 1, 1}, sizeof(lengths)) == 0);
+
+  EXPECT_TRUE(vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS, lengths, (size_t)9) == VTENC_OK);
+  EXPECT_TRUE(vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS, lengths, (size_t)0) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTHS, NULL, (size_t)9) == VTENC_ERR_CONFIG);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_encode_strided(void)
+{
+  struct record { uint32_t id; uint32_t key; uint32_t payload; } records[100];
+  uint32_t keys[100];
+  uint8_t dense_out[512], strided_out[512];
+  size_t dense_size, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 100; ++i) {
+    keys[i] = (uint32_t)(i * i / 3);
+    records[i] = (struct record){(uint32_t)i, keys[i], 0xFFFFFFFF};
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, keys, 100, dense_out, sizeof(dense_out)) == VTENC_OK);
+  dense_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_strided32(encoder, records, 100, sizeof(struct record),
+    offsetof(struct record, key), strided_out, sizeof(strided_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == dense_size);
+  EXPECT_TRUE(memcmp(dense_out, strided_out, dense_size) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, keys, 100, dense_out, sizeof(dense_out)) == VTENC_OK);
+  dense_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_strided32(encoder, records, 100, sizeof(struct record),
+    offsetof(struct record, key), strided_out, sizeof(strided_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == dense_size);
+  EXPECT_TRUE(memcmp(dense_out, strided_out, dense_size) == 0);
+
+  EXPECT_TRUE(vtenc_encode_strided32(encoder, records, 100, sizeof(struct record) + 2,
+    0, strided_out, sizeof(strided_out)) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_encode_strided32(encoder, records, 100, sizeof(struct record),
+    2, strided_out, sizeof(strided_out)) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_encode_strided32(encoder, records, 100, sizeof(struct record),
+    sizeof(struct record), strided_out, sizeof(strided_out)) == VTENC_ERR_CONFIG);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_encode_from_bitmap(void)
+{
+  uint64_t bitmap[16] = {0};
+  uint64_t values[1024];
+  uint8_t array_out[1024], bitmap_out[1024];
+  size_t n = 0, array_size, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 1024; ++i) {
+    if ((i >= 100 && i < 300) || (i % 7 == 3) || i == 1023) {
+      bitmap[i >> 6] |= 1ULL << (i & 63);
+      values[n++] = i;
+    }
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode64(encoder, values, n, array_out, sizeof(array_out)) == VTENC_OK);
+  array_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_from_bitmap64(encoder, bitmap, 1024, bitmap_out, sizeof(bitmap_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == array_size);
+  EXPECT_TRUE(memcmp(array_out, bitmap_out, array_size) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  vtenc_config(encoder, VTENC_CONFIG_OPTIMAL_LEAVES, 1);
+  vtenc_config(encoder, VTENC_CONFIG_FRAME_OF_REFERENCE, 1);
+  vtenc_config(encoder, VTENC_CONFIG_DETECT_WIDTH, 1);
+  EXPECT_TRUE(vtenc_encode64(encoder, values, n, array_out, sizeof(array_out)) == VTENC_OK);
+  array_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_from_bitmap64(encoder, bitmap, 1024, bitmap_out, sizeof(bitmap_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == array_size);
+  EXPECT_TRUE(memcmp(array_out, bitmap_out, array_size) == 0);
+
+  EXPECT_TRUE(vtenc_encode_from_bitmap8(encoder, bitmap, 257, bitmap_out, sizeof(bitmap_out)) == VTENC_ERR_INPUT_TOO_BIG);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_encode_strict(void)
+{
+  struct record { uint16_t key; uint16_t payload; } records[1000];
+  uint16_t values[1000];
+  uint8_t out[4096], strict_out[4096];
+  const size_t swaps[] = {0, 254, 255, 256, 511, 998};
+  size_t out_size, i, j;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 1000; ++i) {
+    values[i] = (uint16_t)(i * 3);
+    records[i] = (struct record){values[i], 0};
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+
+  vtenc_config(encoder, VTENC_CONFIG_STRICT, 1);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, strict_out, out_size) == 0);
+  EXPECT_TRUE(vtenc_encode_strided16(encoder, records, 1000, sizeof(struct record),
+    offsetof(struct record, key), strict_out, sizeof(strict_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 0, strict_out, sizeof(strict_out)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1, strict_out, sizeof(strict_out)) == VTENC_OK);
+
+  for (j = 0; j < sizeof(swaps) / sizeof(swaps[0]); ++j) {
+    i = swaps[j];
+    values[i] = values[i + 1] + 1;
+    records[i].key = values[i];
+    EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_ERR_NOT_SORTED);
+    EXPECT_TRUE(vtenc_encoded_size(encoder) == 0);
+    EXPECT_TRUE(vtenc_encode_strided16(encoder, records, 1000, sizeof(struct record),
+      offsetof(struct record, key), strict_out, sizeof(strict_out)) == VTENC_ERR_NOT_SORTED);
+    values[i] = (uint16_t)(i * 3);
+    records[i].key = values[i];
+  }
+
+  /* A repeated value is only allowed in lists */
+  values[600] = values[599];
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_ERR_NOT_SORTED);
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_OK);
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_OK);
+  values[600] = values[599] - 1;
+  EXPECT_TRUE(vtenc_encode16(encoder, values, 1000, strict_out, sizeof(strict_out)) == VTENC_ERR_NOT_SORTED);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_sort_encode(void)
+{
+  uint32_t sorted[500], values[500];
+  uint8_t bytes[600], sorted_bytes[64];
+  uint8_t out[4096], sort_out[4096];
+  size_t out_size, sorted_len, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 500; ++i)
+    sorted[i] = (uint32_t)(3 * i * i + i % 7);
+  for (i = 0; i < 500; ++i)
+    values[i] = sorted[(i * 173) % 500];
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, sorted, 500, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_sort_encode32(encoder, values, 500, sort_out, sizeof(sort_out), &sorted_len) == VTENC_OK);
+  EXPECT_TRUE(sorted_len == 500);
+  EXPECT_TRUE(memcmp(values, sorted, sizeof(sorted)) == 0);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, sort_out, out_size) == 0);
+
+  for (i = 0; i < 500; ++i)
+    values[i] = sorted[(i * 251) % 500];
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, sorted, 500, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_sort_encode32(encoder, values, 500, sort_out, sizeof(sort_out), NULL) == VTENC_OK);
+  EXPECT_TRUE(memcmp(values, sorted, sizeof(sorted)) == 0);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, sort_out, out_size) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_WIDTH, 16);
+  EXPECT_TRUE(vtenc_sort_encode32(encoder, values, 500, sort_out, sizeof(sort_out), NULL) == VTENC_ERR_CONFIG);
+
+  /* Repeated values are removed from a set, so it can be longer than 2^8 */
+  for (i = 0; i < 600; ++i)
+    bytes[i] = (uint8_t)((i * 7) % 40);
+  for (i = 0; i < 40; ++i)
+    sorted_bytes[i] = (uint8_t)i;
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode8(encoder, sorted_bytes, 40, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_sort_encode8(encoder, bytes, 600, sort_out, sizeof(sort_out), &sorted_len) == VTENC_OK);
+  EXPECT_TRUE(sorted_len == 40);
+  EXPECT_TRUE(memcmp(bytes, sorted_bytes, 40) == 0);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, sort_out, out_size) == 0);
+
+  EXPECT_TRUE(vtenc_sort_encode8(encoder, bytes, 3, sort_out, sizeof(sort_out), &sorted_len) == VTENC_OK);
+  EXPECT_TRUE(sorted_len == 3);
+  EXPECT_TRUE(vtenc_sort_encode8(encoder, bytes, 0, sort_out, sizeof(sort_out), &sorted_len) == VTENC_OK);
+  EXPECT_TRUE(sorted_len == 0);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == 0);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+int test_vtenc_encode_merged(void)
+{
+  uint32_t merged[900], a[300], b[300], c[300];
+  const uint32_t *ins[3] = {a, b, c};
+  size_t ins_len[3] = {300, 300, 300};
+  uint8_t out[8192], merged_out[8192];
+  size_t out_size, merged_len, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 900; ++i)
+    merged[i] = (uint32_t)(5 * i + i % 3);
+  for (i = 0; i < 300; ++i) {
+    a[i] = merged[3 * i];
+    b[i] = merged[3 * i + 1];
+    c[i] = merged[3 * i + 2];
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode32(encoder, merged, 900, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 900);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, merged_out, out_size) == 0);
+
+  /* Inputs covering disjoint ranges, in any order */
+  for (i = 0; i < 300; ++i) {
+    c[i] = merged[i];
+    a[i] = merged[300 + i];
+    b[i] = merged[600 + i];
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_PATH_COMPRESSION, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, merged, 900, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 900);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, merged_out, out_size) == 0);
+
+  /* Values in more than one input are encoded once in a set... */
+  for (i = 0; i < 300; ++i) {
+    a[i] = merged[2 * i];
+    b[i] = merged[2 * i + 1];
+    c[i] = merged[i];
+  }
+
+  EXPECT_TRUE(vtenc_encode32(encoder, merged, 600, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 600);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, merged_out, out_size) == 0);
+
+  /* ...and as many times as they appear in a list */
+  for (i = 0; i < 300; ++i) {
+    merged[3 * i] = a[i] = (uint32_t)(11 * i);
+    merged[3 * i + 1] = b[i] = (uint32_t)(11 * i);
+    merged[3 * i + 2] = c[i] = (uint32_t)(11 * i + 4);
+  }
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 1);
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 1);
+  EXPECT_TRUE(vtenc_encode32(encoder, merged, 900, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 900);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, merged_out, out_size) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_RUN_LENGTH_ENCODING, 0);
+  EXPECT_TRUE(vtenc_encode32(encoder, merged, 900, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(memcmp(out, merged_out, out_size) == 0);
+
+  vtenc_config(encoder, VTENC_CONFIG_STRICT, 1);
+  b[7] = 0;
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_ERR_NOT_SORTED);
+
+  ins_len[0] = ins_len[1] = ins_len[2] = 0;
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 3, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 0);
+  EXPECT_TRUE(vtenc_encode_merged32(encoder, ins, ins_len, 0, merged_out, sizeof(merged_out), &merged_len) == VTENC_OK);
+  EXPECT_TRUE(merged_len == 0);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+static int failing_write(void *opaque, const uint8_t *data, size_t data_len)
+{
+  (void)opaque;
+  (void)data;
+  (void)data_len;
+
+  return 1;
+}
+
+int test_vtenc_encode_to_sink(void)
+{
+  uint32_t values[5000];
+  uint8_t out[20100], fd_out[20100];
+  struct vtenc_buffer buffer = {NULL, 0, 0};
+  struct vtenc_sink sink = {vtenc_buffer_write, &buffer};
+  int fds[2];
+  size_t out_size, i;
+  vtenc *encoder = vtenc_create();
+  assert(encoder != NULL);
+
+  for (i = 0; i < 5000; ++i)
+    values[i] = (uint32_t)(i * 797 + i % 13);
+
+  vtenc_config(encoder, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 5000, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(encoder);
+  EXPECT_TRUE(out_size > 4096);
+
+  EXPECT_TRUE(vtenc_encode_to_sink32(encoder, values, 5000, &sink) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == out_size);
+  EXPECT_TRUE(buffer.len == out_size);
+  EXPECT_TRUE(memcmp(buffer.data, out, out_size) == 0);
+
+  buffer.len = 0;
+  EXPECT_TRUE(vtenc_encode_to_sink32(encoder, values, 0, &sink) == VTENC_OK);
+  EXPECT_TRUE(buffer.len == 0);
+  free(buffer.data);
+
+  /* A pipe holds the whole stream, so it can be read back afterwards */
+  EXPECT_TRUE(pipe(fds) == 0);
+  sink.write = vtenc_fd_write;
+  sink.opaque = &fds[1];
+  EXPECT_TRUE(vtenc_encode_to_sink32(encoder, values, 5000, &sink) == VTENC_OK);
+  close(fds[1]);
+  EXPECT_TRUE(read(fds[0], fd_out, sizeof(fd_out)) == (ssize_t)out_size);
+  close(fds[0]);
+  EXPECT_TRUE(memcmp(fd_out, out, out_size) == 0);
+
+  sink.write = failing_write;
+  EXPECT_TRUE(vtenc_encode_to_sink32(encoder, values, 5000, &sink) == VTENC_ERR_SINK);
+  EXPECT_TRUE(vtenc_encode_to_sink32(encoder, values, 10, &sink) == VTENC_ERR_SINK);
+
+  /* Fixed buffers that are too small are not written past their end */
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 5000, out, out_size) == VTENC_ERR_BUFFER_TOO_SMALL);
+  EXPECT_TRUE(vtenc_encoded_size(encoder) == 0);
+  EXPECT_TRUE(vtenc_encode32(encoder, values, 5000, out, out_size + 8) == VTENC_OK);
+
+  vtenc_destroy(encoder);
+
+  return 1;
+}
+
+/* Next number of the xorshift generator of the randomized tests below */
+static uint64_t test_rand(uint64_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+
+  return *state;
+}
+
+/*
+ * Fills @values with @values_len sorted values, from @first on, with gaps of
+ * up to @max_gap between them. Gaps of 0, i.e. repeated values, only come up
+ * if @repeated is set.
+ */
+static void random_sorted32(uint64_t *state, uint32_t *values,
+  size_t values_len, uint32_t first, uint32_t max_gap, int repeated)
+{
+  uint32_t value = first;
+  size_t i;
+
+  for (i = 0; i < values_len; ++i) {
+    values[i] = value;
+    value += (uint32_t)(test_rand(state) % max_gap) + !repeated;
+  }
+}
+
+/* Number of parameter sets of tree_config() */
+#define TREE_CONFIGS 8
+
+/*
+ * Sets up @handler with the @config-th set of parameters that the operations
+ * on bit cluster trees are tested with. The last ones have clusters that
+ * depend on the rest of the tree, alone or mixed, which are decoded and
+ * encoded again instead.
+ */
+static void tree_config(vtenc *handler, int config, int is_set)
+{
+  static const size_t lengths[] = {1, 1, 2, 4, 8, 32};
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, !is_set);
+  vtenc_config(handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, config == 1);
+  vtenc_config(handler, VTENC_CONFIG_MIN_CLUSTER_LENGTH, (size_t)1);
+  if (config == 3)
+    vtenc_config(handler, VTENC_CONFIG_MIN_CLUSTER_LENGTHS, lengths, sizeof(lengths) / sizeof(lengths[0]));
+  vtenc_config(handler, VTENC_CONFIG_RUN_LENGTH_ENCODING, config == 4 || config == 7);
+  vtenc_config(handler, VTENC_CONFIG_OPTIMAL_LEAVES, config == 5 || config == 7);
+  vtenc_config(handler, VTENC_CONFIG_DETECT_WIDTH, config == 2);
+  vtenc_config(handler, VTENC_CONFIG_PATH_COMPRESSION, config == 2 || config == 7);
+  vtenc_config(handler, VTENC_CONFIG_FRAME_OF_REFERENCE, config == 6 || config == 7);
+}
+
+/* Checks that @out, of @out_size bytes, is what vtenc_encode32 gives for @values */
+static int encodes_as32(vtenc *handler, const uint32_t *values,
+  size_t values_len, const uint8_t *out, size_t out_size)
+{
+  static uint8_t expected[32768];
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, values_len, expected, sizeof(expected)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(handler) == out_size);
+  EXPECT_TRUE(out_size == 0 || memcmp(out, expected, out_size) == 0);
+
+  return 1;
+}
+
+static int encodes_as64(vtenc *handler, const uint64_t *values,
+  size_t values_len, const uint8_t *out, size_t out_size)
+{
+  static uint8_t expected[32768];
+
+  EXPECT_TRUE(vtenc_encode64(handler, values, values_len, expected, sizeof(expected)) == VTENC_OK);
+  EXPECT_TRUE(vtenc_encoded_size(handler) == out_size);
+  EXPECT_TRUE(out_size == 0 || memcmp(out, expected, out_size) == 0);
+
+  return 1;
+}
+
+/*
+ * Checks that splitting the stream of @values at @value gives the streams of
+ * the values lower than @value and of the rest.
+ */
+static int split_matches32(vtenc *handler, const uint32_t *values,
+  size_t values_len, uint32_t value)
+{
+  static uint8_t in[32768];
+  struct vtenc_buffer lo = {NULL, 0, 0}, hi = {NULL, 0, 0};
+  struct vtenc_sink lo_sink = {vtenc_buffer_write, &lo};
+  struct vtenc_sink hi_sink = {vtenc_buffer_write, &hi};
+  size_t in_len, lo_len, n = 0;
+  int rc;
+
+  while (n < values_len && values[n] < value)
+    n++;
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  rc = vtenc_split32(handler, in, in_len, values_len, value, &lo_sink, &hi_sink, &lo_len);
+
+  if (rc == VTENC_OK && lo_len == n) {
+    rc = encodes_as32(handler, values, n, lo.data, lo.len) &&
+         encodes_as32(handler, values + n, values_len - n, hi.data, hi.len);
+  } else {
+    rc = 0;
+  }
+
+  free(lo.data);
+  free(hi.data);
+
+  return rc;
+}
+
+static int split_matches64(vtenc *handler, const uint64_t *values,
+  size_t values_len, uint64_t value)
+{
+  static uint8_t in[32768];
+  struct vtenc_buffer lo = {NULL, 0, 0}, hi = {NULL, 0, 0};
+  struct vtenc_sink lo_sink = {vtenc_buffer_write, &lo};
+  struct vtenc_sink hi_sink = {vtenc_buffer_write, &hi};
+  size_t in_len, lo_len, n = 0;
+  int rc;
+
+  while (n < values_len && values[n] < value)
+    n++;
+
+  EXPECT_TRUE(vtenc_encode64(handler, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(handler);
+
+  rc = vtenc_split64(handler, in, in_len, values_len, value, &lo_sink, &hi_sink, &lo_len);
+
+  if (rc == VTENC_OK && lo_len == n) {
+    rc = encodes_as64(handler, values, n, lo.data, lo.len) &&
+         encodes_as64(handler, values + n, values_len - n, hi.data, hi.len);
+  } else {
+    rc = 0;
+  }
+
+  free(lo.data);
+  free(hi.data);
+
+  return rc;
+}
+
+int test_vtenc_split(void)
+{
+  static uint32_t values[3000];
+  uint64_t values64[64];
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  size_t i, round;
+  int config, is_set;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (config = 0; config < TREE_CONFIGS; ++config) {
+    for (is_set = 0; is_set <= 1; ++is_set) {
+      tree_config(handler, config, is_set);
+
+      /* Empty and single value streams */
+      EXPECT_TRUE(split_matches32(handler, values, 0, 0));
+      EXPECT_TRUE(split_matches32(handler, values, 0, 100));
+      values[0] = 1000;
+      EXPECT_TRUE(split_matches32(handler, values, 1, 0));
+      EXPECT_TRUE(split_matches32(handler, values, 1, 1000));
+      EXPECT_TRUE(split_matches32(handler, values, 1, 1001));
+      EXPECT_TRUE(split_matches32(handler, values, 1, 0xffffffff));
+
+      /* At every cluster boundary, where a split copies whole subtrees */
+      for (i = 0; i < 1024; ++i)
+        values[i] = (uint32_t)(i * 4);
+      for (i = 0; i <= 12; ++i) {
+        EXPECT_TRUE(split_matches32(handler, values, 1024, (uint32_t)1 << i));
+        EXPECT_TRUE(split_matches32(handler, values, 1024, ((uint32_t)1 << i) + 1));
+      }
+
+      /* Width 64, at the highest levels */
+      for (i = 0; i < 64; ++i)
+        values64[i] = ((uint64_t)i << 58) | (i * 3);
+      EXPECT_TRUE(split_matches64(handler, values64, 64, 0));
+      EXPECT_TRUE(split_matches64(handler, values64, 64, (uint64_t)1 << 63));
+      EXPECT_TRUE(split_matches64(handler, values64, 64, values64[63]));
+      EXPECT_TRUE(split_matches64(handler, values64, 64, 0xffffffffffffffffULL));
+    }
+
+    /* Lists of a single repeated value go to one side or the other whole */
+    tree_config(handler, config, 0);
+    for (i = 0; i < 100; ++i)
+      values[i] = 7;
+    EXPECT_TRUE(split_matches32(handler, values, 100, 7));
+    EXPECT_TRUE(split_matches32(handler, values, 100, 8));
+  }
+
+  /* Random streams and values to split at */
+  for (round = 0; round < 200; ++round) {
+    static const uint32_t max_gaps[] = {1, 2, 16, 1 << 20};
+    const size_t values_len = (size_t)(test_rand(&state) % 3000);
+    const uint32_t max_gap = max_gaps[test_rand(&state) % 4];
+    uint32_t value;
+
+    is_set = (int)(test_rand(&state) % 2);
+    tree_config(handler, (int)(test_rand(&state) % TREE_CONFIGS), is_set);
+    random_sorted32(&state, values, values_len, (uint32_t)(test_rand(&state) % 1000),
+                    max_gap, !is_set);
+
+    if (values_len > 0 && test_rand(&state) % 2)
+      value = values[test_rand(&state) % values_len] + (uint32_t)(test_rand(&state) % 2);
+    else
+      value = (uint32_t)test_rand(&state);
+
+    EXPECT_TRUE(split_matches32(handler, values, values_len, value));
+  }
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+/*
+ * Checks that concatenating the streams of the values of @values before @at
+ * and of the rest gives the stream of all of them.
+ */
+static int concat_matches32(vtenc *handler, const uint32_t *values,
+  size_t values_len, size_t at)
+{
+  static uint8_t a[32768], b[32768], out[32768];
+  size_t a_size, b_size;
+
+  EXPECT_TRUE(vtenc_encode32(handler, values, at, a, sizeof(a)) == VTENC_OK);
+  a_size = vtenc_encoded_size(handler);
+  EXPECT_TRUE(vtenc_encode32(handler, values + at, values_len - at, b, sizeof(b)) == VTENC_OK);
+  b_size = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_concat32(handler, a, a_size, at, b, b_size, values_len - at, out, sizeof(out)) == VTENC_OK);
+  EXPECT_TRUE(encodes_as32(handler, values, values_len, out, vtenc_encoded_size(handler)));
+
+  return 1;
+}
+
+static int concat_matches64(vtenc *handler, const uint64_t *values,
+  size_t values_len, size_t at)
+{
+  static uint8_t a[32768], b[32768], out[32768];
+  size_t a_size, b_size;
+
+  EXPECT_TRUE(vtenc_encode64(handler, values, at, a, sizeof(a)) == VTENC_OK);
+  a_size = vtenc_encoded_size(handler);
+  EXPECT_TRUE(vtenc_encode64(handler, values + at, values_len - at, b, sizeof(b)) == VTENC_OK);
+  b_size = vtenc_encoded_size(handler);
+
+  EXPECT_TRUE(vtenc_concat64(handler, a, a_size, at, b, b_size, values_len - at, out, sizeof(out)) == VTENC_OK);
+  EXPECT_TRUE(encodes_as64(handler, values, values_len, out, vtenc_encoded_size(handler)));
+
+  return 1;
+}
+
+int test_vtenc_concat(void)
+{
+  static uint32_t values[3000];
+  static uint8_t a[8192], b[8192], out[8192];
+  uint64_t values64[64];
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  size_t a_size, b_size, at, i, round;
+  int config, is_set;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (config = 0; config < TREE_CONFIGS; ++config) {
+    for (is_set = 0; is_set <= 1; ++is_set) {
+      tree_config(handler, config, is_set);
+
+      /* Empty and single value streams */
+      EXPECT_TRUE(concat_matches32(handler, values, 0, 0));
+      values[0] = 1000;
+      EXPECT_TRUE(concat_matches32(handler, values, 1, 0));
+      EXPECT_TRUE(concat_matches32(handler, values, 1, 1));
+      values[1] = 1001;
+      EXPECT_TRUE(concat_matches32(handler, values, 2, 1));
+
+      /* Streams that meet at every cluster boundary, or in the middle of one */
+      for (i = 0; i < 1024; ++i)
+        values[i] = (uint32_t)(i * 4);
+      for (i = 0; i <= 10; ++i) {
+        EXPECT_TRUE(concat_matches32(handler, values, 1024, (size_t)1 << i));
+        EXPECT_TRUE(concat_matches32(handler, values, 1024, ((size_t)1 << i) - 1));
+      }
+
+      /* Width 64, at the highest levels */
+      for (i = 0; i < 64; ++i)
+        values64[i] = ((uint64_t)i << 58) | (i * 3);
+      EXPECT_TRUE(concat_matches64(handler, values64, 64, 32));
+      EXPECT_TRUE(concat_matches64(handler, values64, 64, 63));
+      EXPECT_TRUE(concat_matches64(handler, values64, 64, 64));
+    }
+
+    /* Lists can repeat the last value of the first stream in the second one */
+    tree_config(handler, config, 0);
+    for (i = 0; i < 100; ++i)
+      values[i] = 7;
+    EXPECT_TRUE(concat_matches32(handler, values, 100, 50));
+
+    /* But sets can't, nor can either go back */
+    tree_config(handler, config, 1);
+    values[0] = 5;
+    values[1] = 9;
+    EXPECT_TRUE(vtenc_encode32(handler, values, 2, a, sizeof(a)) == VTENC_OK);
+    a_size = vtenc_encoded_size(handler);
+    EXPECT_TRUE(vtenc_encode32(handler, values + 1, 1, b, sizeof(b)) == VTENC_OK);
+    b_size = vtenc_encoded_size(handler);
+    EXPECT_TRUE(vtenc_concat32(handler, a, a_size, 2, b, b_size, 1, out, sizeof(out)) == VTENC_ERR_NOT_SORTED);
+    EXPECT_TRUE(vtenc_concat32(handler, b, b_size, 1, a, a_size, 2, out, sizeof(out)) == VTENC_ERR_NOT_SORTED);
+  }
+
+  /* Outputs that are too small are detected */
+  tree_config(handler, 0, 1);
+  for (i = 0; i < 3000; ++i)
+    values[i] = (uint32_t)(i * 3);
+  EXPECT_TRUE(vtenc_encode32(handler, values, 1000, a, sizeof(a)) == VTENC_OK);
+  a_size = vtenc_encoded_size(handler);
+  EXPECT_TRUE(vtenc_encode32(handler, values + 1000, 2000, b, sizeof(b)) == VTENC_OK);
+  b_size = vtenc_encoded_size(handler);
+  EXPECT_TRUE(vtenc_concat32(handler, a, a_size, 1000, b, b_size, 2000, out, a_size) == VTENC_ERR_BUFFER_TOO_SMALL);
+
+  /* Random streams cut at random positions */
+  for (round = 0; round < 200; ++round) {
+    static const uint32_t max_gaps[] = {1, 2, 16, 1 << 20};
+    const size_t values_len = (size_t)(test_rand(&state) % 3000);
+    const uint32_t max_gap = max_gaps[test_rand(&state) % 4];
+
+    is_set = (int)(test_rand(&state) % 2);
+    tree_config(handler, (int)(test_rand(&state) % TREE_CONFIGS), is_set);
+    random_sorted32(&state, values, values_len, (uint32_t)(test_rand(&state) % 1000),
+                    max_gap, !is_set);
+
+    at = (size_t)(test_rand(&state) % (values_len + 1));
+
+    EXPECT_TRUE(concat_matches32(handler, values, values_len, at));
+  }
+
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+/*
+ * Checks that transcoding the stream of @values from the parameters of @dec
+ * to those of @enc gives the stream that @enc encodes them to.
+ */
+static int transcode_matches32(vtenc *dec, vtenc *enc, const uint32_t *values,
+  size_t values_len)
+{
+  static uint8_t in[32768], out[32768];
+  size_t in_len;
+
+  EXPECT_TRUE(vtenc_encode32(dec, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(dec);
+
+  EXPECT_TRUE(vtenc_transcode32(dec, enc, in, in_len, values_len, out, sizeof(out)) == VTENC_OK);
+  EXPECT_TRUE(encodes_as32(enc, values, values_len, out, vtenc_encoded_size(enc)));
+
+  return 1;
+}
+
+static int transcode_matches64(vtenc *dec, vtenc *enc, const uint64_t *values,
+  size_t values_len)
+{
+  static uint8_t in[32768], out[32768];
+  size_t in_len;
+
+  EXPECT_TRUE(vtenc_encode64(dec, values, values_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(dec);
+
+  EXPECT_TRUE(vtenc_transcode64(dec, enc, in, in_len, values_len, out, sizeof(out)) == VTENC_OK);
+  EXPECT_TRUE(encodes_as64(enc, values, values_len, out, vtenc_encoded_size(enc)));
+
+  return 1;
+}
+
+int test_vtenc_transcode(void)
+{
+  static uint32_t values[3000];
+  static uint8_t in[8192], out[8192];
+  uint64_t values64[64];
+  uint64_t state = 0x853c49e6748fea9bULL;
+  size_t in_len, i, round;
+  int from, to, dec_set, enc_set;
+  vtenc *dec = vtenc_create();
+  vtenc *enc = vtenc_create();
+  assert(dec != NULL && enc != NULL);
+
+  for (i = 0; i < 1024; ++i)
+    values[i] = (uint32_t)(i * 4);
+  for (i = 0; i < 64; ++i)
+    values64[i] = ((uint64_t)i << 58) | (i * 3);
+
+  /* Between every two parameter sets, sets and lists, either way */
+  for (from = 0; from < TREE_CONFIGS; ++from) {
+    for (to = 0; to < TREE_CONFIGS; ++to) {
+      for (dec_set = 0; dec_set <= 1; ++dec_set) {
+        for (enc_set = 0; enc_set <= 1; ++enc_set) {
+          tree_config(dec, from, dec_set);
+          tree_config(enc, to, enc_set);
+
+          /* Empty and single value streams */
+          EXPECT_TRUE(transcode_matches32(dec, enc, values, 0));
+          EXPECT_TRUE(transcode_matches32(dec, enc, values + 1000, 1));
+
+          /* Full clusters at every level, which may be copied or not */
+          EXPECT_TRUE(transcode_matches32(dec, enc, values, 1024));
+          EXPECT_TRUE(transcode_matches32(dec, enc, values + 1, 1000));
+
+          /* Width 64, at the highest levels */
+          EXPECT_TRUE(transcode_matches64(dec, enc, values64, 64));
+        }
+      }
+
+      /* Lists of a single repeated value */
+      tree_config(dec, from, 0);
+      tree_config(enc, to, 0);
+      for (i = 0; i < 100; ++i)
+        values[2000 + i] = 7;
+      EXPECT_TRUE(transcode_matches32(dec, enc, values + 2000, 100));
+    }
+  }
+
+  /* Values that don't fit in the new width are detected */
+  tree_config(dec, 0, 1);
+  tree_config(enc, 0, 1);
+  vtenc_config(enc, VTENC_CONFIG_WIDTH, 10);
+  EXPECT_TRUE(vtenc_encode32(dec, values, 1024, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(dec);
+  EXPECT_TRUE(vtenc_transcode32(dec, enc, in, in_len, 1024, out, sizeof(out)) == VTENC_ERR_CONFIG);
+  vtenc_config(enc, VTENC_CONFIG_WIDTH, 12);
+  EXPECT_TRUE(transcode_matches32(dec, enc, values, 1024));
+  vtenc_config(enc, VTENC_CONFIG_WIDTH, 64);
+
+  /* Random streams between random parameter sets */
+  for (round = 0; round < 200; ++round) {
+    static const uint32_t max_gaps[] = {1, 2, 16, 1 << 20};
+    const size_t values_len = (size_t)(test_rand(&state) % 3000);
+    const uint32_t max_gap = max_gaps[test_rand(&state) % 4];
+
+    dec_set = (int)(test_rand(&state) % 2);
+    enc_set = (int)(test_rand(&state) % 2);
+    tree_config(dec, (int)(test_rand(&state) % TREE_CONFIGS), dec_set);
+    tree_config(enc, (int)(test_rand(&state) % TREE_CONFIGS), enc_set);
+    random_sorted32(&state, values, values_len, (uint32_t)(test_rand(&state) % 1000),
+                    max_gap, !dec_set && !enc_set);
+
+    EXPECT_TRUE(transcode_matches32(dec, enc, values, values_len));
+  }
+
+  vtenc_destroy(dec);
+  vtenc_destroy(enc);
+
+  return 1;
+}
+
+/*
+ * Checks that the diff between the stream of @base and @values, applied to
+ * that stream, gives the stream of @values.
+ */
+static int diff_matches32(vtenc *enc, const uint32_t *base, size_t base_len,
+  const uint32_t *values, size_t values_len)
+{
+  static uint8_t in[32768], diff[32768], out[32768];
+  size_t in_len, diff_size, out_len;
+
+  EXPECT_TRUE(vtenc_encode32(enc, base, base_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(enc);
+
+  EXPECT_TRUE(vtenc_diff_encode32(enc, in, in_len, base_len, values, values_len, diff, sizeof(diff)) == VTENC_OK);
+  diff_size = vtenc_encoded_size(enc);
+
+  EXPECT_TRUE(vtenc_diff_apply32(enc, in, in_len, base_len, diff, diff_size, out, sizeof(out), &out_len) == VTENC_OK);
+  EXPECT_TRUE(out_len == values_len);
+  EXPECT_TRUE(encodes_as32(enc, values, values_len, out, vtenc_encoded_size(enc)));
+
+  return 1;
+}
+
+static int diff_matches64(vtenc *enc, const uint64_t *base, size_t base_len,
+  const uint64_t *values, size_t values_len)
+{
+  static uint8_t in[32768], diff[32768], out[32768];
+  size_t in_len, diff_size, out_len;
+
+  EXPECT_TRUE(vtenc_encode64(enc, base, base_len, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(enc);
+
+  EXPECT_TRUE(vtenc_diff_encode64(enc, in, in_len, base_len, values, values_len, diff, sizeof(diff)) == VTENC_OK);
+  diff_size = vtenc_encoded_size(enc);
+
+  EXPECT_TRUE(vtenc_diff_apply64(enc, in, in_len, base_len, diff, diff_size, out, sizeof(out), &out_len) == VTENC_OK);
+  EXPECT_TRUE(out_len == values_len);
+  EXPECT_TRUE(encodes_as64(enc, values, values_len, out, vtenc_encoded_size(enc)));
+
+  return 1;
+}
+
+/*
+ * Copies @base to @values, dropping about one in @rate of its values, and
+ * inserting about as many between them. Returns the number of values copied
+ * or inserted.
+ */
+static size_t random_edits32(uint64_t *state, const uint32_t *base,
+  size_t base_len, uint32_t *values, unsigned int rate, int is_set)
+{
+  size_t values_len = 0, i;
+
+  for (i = 0; i < base_len; ++i) {
+    const uint32_t next = i + 1 < base_len ? base[i + 1] : base[i] + 1000;
+
+    if (test_rand(state) % rate != 0)
+      values[values_len++] = base[i];
+
+    if (test_rand(state) % rate == 0) {
+      if (!is_set)
+        values[values_len++] = base[i] + (uint32_t)(test_rand(state) % (next - base[i] + 1));
+      else if (next - base[i] > 1)
+        values[values_len++] = base[i] + 1 + (uint32_t)(test_rand(state) % (next - base[i] - 1));
+    }
+  }
+
+  return values_len;
+}
+
+int test_vtenc_diff(void)
+{
+  static uint32_t base[3000], values[6000];
+  static uint8_t in[8192], diff[8192], out[8192];
+  uint64_t base64[64], values64[64];
+  uint64_t state = 0xda942042e4dd58b5ULL;
+  size_t in_len, diff_size, out_len, base_len, values_len, i, round;
+  int config, is_set;
+  vtenc *enc = vtenc_create();
+  assert(enc != NULL);
+
+  for (i = 0; i < 1024; ++i)
+    base[i] = (uint32_t)(i * 4);
+  for (i = 0; i < 64; ++i)
+    base64[i] = ((uint64_t)i << 58) | (i * 3);
+
+  for (config = 0; config < TREE_CONFIGS; ++config) {
+    for (is_set = 0; is_set <= 1; ++is_set) {
+      tree_config(enc, config, is_set);
+
+      /* From and to empty and single value streams */
+      EXPECT_TRUE(diff_matches32(enc, base, 0, base, 0));
+      EXPECT_TRUE(diff_matches32(enc, base, 0, base + 5, 1));
+      EXPECT_TRUE(diff_matches32(enc, base + 5, 1, base, 0));
+      EXPECT_TRUE(diff_matches32(enc, base + 5, 1, base + 6, 1));
+      EXPECT_TRUE(diff_matches32(enc, base, 1024, base, 0));
+      EXPECT_TRUE(diff_matches32(enc, base, 0, base, 1024));
+
+      /* No edits at all */
+      EXPECT_TRUE(diff_matches32(enc, base, 1024, base, 1024));
+
+      /* Edits at every cluster boundary: the first value of each power of two is dropped, and the one before it inserted */
+      values_len = 0;
+      for (i = 0; i < 1024; ++i) {
+        if (i > 0 && (i & (i - 1)) == 0) {
+          values[values_len++] = base[i] - 1;
+          continue;
+        }
+        values[values_len++] = base[i];
+      }
+      EXPECT_TRUE(diff_matches32(enc, base, 1024, values, values_len));
+      EXPECT_TRUE(diff_matches32(enc, values, values_len, base, 1024));
+
+      /* Width 64, at the highest levels */
+      for (i = 0; i < 64; ++i)
+        values64[i] = base64[i] + (i % 2);
+      EXPECT_TRUE(diff_matches64(enc, base64, 64, values64, 64));
+      EXPECT_TRUE(diff_matches64(enc, base64, 64, base64 + 32, 32));
+    }
+
+    /* In lists, repeated values are matched once each */
+    tree_config(enc, config, 0);
+    for (i = 0; i < 130; ++i)
+      values[2000 + i] = 7;
+    EXPECT_TRUE(diff_matches32(enc, values + 2000, 100, values + 2000, 60));
+    EXPECT_TRUE(diff_matches32(enc, values + 2000, 100, values + 2000, 130));
+  }
+
+  /* A few edits give a small diff */
+  tree_config(enc, 0, 1);
+  EXPECT_TRUE(vtenc_encode32(enc, base, 1024, in, sizeof(in)) == VTENC_OK);
+  in_len = vtenc_encoded_size(enc);
+  EXPECT_TRUE(vtenc_diff_encode32(enc, in, in_len, 1024, values, values_len, diff, sizeof(diff)) == VTENC_OK);
+  diff_size = vtenc_encoded_size(enc);
+  EXPECT_TRUE(diff_size < in_len / 4);
+
+  /* Repeated values in sets, and deletions past the end of the base, are detected */
+  EXPECT_TRUE(vtenc_diff_encode32(enc, in, in_len, 1024, values + 2000, 2, diff, sizeof(diff)) == VTENC_ERR_NOT_SORTED);
+  EXPECT_TRUE(vtenc_diff_apply32(enc, in, in_len, 100, diff, diff_size, out, sizeof(out), &out_len) == VTENC_ERR_WRONG_FORMAT);
+
+  /* Random edits of random streams */
+  for (round = 0; round < 200; ++round) {
+    static const uint32_t max_gaps[] = {1, 2, 16, 1 << 20};
+    const uint32_t max_gap = max_gaps[test_rand(&state) % 4];
+    const unsigned int rate = 2 + (unsigned int)(test_rand(&state) % 50);
+
+    base_len = (size_t)(test_rand(&state) % 3000);
+    is_set = (int)(test_rand(&state) % 2);
+    tree_config(enc, (int)(test_rand(&state) % TREE_CONFIGS), is_set);
+    random_sorted32(&state, base, base_len, (uint32_t)(test_rand(&state) % 1000),
+                    max_gap, !is_set);
+    values_len = random_edits32(&state, base, base_len, values, rate, is_set);
+
+    EXPECT_TRUE(diff_matches32(enc, base, base_len, values, values_len));
+  }
+
+  vtenc_destroy(enc);
+
+  return 1;
+}
@@ -0,0 +1,200 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unit_tests.h"
+#include "../../vtenc.h"
+
+struct log_values {
+  uint32_t values[20000];
+  size_t len;
+};
+
+static int collect_value(void *opaque, uint32_t value)
+{
+  struct log_values *collected = opaque;
+
+  if (collected->len == 20000)
+    return 1;
+
+  collected->values[collected->len++] = value;
+
+  return 0;
+}
+
+/* Checks that @log holds the @values_len values of @values */
+static int log_matches(vtenc_log *log, const uint32_t *values, size_t values_len)
+{
+  static struct log_values collected;
+  static uint32_t decoded[20000];
+  size_t from;
+
+  EXPECT_TRUE(vtenc_log_len(log) == values_len);
+
+  collected.len = 0;
+  EXPECT_TRUE(vtenc_log_foreach32(log, collect_value, &collected) == VTENC_OK);
+  EXPECT_TRUE(collected.len == values_len);
+  EXPECT_TRUE(memcmp(collected.values, values, values_len * sizeof(uint32_t)) == 0);
+
+  for (from = 0; from < values_len; from += 997) {
+    const size_t len = (values_len - from) / 3;
+
+    EXPECT_TRUE(vtenc_log_decode32(log, from, decoded, len) == VTENC_OK);
+    EXPECT_TRUE(memcmp(decoded, values + from, len * sizeof(uint32_t)) == 0);
+  }
+
+  EXPECT_TRUE(vtenc_log_decode32(log, 0, decoded, values_len + 1) == VTENC_ERR_CONFIG);
+
+  return 1;
+}
+
+int test_vtenc_log(void)
+{
+  static uint32_t values[20000];
+  size_t i;
+  vtenc_log *log;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 20000; ++i)
+    values[i] = (uint32_t)(i * 5 + i / 3);
+
+  log = vtenc_log_create32(handler, 100, 1);
+  assert(log != NULL);
+
+  EXPECT_TRUE(log_matches(log, values, 0));
+
+  /* Appends only begin a merge, and leave the rest */
+  EXPECT_TRUE(vtenc_log_append32(log, values, 300) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_merging(log) == 0);
+  EXPECT_TRUE(vtenc_log_append32(log, values + 300, 200) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_merging(log) == 1);
+  EXPECT_TRUE(vtenc_log_segments(log) == 5);
+  EXPECT_TRUE(log_matches(log, values, 500));
+  EXPECT_TRUE(vtenc_log_merge_run(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_merge_end(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_segments(log) == 2);
+
+  for (i = 500; i < 20000; i += 250) {
+    EXPECT_TRUE(vtenc_log_append32(log, values + i, 250) == VTENC_OK);
+
+    if (vtenc_log_merging(log)) {
+      EXPECT_TRUE(vtenc_log_merge_run(log) == VTENC_OK);
+      EXPECT_TRUE(vtenc_log_merge_end(log) == VTENC_OK);
+    }
+  }
+  EXPECT_TRUE(log_matches(log, values, 20000));
+
+  /* 200 segments of 100 values are merged into few larger ones */
+  EXPECT_TRUE(vtenc_log_segments(log) < 20);
+
+  EXPECT_TRUE(vtenc_log_append32(log, values, 1) == VTENC_ERR_NOT_SORTED);
+  EXPECT_TRUE(vtenc_log_append16(log, (const uint16_t *)values, 1) == VTENC_ERR_CONFIG);
+
+  vtenc_log_destroy(log);
+
+  /* Appends go on while segments are being merged */
+  log = vtenc_log_create32(handler, 100, 0);
+  assert(log != NULL);
+
+  EXPECT_TRUE(vtenc_log_append32(log, values, 1000) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_segments(log) == 10);
+
+  EXPECT_TRUE(vtenc_log_merge_begin(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_merge_begin(log) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_log_append32(log, values + 1000, 1000) == VTENC_OK);
+  EXPECT_TRUE(log_matches(log, values, 2000));
+  EXPECT_TRUE(vtenc_log_merge_run(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_append32(log, values + 2000, 1000) == VTENC_OK);
+  EXPECT_TRUE(log_matches(log, values, 3000));
+  EXPECT_TRUE(vtenc_log_merge_end(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_merge_end(log) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(vtenc_log_segments(log) == 27);
+  EXPECT_TRUE(log_matches(log, values, 3000));
+
+  EXPECT_TRUE(vtenc_log_merge(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_segments(log) < 10);
+  EXPECT_TRUE(log_matches(log, values, 3000));
+
+  vtenc_log_destroy(log);
+
+  /* Levels have no cap: 4^7 segments of a value are merged into one */
+  log = vtenc_log_create32(handler, 1, 0);
+  assert(log != NULL);
+
+  EXPECT_TRUE(vtenc_log_append32(log, values, 16384) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_segments(log) == 16384);
+  EXPECT_TRUE(vtenc_log_merge(log) == VTENC_OK);
+  EXPECT_TRUE(vtenc_log_segments(log) == 1);
+  EXPECT_TRUE(log_matches(log, values, 16384));
+
+  vtenc_log_destroy(log);
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+struct log_merge_thread {
+  vtenc_log *log;
+  int rc;
+};
+
+static void *merge_run(void *arg)
+{
+  struct log_merge_thread *merge = arg;
+
+  merge->rc = vtenc_log_merge_run(merge->log);
+
+  return NULL;
+}
+
+int test_vtenc_log_merge_thread(void)
+{
+  static uint32_t values[20000];
+  struct log_merge_thread merge;
+  pthread_t thread;
+  vtenc_log *log;
+  size_t i;
+  int rc;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 20000; ++i)
+    values[i] = (uint32_t)(i * 5 + i / 3);
+
+  log = vtenc_log_create32(handler, 100, 0);
+  assert(log != NULL);
+
+  for (i = 0; i < 20000; i += 2000) {
+    EXPECT_TRUE(vtenc_log_append32(log, values + i, 1000) == VTENC_OK);
+    EXPECT_TRUE(vtenc_log_merge_begin(log) == VTENC_OK);
+
+    merge.log = log;
+    merge.rc = VTENC_OK;
+    EXPECT_TRUE(pthread_create(&thread, NULL, merge_run, &merge) == 0);
+
+    /* The log is read and appended to while the segments are merged */
+    EXPECT_TRUE(vtenc_log_append32(log, values + i + 1000, 1000) == VTENC_OK);
+    EXPECT_TRUE(log_matches(log, values, i + 2000));
+
+    /* Only one of the end and the run merges them, whichever comes first */
+    while ((rc = vtenc_log_merge_end(log)) == VTENC_ERR_CONFIG)
+      ;
+    EXPECT_TRUE(rc == VTENC_OK);
+
+    EXPECT_TRUE(pthread_join(thread, NULL) == 0);
+    EXPECT_TRUE(merge.rc == VTENC_OK || merge.rc == VTENC_ERR_CONFIG);
+    EXPECT_TRUE(log_matches(log, values, i + 2000));
+  }
+
+  vtenc_log_destroy(log);
+  vtenc_destroy(handler);
+
+  return 1;
+}
@@ -0,0 +1,68 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unit_tests.h"
+#include "../../vtenc.h"
+
+int test_vtenc_postings(void)
+{
+  static uint32_t ids[1000], payloads[1000], decoded_ids[1000], decoded_payloads[1000];
+  static uint8_t out[16384], small[16384];
+  uint32_t id, payload;
+  size_t out_size, pos, i;
+  vtenc_postings_cursor *cursor;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  for (i = 0; i < 1000; ++i) {
+    ids[i] = (uint32_t)(i * 10 + i % 7);
+    payloads[i] = (uint32_t)(i % 13 == 0 ? 100000 + i : i % 5);
+  }
+
+  vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
+  EXPECT_TRUE(vtenc_postings_max_encoded_size32(1000) <= sizeof(out));
+  EXPECT_TRUE(vtenc_postings_encode32(handler, ids, payloads, 1000, out, sizeof(out)) == VTENC_OK);
+  out_size = vtenc_encoded_size(handler);
+  EXPECT_TRUE(vtenc_postings_encode32(handler, ids, payloads, 1000, small, out_size - 1) == VTENC_ERR_BUFFER_TOO_SMALL);
+
+  EXPECT_TRUE(vtenc_postings_decode32(handler, out, out_size, decoded_ids, decoded_payloads, 1000) == VTENC_OK);
+  EXPECT_TRUE(memcmp(decoded_ids, ids, sizeof(ids)) == 0);
+  EXPECT_TRUE(memcmp(decoded_payloads, payloads, sizeof(payloads)) == 0);
+  EXPECT_TRUE(vtenc_postings_decode32(handler, out, out_size / 2, decoded_ids, decoded_payloads, 1000) == VTENC_ERR_WRONG_FORMAT);
+
+  cursor = vtenc_postings_cursor_create32(handler, out, out_size, 1000);
+  assert(cursor != NULL);
+
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, 0, &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 0 && id == ids[0] && payload == payloads[0]);
+
+  /* Targets that are ids and targets between ids, across blocks */
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[300], &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 300 && id == ids[300] && payload == payloads[300]);
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[300], &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 300);
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[650] + 1, &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 651 && id == ids[651] && payload == payloads[651]);
+
+  /* Postings behind the cursor aren't considered again */
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[10], &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 651);
+
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[999], &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 999 && id == ids[999] && payload == payloads[999]);
+  EXPECT_TRUE(vtenc_postings_next_geq32(cursor, ids[999] + 1, &pos, &id, &payload) == VTENC_OK);
+  EXPECT_TRUE(pos == 1000);
+
+  EXPECT_TRUE(vtenc_postings_next_geq64(cursor, 0, &pos, NULL, NULL) == VTENC_ERR_CONFIG);
+
+  vtenc_postings_cursor_destroy(cursor);
+  vtenc_destroy(handler);
+
+  return 1;
+}
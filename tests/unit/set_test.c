@@ -0,0 +1,229 @@
+/**
+  Copyright (c) 2022 Vicente Romero Calero. All rights reserved.
+  Licensed under the MIT License.
+  See LICENSE file in the project root for full license information.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "unit_tests.h"
+#include "../../vtenc.h"
+
+struct set_values {
+  uint32_t values[10000];
+  size_t len;
+};
+
+static int collect_value(void *opaque, uint32_t value)
+{
+  struct set_values *collected = opaque;
+
+  if (collected->len == 10000)
+    return 1;
+
+  collected->values[collected->len++] = value;
+
+  return 0;
+}
+
+/* Checks that @set holds the values of @in, a bitmap of the values below 10000 */
+static int set_matches(vtenc_set *set, const uint8_t *in)
+{
+  static struct set_values collected;
+  size_t len = 0, i;
+  int found;
+
+  collected.len = 0;
+  EXPECT_TRUE(vtenc_set_foreach32(set, collect_value, &collected) == VTENC_OK);
+
+  for (i = 0; i < 10000; ++i) {
+    EXPECT_TRUE(vtenc_set_contains32(set, (uint32_t)i, &found) == VTENC_OK);
+    EXPECT_TRUE(found == in[i]);
+
+    if (in[i]) {
+      EXPECT_TRUE(len < collected.len && collected.values[len] == i);
+      len++;
+    }
+  }
+
+  EXPECT_TRUE(collected.len == len);
+  EXPECT_TRUE(vtenc_set_len(set) == len);
+
+  return 1;
+}
+
+int test_vtenc_set(void)
+{
+  static uint32_t values[3000];
+  static uint8_t in[10000];
+  static struct set_values collected;
+  vtenc_set *set;
+  size_t i;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  vtenc_config(handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
+  set = vtenc_set_create32(handler, 0);
+  assert(set != NULL);
+
+  memset(in, 0, sizeof(in));
+  EXPECT_TRUE(set_matches(set, in));
+
+  for (i = 0; i < 3000; ++i) {
+    values[i] = (uint32_t)(i * 3);
+    in[i * 3] = 1;
+  }
+
+  EXPECT_TRUE(vtenc_set_assign32(set, values, 3000) == VTENC_OK);
+  EXPECT_TRUE(set_matches(set, in));
+
+  /* Edits are seen before and after every step of a compaction */
+  for (i = 0; i < 10000; i += 7) {
+    EXPECT_TRUE(vtenc_set_insert32(set, (uint32_t)i) == VTENC_OK);
+    in[i] = 1;
+  }
+  EXPECT_TRUE(set_matches(set, in));
+
+  EXPECT_TRUE(vtenc_set_compact_begin(set) == VTENC_OK);
+  EXPECT_TRUE(vtenc_set_compact_begin(set) == VTENC_ERR_CONFIG);
+
+  for (i = 0; i < 10000; i += 5) {
+    EXPECT_TRUE(vtenc_set_erase32(set, (uint32_t)i) == VTENC_OK);
+    in[i] = 0;
+  }
+  EXPECT_TRUE(set_matches(set, in));
+
+  EXPECT_TRUE(vtenc_set_compact_run(set) == VTENC_OK);
+  EXPECT_TRUE(vtenc_set_compact_run(set) == VTENC_ERR_CONFIG);
+
+  for (i = 0; i < 10000; i += 10) {
+    EXPECT_TRUE(vtenc_set_insert32(set, (uint32_t)i) == VTENC_OK);
+    in[i] = 1;
+  }
+  EXPECT_TRUE(set_matches(set, in));
+
+  EXPECT_TRUE(vtenc_set_compact_end(set) == VTENC_OK);
+  EXPECT_TRUE(vtenc_set_compact_end(set) == VTENC_ERR_CONFIG);
+  EXPECT_TRUE(set_matches(set, in));
+
+  EXPECT_TRUE(vtenc_set_compact(set) == VTENC_OK);
+  EXPECT_TRUE(set_matches(set, in));
+
+  /* The iteration stops when the callback asks to */
+  collected.len = 9990;
+  EXPECT_TRUE(vtenc_set_foreach32(set, collect_value, &collected) == VTENC_ERR_SINK);
+
+  EXPECT_TRUE(vtenc_set_insert16(set, 1) == VTENC_ERR_CONFIG);
+  values[1] = values[0];
+  EXPECT_TRUE(vtenc_set_assign32(set, values, 3000) == VTENC_ERR_NOT_SORTED);
+  EXPECT_TRUE(set_matches(set, in));
+
+  vtenc_set_destroy(set);
+
+  /* Sets with a threshold only begin a compaction, and leave the rest */
+  set = vtenc_set_create32(handler, 64);
+  assert(set != NULL);
+
+  memset(in, 0, sizeof(in));
+  for (i = 0; i < 64 * 3; i += 3) {
+    EXPECT_TRUE(vtenc_set_compacting(set) == 0);
+    EXPECT_TRUE(vtenc_set_insert32(set, (uint32_t)(9999 - i)) == VTENC_OK);
+    in[9999 - i] = 1;
+  }
+  EXPECT_TRUE(vtenc_set_compacting(set) == 1);
+
+  for (; i < 10000; i += 3) {
+    EXPECT_TRUE(vtenc_set_insert32(set, (uint32_t)(9999 - i)) == VTENC_OK);
+    in[9999 - i] = 1;
+  }
+  EXPECT_TRUE(vtenc_set_compacting(set) == 1);
+  EXPECT_TRUE(set_matches(set, in));
+
+  EXPECT_TRUE(vtenc_set_compact_run(set) == VTENC_OK);
+  EXPECT_TRUE(vtenc_set_compact_end(set) == VTENC_OK);
+  EXPECT_TRUE(vtenc_set_compacting(set) == 0);
+  EXPECT_TRUE(set_matches(set, in));
+
+  for (i = 0; i < 10000; i += 4) {
+    EXPECT_TRUE(vtenc_set_erase32(set, (uint32_t)i) == VTENC_OK);
+    in[i] = 0;
+
+    if (vtenc_set_compacting(set)) {
+      EXPECT_TRUE(vtenc_set_compact_run(set) == VTENC_OK);
+      EXPECT_TRUE(vtenc_set_compact_end(set) == VTENC_OK);
+    }
+  }
+  EXPECT_TRUE(set_matches(set, in));
+
+  vtenc_set_destroy(set);
+  vtenc_destroy(handler);
+
+  return 1;
+}
+
+struct set_compaction {
+  vtenc_set *set;
+  int rc;
+};
+
+static void *compact_run(void *arg)
+{
+  struct set_compaction *compaction = arg;
+
+  compaction->rc = vtenc_set_compact_run(compaction->set);
+
+  return NULL;
+}
+
+int test_vtenc_set_compact_thread(void)
+{
+  static uint8_t in[10000];
+  struct set_compaction compaction;
+  pthread_t thread;
+  vtenc_set *set;
+  size_t round, i;
+  int rc;
+  vtenc *handler = vtenc_create();
+  assert(handler != NULL);
+
+  set = vtenc_set_create32(handler, 0);
+  assert(set != NULL);
+
+  memset(in, 0, sizeof(in));
+
+  for (round = 0; round < 20; ++round) {
+    for (i = round; i < 10000; i += 7) {
+      EXPECT_TRUE(vtenc_set_insert32(set, (uint32_t)i) == VTENC_OK);
+      in[i] = 1;
+    }
+
+    EXPECT_TRUE(vtenc_set_compact_begin(set) == VTENC_OK);
+
+    compaction.set = set;
+    compaction.rc = VTENC_OK;
+    EXPECT_TRUE(pthread_create(&thread, NULL, compact_run, &compaction) == 0);
+
+    /* The set is read and edited while the next base is built */
+    for (i = round; i < 10000; i += 13) {
+      EXPECT_TRUE(vtenc_set_erase32(set, (uint32_t)i) == VTENC_OK);
+      in[i] = 0;
+    }
+    EXPECT_TRUE(set_matches(set, in));
+
+    /* Only one of the end and the run builds it, whichever comes first */
+    while ((rc = vtenc_set_compact_end(set)) == VTENC_ERR_CONFIG)
+      ;
+    EXPECT_TRUE(rc == VTENC_OK);
+
+    EXPECT_TRUE(pthread_join(thread, NULL) == 0);
+    EXPECT_TRUE(compaction.rc == VTENC_OK || compaction.rc == VTENC_ERR_CONFIG);
+    EXPECT_TRUE(set_matches(set, in));
+  }
+
+  vtenc_set_destroy(set);
+  vtenc_destroy(handler);
+
+  return 1;
+}
@@ -28,6 +28,9 @@ int main()
   RUN_TEST(test_bits_len_u32);
   RUN_TEST(test_bits_len_u64);
 
+  RUN_TEST(test_bits_count_u64);
+  RUN_TEST(test_bits_ctz_u64);
+
   RUN_TEST(test_little_endian_read_and_write_u16);
   RUN_TEST(test_little_endian_read_and_write_u32);
   RUN_TEST(test_little_endian_read_and_write_u64);
@@ -50,6 +53,10 @@ int main()
   RUN_TEST(test_bsreader_read_5);
   RUN_TEST(test_bsreader_size);
 
+  RUN_TEST(test_bitmap_count);
+  RUN_TEST(test_bitmap_next_and_prev);
+  RUN_TEST(test_bitmap_set_range);
+
   RUN_TEST(test_stack_init);
   RUN_TEST(test_stack_push_and_pop);
 
@@ -68,15 +75,46 @@ int main()
   RUN_TEST(test_vtenc_encode32);
   RUN_TEST(test_vtenc_encode64);
 
+  RUN_TEST(test_vtenc_encode_strided);
+  RUN_TEST(test_vtenc_encode_from_bitmap);
+  RUN_TEST(test_vtenc_encode_strict);
+  RUN_TEST(test_vtenc_sort_encode);
+  RUN_TEST(test_vtenc_encode_merged);
+  RUN_TEST(test_vtenc_encode_to_sink);
+
   RUN_TEST(test_vtenc_max_encoded_size8);
   RUN_TEST(test_vtenc_max_encoded_size16);
   RUN_TEST(test_vtenc_max_encoded_size32);
   RUN_TEST(test_vtenc_max_encoded_size64);
+  RUN_TEST(test_vtenc_max_encoded_size_range);
+  RUN_TEST(test_vtenc_encoded_size_exact);
+
+  RUN_TEST(test_vtenc_suggest_min_cluster_lengths);
 
   RUN_TEST(test_vtenc_decode8);
   RUN_TEST(test_vtenc_decode16);
   RUN_TEST(test_vtenc_decode32);
   RUN_TEST(test_vtenc_decode64);
 
+  RUN_TEST(test_vtenc_decode_strided);
+  RUN_TEST(test_vtenc_decode_to_bitmap);
+  RUN_TEST(test_vtenc_decode_converted);
+  RUN_TEST(test_vtenc_decode_prefix);
+  RUN_TEST(test_vtenc_min_max);
+  RUN_TEST(test_vtenc_histogram);
+  RUN_TEST(test_vtenc_quantile);
+  RUN_TEST(test_vtenc_contains_batch);
+  RUN_TEST(test_vtenc_sample);
+  RUN_TEST(test_vtenc_split);
+  RUN_TEST(test_vtenc_concat);
+  RUN_TEST(test_vtenc_transcode);
+  RUN_TEST(test_vtenc_diff);
+
+  RUN_TEST(test_vtenc_set);
+  RUN_TEST(test_vtenc_set_compact_thread);
+  RUN_TEST(test_vtenc_log);
+  RUN_TEST(test_vtenc_log_merge_thread);
+  RUN_TEST(test_vtenc_postings);
+
   return 0;
 }
@@ -33,6 +33,9 @@ int test_bits_len_u16(void);
 int test_bits_len_u32(void);
 int test_bits_len_u64(void);
 
+int test_bits_count_u64(void);
+int test_bits_ctz_u64(void);
+
 int test_little_endian_read_and_write_u16(void);
 int test_little_endian_read_and_write_u32(void);
 int test_little_endian_read_and_write_u64(void);
@@ -55,6 +58,10 @@ int test_bsreader_read_4(void);
 int test_bsreader_read_5(void);
 int test_bsreader_size(void);
 
+int test_bitmap_count(void);
+int test_bitmap_next_and_prev(void);
+int test_bitmap_set_range(void);
+
 int test_stack_init(void);
 int test_stack_push_and_pop(void);
 
@@ -73,14 +80,45 @@ int test_vtenc_encode16(void);
 int test_vtenc_encode32(void);
 int test_vtenc_encode64(void);
 
+int test_vtenc_encode_strided(void);
+int test_vtenc_encode_from_bitmap(void);
+int test_vtenc_encode_strict(void);
+int test_vtenc_sort_encode(void);
+int test_vtenc_encode_merged(void);
+int test_vtenc_encode_to_sink(void);
+
 int test_vtenc_max_encoded_size8(void);
 int test_vtenc_max_encoded_size16(void);
 int test_vtenc_max_encoded_size32(void);
 int test_vtenc_max_encoded_size64(void);
+int test_vtenc_max_encoded_size_range(void);
+int test_vtenc_encoded_size_exact(void);
+
+int test_vtenc_suggest_min_cluster_lengths(void);
 
 int test_vtenc_decode8(void);
 int test_vtenc_decode16(void);
 int test_vtenc_decode32(void);
 int test_vtenc_decode64(void);
 
+int test_vtenc_decode_strided(void);
+int test_vtenc_decode_to_bitmap(void);
+int test_vtenc_decode_converted(void);
+int test_vtenc_decode_prefix(void);
+int test_vtenc_min_max(void);
+int test_vtenc_histogram(void);
+int test_vtenc_quantile(void);
+int test_vtenc_contains_batch(void);
+int test_vtenc_sample(void);
+int test_vtenc_split(void);
+int test_vtenc_concat(void);
+int test_vtenc_transcode(void);
+int test_vtenc_diff(void);
+
+int test_vtenc_set(void);
+int test_vtenc_set_compact_thread(void);
+int test_vtenc_log(void);
+int test_vtenc_log_merge_thread(void);
+int test_vtenc_postings(void);
+
 #endif /* VTENC_UNIT_TESTS_H_ */
@@ -33,6 +33,9 @@ extern "C" {
 #define VTENC_ERR_OUTPUT_TOO_BIG    (-3)  /* Output size too big */
 #define VTENC_ERR_WRONG_FORMAT      (-4)  /* Wrong encoded format */
 #define VTENC_ERR_CONFIG            (-5)  /* Unrecognised config option */
+#define VTENC_ERR_NO_MEMORY         (-6)  /* Memory allocation failed */
+#define VTENC_ERR_NOT_SORTED        (-7)  /* Input sequence not sorted */
+#define VTENC_ERR_SINK              (-8)  /* Output sink failed */
 
 /* Encoding/decoding handler */
 typedef struct vtenc vtenc;
@@ -64,10 +67,90 @@ void vtenc_destroy(vtenc *handler);
  *
  * VTENC_CONFIG_MIN_CLUSTER_LENGTH takes a single argument of type size_t. It
  * sets the minimun cluster length that is encoded.
+ *
+ * VTENC_CONFIG_MIN_CLUSTER_LENGTHS takes two arguments: a pointer to an array
+ * of size_t and the number of elements in it. It sets a different minimum
+ * cluster length for each level of the bit cluster tree, so that the element
+ * at index i applies to clusters whose values have i lower bits left to be
+ * encoded (the root of a tree for uintW_t values is at level W). Levels beyond
+ * the end of the array take its last element.
+ *
+ * VTENC_CONFIG_RUN_LENGTH_ENCODING takes a single argument of type int. If
+ * non-zero, only the distinct values of the sequence go through the bit
+ * cluster tree, and the number of times each of them is repeated is encoded
+ * separately as a sequence of run lengths. Since the distinct values form a
+ * set, VTENC_CONFIG_SKIP_FULL_SUBTREES does apply to them. If the run lengths
+ * would take more bits than the repeated values they stand for, the sequence
+ * is encoded as it is instead, which takes a single bit more.
+ * VTENC_CONFIG_RUN_LENGTH_ENCODING is only relevant to lists, so this config
+ * will be ignored when VTENC_CONFIG_ALLOW_REPEATED_VALUES is set to zero.
+ *
+ * VTENC_CONFIG_OPTIMAL_LEAVES takes a single argument of type int. If
+ * non-zero, every cluster longer than the minimum cluster length carries a
+ * 1-bit flag saying whether it's split or its values are encoded as lower
+ * bits. The encoder picks, for each cluster, the cheapest of both options
+ * according to the exact bit cost of the whole subtree below it.
+ *
+ * VTENC_CONFIG_SPLIT_PENALTY takes a single argument of type size_t. It's only
+ * used by the encoder when VTENC_CONFIG_OPTIMAL_LEAVES is enabled, and it
+ * sets the cost, in bits, that is added to every split cluster when comparing
+ * both options. A value of 0 gives the smallest output, while larger values
+ * favour leaves, which are faster to decode.
+ *
+ * VTENC_CONFIG_WIDTH takes a single argument of type unsigned int. It sets the
+ * number of bits that all values fit in, so that the bit cluster tree starts
+ * at that level instead of at the bit width of the values' type. Widths equal
+ * to or greater than the type's bit width have no effect, which is the
+ * default. When encoding, if the last (largest) value doesn't fit in the
+ * width, VTENC_ERR_CONFIG is returned.
+ *
+ * VTENC_CONFIG_DETECT_WIDTH takes a single argument of type int. If non-zero,
+ * the encoder finds out the actual bit width of the largest value and starts
+ * the bit cluster tree at that level. The detected width is stored at the
+ * beginning of the stream, using as few bits as needed to represent the width
+ * set by VTENC_CONFIG_WIDTH, and the decoder restores it from there.
+ *
+ * VTENC_CONFIG_PATH_COMPRESSION takes a single argument of type int. If
+ * non-zero, a cluster whose values don't split at the next level encodes the
+ * number of higher bits they all have in common, followed by those bits, and
+ * then splits at the first level where they differ. This skips whole chains
+ * of levels that don't split, which are common in sparse sequences, and it
+ * doesn't add anything to clusters that split right away.
+ *
+ * VTENC_CONFIG_BASE takes a single argument of type uint64_t. It sets a base
+ * that is subtracted from all values before building the bit cluster tree,
+ * and added back when decoding, so VTENC_CONFIG_WIDTH then refers to the
+ * values minus the base. It's 0 by default. When encoding, if the first
+ * (smallest) value is below the base, VTENC_ERR_CONFIG is returned.
+ *
+ * VTENC_CONFIG_FRAME_OF_REFERENCE takes a single argument of type int. If
+ * non-zero, the encoder uses the first value of the sequence as the base. Its
+ * difference to the base set by VTENC_CONFIG_BASE is stored at the beginning
+ * of the stream, using as many bits as the width set by VTENC_CONFIG_WIDTH,
+ * and the decoder restores it from there. If it doesn't fit in that width,
+ * encoding fails with VTENC_ERR_CONFIG. Along with
+ * VTENC_CONFIG_DETECT_WIDTH, a narrow range of large values is encoded as if
+ * they were small values.
+ *
+ * VTENC_CONFIG_STRICT takes a single argument of type int. If non-zero, the
+ * encoder checks that the sequence is sorted, in non-decreasing order for
+ * lists and in strictly increasing order for sets, and returns
+ * VTENC_ERR_NOT_SORTED if it isn't. It's 0 by default, since the check takes
+ * an extra pass over the values, even if a fast one.
  */
 #define VTENC_CONFIG_ALLOW_REPEATED_VALUES  0   /* int */
 #define VTENC_CONFIG_SKIP_FULL_SUBTREES     1   /* int */
 #define VTENC_CONFIG_MIN_CLUSTER_LENGTH     2   /* size_t */
+#define VTENC_CONFIG_RUN_LENGTH_ENCODING    3   /* int */
+#define VTENC_CONFIG_OPTIMAL_LEAVES         4   /* int */
+#define VTENC_CONFIG_SPLIT_PENALTY          5   /* size_t */
+#define VTENC_CONFIG_MIN_CLUSTER_LENGTHS    6   /* const size_t *, size_t */
+#define VTENC_CONFIG_WIDTH                  7   /* unsigned int */
+#define VTENC_CONFIG_DETECT_WIDTH           8   /* int */
+#define VTENC_CONFIG_PATH_COMPRESSION       9   /* int */
+#define VTENC_CONFIG_BASE                   10  /* uint64_t */
+#define VTENC_CONFIG_FRAME_OF_REFERENCE     11  /* int */
+#define VTENC_CONFIG_STRICT                 12  /* int */
 
 /* Configure encoding/decoding handler */
 int vtenc_config(vtenc *handler, int op, ...);
@@ -88,17 +171,177 @@ int vtenc_config(vtenc *handler, int op, ...);
  * will be returned (see result codes for more info).
  *
  * The output size can be obtained by calling vtenc_encoded_size() separately.
+ * If it doesn't fit in @out_cap bytes, VTENC_ERR_BUFFER_TOO_SMALL is returned.
  *
- * Note that these functions assume that @in is a sorted sequence and they don't
- * check its order. If you pass in an unsorted sequence, you may still get a
- * VTENC_OK code, but the output won't necessarily correspond to the correct
- * encoded stream for the input sequence.
+ * Note that these functions assume that @in is a sorted sequence and, unless
+ * VTENC_CONFIG_STRICT is set, they don't check its order. If you pass in an
+ * unsorted sequence, you may still get a VTENC_OK code, but the output won't
+ * necessarily correspond to the correct encoded stream for the input sequence.
  */
 int vtenc_encode8(vtenc *enc, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_cap);
 int vtenc_encode16(vtenc *enc, const uint16_t *in, size_t in_len, uint8_t *out, size_t out_cap);
 int vtenc_encode32(vtenc *enc, const uint32_t *in, size_t in_len, uint8_t *out, size_t out_cap);
 int vtenc_encode64(vtenc *enc, const uint64_t *in, size_t in_len, uint8_t *out, size_t out_cap);
 
+/*
+ * Output sink.
+ *
+ * @write is called with every chunk of an encoded stream, in order, and
+ * @opaque as its first argument. It returns 0 on success or any other value
+ * to stop the encoding.
+ */
+struct vtenc_sink {
+  int (*write)(void *opaque, const uint8_t *data, size_t data_len);
+  void *opaque;
+};
+
+/*
+ * Growable output buffer, for vtenc_buffer_write(). It can start empty, with
+ * all members set to 0. @data must be released with free().
+ */
+struct vtenc_buffer {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+};
+
+/*
+ * Sink writers for the most common outputs:
+ * - vtenc_buffer_write() appends to the struct vtenc_buffer that @opaque
+ *   points to, making it grow as needed.
+ * - vtenc_fd_write() writes to the file descriptor that @opaque points to, as
+ *   an int.
+ */
+int vtenc_buffer_write(void *opaque, const uint8_t *data, size_t data_len);
+int vtenc_fd_write(void *opaque, const uint8_t *data, size_t data_len);
+
+/**
+ * vtenc_encode_to_sink* functions.
+ *
+ * Like vtenc_encode*, but the encoded stream is handed to @sink in chunks of a
+ * few kilobytes as it's written, so that there's no need for a buffer of the
+ * maximum encoded size.
+ *
+ * Returns VTENC_OK if the encoding is successful, VTENC_ERR_SINK if @sink
+ * fails, or another error code otherwise. In case of error, part of the
+ * stream may already have been written.
+ */
+int vtenc_encode_to_sink8(vtenc *enc, const uint8_t *in, size_t in_len, const struct vtenc_sink *sink);
+int vtenc_encode_to_sink16(vtenc *enc, const uint16_t *in, size_t in_len, const struct vtenc_sink *sink);
+int vtenc_encode_to_sink32(vtenc *enc, const uint32_t *in, size_t in_len, const struct vtenc_sink *sink);
+int vtenc_encode_to_sink64(vtenc *enc, const uint64_t *in, size_t in_len, const struct vtenc_sink *sink);
+
+/**
+ * vtenc_encode_strided* functions.
+ *
+ * Functions to encode a sorted sequence whose values are a field of an array
+ * of records, e.g. a member of an array of structs, with no need to gather
+ * them into a separate array first. The output is the same as that of the
+ * corresponding vtenc_encode* function for the gathered sequence.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @in: pointer to the first record.
+ * @in_len: number of records.
+ * @stride: distance in bytes between two consecutive records.
+ * @offset: offset in bytes of the field within a record.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out / number of allocated bytes in @out.
+ *
+ * Both @stride and @offset must be multiples of the values' size, and the
+ * field must fit in a record, i.e. @offset plus the values' size can't be
+ * greater than @stride. Otherwise, VTENC_ERR_CONFIG is returned. @in must be
+ * suitably aligned for the values' type.
+ */
+int vtenc_encode_strided8(vtenc *enc, const void *in, size_t in_len, size_t stride, size_t offset, uint8_t *out, size_t out_cap);
+int vtenc_encode_strided16(vtenc *enc, const void *in, size_t in_len, size_t stride, size_t offset, uint8_t *out, size_t out_cap);
+int vtenc_encode_strided32(vtenc *enc, const void *in, size_t in_len, size_t stride, size_t offset, uint8_t *out, size_t out_cap);
+int vtenc_encode_strided64(vtenc *enc, const void *in, size_t in_len, size_t stride, size_t offset, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_encode_from_bitmap* functions.
+ *
+ * Functions to encode the set of positions of the set bits of a bitmap, with
+ * no need to turn it into a sorted sequence first. The output is the same as
+ * that of the corresponding vtenc_encode* function for that sequence.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @bitmap: input bitmap. Bit i is bit (i % 64) of the word at index (i / 64).
+ * @bitmap_len: size of @bitmap in bits. It can't be greater than 2^W, W being
+ *  the bit width of the values, or VTENC_ERR_INPUT_TOO_BIG is returned.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out / number of allocated bytes in @out.
+ *
+ * Returns VTENC_OK if the encoding is successful or an error code otherwise.
+ *
+ * The decoder needs the number of values, i.e. the number of set bits.
+ */
+int vtenc_encode_from_bitmap8(vtenc *enc, const uint64_t *bitmap, size_t bitmap_len, uint8_t *out, size_t out_cap);
+int vtenc_encode_from_bitmap16(vtenc *enc, const uint64_t *bitmap, size_t bitmap_len, uint8_t *out, size_t out_cap);
+int vtenc_encode_from_bitmap32(vtenc *enc, const uint64_t *bitmap, size_t bitmap_len, uint8_t *out, size_t out_cap);
+int vtenc_encode_from_bitmap64(vtenc *enc, const uint64_t *bitmap, size_t bitmap_len, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_sort_encode* functions.
+ *
+ * Functions to encode an unsorted sequence, sorting it in place at the same
+ * time. The bit cluster tree is what partitioning the values by each bit,
+ * from the highest one down, gives, so the values are partitioned while the
+ * tree is encoded, instead of being sorted first. The output is the same as
+ * that of the corresponding vtenc_encode* function for the sorted sequence.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @in: input sequence to be sorted and encoded.
+ * @in_len: size of @in.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out / number of allocated bytes in @out.
+ * @sorted_len: if not NULL, it's set to the number of encoded values.
+ *
+ * Returns VTENC_OK if the encoding is successful or an error code otherwise.
+ *
+ * On success, the first @sorted_len values of @in are the encoded sequence,
+ * which the decoder returns. When encoding a set, repeated values are removed,
+ * so @sorted_len may be smaller than @in_len, and if the set still has too
+ * many values, VTENC_ERR_INPUT_TOO_BIG is returned. On error, @in may have
+ * been reordered, and a set's repeated values may have been removed from it.
+ *
+ * With VTENC_CONFIG_OPTIMAL_LEAVES or VTENC_CONFIG_RUN_LENGTH_ENCODING, the
+ * values are sorted first and then encoded.
+ */
+int vtenc_sort_encode8(vtenc *enc, uint8_t *in, size_t in_len, uint8_t *out, size_t out_cap, size_t *sorted_len);
+int vtenc_sort_encode16(vtenc *enc, uint16_t *in, size_t in_len, uint8_t *out, size_t out_cap, size_t *sorted_len);
+int vtenc_sort_encode32(vtenc *enc, uint32_t *in, size_t in_len, uint8_t *out, size_t out_cap, size_t *sorted_len);
+int vtenc_sort_encode64(vtenc *enc, uint64_t *in, size_t in_len, uint8_t *out, size_t out_cap, size_t *sorted_len);
+
+/**
+ * vtenc_encode_merged* functions.
+ *
+ * Functions to encode the sequence that results from merging several sorted
+ * sequences, with no need to merge them first. The number of zeros of each
+ * cluster is the sum of those of the inputs, so each input is just split
+ * where it would be on its own. The output is the same as that of the
+ * corresponding vtenc_encode* function for the merged sequence.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @ins: sorted input sequences.
+ * @ins_len: size of each of @ins.
+ * @n_ins: number of input sequences.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out / number of allocated bytes in @out.
+ * @merged_len: if not NULL, it's set to the number of encoded values.
+ *
+ * Returns VTENC_OK if the encoding is successful or an error code otherwise.
+ *
+ * When encoding a set, values that are in more than one input are encoded
+ * once, so @merged_len may be smaller than the sum of @ins_len. Those values
+ * can only be found by merging the inputs, though, so in that case, as well
+ * as with VTENC_CONFIG_OPTIMAL_LEAVES or VTENC_CONFIG_RUN_LENGTH_ENCODING, the
+ * inputs are merged into a temporary array first.
+ */
+int vtenc_encode_merged8(vtenc *enc, const uint8_t *const *ins, const size_t *ins_len, size_t n_ins, uint8_t *out, size_t out_cap, size_t *merged_len);
+int vtenc_encode_merged16(vtenc *enc, const uint16_t *const *ins, const size_t *ins_len, size_t n_ins, uint8_t *out, size_t out_cap, size_t *merged_len);
+int vtenc_encode_merged32(vtenc *enc, const uint32_t *const *ins, const size_t *ins_len, size_t n_ins, uint8_t *out, size_t out_cap, size_t *merged_len);
+int vtenc_encode_merged64(vtenc *enc, const uint64_t *const *ins, const size_t *ins_len, size_t n_ins, uint8_t *out, size_t out_cap, size_t *merged_len);
+
 /*
  * Returns the number of bytes of the output of calling a vtenc_encode* function.
  */
@@ -118,6 +361,69 @@ size_t vtenc_max_encoded_size16(size_t in_len);
 size_t vtenc_max_encoded_size32(size_t in_len);
 size_t vtenc_max_encoded_size64(size_t in_len);
 
+/**
+ * vtenc_max_encoded_size_range* functions.
+ *
+ * Like vtenc_max_encoded_size*, but for a sequence whose values are all
+ * between @min and @max, and for the encoding parameters of @enc. The higher
+ * bits that @min and @max have in common are encoded once rather than for
+ * every value, so the closer they are, the tighter the bound.
+ *
+ * If @enc can't encode such a sequence, it returns the same as
+ * vtenc_max_encoded_size*.
+ */
+size_t vtenc_max_encoded_size_range8(const vtenc *enc, size_t in_len, uint8_t min, uint8_t max);
+size_t vtenc_max_encoded_size_range16(const vtenc *enc, size_t in_len, uint16_t min, uint16_t max);
+size_t vtenc_max_encoded_size_range32(const vtenc *enc, size_t in_len, uint32_t min, uint32_t max);
+size_t vtenc_max_encoded_size_range64(const vtenc *enc, size_t in_len, uint64_t min, uint64_t max);
+
+/**
+ * vtenc_encoded_size_exact* functions.
+ *
+ * Functions to calculate the exact size in bytes of the output of the
+ * corresponding vtenc_encode* function, with no output. The bit cluster tree
+ * is traversed as when encoding, but bits are only counted.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @in: input sequence to encode.
+ * @in_len: size of @in.
+ *
+ * Returns VTENC_OK on success or an error code otherwise, which is the same
+ * that the vtenc_encode* function would return. On success, the size is
+ * returned by vtenc_encoded_size(). Note that vtenc_encode* functions need 8
+ * bytes more than that in their output buffer, as they write 8 bytes at once.
+ */
+int vtenc_encoded_size_exact8(vtenc *enc, const uint8_t *in, size_t in_len);
+int vtenc_encoded_size_exact16(vtenc *enc, const uint16_t *in, size_t in_len);
+int vtenc_encoded_size_exact32(vtenc *enc, const uint32_t *in, size_t in_len);
+int vtenc_encoded_size_exact64(vtenc *enc, const uint64_t *in, size_t in_len);
+
+/**
+ * vtenc_suggest_min_cluster_lengths* functions.
+ *
+ * Functions to derive a minimum cluster length for each level of the bit
+ * cluster tree from a sample of the data to be encoded, so that they can be
+ * passed in to VTENC_CONFIG_MIN_CLUSTER_LENGTHS.
+ *
+ * For every level, the suggested length is the power of two that minimises
+ * the total cost of the sample's clusters at that level, where the cost of a
+ * split cluster includes the VTENC_CONFIG_SPLIT_PENALTY set on @enc. Hence, a
+ * zero penalty favours compression ratio, while larger penalties favour
+ * decoding speed.
+ *
+ * @enc: encoder. Provides encoding parameters.
+ * @sample: sorted sample of values.
+ * @sample_len: size of @sample.
+ * @lengths: output array, with room for W+1 elements, W being the bit width
+ *  of the values.
+ *
+ * Returns VTENC_OK on success or an error code otherwise.
+ */
+int vtenc_suggest_min_cluster_lengths8(vtenc *enc, const uint8_t *sample, size_t sample_len, size_t *lengths);
+int vtenc_suggest_min_cluster_lengths16(vtenc *enc, const uint16_t *sample, size_t sample_len, size_t *lengths);
+int vtenc_suggest_min_cluster_lengths32(vtenc *enc, const uint32_t *sample, size_t sample_len, size_t *lengths);
+int vtenc_suggest_min_cluster_lengths64(vtenc *enc, const uint64_t *sample, size_t sample_len, size_t *lengths);
+
 /**
  * vtenc_decode* functions.
  *
@@ -141,6 +447,759 @@ int vtenc_decode16(vtenc *dec, const uint8_t *in, size_t in_len, uint16_t *out,
 int vtenc_decode32(vtenc *dec, const uint8_t *in, size_t in_len, uint32_t *out, size_t out_len);
 int vtenc_decode64(vtenc *dec, const uint8_t *in, size_t in_len, uint64_t *out, size_t out_len);
 
+/**
+ * vtenc_decode_strided* functions.
+ *
+ * Functions to decode the stream of bytes @in straight into a field of an
+ * array of records, e.g. a member of an array of structs. Only that field of
+ * every record is written.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes to be decoded.
+ * @in_len: size of @in.
+ * @out: pointer to the first record.
+ * @out_len: number of records.
+ * @stride: distance in bytes between two consecutive records.
+ * @offset: offset in bytes of the field within a record.
+ *
+ * @stride and @offset have the same requirements as in vtenc_encode_strided*.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ */
+int vtenc_decode_strided8(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, size_t stride, size_t offset);
+int vtenc_decode_strided16(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, size_t stride, size_t offset);
+int vtenc_decode_strided32(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, size_t stride, size_t offset);
+int vtenc_decode_strided64(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, size_t stride, size_t offset);
+
+/**
+ * vtenc_decode_to_bitmap* functions.
+ *
+ * Functions to decode the stream of bytes @in into a bitmap, setting the bit
+ * at the position of every decoded value. Other bits are left untouched, so
+ * @bitmap usually needs to be cleared beforehand.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes to be decoded.
+ * @in_len: size of @in.
+ * @out_len: number of encoded values.
+ * @bitmap: output bitmap, with the same layout as in vtenc_encode_from_bitmap*.
+ * @bitmap_len: size of @bitmap in bits.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ * If a value doesn't fit in @bitmap, VTENC_ERR_BUFFER_TOO_SMALL is returned.
+ *
+ * With repeated values, only the distinct ones are recorded in @bitmap.
+ */
+int vtenc_decode_to_bitmap8(vtenc *dec, const uint8_t *in, size_t in_len, size_t out_len, uint64_t *bitmap, size_t bitmap_len);
+int vtenc_decode_to_bitmap16(vtenc *dec, const uint8_t *in, size_t in_len, size_t out_len, uint64_t *bitmap, size_t bitmap_len);
+int vtenc_decode_to_bitmap32(vtenc *dec, const uint8_t *in, size_t in_len, size_t out_len, uint64_t *bitmap, size_t bitmap_len);
+int vtenc_decode_to_bitmap64(vtenc *dec, const uint8_t *in, size_t in_len, size_t out_len, uint64_t *bitmap, size_t bitmap_len);
+
+/**
+ * vtenc_decode_converted* functions.
+ *
+ * Functions to decode the stream of bytes @in into an array of integers of
+ * another width than the encoded one, adding @offset to every value. This is
+ * done as values are stored, rather than in a second pass over @out. E.g.,
+ * local ids of a segment encoded as 32-bit integers can be decoded straight
+ * into 64-bit global ids.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes to be decoded.
+ * @in_len: size of @in.
+ * @out: output sequence, of integers of @out_width bits.
+ * @out_len: size of @out.
+ * @out_width: width of the output integers: 8, 16, 32 or 64.
+ * @offset: value added to every decoded value.
+ *
+ * Every value plus @offset is truncated to @out_width bits, so the output
+ * can also be narrower than the encoded values, as long as the values fit.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ */
+int vtenc_decode_converted8(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, unsigned int out_width, uint64_t offset);
+int vtenc_decode_converted16(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, unsigned int out_width, uint64_t offset);
+int vtenc_decode_converted32(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, unsigned int out_width, uint64_t offset);
+int vtenc_decode_converted64(vtenc *dec, const uint8_t *in, size_t in_len, void *out, size_t out_len, unsigned int out_width, uint64_t offset);
+
+/**
+ * vtenc_decode_prefix* functions.
+ *
+ * Functions to decode only the first, i.e. smallest, @out_len values of the
+ * stream of bytes @in. Values come out of the bit cluster tree in ascending
+ * order, so the decoding stops as soon as they have been written, with no
+ * need to decode the rest.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes to be decoded.
+ * @in_len: size of @in.
+ * @values_len: number of encoded values.
+ * @out: output sequence.
+ * @out_len: size of @out. If greater than @values_len, only @values_len values
+ *  are written.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ *
+ * With VTENC_CONFIG_RUN_LENGTH_ENCODING, run lengths come after all of the
+ * distinct values in the stream, so the bit cluster tree is traversed to the
+ * end, although only the values in the prefix are stored.
+ */
+int vtenc_decode_prefix8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *out, size_t out_len);
+int vtenc_decode_prefix16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint16_t *out, size_t out_len);
+int vtenc_decode_prefix32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint32_t *out, size_t out_len);
+int vtenc_decode_prefix64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint64_t *out, size_t out_len);
+
+/**
+ * vtenc_min* and vtenc_max* functions.
+ *
+ * Functions to decode only the smallest or the largest value of the stream of
+ * bytes @in, which has @values_len values, into @min or @max.
+ *
+ * vtenc_min* only follows the left-most path of the bit cluster tree. The
+ * right-most path comes last in the stream, so vtenc_max* still needs to read
+ * the number of values of every cluster, but the lower bits of the leaves are
+ * skipped rather than decoded. With VTENC_CONFIG_RUN_LENGTH_ENCODING, run
+ * lengths aren't read in either case.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ * If @values_len is 0, there's no such value and VTENC_ERR_CONFIG is returned.
+ */
+int vtenc_min8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *min);
+int vtenc_min16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint16_t *min);
+int vtenc_min32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint32_t *min);
+int vtenc_min64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint64_t *min);
+int vtenc_max8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *max);
+int vtenc_max16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint16_t *max);
+int vtenc_max32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint32_t *max);
+int vtenc_max64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, uint64_t *max);
+
+/**
+ * vtenc_histogram* functions.
+ *
+ * Functions to count the values of the stream of bytes @in in 2^@depth
+ * buckets of equal width, which split the whole range of the values' type,
+ * i.e. bucket i counts the values whose @depth higher bits are i.
+ *
+ * The numbers of values of the clusters of the bit cluster tree are read as
+ * when decoding, but values aren't decoded, other than those of leaves that
+ * span more than one bucket. Lower bits of the rest of leaves are skipped.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes.
+ * @in_len: size of @in.
+ * @values_len: number of encoded values.
+ * @depth: number of higher bits that make the buckets, from 1 to 32 and no
+ *  more than the bit width of the values.
+ * @counts: output array of 2^@depth elements, which are overwritten.
+ *
+ * Returns VTENC_OK on success or an error code otherwise.
+ */
+int vtenc_histogram8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, unsigned int depth, size_t *counts);
+int vtenc_histogram16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, unsigned int depth, size_t *counts);
+int vtenc_histogram32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, unsigned int depth, size_t *counts);
+int vtenc_histogram64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, unsigned int depth, size_t *counts);
+
+/**
+ * vtenc_quantile* functions.
+ *
+ * Functions to decode the @q-quantile of the stream of bytes @in, which has
+ * @values_len values, into @value. That's the value at position
+ * floor(@q * (@values_len - 1)) of the sequence.
+ *
+ * Only that value is decoded. Clusters before it are read as in vtenc_max*,
+ * and the decoding stops right after it. With
+ * VTENC_CONFIG_RUN_LENGTH_ENCODING, the whole tree and then run lengths up to
+ * the value are read first, to find which distinct value it is.
+ *
+ * Returns VTENC_OK when the decoding is successful or an error code otherwise.
+ * If @q isn't between 0 and 1, or @values_len is 0, VTENC_ERR_CONFIG is
+ * returned.
+ */
+int vtenc_quantile8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, double q, uint8_t *value);
+int vtenc_quantile16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, double q, uint16_t *value);
+int vtenc_quantile32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, double q, uint32_t *value);
+int vtenc_quantile64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, double q, uint64_t *value);
+
+/**
+ * vtenc_contains_batch* functions.
+ *
+ * Functions to look for a sorted batch of values, @probes, in the stream of
+ * bytes @in. The bit cluster tree is traversed once for the whole batch, and
+ * its values, which come out in ascending order, are merged with @probes:
+ * - Leaves with no probe between their smallest and largest possible values
+ *   are skipped rather than decoded.
+ * - The traversal stops as soon as all of the probes have been looked for.
+ * Clusters with no probes before that still need their number of values to
+ * be read, though, as they're in the stream.
+ *
+ * @dec: decoder. Provides encoding parameters.
+ * @in: input stream of bytes.
+ * @in_len: size of @in.
+ * @values_len: number of encoded values.
+ * @probes: sorted array of values to look for. It can have repeated values.
+ * @probes_len: size of @probes.
+ * @found: output bitmap, with the same layout as in vtenc_encode_from_bitmap*,
+ *  whose bit i is set if @probes[i] is found, or cleared otherwise. Its
+ *  ceil(@probes_len / 64) words are overwritten.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_NOT_SORTED if @probes isn't sorted,
+ * or another error code otherwise.
+ */
+int vtenc_contains_batch8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, const uint8_t *probes, size_t probes_len, uint64_t *found);
+int vtenc_contains_batch16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, const uint16_t *probes, size_t probes_len, uint64_t *found);
+int vtenc_contains_batch32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, const uint32_t *probes, size_t probes_len, uint64_t *found);
+int vtenc_contains_batch64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, const uint64_t *probes, size_t probes_len, uint64_t *found);
+
+/**
+ * vtenc_sample* functions.
+ *
+ * Functions to pick @k of the @values_len values of the stream of bytes @in
+ * uniformly at random, with no repetitions, into @out, in ascending order.
+ *
+ * The bit cluster tree is traversed once, and the samples of every cluster
+ * are split between its two halves in proportion to their number of values.
+ * Only the leaves with samples are decoded, and the traversal stops after the
+ * last sample. The stream has no information to skip clusters, though, so the
+ * ones before the last sample still need their number of values to be read.
+ *
+ * Lists encoded with VTENC_CONFIG_RUN_LENGTH_ENCODING aren't supported, since
+ * their tree only counts distinct values.
+ *
+ * @seed: seed of the random numbers. The same seed, stream and @k always
+ *  give the same sample.
+ *
+ * Returns VTENC_OK on success or an error code otherwise. If @k is greater
+ * than @values_len, or run-length encoding is enabled, VTENC_ERR_CONFIG is
+ * returned.
+ */
+int vtenc_sample8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, size_t k, uint64_t seed, uint8_t *out);
+int vtenc_sample16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, size_t k, uint64_t seed, uint16_t *out);
+int vtenc_sample32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, size_t k, uint64_t seed, uint32_t *out);
+int vtenc_sample64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len, size_t k, uint64_t seed, uint64_t *out);
+
+/**
+ * vtenc_split* functions.
+ *
+ * Functions to split the stream of bytes @in in two: the values lower than
+ * @value, which are encoded to @lo, and the rest, which are encoded to @hi.
+ * Both are encoded with the parameters of @handler, as vtenc_encode_to_sink*
+ * would.
+ *
+ * The bit cluster tree is split rather than decoded. Only the clusters on the
+ * path to @value are encoded again, and the rest are copied as they are. The
+ * stream has no information to skip clusters, though, so finding the path
+ * still takes reading the number of values of the clusters before it.
+ * Streams encoded with VTENC_CONFIG_RUN_LENGTH_ENCODING,
+ * VTENC_CONFIG_FRAME_OF_REFERENCE or VTENC_CONFIG_OPTIMAL_LEAVES have clusters
+ * that depend on the rest of the tree, so they are decoded and encoded again
+ * instead.
+ *
+ * @handler: encoder and decoder. Provides encoding parameters.
+ * @in: input stream of bytes.
+ * @in_len: size of @in.
+ * @values_len: number of encoded values.
+ * @value: value to split at.
+ * @lo: output sink of the values lower than @value.
+ * @hi: output sink of the rest of the values.
+ * @lo_len: output number of values lower than @value.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_SINK if @lo or @hi fail, or another
+ * error code otherwise. In case of error, part of the streams may already have
+ * been written.
+ */
+int vtenc_split8(vtenc *handler, const uint8_t *in, size_t in_len, size_t values_len, uint8_t value, const struct vtenc_sink *lo, const struct vtenc_sink *hi, size_t *lo_len);
+int vtenc_split16(vtenc *handler, const uint8_t *in, size_t in_len, size_t values_len, uint16_t value, const struct vtenc_sink *lo, const struct vtenc_sink *hi, size_t *lo_len);
+int vtenc_split32(vtenc *handler, const uint8_t *in, size_t in_len, size_t values_len, uint32_t value, const struct vtenc_sink *lo, const struct vtenc_sink *hi, size_t *lo_len);
+int vtenc_split64(vtenc *handler, const uint8_t *in, size_t in_len, size_t values_len, uint64_t value, const struct vtenc_sink *lo, const struct vtenc_sink *hi, size_t *lo_len);
+
+/**
+ * vtenc_concat* functions.
+ *
+ * Functions to encode the values of the stream of bytes @a followed by those
+ * of @b into @out, as vtenc_encode* would. All the values of @a must be lower
+ * than those of @b, or not greater for lists.
+ *
+ * Like vtenc_split*, they work on the bit cluster trees: only the clusters
+ * that hold values of both streams are encoded again, and the rest are
+ * copied. The same encoding parameters aren't supported either, so those
+ * streams are decoded and encoded again.
+ *
+ * @handler: encoder and decoder. Provides encoding parameters.
+ * @a: first input stream of bytes.
+ * @a_in_len: size of @a.
+ * @a_len: number of values encoded in @a.
+ * @b: second input stream of bytes.
+ * @b_in_len: size of @b.
+ * @b_len: number of values encoded in @b.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out, which is enough if it's that of the output of
+ *  vtenc_encode* for @a_len + @b_len values.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_NOT_SORTED if a value of @a isn't
+ * lower than one of @b, VTENC_ERR_INPUT_TOO_BIG if there are too many values
+ * for a single stream, or another error code otherwise. On success, the size
+ * of @out is given by vtenc_encoded_size().
+ */
+int vtenc_concat8(vtenc *handler, const uint8_t *a, size_t a_in_len, size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len, uint8_t *out, size_t out_cap);
+int vtenc_concat16(vtenc *handler, const uint8_t *a, size_t a_in_len, size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len, uint8_t *out, size_t out_cap);
+int vtenc_concat32(vtenc *handler, const uint8_t *a, size_t a_in_len, size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len, uint8_t *out, size_t out_cap);
+int vtenc_concat64(vtenc *handler, const uint8_t *a, size_t a_in_len, size_t a_len, const uint8_t *b, size_t b_in_len, size_t b_len, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_transcode* functions.
+ *
+ * Functions to encode the values of the stream of bytes @in, encoded with the
+ * parameters of @dec, as vtenc_encode* would with those of @enc, such as
+ * another VTENC_CONFIG_MIN_CLUSTER_LENGTH or VTENC_CONFIG_SKIP_FULL_SUBTREES.
+ *
+ * Like vtenc_split*, they work on the bit cluster tree: clusters whose levels
+ * and lower ones have the same parameters in both are copied, and only the
+ * rest, usually the lowest levels, are encoded again. Streams of sets to be
+ * encoded as lists or the other way around, with another VTENC_CONFIG_BASE, or
+ * with the parameters that vtenc_split* doesn't support, are decoded and
+ * encoded again instead.
+ *
+ * @dec: decoder. Provides the encoding parameters of @in.
+ * @enc: encoder. Provides the encoding parameters of @out.
+ * @in: input stream of bytes.
+ * @in_len: size of @in.
+ * @values_len: number of encoded values.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out, which is enough if it's that of the output of
+ *  vtenc_encode* for @values_len values.
+ *
+ * Returns VTENC_OK on success or an error code otherwise. On success, the size
+ * of @out is given by vtenc_encoded_size() on @enc.
+ */
+int vtenc_transcode8(vtenc *dec, vtenc *enc, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_transcode16(vtenc *dec, vtenc *enc, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_transcode32(vtenc *dec, vtenc *enc, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_transcode64(vtenc *dec, vtenc *enc, const uint8_t *in, size_t in_len, size_t values_len, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_diff_encode* functions.
+ *
+ * Functions to encode the differences between the values of the stream of
+ * bytes @base and the sorted sequence @values into @out, so that
+ * vtenc_diff_apply* can rebuild the stream of @values from @base.
+ *
+ * A diff holds the values of @values that aren't in @base, encoded as
+ * vtenc_encode* would, and the ranks in @base of its values that aren't in
+ * @values, encoded as a set. For lists, repeated values are matched once each.
+ *
+ * @enc: encoder and decoder. Provides the encoding parameters of @base.
+ * @base: input stream of bytes.
+ * @base_in_len: size of @base.
+ * @base_len: number of values encoded in @base.
+ * @values: new sequence of values.
+ * @values_len: number of elements of @values.
+ * @out: output diff.
+ * @out_cap: capacity of @out.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_NOT_SORTED if @values isn't sorted,
+ * or another error code otherwise. On success, the size of @out is given by
+ * vtenc_encoded_size().
+ */
+int vtenc_diff_encode8(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint8_t *values, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_diff_encode16(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint16_t *values, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_diff_encode32(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint32_t *values, size_t values_len, uint8_t *out, size_t out_cap);
+int vtenc_diff_encode64(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint64_t *values, size_t values_len, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_diff_apply* functions.
+ *
+ * Functions to encode the values of the stream of bytes @base with the
+ * insertions and deletions of @diff, from vtenc_diff_encode*, applied to them,
+ * as vtenc_encode* would.
+ *
+ * Like vtenc_split*, they work on the bit cluster tree: clusters with no
+ * insertions or deletions are copied, and only those on the path to an edit
+ * are encoded again. The same encoding parameters aren't supported either, so
+ * those streams are decoded and encoded again.
+ *
+ * @enc: encoder and decoder. Provides the encoding parameters of @base and
+ *  @diff.
+ * @base: input stream of bytes that @diff was made from.
+ * @base_in_len: size of @base.
+ * @base_len: number of values encoded in @base.
+ * @diff: input diff.
+ * @diff_len: size of @diff.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out.
+ * @out_len: output number of values encoded in @out.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_WRONG_FORMAT if @diff is malformed or
+ * deletes values that @base doesn't have, VTENC_ERR_NOT_SORTED if it inserts
+ * a value of a set that is already there, or another error code otherwise. On
+ * success, the size of @out is given by vtenc_encoded_size().
+ */
+int vtenc_diff_apply8(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint8_t *diff, size_t diff_len, uint8_t *out, size_t out_cap, size_t *out_len);
+int vtenc_diff_apply16(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint8_t *diff, size_t diff_len, uint8_t *out, size_t out_cap, size_t *out_len);
+int vtenc_diff_apply32(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint8_t *diff, size_t diff_len, uint8_t *out, size_t out_cap, size_t *out_len);
+int vtenc_diff_apply64(vtenc *enc, const uint8_t *base, size_t base_in_len, size_t base_len, const uint8_t *diff, size_t diff_len, uint8_t *out, size_t out_cap, size_t *out_len);
+
+/*
+ * Mutable set of values, kept encoded.
+ *
+ * The values of the last compaction, its base, are encoded in blocks of a few
+ * hundred values, so that a lookup only reads one block. Insertions and
+ * erasures are kept in a small sorted buffer on top of the base, until a
+ * compaction folds them into a new base. Only the blocks with edits are
+ * decoded and encoded again; the rest are copied.
+ *
+ * The functions of a set can't be called concurrently, except for
+ * vtenc_set_compact_run().
+ */
+typedef struct vtenc_set vtenc_set;
+
+/**
+ * vtenc_set_create* functions.
+ *
+ * Functions to create an empty set, whose blocks are encoded with the
+ * parameters of @handler, which are copied. Repeated values and run-length
+ * encoding don't apply to sets, so they are disabled.
+ *
+ * @threshold: number of buffered edits that make vtenc_set_insert* and
+ *  vtenc_set_erase* begin a compaction, or 0 to only begin it explicitly.
+ *  Either way, running and ending the compaction is left to the caller, see
+ *  vtenc_set_compacting().
+ *
+ * Returns the new set, or NULL if there isn't enough memory.
+ */
+vtenc_set *vtenc_set_create8(vtenc *handler, size_t threshold);
+vtenc_set *vtenc_set_create16(vtenc *handler, size_t threshold);
+vtenc_set *vtenc_set_create32(vtenc *handler, size_t threshold);
+vtenc_set *vtenc_set_create64(vtenc *handler, size_t threshold);
+
+/* Destroy a set */
+void vtenc_set_destroy(vtenc_set *set);
+
+/* Number of values of a set */
+size_t vtenc_set_len(const vtenc_set *set);
+
+/*
+ * Returns 1 if a compaction of @set is in progress, begun explicitly or by
+ * the threshold of the set, or 0 otherwise. That's when vtenc_set_compact_run()
+ * can be called on another thread, and vtenc_set_compact_end() once it's done.
+ */
+int vtenc_set_compacting(const vtenc_set *set);
+
+/*
+ * The functions below that take or give values must be those of the width
+ * the set was created with, or they return VTENC_ERR_CONFIG.
+ */
+
+/**
+ * vtenc_set_assign* functions.
+ *
+ * Functions to replace the values of @set with the strictly increasing
+ * sequence @values, which becomes its base with no edits.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_NOT_SORTED if @values isn't strictly
+ * increasing, VTENC_ERR_CONFIG if a compaction is in progress, or another error
+ * code otherwise. In case of error, @set is left as it was.
+ */
+int vtenc_set_assign8(vtenc_set *set, const uint8_t *values, size_t values_len);
+int vtenc_set_assign16(vtenc_set *set, const uint16_t *values, size_t values_len);
+int vtenc_set_assign32(vtenc_set *set, const uint32_t *values, size_t values_len);
+int vtenc_set_assign64(vtenc_set *set, const uint64_t *values, size_t values_len);
+
+/**
+ * vtenc_set_contains* functions.
+ *
+ * Functions to look @value up in @set. @found is set to 1 if it's there, or
+ * to 0 otherwise.
+ *
+ * Returns VTENC_OK on success or an error code otherwise.
+ */
+int vtenc_set_contains8(vtenc_set *set, uint8_t value, int *found);
+int vtenc_set_contains16(vtenc_set *set, uint16_t value, int *found);
+int vtenc_set_contains32(vtenc_set *set, uint32_t value, int *found);
+int vtenc_set_contains64(vtenc_set *set, uint64_t value, int *found);
+
+/**
+ * vtenc_set_insert* and vtenc_set_erase* functions.
+ *
+ * Functions to insert @value into @set, or erase it from @set. Inserting a
+ * value that is already there, or erasing one that isn't, does nothing.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_CONFIG if @value is out of the range
+ * of VTENC_CONFIG_BASE and VTENC_CONFIG_WIDTH, or another error code otherwise.
+ */
+int vtenc_set_insert8(vtenc_set *set, uint8_t value);
+int vtenc_set_insert16(vtenc_set *set, uint16_t value);
+int vtenc_set_insert32(vtenc_set *set, uint32_t value);
+int vtenc_set_insert64(vtenc_set *set, uint64_t value);
+int vtenc_set_erase8(vtenc_set *set, uint8_t value);
+int vtenc_set_erase16(vtenc_set *set, uint16_t value);
+int vtenc_set_erase32(vtenc_set *set, uint32_t value);
+int vtenc_set_erase64(vtenc_set *set, uint64_t value);
+
+/**
+ * vtenc_set_foreach* functions.
+ *
+ * Functions to call @fn with @opaque and every value of @set, in ascending
+ * order. @fn returns 0 to go on or any other value to stop.
+ *
+ * Returns VTENC_OK once all values are visited, VTENC_ERR_SINK if @fn stops the
+ * iteration, or another error code otherwise.
+ */
+int vtenc_set_foreach8(vtenc_set *set, int (*fn)(void *opaque, uint8_t value), void *opaque);
+int vtenc_set_foreach16(vtenc_set *set, int (*fn)(void *opaque, uint16_t value), void *opaque);
+int vtenc_set_foreach32(vtenc_set *set, int (*fn)(void *opaque, uint32_t value), void *opaque);
+int vtenc_set_foreach64(vtenc_set *set, int (*fn)(void *opaque, uint64_t value), void *opaque);
+
+/*
+ * Compaction of a set, in three steps:
+ * - vtenc_set_compact_begin() freezes the buffered edits, and starts a new
+ *   buffer for the edits to come.
+ * - vtenc_set_compact_run() builds the next base from the current one and the
+ *   frozen edits. Both stay untouched until the compaction ends, so this step
+ *   can run on another thread, while the set is still read and edited through
+ *   the rest of functions.
+ * - vtenc_set_compact_end() replaces the base with the next one, runs the
+ *   previous step first if needed, and drops the frozen edits.
+ * vtenc_set_compact() runs all of them, or the last one if a compaction is in
+ * progress.
+ *
+ * They return VTENC_OK on success, VTENC_ERR_CONFIG if they are called out of
+ * order, or another error code otherwise. If vtenc_set_compact_run() fails,
+ * the set is still valid and the step can be retried.
+ *
+ * vtenc_set_compact_end() and vtenc_set_compact() return VTENC_ERR_CONFIG,
+ * and leave the compaction as it is, while vtenc_set_compact_run() is still
+ * going on another thread. Join that thread before ending the compaction, or
+ * before destroying the set.
+ */
+int vtenc_set_compact_begin(vtenc_set *set);
+int vtenc_set_compact_run(vtenc_set *set);
+int vtenc_set_compact_end(vtenc_set *set);
+int vtenc_set_compact(vtenc_set *set);
+
+/*
+ * Appendable list of values, kept encoded.
+ *
+ * Values are appended to a tail, which is encoded to a new segment once it
+ * has as many values as a segment. Consecutive segments of similar length are
+ * merged with vtenc_concat* as they pile up, so that their number only grows
+ * with the logarithm of the length of the log. Reads go through all segments
+ * and the tail, in order.
+ *
+ * The functions of a log can't be called concurrently, except for
+ * vtenc_log_merge_run().
+ */
+typedef struct vtenc_log vtenc_log;
+
+/**
+ * vtenc_log_create* functions.
+ *
+ * Functions to create an empty log, whose segments are encoded with the
+ * parameters of @handler, which are copied.
+ *
+ * @segment_len: number of values of a new segment, or 0 for the default of
+ *  1024.
+ * @auto_merge: 1 to make appends begin a merge when there are segments to
+ *  merge, or 0 to only begin it explicitly. Either way, running and ending
+ *  the merge is left to the caller, see vtenc_log_merging().
+ *
+ * Returns the new log, or NULL if there isn't enough memory.
+ */
+vtenc_log *vtenc_log_create8(vtenc *handler, size_t segment_len, int auto_merge);
+vtenc_log *vtenc_log_create16(vtenc *handler, size_t segment_len, int auto_merge);
+vtenc_log *vtenc_log_create32(vtenc *handler, size_t segment_len, int auto_merge);
+vtenc_log *vtenc_log_create64(vtenc *handler, size_t segment_len, int auto_merge);
+
+/* Destroy a log */
+void vtenc_log_destroy(vtenc_log *log);
+
+/* Number of values of a log */
+size_t vtenc_log_len(const vtenc_log *log);
+
+/* Number of encoded segments of a log */
+size_t vtenc_log_segments(const vtenc_log *log);
+
+/*
+ * Returns 1 if a merge of the segments of @log is in progress, begun
+ * explicitly or by an append, or 0 otherwise. That's when
+ * vtenc_log_merge_run() can be called on another thread, and
+ * vtenc_log_merge_end() once it's done.
+ */
+int vtenc_log_merging(const vtenc_log *log);
+
+/*
+ * The functions below that take or give values must be those of the width
+ * the log was created with, or they return VTENC_ERR_CONFIG.
+ */
+
+/**
+ * vtenc_log_append* functions.
+ *
+ * Functions to append the sorted sequence @values to @log. Its values can't
+ * be lower than the last one of @log, or equal if repeated values aren't
+ * allowed.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_NOT_SORTED if the values are out of
+ * order, in which case none is appended, VTENC_ERR_CONFIG if a value is out
+ * of the range of VTENC_CONFIG_BASE and VTENC_CONFIG_WIDTH, or another error
+ * code otherwise. In case of error, the number of values that were appended
+ * is given by vtenc_log_len().
+ */
+int vtenc_log_append8(vtenc_log *log, const uint8_t *values, size_t values_len);
+int vtenc_log_append16(vtenc_log *log, const uint16_t *values, size_t values_len);
+int vtenc_log_append32(vtenc_log *log, const uint32_t *values, size_t values_len);
+int vtenc_log_append64(vtenc_log *log, const uint64_t *values, size_t values_len);
+
+/**
+ * vtenc_log_foreach* functions.
+ *
+ * Functions to call @fn with @opaque and every value of @log, in order. @fn
+ * returns 0 to go on or any other value to stop.
+ *
+ * Returns VTENC_OK once all values are visited, VTENC_ERR_SINK if @fn stops the
+ * iteration, or another error code otherwise.
+ */
+int vtenc_log_foreach8(vtenc_log *log, int (*fn)(void *opaque, uint8_t value), void *opaque);
+int vtenc_log_foreach16(vtenc_log *log, int (*fn)(void *opaque, uint16_t value), void *opaque);
+int vtenc_log_foreach32(vtenc_log *log, int (*fn)(void *opaque, uint32_t value), void *opaque);
+int vtenc_log_foreach64(vtenc_log *log, int (*fn)(void *opaque, uint64_t value), void *opaque);
+
+/**
+ * vtenc_log_decode* functions.
+ *
+ * Functions to decode the @out_len values of @log from position @from on into
+ * @out. Only the segments that hold them are decoded, and the last one only
+ * up to the last of them.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_CONFIG if the values are past the end
+ * of @log, or another error code otherwise.
+ */
+int vtenc_log_decode8(vtenc_log *log, size_t from, uint8_t *out, size_t out_len);
+int vtenc_log_decode16(vtenc_log *log, size_t from, uint16_t *out, size_t out_len);
+int vtenc_log_decode32(vtenc_log *log, size_t from, uint32_t *out, size_t out_len);
+int vtenc_log_decode64(vtenc_log *log, size_t from, uint64_t *out, size_t out_len);
+
+/*
+ * Merging of the segments of a log, in three steps:
+ * - vtenc_log_merge_begin() picks the next segments to merge, if any.
+ * - vtenc_log_merge_run() merges them into a new segment. They stay in the log
+ *   until the merge ends, so this step can run on another thread, while the
+ *   log is still read and appended to through the rest of functions.
+ * - vtenc_log_merge_end() replaces them with the new segment, and runs the
+ *   previous step first if needed.
+ * vtenc_log_merge() finishes the merge in progress, if any, and then merges
+ * segments as long as there are some to merge.
+ *
+ * They return VTENC_OK on success, VTENC_ERR_CONFIG if they are called out of
+ * order, or another error code otherwise. If vtenc_log_merge_run() fails, the
+ * log is still valid and the step can be retried.
+ *
+ * vtenc_log_merge_end() and vtenc_log_merge() return VTENC_ERR_CONFIG, and
+ * leave the merge as it is, while vtenc_log_merge_run() is still going on
+ * another thread. Join that thread before ending the merge, or before
+ * destroying the log.
+ */
+int vtenc_log_merge_begin(vtenc_log *log);
+int vtenc_log_merge_run(vtenc_log *log);
+int vtenc_log_merge_end(vtenc_log *log);
+int vtenc_log_merge(vtenc_log *log);
+
+/**
+ * vtenc_postings_max_encoded_size* functions.
+ *
+ * Functions to get the maximum size of the output of vtenc_postings_encode*
+ * for @in_len postings.
+ */
+size_t vtenc_postings_max_encoded_size8(size_t in_len);
+size_t vtenc_postings_max_encoded_size16(size_t in_len);
+size_t vtenc_postings_max_encoded_size32(size_t in_len);
+size_t vtenc_postings_max_encoded_size64(size_t in_len);
+
+/**
+ * vtenc_postings_encode* functions.
+ *
+ * Functions to encode a posting list: the sorted sequence of ids @ids, each
+ * with the payload of the same position of @payloads, e.g. a term frequency.
+ *
+ * Postings are encoded in blocks of 128. The ids of a block are encoded as
+ * vtenc_encode* would, and followed by its payloads, in the same order,
+ * bit-packed with the width of the largest one. Every block starts with its
+ * last id and its size, so that vtenc_postings_next_geq* can skip it, and any
+ * of its payloads can be read without reading the rest.
+ *
+ * @enc: encoder. Provides the encoding parameters of the ids.
+ * @ids: input sequence of ids.
+ * @payloads: input sequence of payloads.
+ * @in_len: number of postings.
+ * @out: output stream of bytes.
+ * @out_cap: capacity of @out, which is enough if it's that given by
+ *  vtenc_postings_max_encoded_size*.
+ *
+ * Returns VTENC_OK on success or an error code otherwise. On success, the size
+ * of @out is given by vtenc_encoded_size().
+ */
+int vtenc_postings_encode8(vtenc *enc, const uint8_t *ids, const uint32_t *payloads, size_t in_len, uint8_t *out, size_t out_cap);
+int vtenc_postings_encode16(vtenc *enc, const uint16_t *ids, const uint32_t *payloads, size_t in_len, uint8_t *out, size_t out_cap);
+int vtenc_postings_encode32(vtenc *enc, const uint32_t *ids, const uint32_t *payloads, size_t in_len, uint8_t *out, size_t out_cap);
+int vtenc_postings_encode64(vtenc *enc, const uint64_t *ids, const uint32_t *payloads, size_t in_len, uint8_t *out, size_t out_cap);
+
+/**
+ * vtenc_postings_decode* functions.
+ *
+ * Functions to decode the @out_len postings of the stream of bytes @in, as
+ * encoded by vtenc_postings_encode*, into @ids and @payloads.
+ *
+ * Returns VTENC_OK on success or an error code otherwise.
+ */
+int vtenc_postings_decode8(vtenc *dec, const uint8_t *in, size_t in_len, uint8_t *ids, uint32_t *payloads, size_t out_len);
+int vtenc_postings_decode16(vtenc *dec, const uint8_t *in, size_t in_len, uint16_t *ids, uint32_t *payloads, size_t out_len);
+int vtenc_postings_decode32(vtenc *dec, const uint8_t *in, size_t in_len, uint32_t *ids, uint32_t *payloads, size_t out_len);
+int vtenc_postings_decode64(vtenc *dec, const uint8_t *in, size_t in_len, uint64_t *ids, uint32_t *payloads, size_t out_len);
+
+/* Cursor over a posting list */
+typedef struct vtenc_postings_cursor vtenc_postings_cursor;
+
+/**
+ * vtenc_postings_cursor_create* functions.
+ *
+ * Functions to create a cursor over the @values_len postings of the stream of
+ * bytes @in, as encoded by vtenc_postings_encode* with the parameters of
+ * @dec, which are copied. @in must outlive the cursor.
+ *
+ * Returns the new cursor, or NULL if there isn't enough memory.
+ */
+vtenc_postings_cursor *vtenc_postings_cursor_create8(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len);
+vtenc_postings_cursor *vtenc_postings_cursor_create16(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len);
+vtenc_postings_cursor *vtenc_postings_cursor_create32(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len);
+vtenc_postings_cursor *vtenc_postings_cursor_create64(vtenc *dec, const uint8_t *in, size_t in_len, size_t values_len);
+
+/* Destroy a cursor over a posting list */
+void vtenc_postings_cursor_destroy(vtenc_postings_cursor *cursor);
+
+/**
+ * vtenc_postings_next_geq* functions.
+ *
+ * Functions to move @cursor to the first posting whose id isn't lower than
+ * @target, from the current one on. Targets are meant to come in ascending
+ * order, as in the intersection of posting lists, and the postings that
+ * @cursor has moved past aren't considered again.
+ *
+ * The blocks whose last id is lower than @target are skipped by their header,
+ * and only the ids of the block that holds the posting are decoded, once. Its
+ * payload is read on its own.
+ *
+ * @pos: output position of the posting, or the number of postings if there's
+ *  none, in which case @id and @payload aren't written.
+ * @id: output id of the posting.
+ * @payload: output payload of the posting.
+ *
+ * Returns VTENC_OK on success, VTENC_ERR_CONFIG if @cursor was created for
+ * another width, or another error code otherwise.
+ */
+int vtenc_postings_next_geq8(vtenc_postings_cursor *cursor, uint8_t target, size_t *pos, uint8_t *id, uint32_t *payload);
+int vtenc_postings_next_geq16(vtenc_postings_cursor *cursor, uint16_t target, size_t *pos, uint16_t *id, uint32_t *payload);
+int vtenc_postings_next_geq32(vtenc_postings_cursor *cursor, uint32_t target, size_t *pos, uint32_t *id, uint32_t *payload);
+int vtenc_postings_next_geq64(vtenc_postings_cursor *cursor, uint64_t target, size_t *pos, uint64_t *id, uint32_t *payload);
+
 #ifdef __cplusplus
 }
 #endif